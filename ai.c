@@ -0,0 +1,152 @@
+#include "ai.h"
+#include "collide.h"
+#include "level.h"
+#include <math.h>
+
+// Position along [lo, hi] after bouncing between both ends, for a point that
+// would be at y with no walls. Returns the number of walls hit on the way.
+static float FoldY(float y, float lo, float hi, int *bounces) {
+    float span = hi - lo;
+    if (span <= 0.0f) return lo;
+
+    float offset = y - lo;
+    float period = floorf(offset / span);
+    float m = offset - period * span;
+    *bounces += (int)fabsf(period);
+    return ((int)period % 2 == 0) ? lo + m : hi - m;
+}
+
+// Any obstacle between the ball and the paddle face, with the ball radius around it
+static bool ObstaclesAhead(const SimState *state, float fromX, float toX) {
+    float radius = state->config.ballRadius;
+    float lo = fminf(fromX, toX), hi = fmaxf(fromX, toX);
+    for (int i = 0; i < state->obstacleCount; i++) {
+        const SimRect *box = &state->obstacles[i];
+        if (box->x + box->width + radius >= lo && box->x - radius <= hi) return true;
+    }
+    const Level *level = state->config.level;
+    if (level != NULL && level->nodeCount > 0) {
+        const SimRect *box = &level->nodes[0].bounds;
+        if (box->x + box->width + radius >= lo && box->x - radius <= hi) return true;
+    }
+    return false;
+}
+
+AiPrediction AiPredict(const SimState *state, SimSide side) {
+    const SimConfig *config = &state->config;
+    const float radius = config->ballRadius;
+    const SimRect *paddle = (side == SIDE_LAVA) ? &state->leftPaddle : &state->rightPaddle;
+    const float direction = (side == SIDE_LAVA) ? -1.0f : 1.0f;
+    const float faceX = (side == SIDE_LAVA) ? paddle->x + paddle->width + radius : paddle->x - radius;
+    const float top = radius, bottom = config->height - radius;
+
+    AiPrediction prediction = { false, config->height / 2.0f, 0.0f, 0 };
+    SimVec2 position = state->ballPosition;
+    SimVec2 speed = state->ballSpeed;
+
+    for (int leg = 0; leg < AI_MAX_LEGS; leg++) {
+        if (speed.x * direction <= 0.0f) return prediction;   // Heading away
+        float timeToFace = fmaxf((faceX - position.x) / speed.x, 0.0f);
+
+        // Open field to the paddle: fold the straight line between the walls in one go
+        if (!ObstaclesAhead(state, position.x, faceX)) {
+            prediction.incoming = true;
+            prediction.y = FoldY(position.y + speed.y * timeToFace, top, bottom, &prediction.bounces);
+            prediction.time += timeToFace;
+            return prediction;
+        }
+
+        // Otherwise walk one straight leg: up to the next wall, obstacle or the face
+        float legTime = timeToFace;
+        float wallTime;
+        SimVec2 normal = { 0, 0 };
+        float depth = 0.0f;
+        bool wall = false, box = false, mirror = false;
+        SweepHit hit;
+        int shape;
+        if (SweepPlane(position.y, speed.y, bottom, true, legTime, &wallTime) ||
+            SweepPlane(position.y, speed.y, top, false, legTime, &wallTime)) {
+            legTime = wallTime;
+            wall = true;
+        }
+        for (int i = 0; i < state->obstacleCount; i++) {
+            if (SweepCircleRect(position, speed, radius, state->obstacles[i], legTime, &hit) && hit.time <= legTime) {
+                legTime = hit.time;
+                normal = hit.normal;
+                depth = hit.depth;
+                box = true;
+                wall = false;
+            }
+        }
+        if (config->level != NULL && LevelSweep(config->level, position, speed, radius, legTime, &hit, &shape) && hit.time <= legTime) {
+            legTime = hit.time;
+            normal = hit.normal;
+            depth = hit.depth;
+            box = true;
+            wall = false;
+            mirror = config->level->shapes[shape].type != LEVEL_RECT;
+        }
+
+        position.x += speed.x * legTime + normal.x * depth;
+        position.y += speed.y * legTime + normal.y * depth;
+        prediction.time += legTime;
+        if (!wall && !box) {
+            prediction.incoming = true;
+            prediction.y = position.y;
+            return prediction;
+        }
+
+        // Same response as the simulation (see BounceOffBox in sim.c)
+        prediction.bounces++;
+        if (wall) {
+            speed.y = -speed.y;
+        } else if (mirror) {
+            float along = speed.x * normal.x + speed.y * normal.y;
+            if (along < 0.0f) {
+                speed.x -= 2.0f * along * normal.x;
+                speed.y -= 2.0f * along * normal.y;
+            }
+        } else if (fabsf(normal.x) >= fabsf(normal.y)) {
+            speed.x = fabsf(speed.x) * (normal.x > 0 ? 1.0f : -1.0f);
+            if (speed.x * normal.x + speed.y * normal.y < 0) speed.y = -speed.y;
+        } else {
+            speed.y = fabsf(speed.y) * (normal.y > 0 ? 1.0f : -1.0f);
+            if (speed.x * normal.x + speed.y * normal.y < 0) speed.x = -speed.x;
+        }
+    }
+    return prediction;
+}
+
+void AiReset(AiBrain *brain, const SimConfig *config) {
+    *brain = (AiBrain){ 0 };
+    brain->skill = (AiSkill){ config->aiSpeed, config->aiReaction, config->aiError };
+    brain->targetY = config->height / 2.0f;
+    brain->pendingY = brain->targetY;
+    brain->seenScore = -1;
+}
+
+float AiUpdate(SimState *state, AiBrain *brain, SimSide side) {
+    const SimConfig *config = &state->config;
+    int score = state->leftScore + state->rightScore;
+
+    // The ball path only changes when it hits something or is served, otherwise the cached prediction stands
+    if (state->ballSpeed.x != brain->seenSpeed.x || state->ballSpeed.y != brain->seenSpeed.y || score != brain->seenScore) {
+        AiPrediction prediction = AiPredict(state, side);
+        bool newShot = (state->ballSpeed.x > 0) != (brain->seenSpeed.x > 0) || score != brain->seenScore;
+        if (newShot && prediction.incoming) {
+            // One misjudgement per shot, larger for long shots. Wall bounces refine the
+            // path but keep the same error, otherwise the last bounce would fix every miss.
+            float unit = (float)SimRandom(state) * (1.0f / 4294967296.0f);
+            brain->aimError = (unit * 2.0f - 1.0f) * brain->skill.error * fminf(prediction.time, 1.0f);
+        }
+        // Wait in the middle while the ball is going away
+        brain->pendingY = prediction.incoming ? prediction.y + brain->aimError : config->height / 2.0f;
+        brain->reactTick = state->tick + (uint32_t)(brain->skill.reaction * config->tickRate);
+        brain->seenSpeed = state->ballSpeed;
+        brain->seenScore = score;
+        brain->predictions++;
+    }
+
+    if (state->tick >= brain->reactTick) brain->targetY = brain->pendingY;
+    return brain->targetY;
+}
@@ -0,0 +1,31 @@
+#ifndef AI_H
+#define AI_H
+
+#include "sim.h"
+#include <stdbool.h>
+
+// Computer opponent. Instead of chasing the ball it solves where the ball will
+// cross its paddle face, following bounces off the top and bottom walls and
+// the center obstacles. The answer only changes when the ball hits something,
+// so it is computed once per bounce and cached in the AiBrain.
+
+#define AI_MAX_LEGS 16   // Straight segments traced before giving up on a prediction
+
+typedef struct AiPrediction {
+    bool incoming;   // Ball is heading for this paddle
+    float y;         // Ball center when it reaches the paddle face
+    float time;      // Seconds until then
+    int bounces;     // Walls and obstacles hit on the way
+} AiPrediction;
+
+// Trace the current ball path to the face of the paddle on side
+AiPrediction AiPredict(const SimState *state, SimSide side);
+
+// Forget any cached prediction, return to the center and take the skill from config
+void AiReset(AiBrain *brain, const SimConfig *config);
+
+// Paddle center the computer wants this step. Re-predicts after a bounce or serve
+// and applies the difficulty's reaction delay and aim error.
+float AiUpdate(SimState *state, AiBrain *brain, SimSide side);
+
+#endif // AI_H
@@ -0,0 +1,489 @@
+#include "arena.h"
+#include "collide.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Keep obstacles this far apart and out of the serve area, so balls never wedge in a gap
+#define OBSTACLE_GAP_BALLS 2.0f
+#define SERVE_CLEAR 80.0f
+
+// xorshift64* mapped to [0, 1)
+static float RandomUnit(uint64_t *rng) {
+    uint64_t x = *rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *rng = x;
+    return (float)((x * 0x2545F4914F6CDD1DULL) >> 40) * (1.0f / 16777216.0f);
+}
+
+static float RandomRange(uint64_t *rng, float low, float high) {
+    return low + RandomUnit(rng) * (high - low);
+}
+
+ArenaConfig ArenaDefaultConfig(Difficulty difficulty, float width, float height) {
+    ArenaConfig config = { 0 };
+    config.sim = SimDifficultyConfig(difficulty, width, height);
+    config.balls = ARENA_DEFAULT_BALLS;
+    config.obstacles = ARENA_DEFAULT_OBSTACLES;
+    config.radius = 5.0f;
+    config.seconds = 60.0f;
+    return config;
+}
+
+static int CellColumn(const Arena *arena, float x) {
+    int column = (int)(x / arena->cellSize);
+    if (column < 0) return 0;
+    return column < arena->columns ? column : arena->columns - 1;
+}
+
+static int CellRow(const Arena *arena, float y) {
+    int row = (int)(y / arena->cellSize);
+    if (row < 0) return 0;
+    return row < arena->rows ? row : arena->rows - 1;
+}
+
+static bool RectsOverlap(SimRect a, SimRect b, float margin) {
+    return a.x < b.x + b.width + margin && b.x < a.x + a.width + margin &&
+           a.y < b.y + b.height + margin && b.y < a.y + a.height + margin;
+}
+
+// Scatter obstacles between the paddle lanes, clear of each other and of the serve area
+static void PlaceObstacles(Arena *arena, int wanted) {
+    const SimConfig *sim = &arena->config.sim;
+    const float gap = OBSTACLE_GAP_BALLS * 2.0f * arena->config.radius;
+    const SimRect serve = { sim->width / 2 - SERVE_CLEAR, sim->height / 2 - SERVE_CLEAR, 2 * SERVE_CLEAR, 2 * SERVE_CLEAR };
+    const float lane = arena->rightPaddle.x - (arena->leftPaddle.x + arena->leftPaddle.width);
+
+    for (int attempt = 0; attempt < wanted * 50 && arena->obstacleCount < wanted; attempt++) {
+        // Same shape as the center obstacles of a normal match, standing or lying down
+        float length = RandomRange(&arena->rng, 20.0f, 60.0f);
+        bool standing = RandomUnit(&arena->rng) < 0.5f;
+        SimRect box = { 0, 0, standing ? 20.0f : length, standing ? length : 20.0f };
+        box.x = arena->leftPaddle.x + arena->leftPaddle.width + gap + RandomUnit(&arena->rng) * (lane - 2 * gap - box.width);
+        box.y = RandomUnit(&arena->rng) * (sim->height - box.height);
+
+        bool clear = !RectsOverlap(box, serve, 0.0f);
+        for (int i = 0; i < arena->obstacleCount && clear; i++) {
+            clear = !RectsOverlap(box, arena->obstacles[i], gap);
+        }
+        if (clear) arena->obstacles[arena->obstacleCount++] = box;
+    }
+}
+
+// Bucket the obstacles into every grid cell they cover, same layout as the balls
+static bool BuildObstacleGrid(Arena *arena) {
+    int cells = arena->columns * arena->rows;
+    int entries = 0;
+    for (int i = 0; i < arena->obstacleCount; i++) {
+        SimRect box = arena->obstacles[i];
+        int columns = CellColumn(arena, box.x + box.width) - CellColumn(arena, box.x) + 1;
+        int rows = CellRow(arena, box.y + box.height) - CellRow(arena, box.y) + 1;
+        entries += columns * rows;
+    }
+
+    arena->obstacleStart = calloc((size_t)cells + 1, sizeof(int));
+    arena->obstacleItems = malloc(sizeof(int) * (size_t)(entries > 0 ? entries : 1));
+    if (arena->obstacleStart == NULL || arena->obstacleItems == NULL) return false;
+
+    // Count, prefix sum, then fill. Filling advances each start to the next cell's, shift them back after.
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < arena->obstacleCount; i++) {
+            SimRect box = arena->obstacles[i];
+            for (int row = CellRow(arena, box.y); row <= CellRow(arena, box.y + box.height); row++) {
+                for (int column = CellColumn(arena, box.x); column <= CellColumn(arena, box.x + box.width); column++) {
+                    int cell = row * arena->columns + column;
+                    if (pass == 0) arena->obstacleStart[cell]++;
+                    else arena->obstacleItems[arena->obstacleStart[cell]++] = i;
+                }
+            }
+        }
+        if (pass == 0) {
+            int sum = 0;
+            for (int cell = 0; cell < cells; cell++) {
+                int count = arena->obstacleStart[cell];
+                arena->obstacleStart[cell] = sum;
+                sum += count;
+            }
+        }
+    }
+    for (int cell = cells; cell > 0; cell--) arena->obstacleStart[cell] = arena->obstacleStart[cell - 1];
+    arena->obstacleStart[0] = 0;
+    return true;
+}
+
+static bool OverlapsObstacle(const Arena *arena, SimVec2 center, float radius) {
+    int firstColumn = CellColumn(arena, center.x - radius), lastColumn = CellColumn(arena, center.x + radius);
+    int firstRow = CellRow(arena, center.y - radius), lastRow = CellRow(arena, center.y + radius);
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            int cell = row * arena->columns + column;
+            for (int k = arena->obstacleStart[cell]; k < arena->obstacleStart[cell + 1]; k++) {
+                if (CircleRectOverlap(center, radius, arena->obstacles[arena->obstacleItems[k]])) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Mostly horizontal, so a fresh ball heads for a goal rather than bouncing between the walls
+static void RandomVelocity(Arena *arena, int i) {
+    float speed = arena->config.sim.serveSpeed;
+    arena->vx[i] = speed * (RandomUnit(&arena->rng) < 0.5f ? -1.0f : 1.0f);
+    arena->vy[i] = RandomRange(&arena->rng, -speed, speed);
+}
+
+bool ArenaInit(Arena *arena, ArenaConfig config, uint64_t seed) {
+    const SimConfig *sim = &config.sim;
+    const size_t floats = sizeof(float) * (size_t)config.balls;
+
+    *arena = (Arena){ 0 };
+    arena->config = config;
+    arena->rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    arena->leftPaddle = (SimRect){ 50, sim->height / 2 - sim->paddleHeight / 2, 20, sim->paddleHeight };
+    arena->rightPaddle = (SimRect){ sim->width - 70, sim->height / 2 - sim->paddleHeight / 2, 20, sim->paddleHeight };
+
+    // Diameter-sized cells, but not so small that the grid outgrows the ball count on a big field
+    arena->cellSize = fmaxf(2.0f * config.radius, 8.0f);
+    arena->columns = (int)ceilf(sim->width / arena->cellSize);
+    arena->rows = (int)ceilf(sim->height / arena->cellSize);
+    int cells = arena->columns * arena->rows;
+
+    arena->block = malloc(floats * 5 + sizeof(int) * (size_t)config.balls);
+    arena->cellStart = calloc((size_t)cells + 1, sizeof(int));
+    arena->obstacles = malloc(sizeof(SimRect) * (size_t)(config.obstacles > 0 ? config.obstacles : 1));
+    if (arena->block == NULL || arena->cellStart == NULL || arena->obstacles == NULL) {
+        ArenaFree(arena);
+        return false;
+    }
+    char *memory = (char *)arena->block;
+    arena->x = (float *)(memory + floats * 0);
+    arena->y = (float *)(memory + floats * 1);
+    arena->vx = (float *)(memory + floats * 2);
+    arena->vy = (float *)(memory + floats * 3);
+    arena->scratch = (float *)(memory + floats * 4);
+    arena->ballSlot = (int *)(memory + floats * 5);
+
+    PlaceObstacles(arena, config.obstacles);
+    if (!BuildObstacleGrid(arena)) {
+        ArenaFree(arena);
+        return false;
+    }
+
+    // Anywhere off the obstacles and paddles, balls that land on each other get pushed apart in the first steps
+    const float radius = config.radius;
+    const float left = arena->leftPaddle.x + arena->leftPaddle.width + radius;
+    const float right = arena->rightPaddle.x - radius;
+    for (int i = 0; i < config.balls; i++) {
+        SimVec2 position;
+        int tries = 0;
+        do {
+            position.x = RandomRange(&arena->rng, left, right);
+            position.y = RandomRange(&arena->rng, radius, sim->height - radius);
+        } while (OverlapsObstacle(arena, position, radius) && ++tries < 32);
+        arena->x[i] = position.x;
+        arena->y[i] = position.y;
+        RandomVelocity(arena, i);
+    }
+    arena->ballCount = config.balls;
+    return true;
+}
+
+void ArenaFree(Arena *arena) {
+    free(arena->block);
+    free(arena->cellStart);
+    free(arena->obstacles);
+    free(arena->obstacleStart);
+    free(arena->obstacleItems);
+    *arena = (Arena){ 0 };
+}
+
+// Ball crossing the paddle face soonest, the computer paddle heads for where it is now
+static float ChaseBall(const Arena *arena, SimSide side) {
+    const SimRect *paddle = (side == SIDE_LAVA) ? &arena->leftPaddle : &arena->rightPaddle;
+    float face = (side == SIDE_LAVA) ? paddle->x + paddle->width : paddle->x;
+    float best = INFINITY;
+    float target = arena->config.sim.height / 2;
+
+    for (int i = 0; i < arena->ballCount; i++) {
+        float vx = arena->vx[i];
+        if ((side == SIDE_LAVA) ? vx >= 0.0f : vx <= 0.0f) continue;
+        float time = (face - arena->x[i]) / vx;
+        if (time >= 0.0f && time < best) {
+            best = time;
+            target = arena->y[i];
+        }
+    }
+    return target;
+}
+
+static void MoveArenaPaddle(Arena *arena, SimSide side, SimPaddleInput input, float dt) {
+    const SimConfig *sim = &arena->config.sim;
+    SimRect *paddle = (side == SIDE_LAVA) ? &arena->leftPaddle : &arena->rightPaddle;
+    if (input.ai) {
+        float target = ChaseBall(arena, side) - paddle->height / 2;
+        float step = sim->aiSpeed * dt;
+        if (paddle->y < target) paddle->y = fminf(paddle->y + step, target);
+        else paddle->y = fmaxf(paddle->y - step, target);
+    } else if (input.useTarget) {
+        paddle->y = input.targetY - paddle->height / 2;
+    } else {
+        paddle->y += input.move * sim->paddleSpeed * dt;
+    }
+    if (paddle->y < 0) paddle->y = 0;
+    if (paddle->y + paddle->height > sim->height) paddle->y = sim->height - paddle->height;
+}
+
+// What one ball runs into first during a step
+typedef enum ArenaContact {
+    ARENA_NONE,
+    ARENA_PADDLE,
+    ARENA_OBSTACLE,
+    ARENA_WALL,
+    ARENA_LAVA_GOAL,   // Right edge, point for Lava
+    ARENA_ICE_GOAL     // Left edge, point for Ice
+} ArenaContact;
+
+// Swept move of ball i through one step, like MoveBall in sim.c but with the
+// obstacles taken from the grid cells the motion covers
+static unsigned int MoveArenaBall(Arena *arena, int i, float dt) {
+    const SimConfig *sim = &arena->config.sim;
+    const float radius = arena->config.radius;
+    float remaining = 1.0f;
+    unsigned int events = 0;
+
+    for (int bounce = 0; bounce < ARENA_MAX_BOUNCES && remaining > 0.0f; bounce++) {
+        SimVec2 position = { arena->x[i], arena->y[i] };
+        SimVec2 motion = { arena->vx[i] * dt * remaining, arena->vy[i] * dt * remaining };
+        ArenaContact contact = ARENA_NONE;
+        SweepHit first = { 1.0f, { 0, 0 }, 0.0f };
+        SweepHit hit;
+        float time;
+
+        if (SweepCircleRect(position, motion, radius, arena->leftPaddle, first.time, &hit)) {
+            first = hit;
+            contact = ARENA_PADDLE;
+        }
+        if (SweepCircleRect(position, motion, radius, arena->rightPaddle, first.time, &hit) &&
+            (contact == ARENA_NONE || hit.time < first.time)) {
+            first = hit;
+            contact = ARENA_PADDLE;
+        }
+
+        float endX = position.x + motion.x, endY = position.y + motion.y;
+        int firstColumn = CellColumn(arena, fminf(position.x, endX) - radius);
+        int lastColumn = CellColumn(arena, fmaxf(position.x, endX) + radius);
+        int firstRow = CellRow(arena, fminf(position.y, endY) - radius);
+        int lastRow = CellRow(arena, fmaxf(position.y, endY) + radius);
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int column = firstColumn; column <= lastColumn; column++) {
+                int cell = row * arena->columns + column;
+                for (int k = arena->obstacleStart[cell]; k < arena->obstacleStart[cell + 1]; k++) {
+                    arena->stats.obstacleTests++;
+                    if (SweepCircleRect(position, motion, radius, arena->obstacles[arena->obstacleItems[k]], first.time, &hit) &&
+                        (contact == ARENA_NONE || hit.time < first.time)) {
+                        first = hit;
+                        contact = ARENA_OBSTACLE;
+                    }
+                }
+            }
+        }
+
+        // Walls, then goal lines
+        if (SweepPlane(position.y, motion.y, sim->height - radius, true, first.time, &time) &&
+            (contact == ARENA_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, -1 }, 0.0f };
+            contact = ARENA_WALL;
+        }
+        if (SweepPlane(position.y, motion.y, radius, false, first.time, &time) &&
+            (contact == ARENA_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, 1 }, 0.0f };
+            contact = ARENA_WALL;
+        }
+        if (SweepPlane(position.x, motion.x, sim->width - radius, true, first.time, &time) &&
+            (contact == ARENA_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, 0 }, 0.0f };
+            contact = ARENA_LAVA_GOAL;
+        }
+        if (SweepPlane(position.x, motion.x, radius, false, first.time, &time) &&
+            (contact == ARENA_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, 0 }, 0.0f };
+            contact = ARENA_ICE_GOAL;
+        }
+
+        arena->x[i] = position.x + motion.x * first.time + first.normal.x * first.depth;
+        arena->y[i] = position.y + motion.y * first.time + first.normal.y * first.depth;
+        remaining *= 1.0f - first.time;
+
+        if (contact == ARENA_NONE) break;
+        if (contact == ARENA_LAVA_GOAL || contact == ARENA_ICE_GOAL) {
+            // Serve it again from the middle, the grid picks it up there
+            if (contact == ARENA_LAVA_GOAL) arena->leftScore++;
+            else arena->rightScore++;
+            events |= (contact == ARENA_LAVA_GOAL) ? SIM_EVENT_LAVA_SCORED : SIM_EVENT_ICE_SCORED;
+            arena->x[i] = sim->width / 2 + RandomRange(&arena->rng, -SERVE_CLEAR, SERVE_CLEAR) / 2;
+            arena->y[i] = sim->height / 2 + RandomRange(&arena->rng, -SERVE_CLEAR, SERVE_CLEAR) / 2;
+            RandomVelocity(arena, i);
+            break;
+        }
+
+        // Mirror the velocity about the contact normal
+        float along = arena->vx[i] * first.normal.x + arena->vy[i] * first.normal.y;
+        if (along < 0.0f) {
+            arena->vx[i] -= 2.0f * along * first.normal.x;
+            arena->vy[i] -= 2.0f * along * first.normal.y;
+        }
+        if (contact == ARENA_PADDLE) {
+            arena->vy[i] += (arena->vy[i] > 0 ? sim->hitBoost : -sim->hitBoost);
+            events |= SIM_EVENT_PADDLE_HIT;
+        } else {
+            events |= (contact == ARENA_WALL) ? SIM_EVENT_WALL_HIT : SIM_EVENT_OBSTACLE_HIT;
+        }
+    }
+
+    // Ball-ball contacts trade speed around, keep every ball within the preset's limits
+    const float maxSpeed = sim->maxSpeed;
+    arena->vx[i] = fminf(fmaxf(arena->vx[i], -maxSpeed), maxSpeed);
+    arena->vy[i] = fminf(fmaxf(arena->vy[i], -maxSpeed), maxSpeed);
+    return events;
+}
+
+// Counting sort of the balls by cell: each cell's balls end up contiguous and
+// cellStart indexes them. The arrays are permuted through the scratch array.
+static void SortBalls(Arena *arena) {
+    const int count = arena->ballCount;
+    const int cells = arena->columns * arena->rows;
+    int *restrict start = arena->cellStart;
+    int *restrict slot = arena->ballSlot;
+
+    for (int cell = 0; cell <= cells; cell++) start[cell] = 0;
+    for (int i = 0; i < count; i++) {
+        slot[i] = CellRow(arena, arena->y[i]) * arena->columns + CellColumn(arena, arena->x[i]);
+        start[slot[i]]++;
+    }
+    int sum = 0;
+    for (int cell = 0; cell < cells; cell++) {
+        int balls = start[cell];
+        start[cell] = sum;
+        sum += balls;
+    }
+    for (int i = 0; i < count; i++) slot[i] = start[slot[i]]++;
+    for (int cell = cells; cell > 0; cell--) start[cell] = start[cell - 1];
+    start[0] = 0;
+
+    float **arrays[4] = { &arena->x, &arena->y, &arena->vx, &arena->vy };
+    for (int a = 0; a < 4; a++) {
+        float *restrict from = *arrays[a];
+        float *restrict to = arena->scratch;
+        for (int i = 0; i < count; i++) to[slot[i]] = from[i];
+        arena->scratch = from;
+        *arrays[a] = to;
+    }
+}
+
+// Check ball i against the balls [first, last), pushing touching pairs apart and
+// trading their speed along the contact normal (equal masses, elastic)
+static int CollideRange(Arena *arena, int i, int first, int last, bool resolve) {
+    float *restrict x = arena->x;
+    float *restrict y = arena->y;
+    float *restrict vx = arena->vx;
+    float *restrict vy = arena->vy;
+    const float diameter = 2.0f * arena->config.radius;
+    int contacts = 0;
+
+    arena->stats.pairTests += (uint64_t)(last - first);
+    for (int j = first; j < last; j++) {
+        float dx = x[j] - x[i];
+        float dy = y[j] - y[i];
+        float distanceSq = dx * dx + dy * dy;
+        if (distanceSq >= diameter * diameter) continue;
+        contacts++;
+        if (!resolve) continue;
+
+        float distance = sqrtf(distanceSq);
+        float nx = 1.0f, ny = 0.0f;
+        if (distance > 0.0f) {
+            nx = dx / distance;
+            ny = dy / distance;
+        }
+        float push = (diameter - distance) * 0.5f;
+        x[i] -= nx * push;
+        y[i] -= ny * push;
+        x[j] += nx * push;
+        y[j] += ny * push;
+
+        float closing = (vx[j] - vx[i]) * nx + (vy[j] - vy[i]) * ny;
+        if (closing < 0.0f) {
+            vx[i] += closing * nx;
+            vy[i] += closing * ny;
+            vx[j] -= closing * nx;
+            vy[j] -= closing * ny;
+        }
+    }
+    return contacts;
+}
+
+// Every pair once: a ball against the rest of its cell, then the whole of the
+// right, lower-left, lower and lower-right cells
+static int CollideBalls(Arena *arena, bool resolve) {
+    static const int offsets[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    const int *start = arena->cellStart;
+    int contacts = 0;
+
+    arena->stats.pairTests = 0;
+    for (int row = 0; row < arena->rows; row++) {
+        for (int column = 0; column < arena->columns; column++) {
+            int cell = row * arena->columns + column;
+            if (start[cell] == start[cell + 1]) continue;
+            for (int i = start[cell]; i < start[cell + 1]; i++) {
+                contacts += CollideRange(arena, i, i + 1, start[cell + 1], resolve);
+                for (int n = 0; n < 4; n++) {
+                    int neighbourColumn = column + offsets[n][0];
+                    int neighbourRow = row + offsets[n][1];
+                    if (neighbourColumn < 0 || neighbourColumn >= arena->columns || neighbourRow >= arena->rows) continue;
+                    int neighbour = neighbourRow * arena->columns + neighbourColumn;
+                    contacts += CollideRange(arena, i, start[neighbour], start[neighbour + 1], resolve);
+                }
+            }
+        }
+    }
+    return contacts;
+}
+
+unsigned int ArenaStep(Arena *arena, SimInput input) {
+    const SimConfig *sim = &arena->config.sim;
+    const float dt = 1.0f / sim->tickRate;
+    const float radius = arena->config.radius;
+    unsigned int events = 0;
+
+    if (arena->finished) return 0;
+    arena->tick++;
+
+    MoveArenaPaddle(arena, SIDE_LAVA, input.left, dt);
+    MoveArenaPaddle(arena, SIDE_ICE, input.right, dt);
+
+    arena->stats.obstacleTests = 0;
+    for (int i = 0; i < arena->ballCount; i++) events |= MoveArenaBall(arena, i, dt);
+
+    SortBalls(arena);
+    arena->stats.ballContacts = (uint32_t)CollideBalls(arena, true);
+
+    // Separation can nudge a ball past a wall, the next sweep expects it inside
+    for (int i = 0; i < arena->ballCount; i++) {
+        arena->y[i] = fminf(fmaxf(arena->y[i], radius), sim->height - radius);
+    }
+
+    if (arena->tick >= (uint32_t)(arena->config.seconds * sim->tickRate)) {
+        arena->finished = true;
+        if (arena->leftScore != arena->rightScore) {
+            arena->winner = (arena->leftScore > arena->rightScore) ? SIDE_LAVA : SIDE_ICE;
+        }
+        events |= SIM_EVENT_GAME_OVER;
+    }
+    return events;
+}
+
+int ArenaCountContacts(Arena *arena) {
+    SortBalls(arena);
+    return CollideBalls(arena, false);
+}
@@ -0,0 +1,80 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Arena party mode: thousands of balls at once against two paddles and a field
+// of obstacles. Balls are stored as parallel arrays and re-sorted by grid cell
+// every step, so each cell's balls sit next to each other in memory and the
+// ball-ball pass only looks at a cell and its neighbours. Obstacles never move
+// and are bucketed into the same grid once at init. A step costs roughly the
+// same per ball whether there are 500 balls or 16000.
+
+#define ARENA_DEFAULT_BALLS 2000
+#define ARENA_DEFAULT_OBSTACLES 200
+#define ARENA_MAX_BOUNCES 4          // Wall, paddle and obstacle contacts resolved per ball per step
+
+typedef struct ArenaConfig {
+    SimConfig sim;                   // Field size, tick rate, speeds and paddle size come from a difficulty preset
+    int balls;
+    int obstacles;
+    float radius;                    // Shared by every ball
+    float seconds;                   // Match length, most goals wins
+} ArenaConfig;
+
+typedef struct ArenaStats {
+    uint64_t pairTests;              // Ball pairs distance-checked, last step
+    uint32_t ballContacts;           // Ball pairs that were touching, last step
+    uint32_t obstacleTests;          // Swept ball-obstacle tests, last step
+} ArenaStats;
+
+typedef struct Arena {
+    ArenaConfig config;
+    int ballCount;
+    float *x;
+    float *y;
+    float *vx;                       // Pixels per second
+    float *vy;
+    float *scratch;                  // Sort target, swapped with the arrays above every step
+    void *block;                     // Single allocation backing every ball array
+
+    SimRect *obstacles;
+    int obstacleCount;
+    SimRect leftPaddle;
+    SimRect rightPaddle;
+
+    // Uniform grid, cells at least one ball diameter wide so touching balls are always in neighbouring cells
+    float cellSize;
+    int columns;
+    int rows;
+    int *cellStart;                  // Balls of cell c are [cellStart[c], cellStart[c + 1]), columns * rows + 1 entries
+    int *ballSlot;                   // Sorted position of each ball while the grid is rebuilt
+    int *obstacleStart;              // Same layout for obstacleItems, built once
+    int *obstacleItems;              // Obstacle indices, one entry per cell an obstacle covers
+
+    int leftScore;
+    int rightScore;
+    SimSide winner;                  // Set with finished, SIDE_NONE for a draw
+    bool finished;
+    uint32_t tick;
+    uint64_t rng;
+    ArenaStats stats;
+} Arena;
+
+// Defaults for a difficulty preset on a field of the given size
+ArenaConfig ArenaDefaultConfig(Difficulty difficulty, float width, float height);
+
+// Place the obstacles and scatter the balls, returns false if memory runs out
+bool ArenaInit(Arena *arena, ArenaConfig config, uint64_t seed);
+void ArenaFree(Arena *arena);
+
+// Advance by one fixed step, returns a mask of SimEvent flags
+unsigned int ArenaStep(Arena *arena, SimInput input);
+
+// Rebuild the grid and count touching ball pairs through it without resolving
+// them, used to check the broadphase against a brute-force count
+int ArenaCountContacts(Arena *arena);
+
+#endif // ARENA_H
@@ -0,0 +1,147 @@
+#include "assets.h"
+#include <stdlib.h>
+#include <string.h>
+
+// File type hint for raylib's decoders, ".wav" from "paddle_hit.wav"
+static const char *Extension(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot ? dot : "";
+}
+
+static void *LoaderThread(void *arg) {
+    Assets *assets = (Assets *)arg;
+    unsigned char *looseData[ASSETS_MAX_SOUNDS] = { 0 };
+    int looseSize[ASSETS_MAX_SOUNDS] = { 0 };
+
+    // Music first, the menu wants it soonest. Streams straight from the mapping, or from the file.
+    if (assets->fromBundle) {
+        const BundleEntry *entry = BundleFind(&assets->bundle, assets->musicName);
+        if (entry != NULL) {
+            assets->pendingMusic = LoadMusicStreamFromMemory(Extension(assets->musicName),
+                                                            BundleData(&assets->bundle, entry), (int)entry->size);
+        }
+    } else {
+        assets->pendingMusic = LoadMusicStream(assets->musicName);
+    }
+    atomic_store_explicit(&assets->musicReady, true, memory_order_release);
+
+    for (int i = 0; i < assets->soundCount; i++) {
+        const char *name = assets->soundNames[i];
+        const unsigned char *data = NULL;
+        int size = 0;
+        assets->shared[i] = -1;
+
+        if (assets->fromBundle) {
+            // Packing already merged identical files, so shared content means a shared offset
+            const BundleEntry *entry = BundleFind(&assets->bundle, name);
+            if (entry != NULL) {
+                data = BundleData(&assets->bundle, entry);
+                size = (int)entry->size;
+                for (int j = 0; j < i; j++) {
+                    const BundleEntry *other = BundleFind(&assets->bundle, assets->soundNames[j]);
+                    if (other != NULL && other->offset == entry->offset && other->size == entry->size) {
+                        assets->shared[i] = j;
+                        break;
+                    }
+                }
+            }
+        } else {
+            looseData[i] = LoadFileData(name, &looseSize[i]);
+            data = looseData[i];
+            size = looseSize[i];
+            for (int j = 0; data != NULL && j < i; j++) {
+                if (looseData[j] != NULL && looseSize[j] == size && memcmp(looseData[j], data, (size_t)size) == 0) {
+                    assets->shared[i] = j;
+                    break;
+                }
+            }
+        }
+
+        if (data != NULL && assets->shared[i] < 0) assets->waves[i] = LoadWaveFromMemory(Extension(name), data, size);
+        atomic_store_explicit(&assets->soundReady[i], true, memory_order_release);
+    }
+
+    for (int i = 0; i < assets->soundCount; i++) {
+        if (looseData[i] != NULL) UnloadFileData(looseData[i]);
+    }
+    return NULL;
+}
+
+void AssetsStart(Assets *assets, const char *bundlePath, const char *musicName, const char *const *soundNames, int soundCount) {
+    memset(assets, 0, sizeof(*assets));
+    assets->startTime = GetTime();
+    assets->musicName = musicName;
+    assets->soundCount = (soundCount < ASSETS_MAX_SOUNDS) ? soundCount : ASSETS_MAX_SOUNDS;
+    for (int i = 0; i < assets->soundCount; i++) assets->soundNames[i] = soundNames[i];
+
+    assets->fromBundle = (bundlePath != NULL) && BundleOpen(&assets->bundle, bundlePath);
+    TraceLog(LOG_INFO, "ASSETS: Loading audio from %s", assets->fromBundle ? bundlePath : "loose files");
+
+    if (pthread_create(&assets->thread, NULL, LoaderThread, assets) == 0) {
+        assets->threadRunning = true;
+    } else {
+        LoaderThread(assets);   // No thread, load in place
+    }
+}
+
+bool AssetsPoll(Assets *assets) {
+    bool musicArrived = false;
+    if (!assets->musicLoaded && atomic_load_explicit(&assets->musicReady, memory_order_acquire)) {
+        assets->music = assets->pendingMusic;
+        assets->musicLoaded = true;
+        musicArrived = IsMusicValid(assets->music);
+    }
+
+    // Sounds go to the audio device here, on the thread that owns it
+    for (int i = 0; i < assets->soundCount; i++) {
+        if (assets->soundLoaded[i] || !atomic_load_explicit(&assets->soundReady[i], memory_order_acquire)) continue;
+        int source = assets->shared[i];
+        if (source >= 0) {
+            if (!assets->soundLoaded[source]) continue;
+            if (IsSoundValid(assets->sounds[source])) {
+                assets->sounds[i] = LoadSoundAlias(assets->sounds[source]);
+                assets->aliased[i] = true;
+            }
+        } else if (assets->waves[i].data != NULL) {
+            assets->sounds[i] = LoadSoundFromWave(assets->waves[i]);
+            UnloadWave(assets->waves[i]);
+            assets->waves[i] = (Wave){ 0 };
+        }
+        assets->soundLoaded[i] = true;
+    }
+
+    if (assets->threadRunning && AssetsDone(assets)) {
+        pthread_join(assets->thread, NULL);
+        assets->threadRunning = false;
+        TraceLog(LOG_INFO, "ASSETS: Audio ready after %.1f ms", (GetTime() - assets->startTime) * 1000.0);
+    }
+    return musicArrived;
+}
+
+bool AssetsDone(const Assets *assets) {
+    if (!assets->musicLoaded) return false;
+    for (int i = 0; i < assets->soundCount; i++) {
+        if (!assets->soundLoaded[i]) return false;
+    }
+    return true;
+}
+
+void AssetsUnload(Assets *assets) {
+    if (assets->threadRunning) pthread_join(assets->thread, NULL);
+    assets->threadRunning = false;
+    AssetsPoll(assets);   // Collect anything finished after the last frame so it gets freed below
+
+    // Aliases before the sounds they borrow from
+    for (int i = 0; i < assets->soundCount; i++) {
+        if (assets->soundLoaded[i] && assets->aliased[i]) UnloadSoundAlias(assets->sounds[i]);
+    }
+    for (int i = 0; i < assets->soundCount; i++) {
+        if (assets->soundLoaded[i] && !assets->aliased[i]) UnloadSound(assets->sounds[i]);
+        if (assets->waves[i].data != NULL) UnloadWave(assets->waves[i]);
+    }
+    if (assets->musicLoaded) UnloadMusicStream(assets->music);
+
+    // The music streamed from the mapping, so it goes last
+    if (assets->fromBundle) BundleClose(&assets->bundle);
+    memset(assets, 0, sizeof(*assets));
+}
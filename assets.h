@@ -0,0 +1,55 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "raylib.h"
+#include "bundle.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Background audio loading. Assets come from a packed bundle (see bundle.c) when
+// one is present, otherwise from the loose files next to the executable. A loader
+// thread opens the music stream and decodes every sound, the audio thread picks the
+// results up with AssetsPoll (see audio.c), so the menu is drawn while audio is still loading.
+// Sounds with identical content are decoded once and shared through sound aliases.
+
+#define ASSETS_MAX_SOUNDS 16
+
+typedef struct Assets {
+    // Owned by the thread calling AssetsPoll, zeroed until loaded (raylib audio calls ignore those)
+    Music music;
+    Sound sounds[ASSETS_MAX_SOUNDS];
+    bool musicLoaded;
+    bool soundLoaded[ASSETS_MAX_SOUNDS];
+    bool aliased[ASSETS_MAX_SOUNDS];
+    int soundCount;
+
+    // Filled in by the loader thread, each handed over by its ready flag
+    const char *musicName;
+    const char *soundNames[ASSETS_MAX_SOUNDS];
+    Music pendingMusic;
+    Wave waves[ASSETS_MAX_SOUNDS];
+    int shared[ASSETS_MAX_SOUNDS];           // Earlier sound with the same content, or -1
+    atomic_bool musicReady;
+    atomic_bool soundReady[ASSETS_MAX_SOUNDS];
+
+    Bundle bundle;
+    bool fromBundle;
+    pthread_t thread;
+    bool threadRunning;
+    double startTime;
+} Assets;
+
+// Map the bundle if it exists and start loading on a background thread
+void AssetsStart(Assets *assets, const char *bundlePath, const char *musicName, const char *const *soundNames, int soundCount);
+
+// Take over whatever the loader finished since the last call. Returns true on the
+// frame the music becomes available, so the caller can start it.
+bool AssetsPoll(Assets *assets);
+
+bool AssetsDone(const Assets *assets);
+
+// Waits for the loader if it is still running
+void AssetsUnload(Assets *assets);
+
+#endif // ASSETS_H
@@ -0,0 +1,234 @@
+// nanosleep is POSIX, not C11 (MinGW gets it from winpthreads)
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "audio.h"
+#include "profiler.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+static double Seconds(void) {
+    return (double)ProfilerNow() / 1e9;
+}
+
+static bool Push(Audio *audio, AudioCommand command) {
+    AudioQueue *queue = &audio->queue;
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head >= AUDIO_QUEUE_SIZE) {
+        atomic_fetch_add_explicit(&audio->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    queue->items[tail & (AUDIO_QUEUE_SIZE - 1)] = command;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool Pop(Audio *audio, AudioCommand *command) {
+    AudioQueue *queue = &audio->queue;
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) return false;
+    *command = queue->items[head & (AUDIO_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Fade from the current volume to target, at once when seconds is zero
+static void FadeTo(Audio *audio, float target, float seconds) {
+    audio->musicTarget = target;
+    if (seconds > 0.0f) {
+        audio->fadeRate = fabsf(target - audio->musicVolume) / seconds;
+    } else {
+        audio->musicVolume = target;
+        SetMusicVolume(audio->assets.music, target);
+    }
+}
+
+// Give every sound that just arrived its extra voices. PlaySound restarts a sound that is
+// already playing, so two quick hits on one Sound cut each other off; aliases share the
+// samples but play independently.
+static void AddVoices(Audio *audio) {
+    Assets *assets = &audio->assets;
+    for (int i = 0; i < assets->soundCount; i++) {
+        if (audio->voiceCount[i] > 0 || !assets->soundLoaded[i]) continue;
+        if (!IsSoundValid(assets->sounds[i])) {
+            audio->voiceCount[i] = -1;   // Missing file, never retry
+            continue;
+        }
+        audio->voices[i][0] = assets->sounds[i];
+        audio->voiceCount[i] = 1;
+        for (int v = 1; v < AUDIO_VOICES; v++) {
+            audio->voices[i][v] = LoadSoundAlias(assets->sounds[i]);
+            audio->voiceCount[i]++;
+        }
+    }
+}
+
+static void PlayVoice(Audio *audio, int sound, double now) {
+    if (sound < 0 || sound >= audio->assets.soundCount || audio->voiceCount[sound] <= 0) return;
+
+    // Collisions can report the same hit on consecutive frames, one play is enough
+    if (now - audio->lastPlayed[sound] < audio->rateLimit[sound]) {
+        atomic_fetch_add_explicit(&audio->limited, 1, memory_order_relaxed);
+        return;
+    }
+    audio->lastPlayed[sound] = now;
+
+    // A free voice if there is one, otherwise cut off the oldest
+    int count = audio->voiceCount[sound];
+    int voice = audio->nextVoice[sound];
+    for (int v = 0; v < count; v++) {
+        int candidate = (audio->nextVoice[sound] + v) % count;
+        if (!IsSoundPlaying(audio->voices[sound][candidate])) {
+            voice = candidate;
+            break;
+        }
+    }
+    PlaySound(audio->voices[sound][voice]);
+    audio->nextVoice[sound] = (voice + 1) % count;
+}
+
+static void Execute(Audio *audio, const AudioCommand *command, double now) {
+    Music music = audio->assets.music;   // Zeroed until loaded, raylib ignores it then
+    switch (command->type) {
+        case AUDIO_PLAY_SOUND:
+            PlayVoice(audio, command->sound, now);
+            break;
+        case AUDIO_RATE_LIMIT:
+            if (command->sound >= 0 && command->sound < ASSETS_MAX_SOUNDS) audio->rateLimit[command->sound] = command->value;
+            break;
+        case AUDIO_MUSIC_VOLUME:
+            audio->musicRestore = command->value;
+            audio->stopAfterFade = false;
+            FadeTo(audio, command->value, command->seconds);
+            break;
+        case AUDIO_MUSIC_PLAY:
+            // Restart from the top, fading in from silence
+            if (audio->musicPlaying) StopMusicStream(music);
+            audio->musicWanted = true;
+            audio->musicPlaying = audio->assets.musicLoaded;
+            audio->stopAfterFade = false;
+            audio->musicVolume = 0.0f;
+            SetMusicVolume(music, 0.0f);
+            PlayMusicStream(music);
+            FadeTo(audio, audio->musicRestore, command->seconds);
+            break;
+        case AUDIO_MUSIC_STOP:
+            audio->musicWanted = false;
+            audio->stopAfterFade = true;
+            FadeTo(audio, 0.0f, command->seconds);
+            break;
+        case AUDIO_IDLE:
+            audio->idle = command->value != 0.0f;
+            break;
+    }
+}
+
+static void UpdateFade(Audio *audio, float dt) {
+    if (audio->musicVolume != audio->musicTarget) {
+        float step = audio->fadeRate * dt;
+        float delta = audio->musicTarget - audio->musicVolume;
+        audio->musicVolume = (fabsf(delta) <= step) ? audio->musicTarget : audio->musicVolume + copysignf(step, delta);
+        SetMusicVolume(audio->assets.music, audio->musicVolume);
+    }
+    if (audio->stopAfterFade && audio->musicVolume == 0.0f) {
+        if (audio->musicPlaying) StopMusicStream(audio->assets.music);
+        audio->musicPlaying = false;
+        audio->stopAfterFade = false;
+    }
+}
+
+static void *AudioThread(void *arg) {
+    Audio *audio = (Audio *)arg;
+    double last = Seconds();
+    struct timespec tick = { 0, (long)(AUDIO_TICK_SECONDS * 1e9) };
+    struct timespec idleTick = { 0, (long)(AUDIO_IDLE_TICK_SECONDS * 1e9) };
+
+    for (;;) {
+        bool quit = atomic_load_explicit(&audio->quit, memory_order_acquire);
+        double now = Seconds();
+
+        if (AssetsPoll(&audio->assets)) {
+            SetMusicVolume(audio->assets.music, audio->musicVolume);
+            if (audio->musicWanted) {
+                PlayMusicStream(audio->assets.music);
+                audio->musicPlaying = true;
+            }
+        }
+        AddVoices(audio);
+
+        AudioCommand command;
+        while (Pop(audio, &command)) Execute(audio, &command, now);
+        UpdateFade(audio, (float)(now - last));
+        UpdateMusicStream(audio->assets.music);
+        last = now;
+
+        if (quit) break;   // Checked before draining, so nothing posted before AudioStop is lost
+        nanosleep((audio->idle && audio->musicVolume == audio->musicTarget) ? &idleTick : &tick, NULL);
+    }
+
+    // Aliases go before the sounds they borrow from, AssetsUnload frees the rest
+    for (int i = 0; i < audio->assets.soundCount; i++) {
+        for (int v = 1; v < audio->voiceCount[i]; v++) UnloadSoundAlias(audio->voices[i][v]);
+    }
+    AssetsUnload(&audio->assets);
+    return NULL;
+}
+
+bool AudioStart(Audio *audio, const char *bundlePath, const char *musicName, const char *const *soundNames, int soundCount) {
+    memset(audio, 0, sizeof(*audio));
+    atomic_init(&audio->queue.head, 0);
+    atomic_init(&audio->queue.tail, 0);
+    atomic_init(&audio->quit, false);
+    atomic_init(&audio->dropped, 0);
+    atomic_init(&audio->limited, 0);
+    for (int i = 0; i < ASSETS_MAX_SOUNDS; i++) {
+        audio->rateLimit[i] = AUDIO_DEFAULT_RATE_LIMIT;
+        audio->lastPlayed[i] = -1e9;
+    }
+    audio->musicRestore = 1.0f;
+
+    AssetsStart(&audio->assets, bundlePath, musicName, soundNames, soundCount);
+    audio->running = (pthread_create(&audio->thread, NULL, AudioThread, audio) == 0);
+    if (!audio->running) TraceLog(LOG_WARNING, "AUDIO: Could not start the audio thread, running silent");
+    return audio->running;
+}
+
+void AudioStop(Audio *audio) {
+    if (audio->running) {
+        atomic_store_explicit(&audio->quit, true, memory_order_release);
+        pthread_join(audio->thread, NULL);
+        audio->running = false;
+        unsigned dropped = atomic_load(&audio->dropped), limited = atomic_load(&audio->limited);
+        if (dropped > 0 || limited > 0) TraceLog(LOG_INFO, "AUDIO: %u commands dropped, %u plays rate limited", dropped, limited);
+    } else {
+        AssetsUnload(&audio->assets);
+    }
+}
+
+bool AudioPlaySound(Audio *audio, int sound) {
+    return Push(audio, (AudioCommand){ AUDIO_PLAY_SOUND, sound, 0.0f, 0.0f });
+}
+
+bool AudioSetRateLimit(Audio *audio, int sound, float seconds) {
+    return Push(audio, (AudioCommand){ AUDIO_RATE_LIMIT, sound, seconds, 0.0f });
+}
+
+bool AudioSetMusicVolume(Audio *audio, float volume, float fadeSeconds) {
+    return Push(audio, (AudioCommand){ AUDIO_MUSIC_VOLUME, 0, volume, fadeSeconds });
+}
+
+bool AudioPlayMusic(Audio *audio, float fadeSeconds) {
+    return Push(audio, (AudioCommand){ AUDIO_MUSIC_PLAY, 0, 0.0f, fadeSeconds });
+}
+
+bool AudioStopMusic(Audio *audio, float fadeSeconds) {
+    return Push(audio, (AudioCommand){ AUDIO_MUSIC_STOP, 0, 0.0f, fadeSeconds });
+}
+
+bool AudioSetIdle(Audio *audio, bool idle) {
+    return Push(audio, (AudioCommand){ AUDIO_IDLE, 0, idle ? 1.0f : 0.0f, 0.0f });
+}
@@ -0,0 +1,88 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "raylib.h"
+#include "assets.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Audio on its own thread. The frame loop never calls raylib audio functions:
+// it posts commands to a single-producer single-consumer ring, and the audio
+// thread keeps the music buffer topped up, plays sounds on a small pool of
+// voices per sound, drops repeats of a sound that come too close together, and
+// fades the music volume instead of jumping.
+
+#define AUDIO_QUEUE_SIZE 256             // Commands in flight, power of two
+#define AUDIO_VOICES 4                   // Copies of each sound that can play at once
+#define AUDIO_DEFAULT_RATE_LIMIT 0.05f   // Seconds between two plays of the same sound
+#define AUDIO_TICK_SECONDS 0.005         // How often the audio thread wakes up
+#define AUDIO_IDLE_TICK_SECONDS 0.02     // Same on idle screens with no fade running, the music buffer lasts far longer
+
+typedef enum AudioCommandType {
+    AUDIO_PLAY_SOUND,
+    AUDIO_RATE_LIMIT,
+    AUDIO_MUSIC_VOLUME,
+    AUDIO_MUSIC_PLAY,
+    AUDIO_MUSIC_STOP,
+    AUDIO_IDLE
+} AudioCommandType;
+
+typedef struct AudioCommand {
+    AudioCommandType type;
+    int sound;
+    float value;      // Volume, or seconds for AUDIO_RATE_LIMIT
+    float seconds;    // Fade time
+} AudioCommand;
+
+// Lock-free ring, the frame loop writes tail and the audio thread writes head
+typedef struct AudioQueue {
+    AudioCommand items[AUDIO_QUEUE_SIZE];
+    alignas(64) atomic_uint head;
+    alignas(64) atomic_uint tail;
+} AudioQueue;
+
+typedef struct Audio {
+    AudioQueue queue;
+    Assets assets;
+    pthread_t thread;
+    bool running;
+    atomic_bool quit;
+    atomic_uint dropped;        // Commands lost to a full queue
+    atomic_uint limited;        // Plays skipped by the rate limit
+
+    // Everything below belongs to the audio thread
+    Sound voices[ASSETS_MAX_SOUNDS][AUDIO_VOICES];
+    int voiceCount[ASSETS_MAX_SOUNDS];
+    int nextVoice[ASSETS_MAX_SOUNDS];
+    double lastPlayed[ASSETS_MAX_SOUNDS];
+    float rateLimit[ASSETS_MAX_SOUNDS];
+    bool musicWanted;           // Play state asked for, applied once the music has loaded
+    bool musicPlaying;
+    bool stopAfterFade;
+    float musicVolume;          // Volume right now
+    float musicTarget;          // Volume being faded to
+    float musicRestore;         // Volume to fade back in to after a stop
+    float fadeRate;             // Volume change per second
+    bool idle;                  // Wake up less often (see AudioSetIdle)
+} Audio;
+
+// Start loading audio (see assets.c) and the audio thread. InitAudioDevice must have been called.
+bool AudioStart(Audio *audio, const char *bundlePath, const char *musicName, const char *const *soundNames, int soundCount);
+
+// Finish the queued commands, stop the thread and unload everything
+void AudioStop(Audio *audio);
+
+// Called from the frame loop only. Each returns false if the queue was full.
+bool AudioPlaySound(Audio *audio, int sound);
+bool AudioSetRateLimit(Audio *audio, int sound, float seconds);
+bool AudioSetMusicVolume(Audio *audio, float volume, float fadeSeconds);
+bool AudioPlayMusic(Audio *audio, float fadeSeconds);
+bool AudioStopMusic(Audio *audio, float fadeSeconds);
+
+// The screen is idle (see power.c): tick every AUDIO_IDLE_TICK_SECONDS while no fade runs.
+// Sounds posted meanwhile can start up to that much later.
+bool AudioSetIdle(Audio *audio, bool idle);
+
+#endif // AUDIO_H
@@ -0,0 +1,312 @@
+// shm_open, mmap and the futex syscall are not C11
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include "botlink.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <limits.h>
+    #include <linux/futex.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+uint64_t BotLinkNow(void) {
+    struct timespec ts;
+#if defined(__linux__)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__linux__)
+
+// Shared objects are named "/name", the leading slash is added when missing
+static bool SetName(BotLink *link, const char *name) {
+    int length = snprintf(link->name, sizeof(link->name), "%s%s", name[0] == '/' ? "" : "/", name);
+    return length > 1 && length < (int)sizeof(link->name) && strchr(link->name + 1, '/') == NULL;
+}
+
+static BotLinkShared *Map(int fd) {
+    void *memory = mmap(NULL, sizeof(BotLinkShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+bool BotLinkCreate(BotLink *link, const char *name) {
+    memset(link, 0, sizeof(*link));
+    if (!SetName(link, name)) return false;
+    int fd = shm_open(link->name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return false;
+    if (ftruncate(fd, sizeof(BotLinkShared)) != 0) {
+        close(fd);
+        shm_unlink(link->name);
+        return false;
+    }
+    link->shared = Map(fd);
+    if (link->shared == NULL) {
+        shm_unlink(link->name);
+        return false;
+    }
+
+    // An object left behind by a game that crashed is reused from scratch. The
+    // magic goes in last, so a bot never attaches to a half-made link.
+    memset(link->shared, 0, sizeof(BotLinkShared));
+    link->shared->version = BOTLINK_VERSION;
+    link->shared->size = sizeof(BotLinkShared);
+    atomic_thread_fence(memory_order_release);
+    link->shared->magic = BOTLINK_MAGIC;
+    link->owner = true;
+    link->stats.latencyMinNs = UINT64_MAX;
+    return true;
+}
+
+bool BotLinkAttach(BotLink *link, const char *name) {
+    memset(link, 0, sizeof(*link));
+    if (!SetName(link, name)) return false;
+    int fd = shm_open(link->name, O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size != (off_t)sizeof(BotLinkShared)) {
+        close(fd);
+        return false;
+    }
+    link->shared = Map(fd);
+    if (link->shared == NULL) return false;
+    if (link->shared->magic != BOTLINK_MAGIC || link->shared->version != BOTLINK_VERSION ||
+        link->shared->size != sizeof(BotLinkShared)) {
+        BotLinkClose(link);
+        return false;
+    }
+    // Start from the newest state, not the first one the game ever sent
+    link->read = atomic_load_explicit(&link->shared->published, memory_order_acquire);
+    link->stats.latencyMinNs = UINT64_MAX;
+    return true;
+}
+
+void BotLinkClose(BotLink *link) {
+    if (link->shared != NULL) munmap(link->shared, sizeof(BotLinkShared));
+    if (link->owner) shm_unlink(link->name);
+    link->shared = NULL;
+    link->owner = false;
+}
+
+static void FutexWait(_Atomic uint32_t *word, uint32_t expected, uint64_t timeoutNs) {
+    struct timespec timeout = { (time_t)(timeoutNs / 1000000000ULL), (long)(timeoutNs % 1000000000ULL) };
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void FutexWakeAll(_Atomic uint32_t *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+#else
+
+bool BotLinkCreate(BotLink *link, const char *name) {
+    (void)name;
+    memset(link, 0, sizeof(*link));
+    return false;
+}
+
+bool BotLinkAttach(BotLink *link, const char *name) {
+    (void)name;
+    memset(link, 0, sizeof(*link));
+    return false;
+}
+
+void BotLinkClose(BotLink *link) {
+    link->shared = NULL;
+}
+
+static void FutexWait(_Atomic uint32_t *word, uint32_t expected, uint64_t timeoutNs) {
+    (void)word;
+    (void)expected;
+    (void)timeoutNs;
+}
+
+static void FutexWakeAll(_Atomic uint32_t *word) {
+    (void)word;
+}
+
+#endif
+
+// Entry n of a ring is being written while its slot's sequence is 2n + 1 and is
+// complete at 2n + 2. A reader checks the sequence on both sides of its copy.
+static void BeginWrite(_Atomic uint32_t *sequence, uint32_t n) {
+    atomic_store_explicit(sequence, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void EndWrite(_Atomic uint32_t *sequence, uint32_t n) {
+    atomic_store_explicit(sequence, 2 * n + 2, memory_order_release);
+}
+
+static bool BeginRead(_Atomic uint32_t *sequence, uint32_t n) {
+    return atomic_load_explicit(sequence, memory_order_acquire) == 2 * n + 2;
+}
+
+static bool EndRead(_Atomic uint32_t *sequence, uint32_t n) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(sequence, memory_order_relaxed) == 2 * n + 2;
+}
+
+static void AddLatency(BotLinkStats *stats, uint64_t ns) {
+    int bucket = 0;
+    while (bucket < BOTLINK_LATENCY_BUCKETS - 1 && (ns >> (bucket + 1)) != 0) bucket++;
+    stats->latency[bucket]++;
+    stats->latencyTotalNs += ns;
+    if (ns < stats->latencyMinNs) stats->latencyMinNs = ns;
+    if (ns > stats->latencyMaxNs) stats->latencyMaxNs = ns;
+}
+
+void BotLinkPoll(BotLink *link, SimInput *input) {
+    BotLinkShared *shared = link->shared;
+    if (shared == NULL) return;
+
+    uint32_t written = atomic_load_explicit(&shared->commands, memory_order_acquire);
+    if (written - link->read > BOTLINK_RING) {
+        // The bot lapped the ring, the oldest commands are gone
+        link->stats.skipped += written - link->read - BOTLINK_RING;
+        link->read = written - BOTLINK_RING;
+    }
+    for (; link->read != written; link->read++) {
+        BotCommandSlot *slot = &shared->commandRing[link->read & (BOTLINK_RING - 1)];
+        if (!BeginRead(&slot->sequence, link->read)) {
+            link->stats.skipped++;
+            continue;
+        }
+        BotCommand command = slot->command;
+        if (!EndRead(&slot->sequence, link->read)) {
+            link->stats.skipped++;
+            continue;
+        }
+        if (command.side != SIDE_LAVA && command.side != SIDE_ICE) continue;
+
+        int side = (command.side == SIDE_ICE) ? 1 : 0;
+        link->input[side] = (SimPaddleInput){
+            .move = command.move < 0 ? -1 : (command.move > 0 ? 1 : 0),
+            .useTarget = command.useTarget != 0,
+            .targetY = command.targetY
+        };
+        link->active[side] = true;
+        link->answered[side] = command.tick;
+        link->stats.commands++;
+        AddLatency(&link->stats, command.sentNs - command.stateSentNs);
+    }
+
+    if (!link->active[0] && !link->active[1]) return;
+    if (link->active[0]) input->left = link->input[0];
+    if (link->active[1]) input->right = link->input[1];
+    link->stats.botSteps++;
+    if ((!link->active[0] || link->answered[0] == link->lastTick) &&
+        (!link->active[1] || link->answered[1] == link->lastTick)) {
+        link->stats.freshSteps++;
+    }
+}
+
+void BotLinkPublish(BotLink *link, const SimState *state, uint32_t match) {
+    BotLinkShared *shared = link->shared;
+    if (shared == NULL) return;
+
+    uint32_t n = atomic_load_explicit(&shared->published, memory_order_relaxed);
+    BotStateSlot *slot = &shared->states[n & (BOTLINK_RING - 1)];
+    BeginWrite(&slot->sequence, n);
+    slot->state = (BotState){
+        .tick = state->tick,
+        .match = match,
+        .sentNs = BotLinkNow(),
+        .width = state->config.width,
+        .height = state->config.height,
+        .ballX = state->ballPosition.x,
+        .ballY = state->ballPosition.y,
+        .ballSpeedX = state->ballSpeed.x,
+        .ballSpeedY = state->ballSpeed.y,
+        .leftY = state->leftPaddle.y + state->leftPaddle.height / 2,
+        .rightY = state->rightPaddle.y + state->rightPaddle.height / 2,
+        .paddleHeight = state->config.paddleHeight,
+        .leftScore = state->leftScore,
+        .rightScore = state->rightScore,
+        .winner = state->winner
+    };
+    EndWrite(&slot->sequence, n);
+
+    // Sequentially consistent with the sleeper count, so either the game sees a bot
+    // going to sleep or the bot's futex wait sees the new count and returns at once
+    atomic_store(&shared->published, n + 1);
+    if (atomic_load(&shared->sleepers) != 0) FutexWakeAll(&shared->published);
+    link->lastTick = state->tick;
+    link->stats.published++;
+}
+
+bool BotLinkWait(BotLink *link, BotState *state, double spinSeconds, double timeoutSeconds) {
+    BotLinkShared *shared = link->shared;
+    if (shared == NULL) return false;
+
+    uint64_t start = BotLinkNow();
+    uint64_t spinUntil = start + (uint64_t)(spinSeconds * 1e9);
+    uint64_t deadline = start + (uint64_t)(timeoutSeconds * 1e9);
+    for (;;) {
+        uint32_t published = atomic_load_explicit(&shared->published, memory_order_acquire);
+        if (published != link->read) {
+            // Only the newest state matters, older ones a slow bot missed are skipped
+            uint32_t n = published - 1;
+            BotStateSlot *slot = &shared->states[n & (BOTLINK_RING - 1)];
+            if (BeginRead(&slot->sequence, n)) {
+                *state = slot->state;
+                if (EndRead(&slot->sequence, n)) {
+                    link->read = published;
+                    link->lastTick = state->tick;
+                    link->stats.published++;
+                    return true;
+                }
+            }
+            continue;   // Overwritten while reading, a newer one is out
+        }
+
+        uint64_t now = BotLinkNow();
+        if (now >= deadline) return false;
+        if (now < spinUntil) continue;
+        atomic_fetch_add(&shared->sleepers, 1);
+        FutexWait(&shared->published, published, deadline - now);
+        atomic_fetch_sub(&shared->sleepers, 1);
+    }
+}
+
+void BotLinkSend(BotLink *link, const BotState *state, BotCommand command) {
+    BotLinkShared *shared = link->shared;
+    if (shared == NULL) return;
+
+    // One bot process writes commands, so its own count is the next slot
+    uint32_t n = atomic_load_explicit(&shared->commands, memory_order_relaxed);
+    BotCommandSlot *slot = &shared->commandRing[n & (BOTLINK_RING - 1)];
+    command.tick = state->tick;
+    command.stateSentNs = state->sentNs;
+    BeginWrite(&slot->sequence, n);
+    command.sentNs = BotLinkNow();
+    slot->command = command;
+    EndWrite(&slot->sequence, n);
+    atomic_store_explicit(&shared->commands, n + 1, memory_order_release);
+    link->stats.commands++;
+}
+
+uint64_t BotLinkLatencyPercentile(const BotLinkStats *stats, double percentile) {
+    uint64_t count = 0;
+    for (int b = 0; b < BOTLINK_LATENCY_BUCKETS; b++) count += stats->latency[b];
+    uint64_t target = (uint64_t)(percentile * count);
+    uint64_t seen = 0;
+    for (int b = 0; b < BOTLINK_LATENCY_BUCKETS; b++) {
+        seen += stats->latency[b];
+        if (seen > target) return 2ULL << b;
+    }
+    return 2ULL << (BOTLINK_LATENCY_BUCKETS - 1);
+}
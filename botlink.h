@@ -0,0 +1,132 @@
+#ifndef BOTLINK_H
+#define BOTLINK_H
+
+#include "sim.h"
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Shared-memory link for bots running in their own process (Linux only). The
+// game creates a POSIX shared memory object and publishes the match state into
+// a ring after every fixed step. A bot maps the same object, sleeps on a futex
+// until a new state is out, and answers with paddle commands for either side
+// through a second ring. The game never waits for a bot: before each step it
+// takes the newest command that has arrived and keeps using it while the bot is
+// busy. Commands carry the publish time of the state they answer, so the game
+// can keep round-trip statistics.
+//
+// Both rings have one writer and one reader. Every slot has a sequence number,
+// written as odd while the slot is being filled, so a reader that falls a whole
+// ring behind sees the slot was reused and skips ahead instead of reading a torn
+// entry.
+
+#define BOTLINK_RING 64              // Slots in each ring, a power of two
+#define BOTLINK_MAGIC 0x4B4E4C42u    // "BLNK"
+#define BOTLINK_VERSION 1
+#define BOTLINK_LATENCY_BUCKETS 40   // Round trips by powers of two nanoseconds, bucket b holds [2^b, 2^(b+1))
+
+// Match state as a bot sees it, published after every step
+typedef struct BotState {
+    uint32_t tick;
+    uint32_t match;                  // Goes up whenever a new match starts
+    uint64_t sentNs;                 // BotLinkNow when it was published
+    float width;                     // Playfield size
+    float height;
+    float ballX;                     // Ball center
+    float ballY;
+    float ballSpeedX;                // Pixels per second
+    float ballSpeedY;
+    float leftY;                     // Paddle centers
+    float rightY;
+    float paddleHeight;
+    int32_t leftScore;
+    int32_t rightScore;
+    int32_t winner;                  // SimSide
+} BotState;
+
+// A paddle command, held by the game until the next one for the same side arrives
+typedef struct BotCommand {
+    uint32_t tick;                   // Of the state it answers
+    int32_t side;                    // SIDE_LAVA or SIDE_ICE
+    int32_t move;                    // -1 up, 0 idle, 1 down
+    int32_t useTarget;               // Place the paddle center at targetY instead of moving it
+    float targetY;
+    uint64_t stateSentNs;            // sentNs of the state it answers
+    uint64_t sentNs;                 // BotLinkNow when it was written
+} BotCommand;
+
+typedef struct BotStateSlot {
+    _Atomic uint32_t sequence;
+    BotState state;
+} BotStateSlot;
+
+typedef struct BotCommandSlot {
+    _Atomic uint32_t sequence;
+    BotCommand command;
+} BotCommandSlot;
+
+// Layout of the shared object, the same for the game and every bot build
+typedef struct BotLinkShared {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                   // sizeof(BotLinkShared), catches a mismatched build
+    alignas(64) _Atomic uint32_t published;   // States written so far, also the futex bots sleep on
+    _Atomic uint32_t sleepers;                 // Bots inside the futex wait, the game skips the wake call without them
+    alignas(64) _Atomic uint32_t commands;    // Commands written so far
+    alignas(64) BotStateSlot states[BOTLINK_RING];
+    alignas(64) BotCommandSlot commandRing[BOTLINK_RING];
+} BotLinkShared;
+
+typedef struct BotLinkStats {
+    uint64_t published;              // States sent
+    uint64_t commands;               // Commands taken
+    uint64_t skipped;                // Commands overwritten before the game read them
+    uint64_t freshSteps;             // Steps where every bot had answered the newest state
+    uint64_t botSteps;               // Steps with a bot on at least one side
+    uint64_t latencyTotalNs;         // State published to command written
+    uint64_t latencyMinNs;
+    uint64_t latencyMaxNs;
+    uint64_t latency[BOTLINK_LATENCY_BUCKETS];
+} BotLinkStats;
+
+typedef struct BotLink {
+    BotLinkShared *shared;
+    char name[64];
+    bool owner;                      // Created the object, removes it on close
+    uint32_t read;                   // Next slot of the other side's ring to read
+    uint32_t lastTick;               // Tick of the newest state published (game) or seen (bot)
+    bool active[2];                  // A bot has sent commands for Lava, Ice (game side)
+    SimPaddleInput input[2];         // Newest command for each side (game side)
+    uint32_t answered[2];            // Tick the newest command for each side answers (game side)
+    BotLinkStats stats;
+} BotLink;
+
+// Monotonic clock in nanoseconds, shared by every process on the machine
+uint64_t BotLinkNow(void);
+
+// Game side: create the shared object ("/name"), false if it can't be made or the platform has no futex
+bool BotLinkCreate(BotLink *link, const char *name);
+
+// Bot side: map an object the game created
+bool BotLinkAttach(BotLink *link, const char *name);
+
+void BotLinkClose(BotLink *link);
+
+// Game side, before a step: take every command that has arrived and put the bots'
+// paddles into the input. Never blocks.
+void BotLinkPoll(BotLink *link, SimInput *input);
+
+// Game side, after a step: publish the state and wake sleeping bots
+void BotLinkPublish(BotLink *link, const SimState *state, uint32_t match);
+
+// Bot side: wait up to timeoutSeconds for a state newer than the last one seen,
+// spinning for spinSeconds before going to sleep. Returns false on timeout.
+bool BotLinkWait(BotLink *link, BotState *state, double spinSeconds, double timeoutSeconds);
+
+// Bot side: send a command answering state, sentNs is filled in
+void BotLinkSend(BotLink *link, const BotState *state, BotCommand command);
+
+// Round trip at the given percentile (0 to 1), the upper end of its bucket
+uint64_t BotLinkLatencyPercentile(const BotLinkStats *stats, double percentile);
+
+#endif // BOTLINK_H
@@ -0,0 +1,215 @@
+// mmap and fstat are POSIX, not C11
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "bundle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOGDI
+    #define NOUSER
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define BUNDLE_MAGIC 0x444E4250u   // "PBND"
+#define BUNDLE_VERSION 1u
+
+uint64_t BundleHash(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Map the whole file read-only
+static bool MapFile(Bundle *bundle, const char *path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(file);   // The mapping keeps the file open
+    if (mapping == NULL) return false;
+
+    bundle->base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (bundle->base == NULL) {
+        CloseHandle(mapping);
+        return false;
+    }
+    bundle->size = (size_t)size.QuadPart;
+    bundle->mapping = mapping;
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);   // The mapping stays valid
+    if (base == MAP_FAILED) return false;
+
+    bundle->base = base;
+    bundle->size = (size_t)info.st_size;
+    return true;
+#endif
+}
+
+static void UnmapFile(Bundle *bundle) {
+#if defined(_WIN32)
+    UnmapViewOfFile(bundle->base);
+    CloseHandle(bundle->mapping);
+#else
+    munmap((void *)bundle->base, bundle->size);
+#endif
+}
+
+bool BundleOpen(Bundle *bundle, const char *path) {
+    *bundle = (Bundle){ 0 };
+    if (!MapFile(bundle, path)) return false;
+
+    // Check the index before trusting any offset in it
+    const BundleHeader *header = (const BundleHeader *)bundle->base;
+    bool ok = bundle->size >= sizeof(BundleHeader) && header->magic == BUNDLE_MAGIC &&
+              header->version == BUNDLE_VERSION &&
+              header->entryCount <= (bundle->size - sizeof(BundleHeader)) / sizeof(BundleEntry);
+    if (ok) {
+        bundle->entries = (const BundleEntry *)(bundle->base + sizeof(BundleHeader));
+        bundle->entryCount = (int)header->entryCount;
+        for (int i = 0; ok && i < bundle->entryCount; i++) {
+            const BundleEntry *entry = &bundle->entries[i];
+            ok = entry->offset <= bundle->size && entry->size <= bundle->size - entry->offset &&
+                 memchr(entry->name, '\0', BUNDLE_NAME_LENGTH) != NULL;
+        }
+    }
+    if (!ok) {
+        UnmapFile(bundle);
+        *bundle = (Bundle){ 0 };
+    }
+    return ok;
+}
+
+void BundleClose(Bundle *bundle) {
+    if (bundle->base != NULL) UnmapFile(bundle);
+    *bundle = (Bundle){ 0 };
+}
+
+const BundleEntry *BundleFind(const Bundle *bundle, const char *name) {
+    // A handful of entries, a linear scan beats anything fancier
+    for (int i = 0; i < bundle->entryCount; i++) {
+        if (strcmp(bundle->entries[i].name, name) == 0) return &bundle->entries[i];
+    }
+    return NULL;
+}
+
+const void *BundleData(const Bundle *bundle, const BundleEntry *entry) {
+    return bundle->base + entry->offset;
+}
+
+static unsigned char *ReadWholeFile(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+    unsigned char *data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc(length > 0 ? (size_t)length : 1);
+            if (data != NULL && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)length;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+static const char *BaseName(const char *path) {
+    const char *name = path;
+    for (const char *c = path; *c; c++) {
+        if (*c == '/' || *c == '\\') name = c + 1;
+    }
+    return name;
+}
+
+bool BundleWrite(const char *path, const char *const *files, int count, BundleStats *stats) {
+    BundleEntry *entries = calloc((size_t)(count > 0 ? count : 1), sizeof(BundleEntry));
+    unsigned char **contents = calloc((size_t)(count > 0 ? count : 1), sizeof(unsigned char *));
+    int *owner = calloc((size_t)(count > 0 ? count : 1), sizeof(int));   // Entry whose blob this one shares
+    BundleStats local = { 0 };
+    bool ok = entries != NULL && contents != NULL && owner != NULL;
+
+    uint64_t offset = sizeof(BundleHeader) + sizeof(BundleEntry) * (uint64_t)count;
+    for (int i = 0; ok && i < count; i++) {
+        size_t size = 0;
+        const char *name = BaseName(files[i]);
+        contents[i] = ReadWholeFile(files[i], &size);
+        ok = contents[i] != NULL && strlen(name) < BUNDLE_NAME_LENGTH;
+        if (!ok) break;
+
+        strcpy(entries[i].name, name);
+        entries[i].hash = BundleHash(contents[i], size);
+        entries[i].size = size;
+        local.inputBytes += size;
+
+        // Same bytes as an earlier file: point at its blob instead of storing another copy
+        owner[i] = i;
+        for (int j = 0; j < i; j++) {
+            if (owner[j] == j && entries[j].hash == entries[i].hash && entries[j].size == size &&
+                memcmp(contents[j], contents[i], size) == 0) {
+                owner[i] = j;
+                break;
+            }
+        }
+        if (owner[i] == i) {
+            offset = (offset + BUNDLE_ALIGN - 1) & ~(uint64_t)(BUNDLE_ALIGN - 1);
+            entries[i].offset = offset;
+            offset += size;
+            local.uniqueBlobs++;
+        } else {
+            entries[i].offset = entries[owner[i]].offset;
+        }
+        local.files++;
+    }
+
+    FILE *file = ok ? fopen(path, "wb") : NULL;
+    if (file != NULL) {
+        BundleHeader header = { BUNDLE_MAGIC, BUNDLE_VERSION, (uint32_t)count, 0 };
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(entries, sizeof(BundleEntry), (size_t)count, file);
+        for (int i = 0; i < count; i++) {
+            if (owner[i] != i) continue;
+            while ((uint64_t)ftell(file) < entries[i].offset) fputc(0, file);
+            fwrite(contents[i], 1, (size_t)entries[i].size, file);
+        }
+        local.bundleBytes = (uint64_t)ftell(file);
+        ok = !ferror(file);
+        ok = (fclose(file) == 0) && ok;
+    } else {
+        ok = false;
+    }
+
+    for (int i = 0; contents != NULL && i < count; i++) free(contents[i]);
+    free(contents);
+    free(entries);
+    free(owner);
+    if (stats != NULL) *stats = local;
+    return ok;
+}
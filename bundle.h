@@ -0,0 +1,60 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Packed asset bundle. One file holds every asset behind a small index, and is
+// memory-mapped so opening it costs nothing until an asset's pages are touched.
+// Files with identical content are stored once and share an offset.
+//
+// Layout (host byte order, version 1):
+//   BundleHeader, BundleEntry[entryCount], blobs aligned to BUNDLE_ALIGN
+
+#define BUNDLE_NAME_LENGTH 48
+#define BUNDLE_ALIGN 16
+
+typedef struct BundleHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+} BundleHeader;
+
+typedef struct BundleEntry {
+    char name[BUNDLE_NAME_LENGTH];   // File name the asset was packed from, NUL terminated
+    uint64_t hash;                   // Content hash, equal hashes mean a shared blob
+    uint64_t offset;                 // From the start of the file
+    uint64_t size;
+} BundleEntry;
+
+typedef struct Bundle {
+    const unsigned char *base;       // Whole file, mapped read-only
+    size_t size;
+    const BundleEntry *entries;
+    int entryCount;
+    void *mapping;                   // Platform handle kept for BundleClose
+} Bundle;
+
+typedef struct BundleStats {
+    int files;
+    int uniqueBlobs;
+    uint64_t inputBytes;
+    uint64_t bundleBytes;
+} BundleStats;
+
+bool BundleOpen(Bundle *bundle, const char *path);
+void BundleClose(Bundle *bundle);
+
+// Entry packed from name, or NULL
+const BundleEntry *BundleFind(const Bundle *bundle, const char *name);
+const void *BundleData(const Bundle *bundle, const BundleEntry *entry);
+
+// Pack files into a bundle at path, stats may be NULL
+bool BundleWrite(const char *path, const char *const *files, int count, BundleStats *stats);
+
+// 64-bit FNV-1a, used to spot identical content
+uint64_t BundleHash(const void *data, size_t size);
+
+#endif // BUNDLE_H
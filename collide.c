@@ -0,0 +1,229 @@
+#include "collide.h"
+#include <math.h>
+
+bool CircleRectOverlap(SimVec2 center, float radius, SimRect rect) {
+    float recCenterX = rect.x + rect.width / 2.0f;
+    float recCenterY = rect.y + rect.height / 2.0f;
+    float dx = fabsf(center.x - recCenterX);
+    float dy = fabsf(center.y - recCenterY);
+
+    if (dx > (rect.width / 2.0f + radius)) return false;
+    if (dy > (rect.height / 2.0f + radius)) return false;
+    if (dx <= (rect.width / 2.0f)) return true;
+    if (dy <= (rect.height / 2.0f)) return true;
+
+    float cornerDistanceSq = (dx - rect.width / 2.0f) * (dx - rect.width / 2.0f) +
+                             (dy - rect.height / 2.0f) * (dy - rect.height / 2.0f);
+    return cornerDistanceSq <= radius * radius;
+}
+
+// Ball already overlapping the box: push it out along the shortest way
+static bool ResolveOverlap(SimVec2 start, SimVec2 motion, float radius, SimRect rect, SweepHit *hit) {
+    float closestX = fminf(fmaxf(start.x, rect.x), rect.x + rect.width);
+    float closestY = fminf(fmaxf(start.y, rect.y), rect.y + rect.height);
+    float dx = start.x - closestX;
+    float dy = start.y - closestY;
+    float distanceSq = dx * dx + dy * dy;
+    SimVec2 normal;
+    float depth;
+
+    if (distanceSq > 0.0f) {
+        float distance = sqrtf(distanceSq);
+        normal = (SimVec2){ dx / distance, dy / distance };
+        depth = radius - distance;
+    } else {
+        // Center inside the box, leave through the nearest face
+        float left = start.x - rect.x;
+        float right = rect.x + rect.width - start.x;
+        float top = start.y - rect.y;
+        float bottom = rect.y + rect.height - start.y;
+        float best = left;
+        normal = (SimVec2){ -1, 0 };
+        if (right < best) { best = right; normal = (SimVec2){ 1, 0 }; }
+        if (top < best) { best = top; normal = (SimVec2){ 0, -1 }; }
+        if (bottom < best) { best = bottom; normal = (SimVec2){ 0, 1 }; }
+        depth = best + radius;
+    }
+
+    // Moving away already, nothing to report
+    if (motion.x * normal.x + motion.y * normal.y >= 0.0f) return false;
+
+    hit->time = 0.0f;
+    hit->normal = normal;
+    hit->depth = depth;
+    return true;
+}
+
+bool SweepCircleRect(SimVec2 start, SimVec2 motion, float radius, SimRect rect, float maxTime, SweepHit *hit) {
+    // Cheap reject: bounds of the whole sweep against the grown box
+    float endX = start.x + motion.x * maxTime;
+    float endY = start.y + motion.y * maxTime;
+    if (fmaxf(start.x, endX) < rect.x - radius || fminf(start.x, endX) > rect.x + rect.width + radius) return false;
+    if (fmaxf(start.y, endY) < rect.y - radius || fminf(start.y, endY) > rect.y + rect.height + radius) return false;
+
+    if (CircleRectOverlap(start, radius, rect)) {
+        // Exactly touching counts as a contact at time 0 only when moving in
+        return ResolveOverlap(start, motion, radius, rect, hit);
+    }
+
+    // Slab test against the box grown by the radius
+    float minX = rect.x - radius, maxX = rect.x + rect.width + radius;
+    float minY = rect.y - radius, maxY = rect.y + rect.height + radius;
+    float enter = 0.0f, exit = maxTime;
+    SimVec2 normal = { 0, 0 };
+
+    if (motion.x == 0.0f) {
+        if (start.x < minX || start.x > maxX) return false;
+    } else {
+        float t1 = (minX - start.x) / motion.x;
+        float t2 = (maxX - start.x) / motion.x;
+        SimVec2 n = { -1, 0 };
+        if (t1 > t2) { float t = t1; t1 = t2; t2 = t; n.x = 1; }
+        if (t1 > enter) { enter = t1; normal = n; }
+        if (t2 < exit) exit = t2;
+        if (enter > exit) return false;
+    }
+
+    if (motion.y == 0.0f) {
+        if (start.y < minY || start.y > maxY) return false;
+    } else {
+        float t1 = (minY - start.y) / motion.y;
+        float t2 = (maxY - start.y) / motion.y;
+        SimVec2 n = { 0, -1 };
+        if (t1 > t2) { float t = t1; t1 = t2; t2 = t; n.y = 1; }
+        if (t1 > enter) { enter = t1; normal = n; }
+        if (t2 < exit) exit = t2;
+        if (enter > exit) return false;
+    }
+
+    // Entering the grown box near a corner only counts if the corner circle is hit
+    float hitX = start.x + motion.x * enter;
+    float hitY = start.y + motion.y * enter;
+    bool outsideX = hitX < rect.x || hitX > rect.x + rect.width;
+    bool outsideY = hitY < rect.y || hitY > rect.y + rect.height;
+
+    // No face crossed means the sweep starts on the grown box: the circle touches
+    // a face to within rounding, so treat it like an overlap
+    if (normal.x == 0.0f && normal.y == 0.0f && !(outsideX && outsideY)) {
+        return ResolveOverlap(start, motion, radius, rect, hit);
+    }
+
+    if (outsideX && outsideY) {
+        float cornerX = (hitX < rect.x) ? rect.x : rect.x + rect.width;
+        float cornerY = (hitY < rect.y) ? rect.y : rect.y + rect.height;
+        float px = start.x - cornerX;
+        float py = start.y - cornerY;
+        float a = motion.x * motion.x + motion.y * motion.y;
+        float b = px * motion.x + py * motion.y;
+        float c = px * px + py * py - radius * radius;
+        float discriminant = b * b - a * c;
+        if (discriminant < 0.0f || a == 0.0f) return false;
+
+        float t = (-b - sqrtf(discriminant)) / a;
+        if (t < 0.0f || t > maxTime) return false;
+
+        float nx = px + motion.x * t;
+        float ny = py + motion.y * t;
+        float length = sqrtf(nx * nx + ny * ny);
+        enter = t;
+        normal = (SimVec2){ nx / length, ny / length };
+    }
+
+    hit->time = enter;
+    hit->normal = normal;
+    hit->depth = 0.0f;
+    return true;
+}
+
+bool SweepPlane(float start, float motion, float limit, bool positive, float maxTime, float *time) {
+    if (positive) {
+        if (motion <= 0.0f) return false;
+        if (start >= limit) { *time = 0.0f; return true; }
+    } else {
+        if (motion >= 0.0f) return false;
+        if (start <= limit) { *time = 0.0f; return true; }
+    }
+
+    float t = (limit - start) / motion;
+    if (t > maxTime) return false;
+    *time = t;
+    return true;
+}
+
+bool SweepCircleCircle(SimVec2 start, SimVec2 motion, float radius, SimVec2 center, float circleRadius, float maxTime, SweepHit *hit) {
+    float reach = radius + circleRadius;
+    float px = start.x - center.x;
+    float py = start.y - center.y;
+    float distanceSq = px * px + py * py;
+
+    if (distanceSq <= reach * reach) {
+        // Already touching: push out along the line between the centers if moving in
+        float distance = sqrtf(distanceSq);
+        SimVec2 normal = (distance > 0.0f) ? (SimVec2){ px / distance, py / distance } : (SimVec2){ 0, -1 };
+        if (motion.x * normal.x + motion.y * normal.y >= 0.0f) return false;
+        hit->time = 0.0f;
+        hit->normal = normal;
+        hit->depth = reach - distance;
+        return true;
+    }
+
+    // Ray against the circle grown by the ball radius
+    float a = motion.x * motion.x + motion.y * motion.y;
+    float b = px * motion.x + py * motion.y;
+    if (a == 0.0f || b >= 0.0f) return false;
+    float discriminant = b * b - a * (distanceSq - reach * reach);
+    if (discriminant < 0.0f) return false;
+
+    float t = (-b - sqrtf(discriminant)) / a;
+    if (t > maxTime) return false;
+    hit->time = t;
+    hit->normal = (SimVec2){ (px + motion.x * t) / reach, (py + motion.y * t) / reach };
+    hit->depth = 0.0f;
+    return true;
+}
+
+bool SweepCircleSegment(SimVec2 start, SimVec2 motion, float radius, SimVec2 a, SimVec2 b, float thickness, float maxTime, SweepHit *hit) {
+    float reach = radius + thickness;
+    float dx = b.x - a.x, dy = b.y - a.y;
+    float lengthSq = dx * dx + dy * dy;
+    if (lengthSq == 0.0f) return SweepCircleCircle(start, motion, radius, a, thickness, maxTime, hit);
+
+    // Closest point on the segment, closer than the reach means the capsule already overlaps the ball
+    float along = fminf(fmaxf(((start.x - a.x) * dx + (start.y - a.y) * dy) / lengthSq, 0.0f), 1.0f);
+    SimVec2 closest = { a.x + dx * along, a.y + dy * along };
+    float px = start.x - closest.x, py = start.y - closest.y;
+    if (px * px + py * py <= reach * reach) return SweepCircleCircle(start, motion, radius, closest, thickness, maxTime, hit);
+
+    // Flat side facing the ball: the segment's normal towards the start point
+    float length = sqrtf(lengthSq);
+    SimVec2 normal = { -dy / length, dx / length };
+    float height = (start.x - a.x) * normal.x + (start.y - a.y) * normal.y;
+    if (height < 0.0f) {
+        normal = (SimVec2){ -normal.x, -normal.y };
+        height = -height;
+    }
+    bool found = false;
+    float approach = motion.x * normal.x + motion.y * normal.y;
+    if (approach < 0.0f && height > reach) {
+        float t = (height - reach) / -approach;
+        float s = ((start.x + motion.x * t - a.x) * dx + (start.y + motion.y * t - a.y) * dy) / lengthSq;
+        if (t <= maxTime && s >= 0.0f && s <= 1.0f) {
+            *hit = (SweepHit){ t, normal, 0.0f };
+            found = true;
+            maxTime = t;
+        }
+    }
+
+    // Rounded ends
+    SweepHit end;
+    if (SweepCircleCircle(start, motion, radius, a, thickness, maxTime, &end) && (!found || end.time < hit->time)) {
+        *hit = end;
+        found = true;
+        maxTime = end.time;
+    }
+    if (SweepCircleCircle(start, motion, radius, b, thickness, maxTime, &end) && (!found || end.time < hit->time)) {
+        *hit = end;
+        found = true;
+    }
+    return found;
+}
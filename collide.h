@@ -0,0 +1,31 @@
+#ifndef COLLIDE_H
+#define COLLIDE_H
+
+#include "sim.h"
+
+// Continuous collision tests for the ball. A moving circle against a box is
+// the same as a ray against the box grown by the radius with rounded corners.
+
+typedef struct SweepHit {
+    float time;       // Fraction of the motion at first contact, 0 when already touching
+    SimVec2 normal;   // Surface normal at the contact, pointing towards the ball
+    float depth;      // Penetration at the start of the motion, 0 for a clean hit
+} SweepHit;
+
+// Discrete overlap test, same as raylib's CheckCollisionCircleRec
+bool CircleRectOverlap(SimVec2 center, float radius, SimRect rect);
+
+// First contact of a circle moving from start by motion against rect, within [0, maxTime].
+// Only reports contacts the circle is moving into, so a ball leaving a surface never re-triggers.
+bool SweepCircleRect(SimVec2 start, SimVec2 motion, float radius, SimRect rect, float maxTime, SweepHit *hit);
+
+// Same for a static circle, the ball sees it grown by its own radius
+bool SweepCircleCircle(SimVec2 start, SimVec2 motion, float radius, SimVec2 center, float circleRadius, float maxTime, SweepHit *hit);
+
+// Same for a segment from a to b with the given half thickness (a capsule), 0 for a thin line
+bool SweepCircleSegment(SimVec2 start, SimVec2 motion, float radius, SimVec2 a, SimVec2 b, float thickness, float maxTime, SweepHit *hit);
+
+// First time a point moving by motion reaches the line coord = limit from the inside
+bool SweepPlane(float start, float motion, float limit, bool positive, float maxTime, float *time);
+
+#endif // COLLIDE_H
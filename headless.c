@@ -0,0 +1,2033 @@
+#include "sim.h"
+#include "ai.h"
+#include "arena.h"
+#include "botlink.h"
+#include "bundle.h"
+#include "collide.h"
+#include "level.h"
+#include "net.h"
+#include "particles.h"
+#include "pipeline.h"
+#include "power.h"
+#include "rain.h"
+#include "replay.h"
+#include "resolution.h"
+#include "rollback.h"
+#include "server.h"
+#include "telemetry.h"
+#include "tournament.h"
+#include "vecenv.h"
+#include "world.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+// Headless runner: plays LAVA VS ICE matches without a window or audio device.
+// Usage: pong_headless <command> [options], run without arguments for help.
+
+static double NowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Look up "--name value" in the argument list
+static const char *GetOption(int argc, char **argv, const char *name, const char *fallback) {
+    for (int i = 0; i < argc - 1; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+static bool HasFlag(int argc, char **argv, const char *name) {
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static Difficulty ParseDifficulty(const char *text) {
+    if (strcmp(text, "easy") == 0) return EASY;
+    if (strcmp(text, "hard") == 0) return HARD;
+    return MEDIUM;
+}
+
+// Both paddles driven by the built-in AI
+static const SimInput aiVsAi = { .left = { .ai = true }, .right = { .ai = true } };
+
+// Every touching pair by checking all of them, the reference for the arena grid
+static int BruteForceContacts(const Arena *arena) {
+    const float diameter = 2.0f * arena->config.radius;
+    int contacts = 0;
+    for (int i = 0; i < arena->ballCount; i++) {
+        for (int j = i + 1; j < arena->ballCount; j++) {
+            float dx = arena->x[j] - arena->x[i];
+            float dy = arena->y[j] - arena->y[i];
+            if (dx * dx + dy * dy < diameter * diameter) contacts++;
+        }
+    }
+    return contacts;
+}
+
+// arena: time arena steps for growing ball counts. The field and obstacle count grow
+// with the balls so crowding stays the same and only the count changes. Every so often
+// the grid's contact count is checked against testing every pair.
+static int RunArena(int argc, char **argv) {
+    const char *counts = GetOption(argc, argv, "--balls", "500,1000,2000,4000,8000,16000");
+    int obstacles = atoi(GetOption(argc, argv, "--obstacles", "200"));
+    int ticks = atoi(GetOption(argc, argv, "--ticks", "600"));
+    int checkEvery = atoi(GetOption(argc, argv, "--check-every", "100"));
+    int bruteLimit = atoi(GetOption(argc, argv, "--brute-limit", "8000"));
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    long mismatches = 0;
+
+    printf("%7s %11s %6s %9s %9s %10s %10s %10s\n",
+           "balls", "field", "obst", "step ms", "ns/ball", "pairs/ball", "touching", "brute ms");
+    for (const char *text = counts; *text != '\0';) {
+        int balls = atoi(text);
+        while (*text != '\0' && *text != ',') text++;
+        if (*text == ',') text++;
+        if (balls <= 0) continue;
+
+        // Same density as the default party on a 1280x800 field
+        float scale = sqrtf((float)balls / ARENA_DEFAULT_BALLS);
+        ArenaConfig config = ArenaDefaultConfig(difficulty, roundf(1280 * scale), roundf(800 * scale));
+        config.balls = balls;
+        config.obstacles = (int)(obstacles * scale * scale);
+        config.seconds = ticks / config.sim.tickRate + 1.0f;
+        Arena arena;
+        if (!ArenaInit(&arena, config, seed)) {
+            printf("could not allocate %d balls\n", balls);
+            return 1;
+        }
+
+        double stepSeconds = 0, bruteSeconds = 0;
+        uint64_t pairTests = 0, contacts = 0;
+        int checks = 0;
+        for (int t = 0; t < ticks; t++) {
+            double start = NowSeconds();
+            ArenaStep(&arena, aiVsAi);
+            stepSeconds += NowSeconds() - start;
+            pairTests += arena.stats.pairTests;
+            contacts += arena.stats.ballContacts;
+
+            if (checkEvery > 0 && t % checkEvery == 0 && balls <= bruteLimit) {
+                int grid = ArenaCountContacts(&arena);
+                start = NowSeconds();
+                int brute = BruteForceContacts(&arena);
+                bruteSeconds += NowSeconds() - start;
+                checks++;
+                if (grid != brute) {
+                    printf("tick %d: grid found %d touching pairs, brute force %d\n", t, grid, brute);
+                    mismatches++;
+                }
+            }
+        }
+
+        char field[32], brute[32] = "-";
+        snprintf(field, sizeof(field), "%.0fx%.0f", config.sim.width, config.sim.height);
+        if (checks > 0) snprintf(brute, sizeof(brute), "%.3f", bruteSeconds / checks * 1000.0);
+        printf("%7d %11s %6d %9.3f %9.1f %10.1f %10.2f %10s\n", balls, field, arena.obstacleCount,
+               stepSeconds / ticks * 1000.0, stepSeconds / ticks / balls * 1e9,
+               (double)pairTests / ticks / balls, (double)contacts / ticks / balls, brute);
+        ArenaFree(&arena);
+    }
+    printf("mismatches:     %ld\n", mismatches);
+    return mismatches ? 1 : 0;
+}
+
+// batch: play many AI vs AI matches and report the results
+static int RunBatch(int argc, char **argv) {
+    long matches = atol(GetOption(argc, argv, "--matches", "10000"));
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    long maxTicks = atol(GetOption(argc, argv, "--max-ticks", "200000"));
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    bool verbose = HasFlag(argc, argv, "--verbose");
+
+    const char *levelPath = GetOption(argc, argv, "--level", NULL);
+
+    SimConfig config = SimDifficultyConfig(difficulty, 1280, 800);
+    config.tickRate = (float)atof(GetOption(argc, argv, "--tick-rate", "120"));
+    Level level;
+    if (levelPath != NULL) {
+        if (!LevelLoad(&level, levelPath)) {
+            printf("could not load %s (line %d)\n", levelPath, level.errorLine);
+            return 1;
+        }
+        config.level = &level;
+    }
+    long lavaWins = 0, iceWins = 0, unfinished = 0;
+    long long totalTicks = 0, paddleHits = 0;
+
+    double start = NowSeconds();
+    for (long m = 0; m < matches; m++) {
+        SimState state;
+        SimInit(&state, config, seed + (uint64_t)m);
+        while (state.winner == SIDE_NONE && state.tick < (uint32_t)maxTicks) {
+            if (SimStep(&state, aiVsAi) & SIM_EVENT_PADDLE_HIT) paddleHits++;
+        }
+        totalTicks += state.tick;
+        if (state.winner == SIDE_LAVA) lavaWins++;
+        else if (state.winner == SIDE_ICE) iceWins++;
+        else unfinished++;
+        if (verbose) printf("match %ld: %d-%d in %u ticks\n", m, state.leftScore, state.rightScore, state.tick);
+    }
+    double elapsed = NowSeconds() - start;
+
+    printf("matches:        %ld\n", matches);
+    printf("lava wins:      %ld\n", lavaWins);
+    printf("ice wins:       %ld\n", iceWins);
+    printf("unfinished:     %ld\n", unfinished);
+    printf("avg ticks:      %.1f\n", matches ? (double)totalTicks / matches : 0.0);
+    printf("paddle hits:    %lld\n", paddleHits);
+    printf("elapsed:        %.3f s\n", elapsed);
+    printf("matches/sec:    %.0f\n", elapsed > 0 ? matches / elapsed : 0.0);
+    printf("ticks/sec:      %.0f\n", elapsed > 0 ? totalTicks / elapsed : 0.0);
+    if (levelPath != NULL) LevelFree(&level);
+    return unfinished ? 1 : 0;
+}
+
+// Held-key pattern standing in for a human player: runs of up, idle or down indexed by tick
+static int ScriptedMove(uint64_t seed, uint32_t tick) {
+    uint64_t x = seed ^ ((uint64_t)(tick / 30) * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    return (int)(x % 3) - 1;
+}
+
+// One match played the way the game plays it: frames of real time, stalled now and then, feed
+// SimClock, which decides how many steps each frame runs. The scripted left paddle is keyed by
+// step like a replay's input, so frame timing can only change the outcome if the clock does.
+typedef struct StressRun {
+    SimState state;
+    long frames;
+    long stalls;
+    double realSeconds;
+    double droppedSeconds;
+    long steps;                 // Granted by the clock, run or not
+    double worstClockError;     // Real time minus dropped time minus granted game time, beyond one tick
+} StressRun;
+
+static StressRun PlayFrames(SimConfig config, uint64_t seed, long maxTicks, double displayHz, int stallPercent,
+                            double maxStallMs, uint64_t *frameRng) {
+    StressRun run = { 0 };
+    SimInit(&run.state, config, seed);
+    SimClock clock;
+    SimClockInit(&clock, config.tickRate);
+    SimInput input = { .right = { .ai = true } };
+    SimState *state = &run.state;
+
+    while (state->winner == SIDE_NONE && state->tick < (uint32_t)maxTicks) {
+        double frameSeconds = 1.0 / displayHz;
+        uint64_t x = *frameRng;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        *frameRng = x;
+        if ((int)(x % 100) < stallPercent) {
+            frameSeconds += (double)(x >> 40 & 0xFFFF) / 0xFFFF * maxStallMs / 1000.0;
+            run.stalls++;
+        }
+        run.frames++;
+        run.realSeconds += frameSeconds;
+
+        int steps = SimClockAdvance(&clock, frameSeconds);
+        run.steps += steps;
+        double error = run.realSeconds - clock.droppedSeconds - run.steps * clock.tickSeconds;
+        double beyond = (error < 0.0) ? -error : error - clock.tickSeconds;
+        if (beyond > run.worstClockError) run.worstClockError = beyond;
+
+        for (int i = 0; i < steps && state->winner == SIDE_NONE && state->tick < (uint32_t)maxTicks; i++) {
+            input.left.move = ScriptedMove(seed, state->tick);
+            SimStep(state, input);
+        }
+    }
+    run.droppedSeconds = clock.droppedSeconds;
+    return run;
+}
+
+// Play a world's match to the end with the AI on both sides, returns the final hash
+static uint64_t FinishMatch(World *world) {
+    while (world->sim.winner == SIDE_NONE && world->sim.tick < 500000) {
+        world->previousSim = world->sim;
+        SimStep(&world->sim, aiVsAi);
+    }
+    return SimHash(&world->sim);
+}
+
+// snapshot: time world snapshots and restores, then check that a match restored
+// halfway, in memory and through a file, plays out exactly like the original
+static int RunSnapshot(int argc, char **argv) {
+    long count = atol(GetOption(argc, argv, "--count", "10000000"));
+    long matches = atol(GetOption(argc, argv, "--matches", "100"));
+    const char *outPath = GetOption(argc, argv, "--out", NULL);
+    const char *levelPath = GetOption(argc, argv, "--level", NULL);
+    const char *path = (outPath != NULL) ? outPath : "snapshot_check.wld";
+
+    SimConfig config = SimDifficultyConfig(MEDIUM, 1280, 800);
+    Level level;
+    if (levelPath != NULL) {
+        if (!LevelLoad(&level, levelPath)) {
+            printf("could not load %s (line %d)\n", levelPath, level.errorLine);
+            return 1;
+        }
+        config.level = &level;
+    }
+    World world;
+    WorldInit(&world);
+    world.screen = PLAYING;
+    SimInit(&world.sim, config, 1);
+    world.previousSim = world.sim;
+    SimClockInit(&world.clock, config.tickRate);
+
+    // A ring of snapshots so no copy is dead, the ticks read back keep the loops honest
+    enum { RING = 16 };
+    static World ring[RING];
+    uint64_t ticks = 0;
+    double start = NowSeconds();
+    for (long i = 0; i < count; i++) {
+        world.sim.tick = (uint32_t)i;
+        WorldSnapshot(&world, &ring[i % RING]);
+    }
+    double saveSeconds = NowSeconds() - start;
+    start = NowSeconds();
+    for (long i = 0; i < count; i++) {
+        WorldRestore(&world, &ring[i % RING], config.level);
+        ticks += world.sim.tick;
+    }
+    double restoreSeconds = NowSeconds() - start;
+
+    // Restored matches must end on the same state as the ones they were taken from
+    long mismatches = 0, fileMismatches = 0;
+    for (long m = 0; m < matches; m++) {
+        SimInit(&world.sim, config, 100 + (uint64_t)m);
+        world.previousSim = world.sim;
+        for (uint32_t t = 0; t < 3000 && world.sim.winner == SIDE_NONE; t++) SimStep(&world.sim, aiVsAi);
+        World snapshot, loaded;
+        WorldSnapshot(&world, &snapshot);
+        bool saved = WorldSave(&snapshot, path);
+        uint64_t expected = FinishMatch(&world);
+
+        if (!WorldRestore(&world, &snapshot, config.level) || FinishMatch(&world) != expected) mismatches++;
+        if (!saved || !WorldLoad(&loaded, path) || !WorldRestore(&world, &loaded, config.level) ||
+            FinishMatch(&world) != expected) {
+            fileMismatches++;
+        }
+    }
+
+    // Files that would break SimStep must not load: a count past obstacles[], no tick rate, no such side
+    long corruptLoaded = 0;
+    for (int c = 0; c < 3; c++) {
+        World snapshot, loaded;
+        WorldSnapshot(&world, &snapshot);
+        if (c == 0) snapshot.sim.obstacleCount = SIM_MAX_OBSTACLES + 1000;
+        if (c == 1) snapshot.previousSim.config.tickRate = 0.0f;
+        if (c == 2) snapshot.sim.winner = (SimSide)7;
+        if (WorldSave(&snapshot, path) && WorldLoad(&loaded, path)) corruptLoaded++;
+    }
+    if (outPath == NULL) remove(path);
+
+    printf("world size:     %zu bytes\n", sizeof(World));
+    printf("snapshot:       %.1f ns, %.1f million per second\n", saveSeconds / count * 1e9, count / saveSeconds / 1e6);
+    printf("restore:        %.1f ns, %.1f million per second\n", restoreSeconds / count * 1e9, count / restoreSeconds / 1e6);
+    printf("tick checksum:  %llu\n", (unsigned long long)ticks);
+    printf("matches:        %ld restored at tick 3000\n", matches);
+    printf("mismatches:     %ld in memory, %ld through %s\n", mismatches, fileMismatches, path);
+    printf("corrupt files:  %ld of 3 loaded\n", corruptLoaded);
+    if (levelPath != NULL) LevelFree(&level);
+    return (mismatches || fileMismatches || corruptLoaded) ? 1 : 0;
+}
+
+// stress: play matches frame by frame with random stalls and once at a steady frame rate.
+// Every match must end on the same state both ways, and game time must track real time
+// minus what the frame cap dropped.
+static int RunStress(int argc, char **argv) {
+    long matches = atol(GetOption(argc, argv, "--matches", "200"));
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    long maxTicks = atol(GetOption(argc, argv, "--max-ticks", "200000"));
+    double displayHz = atof(GetOption(argc, argv, "--display-hz", "144"));
+    int stallPercent = atoi(GetOption(argc, argv, "--stall-percent", "5"));
+    double maxStallMs = atof(GetOption(argc, argv, "--max-stall-ms", "200"));
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+
+    SimConfig config = SimDifficultyConfig(difficulty, 1280, 800);
+    config.tickRate = (float)atof(GetOption(argc, argv, "--tick-rate", "120"));
+
+    long frames = 0, stalls = 0, clockErrors = 0, mismatches = 0, lavaWins = 0, iceWins = 0;
+    double realSeconds = 0, gameSeconds = 0, droppedSeconds = 0, worstClockError = 0;
+    uint64_t frameRng = seed * 0x2545F4914F6CDD1DULL + 1;
+    uint64_t referenceRng = frameRng;
+
+    for (long m = 0; m < matches; m++) {
+        uint64_t matchSeed = seed + (uint64_t)m;
+        StressRun reference = PlayFrames(config, matchSeed, maxTicks, displayHz, 0, 0.0, &referenceRng);
+        StressRun run = PlayFrames(config, matchSeed, maxTicks, displayHz, stallPercent, maxStallMs, &frameRng);
+
+        frames += run.frames;
+        stalls += run.stalls;
+        realSeconds += run.realSeconds;
+        droppedSeconds += run.droppedSeconds;
+        gameSeconds += run.state.tick / (double)config.tickRate;
+        lavaWins += run.state.winner == SIDE_LAVA;
+        iceWins += run.state.winner == SIDE_ICE;
+        if (run.worstClockError > worstClockError) worstClockError = run.worstClockError;
+        if (run.worstClockError > 1e-6) {
+            clockErrors++;
+            printf("match %ld: game time off real time by %.6f s beyond a tick\n", m, run.worstClockError);
+        }
+        if (SimHash(&run.state) != SimHash(&reference.state)) {
+            mismatches++;
+            printf("match %ld: ends on another state than without stalls (tick %u vs %u, %d-%d vs %d-%d)\n", m,
+                   run.state.tick, reference.state.tick, run.state.leftScore, run.state.rightScore,
+                   reference.state.leftScore, reference.state.rightScore);
+        }
+    }
+
+    printf("matches:        %ld (lava %ld, ice %ld)\n", matches, lavaWins, iceWins);
+    printf("tick rate:      %.0f Hz\n", config.tickRate);
+    printf("display rate:   %.0f Hz\n", displayHz);
+    printf("frames:         %ld (%ld stalled)\n", frames, stalls);
+    printf("real time:      %.1f s\n", realSeconds);
+    printf("game time:      %.1f s (%.1f s dropped by the frame cap)\n", gameSeconds, droppedSeconds);
+    printf("clock:          worst %.2e s beyond a tick of real time minus dropped time, %ld matches off\n",
+           worstClockError, clockErrors);
+    printf("mismatches:     %ld of %ld end differently from the stall-free run\n", mismatches, matches);
+    bool failed = clockErrors > 0 || mismatches > 0;
+    printf("failures:       %d\n", failed ? 1 : 0);
+    return failed ? 1 : 0;
+}
+
+// Uniform float in [low, high) from a xorshift state
+static float RandomRange(uint64_t *rng, float low, float high) {
+    uint64_t x = *rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *rng = x;
+    return low + (high - low) * (float)((x >> 40) / (double)(1 << 24));
+}
+
+// How far a circle at center sinks into rect, negative when apart
+static float Penetration(SimVec2 center, float radius, SimRect rect) {
+    float closestX = fminf(fmaxf(center.x, rect.x), rect.x + rect.width);
+    float closestY = fminf(fmaxf(center.y, rect.y), rect.y + rect.height);
+    float dx = center.x - closestX;
+    float dy = center.y - closestY;
+    return radius - sqrtf(dx * dx + dy * dy);
+}
+
+// Sub-stepped reference: first sample along the motion where the circle overlaps rect,
+// also reports the deepest penetration seen so grazing contacts can be told apart
+static int ReferenceContact(SimVec2 start, SimVec2 motion, float radius, SimRect rect, int substeps, float *deepest) {
+    int first = -1;
+    *deepest = -INFINITY;
+    for (int i = 0; i <= substeps; i++) {
+        float t = (float)i / substeps;
+        SimVec2 point = { start.x + motion.x * t, start.y + motion.y * t };
+        float depth = Penetration(point, radius, rect);
+        if (depth > *deepest) *deepest = depth;
+        if (first < 0 && CircleRectOverlap(point, radius, rect)) first = i;
+    }
+    return first;
+}
+
+// fuzz: check SweepCircleRect against a brute-force sub-stepped reference, then run
+// matches at extreme ball speeds and look for tunnelling through paddles and obstacles
+static int RunFuzz(int argc, char **argv) {
+    long cases = atol(GetOption(argc, argv, "--cases", "50000"));
+    uint64_t rng = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10) * 0x9E3779B97F4A7C15ULL + 1;
+    int substeps = atoi(GetOption(argc, argv, "--substeps", "4000"));
+    float speedScale = (float)atof(GetOption(argc, argv, "--speed-scale", "40"));
+    const float grazing = 0.05f;   // Contacts shallower than this may go either way
+    long failures = 0, hits = 0, skipped = 0;
+
+    for (long c = 0; c < cases; c++) {
+        SimRect rect = { RandomRange(&rng, -50, 50), RandomRange(&rng, -50, 50), RandomRange(&rng, 1, 60), RandomRange(&rng, 1, 120) };
+        float radius = RandomRange(&rng, 1, 30);
+        SimVec2 start = { RandomRange(&rng, -200, 200), RandomRange(&rng, -200, 200) };
+        float scale = (c % 4 == 0) ? 2000.0f : 300.0f;   // Every fourth case is a very fast ball
+        SimVec2 motion = { RandomRange(&rng, -scale, scale), RandomRange(&rng, -scale, scale) };
+        if (CircleRectOverlap(start, radius, rect)) {
+            skipped++;
+            continue;
+        }
+
+        float deepest;
+        int reference = ReferenceContact(start, motion, radius, rect, substeps, &deepest);
+        SweepHit hit;
+        bool swept = SweepCircleRect(start, motion, radius, rect, 1.0f, &hit);
+
+        if (swept) hits++;
+        if (deepest < grazing) continue;
+        if (!swept || reference < 0) {
+            failures++;
+            printf("case %ld: swept %s, reference %s (penetration %.4f)\n", c, swept ? "hit" : "miss",
+                   reference < 0 ? "miss" : "hit", deepest);
+            continue;
+        }
+
+        // Time of impact must land within a couple of reference steps, scaled by how
+        // far a grazing tolerance can shift contact at this speed
+        float length = sqrtf(motion.x * motion.x + motion.y * motion.y);
+        float tolerance = 2.0f / substeps + grazing / length * 20.0f;
+        float referenceTime = (float)reference / substeps;
+        if (fabsf(hit.time - referenceTime) > tolerance) {
+            failures++;
+            printf("case %ld: time %.6f, reference %.6f\n", c, hit.time, referenceTime);
+        }
+    }
+    printf("sweep cases:    %ld (%ld hits, %ld skipped overlapping starts)\n", cases, hits, skipped);
+    printf("sweep failures: %ld\n", failures);
+
+    // Whole matches with the ball sped up: whenever a step had no contact the ball
+    // moved in a straight line, so sample that line densely for boxes it went through
+    long tunnels = 0, steps = 0;
+    for (int m = 0; m < 200; m++) {
+        SimConfig config = SimDifficultyConfig((Difficulty)(m % 3), 1280, 800);
+        config.serveSpeed *= speedScale;
+        config.maxSpeed *= speedScale;
+        config.hitBoost *= speedScale;
+        SimState state;
+        SimInit(&state, config, (uint64_t)m + 1);
+        while (state.winner == SIDE_NONE && state.tick < 20000) {
+            SimState before = state;
+            unsigned int events = SimStep(&state, aiVsAi);
+            steps++;
+            if (events) continue;
+
+            SimVec2 motion = { state.ballPosition.x - before.ballPosition.x, state.ballPosition.y - before.ballPosition.y };
+            SimRect boxes[SIM_MAX_OBSTACLES + 2] = { state.leftPaddle, state.rightPaddle };
+            int boxCount = 2;
+            for (int i = 0; i < state.obstacleCount; i++) boxes[boxCount++] = state.obstacles[i];
+            for (int i = 0; i < boxCount; i++) {
+                float deepest;
+                ReferenceContact(before.ballPosition, motion, config.ballRadius, boxes[i], 256, &deepest);
+                if (deepest > 0.5f) {
+                    tunnels++;
+                    printf("match %d tick %u: ball passed %.2f px into box %d\n", m, state.tick, deepest, i);
+                }
+            }
+        }
+    }
+    printf("match steps:    %ld at %.0fx ball speed\n", steps, speedScale);
+    printf("tunnels:        %ld\n", tunnels);
+    return (failures || tunnels) ? 1 : 0;
+}
+
+// resolution: run the dynamic resolution controller against a frame cost model, a
+// fixed part plus a fill part that goes with the pixel count, with noise and a stretch
+// of heavier drawing in the middle (like the menu effects), and report how it held the budget
+static int RunResolution(int argc, char **argv) {
+    float budget = (float)atof(GetOption(argc, argv, "--budget-ms", "16.6")) / 1000.0f;
+    float fixedCost = (float)atof(GetOption(argc, argv, "--fixed-ms", "4")) / 1000.0f;
+    float fillCost = (float)atof(GetOption(argc, argv, "--fill-ms", "10")) / 1000.0f;
+    float heavy = (float)atof(GetOption(argc, argv, "--heavy", "2.5"));
+    float noise = (float)atof(GetOption(argc, argv, "--noise-percent", "10")) / 100.0f;
+    int frames = atoi(GetOption(argc, argv, "--frames", "3000"));
+    float minScale = (float)atof(GetOption(argc, argv, "--min-scale", "0.5"));
+    uint64_t rng = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+
+    Resolution resolution;
+    ResolutionInit(&resolution, budget, minScale, 1.0f);
+    int heavyStart = frames / 3, heavyEnd = 2 * frames / 3;
+    int over[3] = { 0 }, counted[3] = { 0 };
+    double scaleSum[3] = { 0 };
+    int settledAt = -1;
+    for (int f = 0; f < frames; f++) {
+        int part = (f < heavyStart) ? 0 : (f < heavyEnd) ? 1 : 2;
+        float fill = fillCost * (part == 1 ? heavy : 1.0f) * resolution.scale * resolution.scale;
+        float seconds = (fixedCost + fill) * RandomRange(&rng, 1.0f - noise, 1.0f + noise);
+        if (seconds > budget) over[part]++;
+        counted[part]++;
+        scaleSum[part] += resolution.scale;
+        bool changed = ResolutionUpdate(&resolution, seconds);
+        if (part == 1 && changed) settledAt = f - heavyStart;
+    }
+
+    const char *names[3] = { "light", "heavy", "light again" };
+    printf("budget:         %.2f ms, fixed %.2f ms, fill %.2f ms at full size (x%.1f when heavy)\n",
+           budget * 1000.0f, fixedCost * 1000.0f, fillCost * 1000.0f, heavy);
+    for (int p = 0; p < 3; p++) {
+        printf("%-12s    avg scale %.2f, %d of %d frames over budget\n", names[p],
+               scaleSum[p] / counted[p], over[p], counted[p]);
+    }
+    printf("last change:    %d frames into the heavy part\n", settledAt);
+    printf("scale changes:  %u\n", resolution.changes);
+    return 0;
+}
+
+// ai: time the intercept prediction and check it against where the ball really
+// crosses the paddle face, with the paddles moved out of the way
+static int RunAi(int argc, char **argv) {
+    long cases = atol(GetOption(argc, argv, "--cases", "100000"));
+    uint64_t rng = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10) * 0x9E3779B97F4A7C15ULL + 1;
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "hard"));
+    SimConfig config = SimDifficultyConfig(difficulty, 1280, 800);
+    long incoming = 0, checked = 0, misses = 0, bounces = 0;
+    double errorSum = 0, worstError = 0, predictSeconds = 0;
+
+    for (long c = 0; c < cases; c++) {
+        SimState state;
+        SimInit(&state, config, (uint64_t)c + 1);
+        state.ballPosition = (SimVec2){ RandomRange(&rng, 100, 1150), RandomRange(&rng, 25, 775) };
+        state.ballSpeed = (SimVec2){ RandomRange(&rng, 100, 900), RandomRange(&rng, -config.maxSpeed, config.maxSpeed) };
+        bool clear = true;
+        for (int i = 0; i < state.obstacleCount; i++) {
+            if (CircleRectOverlap(state.ballPosition, config.ballRadius, state.obstacles[i])) clear = false;
+        }
+        if (!clear) continue;
+
+        double start = NowSeconds();
+        AiPrediction prediction = AiPredict(&state, SIDE_ICE);
+        predictSeconds += NowSeconds() - start;
+        if (!prediction.incoming) continue;
+        incoming++;
+        bounces += prediction.bounces;
+
+        // Fly the real ball to the face, nothing in the way but walls and obstacles
+        float faceX = state.rightPaddle.x - config.ballRadius;
+        state.leftPaddle.x = -10000;
+        state.rightPaddle.x = 10000;
+        SimState before = state;
+        while (state.ballPosition.x < faceX && state.ballSpeed.x > 0 && state.tick < 10000) {
+            before = state;
+            SimStep(&state, (SimInput){ 0 });
+        }
+        if (state.ballPosition.x < faceX || state.leftScore + state.rightScore > 0) {
+            misses++;   // Predicted a crossing that never happened
+            continue;
+        }
+        float t = (faceX - before.ballPosition.x) / (state.ballPosition.x - before.ballPosition.x);
+        float actual = before.ballPosition.y + (state.ballPosition.y - before.ballPosition.y) * t;
+        double error = fabs(actual - prediction.y);
+        errorSum += error;
+        if (error > worstError) worstError = error;
+        checked++;
+    }
+
+    // Cost inside a real match, where predictions are cached between bounces
+    long matchTicks = 0;
+    uint32_t predictions = 0;
+    double matchStart = NowSeconds();
+    for (int m = 0; m < 200; m++) {
+        SimState state;
+        SimInit(&state, config, (uint64_t)m + 1);
+        while (state.winner == SIDE_NONE && state.tick < 200000) SimStep(&state, aiVsAi);
+        matchTicks += state.tick;
+        predictions += state.leftAi.predictions + state.rightAi.predictions;
+    }
+    double matchSeconds = NowSeconds() - matchStart;
+
+    printf("cases:          %ld (%ld incoming)\n", cases, incoming);
+    printf("avg bounces:    %.2f\n", incoming ? (double)bounces / incoming : 0.0);
+    printf("predict avg:    %.1f ns\n", cases ? predictSeconds / cases * 1e9 : 0.0);
+    printf("error avg:      %.3f px\n", checked ? errorSum / checked : 0.0);
+    printf("error worst:    %.3f px\n", worstError);
+    printf("never reached:  %ld\n", misses);
+    printf("match steps:    %ld, %.2f predictions per 100 steps\n", matchTicks, matchTicks ? predictions * 100.0 / matchTicks : 0.0);
+    printf("step avg:       %.1f ns with both paddles on AI\n", matchTicks ? matchSeconds / matchTicks * 1e9 : 0.0);
+    return 0;
+}
+
+// pack: build the asset bundle the game maps at startup, then read it back and check it
+static int RunPack(int argc, char **argv) {
+    const char *out = GetOption(argc, argv, "--out", "assets.pak");
+    const char *defaults[] = {
+        "background_music.mp3", "game_over.wav", "enter.wav", "back.wav", "arrow.wav", "paddle_hit.wav"
+    };
+    const char **files = (const char **)defaults;
+    int count = (int)(sizeof(defaults) / sizeof(defaults[0]));
+
+    // Any argument that isn't an option or its value is a file to pack
+    const char **listed = malloc(sizeof(char *) * (size_t)(argc > 0 ? argc : 1));
+    int listedCount = 0;
+    for (int i = 0; listed != NULL && i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0) i++;
+        else listed[listedCount++] = argv[i];
+    }
+    if (listedCount > 0) {
+        files = listed;
+        count = listedCount;
+    }
+
+    BundleStats stats;
+    double start = NowSeconds();
+    bool written = BundleWrite(out, files, count, &stats);
+    double packSeconds = NowSeconds() - start;
+    free(listed);
+    if (!written) {
+        printf("could not pack into %s (missing file or name longer than %d characters?)\n", out, BUNDLE_NAME_LENGTH - 1);
+        return 1;
+    }
+
+    Bundle bundle;
+    start = NowSeconds();
+    bool opened = BundleOpen(&bundle, out);
+    double openSeconds = NowSeconds() - start;
+    if (!opened) {
+        printf("could not open %s\n", out);
+        return 1;
+    }
+
+    int bad = 0;
+    for (int i = 0; i < bundle.entryCount; i++) {
+        const BundleEntry *entry = &bundle.entries[i];
+        if (BundleHash(BundleData(&bundle, entry), entry->size) != entry->hash) bad++;
+        printf("  %-24s %10llu bytes at %llu\n", entry->name, (unsigned long long)entry->size,
+               (unsigned long long)entry->offset);
+    }
+    BundleClose(&bundle);
+
+    printf("files:          %d (%d unique)\n", stats.files, stats.uniqueBlobs);
+    printf("input:          %llu bytes\n", (unsigned long long)stats.inputBytes);
+    printf("bundle:         %llu bytes\n", (unsigned long long)stats.bundleBytes);
+    printf("pack time:      %.3f ms\n", packSeconds * 1000.0);
+    printf("open time:      %.3f ms\n", openSeconds * 1000.0);
+    printf("bad entries:    %d\n", bad);
+    return bad ? 1 : 0;
+}
+
+// Random level of about the given shape count over a 1280x800 field, as level file text
+static char *RandomLevelText(int shapes, uint64_t *rng, size_t *size) {
+    size_t capacity = (size_t)shapes * 96 + 64;
+    char *text = malloc(capacity);
+    if (text == NULL) return NULL;
+    size_t used = (size_t)snprintf(text, capacity, "level %d\n", LEVEL_VERSION);
+    for (int i = 0; i < shapes; i++) {
+        float x = RandomRange(rng, 100, 1180), y = RandomRange(rng, 0, 800);
+        float kind = RandomRange(rng, 0, 3);
+        if (kind < 1) {
+            used += (size_t)snprintf(text + used, capacity - used, "rect %.1f %.1f %.1f %.1f\n",
+                                     x, y, RandomRange(rng, 4, 24), RandomRange(rng, 4, 24));
+        } else if (kind < 2) {
+            used += (size_t)snprintf(text + used, capacity - used, "circle %.1f %.1f %.1f\n", x, y, RandomRange(rng, 3, 12));
+        } else {
+            used += (size_t)snprintf(text + used, capacity - used, "poly %.1f %.1f %.1f %.1f %.1f\n", RandomRange(rng, 0, 3),
+                                     x, y, x + RandomRange(rng, -20, 20), y + RandomRange(rng, -20, 20));
+        }
+    }
+    *size = used;
+    return text;
+}
+
+// Time ball-sized sweeps through the BVH and through every shape, and count disagreements
+static long TimeLevelQueries(const Level *level, int queries, uint64_t *rng, double *bvhSeconds, double *linearSeconds) {
+    long mismatches = 0;
+    *bvhSeconds = *linearSeconds = 0;
+    for (int q = 0; q < queries; q++) {
+        SimVec2 start = { RandomRange(rng, 0, 1280), RandomRange(rng, 0, 800) };
+        SimVec2 motion = { RandomRange(rng, -15, 15), RandomRange(rng, -15, 15) };
+        SweepHit treeHit, linearHit;
+        int treeShape, linearShape;
+
+        double begin = NowSeconds();
+        bool tree = LevelSweep(level, start, motion, 20.0f, 1.0f, &treeHit, &treeShape);
+        double middle = NowSeconds();
+        bool linear = LevelSweepLinear(level, start, motion, 20.0f, 1.0f, &linearHit, &linearShape);
+        *bvhSeconds += middle - begin;
+        *linearSeconds += NowSeconds() - middle;
+        if (tree != linear || (tree && treeHit.time != linearHit.time)) mismatches++;
+    }
+    return mismatches;
+}
+
+// level: load a level file (--in FILE) or generated ones of growing size, report load
+// time, BVH shape and memory, and sweep cost against testing every shape. Then play
+// matches on levels/classic.lvl and check they end exactly like the built-in layout.
+static int RunLevel(int argc, char **argv) {
+    const char *path = GetOption(argc, argv, "--in", NULL);
+    const char *counts = GetOption(argc, argv, "--shapes", "10,100,1000,10000");
+    const char *classicPath = GetOption(argc, argv, "--classic", "levels/classic.lvl");
+    int queries = atoi(GetOption(argc, argv, "--queries", "20000"));
+    long matches = atol(GetOption(argc, argv, "--matches", "200"));
+    uint64_t rng = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10) * 0x9E3779B97F4A7C15ULL + 1;
+    long mismatches = 0;
+
+    printf("%-20s %7s %6s %5s %9s %10s %9s %10s\n",
+           "level", "shapes", "nodes", "depth", "load ms", "memory", "bvh ns", "linear ns");
+    for (const char *text = counts; path != NULL || *text != '\0';) {
+        Level level;
+        char name[32];
+        double start = NowSeconds();
+        bool loaded;
+        if (path != NULL) {
+            loaded = LevelLoad(&level, path);
+            if (!loaded) {
+                printf("could not load %s (line %d)\n", path, level.errorLine);
+                return 1;
+            }
+            snprintf(name, sizeof(name), "%.20s", path);
+        } else {
+            int shapes = atoi(text);
+            while (*text != '\0' && *text != ',') text++;
+            if (*text == ',') text++;
+            size_t size;
+            char *generated = RandomLevelText(shapes, &rng, &size);
+            start = NowSeconds();
+            loaded = generated != NULL && LevelParse(&level, generated, size);
+            free(generated);
+            if (!loaded) {
+                printf("could not build a level of %d shapes\n", shapes);
+                return 1;
+            }
+            snprintf(name, sizeof(name), "random %d", shapes);
+        }
+        double loadSeconds = NowSeconds() - start;
+
+        double bvhSeconds, linearSeconds;
+        mismatches += TimeLevelQueries(&level, queries, &rng, &bvhSeconds, &linearSeconds);
+        printf("%-20s %7d %6d %5d %9.3f %8.1fKB %9.1f %10.1f\n", name, level.shapeCount, level.nodeCount, level.depth,
+               loadSeconds * 1000.0, LevelMemory(&level) / 1024.0, bvhSeconds / queries * 1e9, linearSeconds / queries * 1e9);
+        LevelFree(&level);
+        if (path != NULL) break;
+    }
+
+    // The classic level file has to play exactly like the built-in center blocks
+    Level classic;
+    if (LevelLoad(&classic, classicPath)) {
+        long different = 0;
+        SimConfig config = SimDifficultyConfig(MEDIUM, 1280, 800);
+        SimConfig levelConfig = config;
+        levelConfig.level = &classic;
+        for (long m = 0; m < matches; m++) {
+            SimState builtIn, fromFile;
+            SimInit(&builtIn, config, (uint64_t)m + 1);
+            SimInit(&fromFile, levelConfig, (uint64_t)m + 1);
+            while (builtIn.winner == SIDE_NONE && builtIn.tick < 200000) {
+                SimStep(&builtIn, aiVsAi);
+                SimStep(&fromFile, aiVsAi);
+                if (SimHash(&builtIn) != SimHash(&fromFile)) {
+                    different++;
+                    break;
+                }
+            }
+        }
+        printf("classic matches: %ld (%ld differ from the built-in layout)\n", matches, different);
+        mismatches += different;
+        LevelFree(&classic);
+    } else {
+        printf("classic check skipped, could not load %s\n", classicPath);
+    }
+    printf("mismatches:     %ld\n", mismatches);
+    return mismatches ? 1 : 0;
+}
+
+// particles: time the particle pool update with the pool kept full
+static int RunParticles(int argc, char **argv) {
+    int count = atoi(GetOption(argc, argv, "--count", "131072"));
+    int frames = atoi(GetOption(argc, argv, "--frames", "600"));
+    const float dt = 1.0f / 60.0f;
+
+    ParticleSystem system;
+    if (!ParticlesInit(&system, count, 1)) {
+        printf("could not allocate %d particles\n", count);
+        return 1;
+    }
+    system.drag = 0.6f;
+    ParticleEmitter emitter = {
+        .x = 640, .y = 400, .spread = 2 * 3.14159265f, .speedMin = 50, .speedMax = 600,
+        .lifeMin = 0.3f, .lifeMax = 1.5f, .sizeMin = 1.5f, .sizeMax = 3.5f, .color = 0xFF0045FF
+    };
+
+    double total = 0, worst = 0;
+    long long live = 0;
+    for (int f = 0; f < frames; f++) {
+        ParticlesEmit(&system, &emitter, system.capacity - system.count);
+        live += system.count;
+        double start = NowSeconds();
+        ParticlesUpdate(&system, dt);
+        double elapsed = NowSeconds() - start;
+        total += elapsed;
+        if (elapsed > worst) worst = elapsed;
+    }
+
+    printf("particles:      %d\n", count);
+    printf("avg live:       %lld\n", live / frames);
+    printf("update avg:     %.3f ms\n", total / frames * 1000.0);
+    printf("update worst:   %.3f ms\n", worst * 1000.0);
+    printf("per particle:   %.2f ns\n", total / (double)live * 1e9);
+    ParticlesFree(&system);
+    return 0;
+}
+
+// rain: time the raindrop update for kiosk-sized drop counts
+static int RunRain(int argc, char **argv) {
+    int drops = atoi(GetOption(argc, argv, "--drops", "50000"));
+    int frames = atoi(GetOption(argc, argv, "--frames", "1000"));
+
+    RainSystem rain;
+    if (!RainInit(&rain, drops, 1280, 800, 1)) {
+        printf("could not allocate %d raindrops\n", drops);
+        return 1;
+    }
+
+    double start = NowSeconds();
+    for (int f = 0; f < frames; f++) RainUpdate(&rain, (f / 300) % 2 ? RAIN_MIXED : RAIN_SPLIT, 1.0f / 60.0f);
+    double elapsed = NowSeconds() - start;
+
+    printf("drops:          %d per theme\n", drops);
+    printf("update avg:     %.3f ms\n", elapsed / frames * 1000.0);
+    printf("per drop:       %.2f ns\n", elapsed / frames / (drops * 2.0) * 1e9);
+    RainFree(&rain);
+    return 0;
+}
+
+// replay: record a scripted match (--record FILE) and/or play one back (--in FILE).
+// Playback checks every keyframe against a straight run from tick 0, then times random seeks.
+static int RunReplay(int argc, char **argv) {
+    const char *recordPath = GetOption(argc, argv, "--record", NULL);
+    const char *path = GetOption(argc, argv, "--in", recordPath);
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    long maxTicks = atol(GetOption(argc, argv, "--max-ticks", "200000"));
+    int seeks = atoi(GetOption(argc, argv, "--seeks", "1000"));
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    const char *levelPath = GetOption(argc, argv, "--level", NULL);
+    Replay replay;
+    Level level = { 0 };
+
+    if (path == NULL) {
+        printf("replay needs --record FILE or --in FILE\n");
+        return 2;
+    }
+    if (levelPath != NULL && !LevelLoad(&level, levelPath)) {
+        printf("could not load %s (line %d)\n", levelPath, level.errorLine);
+        return 1;
+    }
+
+    if (recordPath != NULL) {
+        SimConfig config = SimDifficultyConfig(difficulty, 1280, 800);
+        config.level = (levelPath != NULL) ? &level : NULL;
+        SimState state;
+        SimInit(&state, config, seed);
+        ReplayBegin(&replay, &state, seed, 0);
+        SimInput input = { .right = { .ai = true } };
+        while (state.winner == SIDE_NONE && state.tick < (uint32_t)maxTicks) {
+            input.left.move = ScriptedMove(seed, state.tick);
+            ReplayRecord(&replay, &state, input);
+            SimStep(&state, input);
+        }
+        bool saved = ReplaySave(&replay, recordPath);
+        ReplayFree(&replay);
+        if (!saved) {
+            printf("could not write %s\n", recordPath);
+            return 1;
+        }
+        printf("recorded:       %s, %d-%d in %u ticks\n", recordPath, state.leftScore, state.rightScore, state.tick);
+    }
+
+    if (!ReplayLoad(&replay, path)) {
+        printf("could not read %s\n", path);
+        return 1;
+    }
+    if (!ReplaySetLevel(&replay, (levelPath != NULL) ? &level : NULL)) {
+        printf("%s was recorded on another level, pass it with --level\n", path);
+        ReplayFree(&replay);
+        LevelFree(&level);
+        return 1;
+    }
+    FILE *file = fopen(path, "rb");
+    long fileSize = 0;
+    if (file != NULL) {
+        fseek(file, 0, SEEK_END);
+        fileSize = ftell(file);
+        fclose(file);
+    }
+
+    // Straight playback from the first keyframe, every later keyframe must be reproduced exactly
+    SimState state = replay.keyframes[0];
+    long mismatches = 0;
+    double start = NowSeconds();
+    while (state.tick < replay.tickCount && state.winner == SIDE_NONE) {
+        SimStep(&state, replay.inputs[state.tick]);
+        if (state.tick % replay.keyframeInterval == 0 && state.tick / replay.keyframeInterval < replay.keyframeCount &&
+            SimHash(&state) != SimHash(&replay.keyframes[state.tick / replay.keyframeInterval])) {
+            mismatches++;
+        }
+    }
+    double playSeconds = NowSeconds() - start;
+    SimState final = state;
+
+    // Random seeks, each must land on the same state as the straight run would
+    srand((unsigned int)seed);
+    double worstSeek = 0;
+    start = NowSeconds();
+    for (int i = 0; i < seeks; i++) {
+        uint32_t target = replay.tickCount ? (uint32_t)rand() % (replay.tickCount + 1) : 0;
+        double seekStart = NowSeconds();
+        ReplaySeek(&replay, target, &state);
+        double seekSeconds = NowSeconds() - seekStart;
+        if (seekSeconds > worstSeek) worstSeek = seekSeconds;
+        if (target == replay.tickCount && SimHash(&state) != SimHash(&final)) mismatches++;
+    }
+    double seekSeconds = NowSeconds() - start;
+
+    printf("file size:      %ld bytes\n", fileSize);
+    printf("ticks:          %u (%.1f s of play)\n", replay.tickCount, replay.tickCount / replay.keyframes[0].config.tickRate);
+    printf("keyframes:      %u every %d ticks\n", replay.keyframeCount, replay.keyframeInterval);
+    printf("final score:    %d-%d\n", final.leftScore, final.rightScore);
+    printf("final hash:     %016llx\n", (unsigned long long)SimHash(&final));
+    printf("playback:       %.3f ms (%.0fx real time)\n", playSeconds * 1000.0,
+           playSeconds > 0 ? replay.tickCount / replay.keyframes[0].config.tickRate / playSeconds : 0.0);
+    printf("seek avg:       %.1f us\n", seeks ? seekSeconds / seeks * 1e6 : 0.0);
+    printf("seek worst:     %.1f us\n", worstSeek * 1e6);
+    printf("mismatches:     %ld\n", mismatches);
+    ReplayFree(&replay);
+    LevelFree(&level);
+    return mismatches ? 1 : 0;
+}
+
+// The host plays with the mouse like in local PVP, so its input carries a paddle target
+static SimPaddleInput HostInput(uint64_t seed, uint32_t tick) {
+    return (SimPaddleInput){ .useTarget = true, .targetY = 400.0f + 250.0f * ScriptedMove(seed, tick) };
+}
+
+// netloop: two rollback peers talking over loopback UDP with latency, jitter and
+// loss added, on a virtual clock. Both must end every match on the same state as
+// a plain run of the same input, and no hash check along the way may differ.
+static int RunNetloop(int argc, char **argv) {
+    int matches = atoi(GetOption(argc, argv, "--matches", "3"));
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    double latencyMs = atof(GetOption(argc, argv, "--latency-ms", "60"));
+    double jitterMs = atof(GetOption(argc, argv, "--jitter-ms", "20"));
+    float lossPercent = (float)atof(GetOption(argc, argv, "--loss-percent", "5"));
+    double driftPercent = atof(GetOption(argc, argv, "--drift-percent", "1"));
+    float tickRate = (float)atof(GetOption(argc, argv, "--tick-rate", "120"));
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    const double frameSeconds = 0.001;       // Virtual time per loop, both peers poll this often
+    const double maxMatchSeconds = 900.0;
+
+    NetConditions conditions = { latencyMs / 1000.0, jitterMs / 1000.0, lossPercent / 100.0f };
+    NetSocket hostNet, joinNet;
+    if (!NetOpen(&hostNet, 0, conditions, seed) || !NetOpen(&joinNet, 0, conditions, seed * 31 + 7)) {
+        printf("could not open UDP sockets\n");
+        return 1;
+    }
+    static Rollback host, join;   // Too big for the stack
+    RollbackHost(&host, &hostNet);
+    RollbackJoin(&join, &joinNet, (NetAddress){ 0x7F000001u, hostNet.port });
+
+    RollbackStats totals = { 0 };
+    long mismatches = 0, unfinished = 0, steps = 0;
+    double worstStep = 0, now = 0, start = NowSeconds();
+
+    for (int m = 0; m < matches; m++) {
+        uint64_t matchSeed = seed + (uint64_t)m;
+        uint64_t joinSeed = matchSeed ^ 0xA5A5A5A5ULL;
+        RollbackMatch setup = { matchSeed, (int32_t)difficulty, 1280, 800, tickRate };
+        SimState initial;
+        if (!RollbackMatchState(setup, &initial) || !RollbackStart(&host, setup, now)) {
+            printf("invalid match setup\n");
+            return 1;
+        }
+
+        // The joining peer's clock runs a little slow, so time sync has something to do
+        SimClock hostClock, joinClock;
+        SimClockInit(&hostClock, tickRate);
+        SimClockInit(&joinClock, tickRate);
+        double matchStart = now;
+        while (now - matchStart < maxMatchSeconds &&
+               (RollbackConfirmed(&host)->winner == SIDE_NONE || RollbackConfirmed(&join)->winner == SIDE_NONE ||
+                !host.running || !join.running)) {
+            now += frameSeconds;
+            RollbackPoll(&join, now);
+            Rollback *peers[2] = { &host, &join };
+            int due[2] = { SimClockAdvance(&hostClock, frameSeconds), SimClockAdvance(&joinClock, frameSeconds * (1.0 - driftPercent / 100.0)) };
+            for (int p = 0; p < 2; p++) {
+                for (int i = 0; i < due[p]; i++) {
+                    SimPaddleInput input = (p == 0) ? HostInput(matchSeed, peers[p]->frame)
+                                                    : (SimPaddleInput){ .move = ScriptedMove(joinSeed, peers[p]->frame) };
+                    double stepStart = NowSeconds();
+                    if (!RollbackAdvance(peers[p], input, now)) break;
+                    double stepSeconds = NowSeconds() - stepStart;
+                    if (stepSeconds > worstStep) worstStep = stepSeconds;
+                    steps++;
+                }
+            }
+        }
+
+        // The same input played straight through, no network involved
+        SimState reference = initial;
+        while (reference.winner == SIDE_NONE && reference.tick < (uint32_t)(maxMatchSeconds * tickRate)) {
+            SimInput input = { .left = HostInput(matchSeed, reference.tick),
+                               .right = { .move = ScriptedMove(joinSeed, reference.tick) } };
+            SimStep(&reference, input);
+        }
+        const SimState *hostFinal = RollbackConfirmed(&host);
+        const SimState *joinFinal = RollbackConfirmed(&join);
+        if (hostFinal->winner == SIDE_NONE || joinFinal->winner == SIDE_NONE) unfinished++;
+        if (SimHash(hostFinal) != SimHash(joinFinal) || SimHash(hostFinal) != SimHash(&reference)) mismatches++;
+
+        for (int p = 0; p < 2; p++) {
+            const RollbackStats *stats = p == 0 ? &host.stats : &join.stats;
+            totals.rollbacks += stats->rollbacks;
+            totals.resimulated += stats->resimulated;
+            if (stats->deepest > totals.deepest) totals.deepest = stats->deepest;
+            totals.stalls += stats->stalls;
+            totals.waits += stats->waits;
+            totals.hashChecks += stats->hashChecks;
+            totals.desyncs += stats->desyncs;
+        }
+        printf("match %d:        %d-%d in %u ticks, hash %016llx\n", m + 1, hostFinal->leftScore, hostFinal->rightScore,
+               hostFinal->tick, (unsigned long long)SimHash(hostFinal));
+    }
+    double seconds = NowSeconds() - start;
+
+    printf("conditions:     %.0f ms +/- %.0f ms one way, %.1f%% loss, %.1f%% clock drift\n",
+           latencyMs, jitterMs, lossPercent, driftPercent);
+    printf("packets:        %u sent, %u dropped\n", hostNet.stats.sent + joinNet.stats.sent,
+           hostNet.stats.dropped + joinNet.stats.dropped);
+    printf("rollbacks:      %u, %.1f steps on average, deepest %u\n", totals.rollbacks,
+           totals.rollbacks ? (double)totals.resimulated / totals.rollbacks : 0.0, totals.deepest);
+    printf("stalls:         %u steps\n", totals.stalls);
+    printf("waits:          %u steps\n", totals.waits);
+    printf("worst step:     %.3f ms (frame budget %.1f ms)\n", worstStep * 1000.0, 1000.0 / 60.0);
+    printf("run time:       %.2f s for %ld steps\n", seconds, steps);
+    printf("hash checks:    %u, %u desyncs\n", totals.hashChecks, totals.desyncs);
+    printf("unfinished:     %ld\n", unfinished);
+    printf("mismatches:     %ld\n", mismatches);
+    NetClose(&hostNet);
+    NetClose(&joinNet);
+    return (mismatches || unfinished || totals.desyncs) ? 1 : 0;
+}
+
+static void SleepSeconds(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&ts, NULL);
+}
+
+static void PrintServerStats(const ServerStats *stats, int workers) {
+    double cores = stats->wallSeconds > 0 ? stats->busySeconds / stats->wallSeconds : 0.0;
+    uint64_t states = stats->fullStates + stats->deltaStates;
+    int worst = SERVER_TICK_BUCKETS - 1;
+    while (worst > 0 && stats->tickHistogram[worst] == 0) worst--;
+    printf("workers:        %d\n", workers);
+    printf("matches:        %llu started, %llu finished, peak %u at once\n", (unsigned long long)stats->matchesStarted,
+           (unsigned long long)stats->matchesFinished, stats->peakMatches);
+    printf("ticks:          %llu, %llu late\n", (unsigned long long)stats->ticks, (unsigned long long)stats->overruns);
+    printf("tick time:      p50 %.0f us, p99 %.0f us, p99.9 %.0f us, max %d us\n", ServerTickPercentile(stats, 0.5) * 1e6,
+           ServerTickPercentile(stats, 0.99) * 1e6, ServerTickPercentile(stats, 0.999) * 1e6, worst + 1);
+    printf("cpu:            %.1f%% of one core\n", cores * 100.0);
+    printf("matches/core:   %.0f (peak matches over busy cores)\n", cores > 0 ? stats->peakMatches / cores : 0.0);
+    printf("packets:        %llu in, %llu out\n", (unsigned long long)stats->packetsIn, (unsigned long long)stats->packetsOut);
+    printf("clients:        %llu reclaimed, %llu joins refused\n", (unsigned long long)stats->clientsReclaimed,
+           (unsigned long long)stats->joinsRefused);
+    printf("state size:     %.1f bytes average, %.1f%% sent as deltas\n",
+           states ? (double)stats->bytesOut / states : 0.0, states ? 100.0 * stats->deltaStates / states : 0.0);
+}
+
+static ServerConfig ParseServerConfig(int argc, char **argv) {
+    ServerConfig config = ServerDefaultConfig();
+    config.port = (uint16_t)atoi(GetOption(argc, argv, "--port", "7777"));
+    config.workers = atoi(GetOption(argc, argv, "--workers", "0"));
+    config.tickRate = (float)atof(GetOption(argc, argv, "--tick-rate", "120"));
+    config.sendInterval = atoi(GetOption(argc, argv, "--send-interval", "2"));
+    config.idleSeconds = atof(GetOption(argc, argv, "--idle-seconds", "5"));
+    return config;
+}
+
+// server: run the match server for a while and report how it held up
+static int RunServer(int argc, char **argv) {
+    double seconds = atof(GetOption(argc, argv, "--seconds", "60"));
+    GameServer server;
+    if (!ServerStart(&server, ParseServerConfig(argc, argv))) {
+        printf("could not start the server (Linux only, is the port free?)\n");
+        return 1;
+    }
+    int workers = server.workerCount;
+    printf("serving on UDP port %u with %d workers for %.0f s\n", server.config.port, workers, seconds);
+    SleepSeconds(seconds);
+    static ServerStats stats;   // Histogram is too big for the stack
+    ServerStop(&server, &stats);
+    PrintServerStats(&stats, workers);
+    return 0;
+}
+
+// One simulated player: joins, chases the ball with its paddle, and joins again after every match
+typedef struct LoadBot {
+    NetSocket net;
+    bool playing;
+    uint16_t match;
+    uint16_t finishedMatch;   // Its last states can still arrive after the bot has moved on
+    SimSide side;
+    uint32_t latest;          // Newest decoded tick, SERVER_NO_BASE for none
+    double nextJoin;
+    Snapshot ring[SERVER_SNAPSHOT_HISTORY];
+} LoadBot;
+
+typedef struct LoadStats {
+    uint64_t states;
+    uint64_t bytes;
+    uint64_t deltas;
+    uint64_t missingBase;     // Delta against a state the bot no longer has
+    uint64_t corrupt;         // Failed the checksum
+    uint64_t finished;
+    uint64_t joined;          // Matches bots got into
+} LoadStats;
+
+static void BotReceive(LoadBot *bot, LoadStats *stats, double now) {
+    unsigned char packet[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+    while ((size = NetReceive(&bot->net, &from, packet, sizeof(packet), now)) > 0) {
+        ServerPacketHeader header;
+        if (size < (int)sizeof(header)) continue;
+        memcpy(&header, packet, sizeof(header));
+        if (header.type != SERVER_STATE || (!bot->playing && header.match == bot->finishedMatch)) continue;
+        if (!bot->playing || header.match != bot->match) {
+            bot->playing = true;
+            stats->joined++;
+            bot->match = header.match;
+            bot->side = (SimSide)header.side;
+            bot->latest = SERVER_NO_BASE;
+            for (int i = 0; i < SERVER_SNAPSHOT_HISTORY; i++) bot->ring[i].fields[FIELD_TICK] = SERVER_NO_BASE;
+        }
+
+        const unsigned char *body = packet + sizeof(header);
+        int bodySize = size - (int)sizeof(header);
+        uint32_t baseTick;
+        if (!SnapshotBaseTick(body, bodySize, &baseTick)) continue;
+        const Snapshot *base = NULL;
+        if (baseTick != SERVER_NO_BASE) {
+            base = &bot->ring[baseTick & (SERVER_SNAPSHOT_HISTORY - 1)];
+            if (base->fields[FIELD_TICK] != baseTick) {
+                stats->missingBase++;
+                continue;
+            }
+        }
+        Snapshot snapshot;
+        if (!SnapshotDecode(body, bodySize, base, &snapshot)) {
+            stats->corrupt++;
+            continue;
+        }
+        uint32_t tick = snapshot.fields[FIELD_TICK];
+        bot->ring[tick & (SERVER_SNAPSHOT_HISTORY - 1)] = snapshot;
+        if (bot->latest == SERVER_NO_BASE || tick > bot->latest) bot->latest = tick;
+        stats->states++;
+        stats->bytes += (uint64_t)size;
+        if (base != NULL) stats->deltas++;
+
+        if (snapshot.fields[FIELD_WINNER] != SIDE_NONE) {
+            stats->finished++;
+            bot->playing = false;
+            bot->finishedMatch = bot->match;
+            bot->nextJoin = now;
+        }
+    }
+}
+
+static void BotAct(LoadBot *bot, NetAddress server, Difficulty difficulty, uint64_t *rng, double now) {
+    unsigned char packet[sizeof(ServerPacketHeader) + sizeof(ServerInput)];
+    if (!bot->playing || bot->latest == SERVER_NO_BASE) {
+        if (now < bot->nextJoin) return;
+        ServerPacketHeader header = { SERVER_MAGIC, SERVER_JOIN, (uint8_t)difficulty, 0 };
+        NetSend(&bot->net, server, &header, sizeof(header), now);
+        bot->nextJoin = now + 0.5;
+        return;
+    }
+
+    const Snapshot *latest = &bot->ring[bot->latest & (SERVER_SNAPSHOT_HISTORY - 1)];
+    float ballY, paddleY, paddleHeight;
+    memcpy(&ballY, &latest->fields[FIELD_BALL_Y], 4);
+    memcpy(&paddleY, &latest->fields[bot->side == SIDE_LAVA ? FIELD_LEFT_Y : FIELD_RIGHT_Y], 4);
+    memcpy(&paddleHeight, &latest->fields[FIELD_PADDLE_HEIGHT], 4);
+    float offset = ballY - (paddleY + paddleHeight / 2);
+    ServerInput input = { .ackTick = bot->latest, .move = (int8_t)(offset > 15 ? 1 : (offset < -15 ? -1 : 0)) };
+    if (RandomRange(rng, 0.0f, 1.0f) < 0.2f) input.move = 0;   // Sloppy enough that matches end
+
+    ServerPacketHeader header = { SERVER_MAGIC, SERVER_INPUT, 0, bot->match };
+    memcpy(packet, &header, sizeof(header));
+    memcpy(packet + sizeof(header), &input, sizeof(input));
+    NetSend(&bot->net, server, packet, sizeof(packet), now);
+}
+
+// A bot that comes back from a new address, like a player whose NAT mapping or client restarted.
+// The match it left ends on the server once it has been quiet for the idle time.
+static bool BotReconnect(LoadBot *bot, double now) {
+    NetClose(&bot->net);
+    memset(bot, 0, sizeof(*bot));
+    bot->latest = SERVER_NO_BASE;
+    bot->nextJoin = now;
+    return NetOpen(&bot->net, 0, (NetConditions){ 0 }, 0);
+}
+
+// loadgen: hundreds of bot players against a server, started in this process unless --server is given.
+// With --reconnect S every bot moves to a new address every S seconds, for address churn.
+static int RunLoadgen(int argc, char **argv) {
+    int botCount = atoi(GetOption(argc, argv, "--clients", "400"));
+    double seconds = atof(GetOption(argc, argv, "--seconds", "10"));
+    double inputRate = atof(GetOption(argc, argv, "--input-rate", "60"));
+    const char *address = GetOption(argc, argv, "--server", NULL);
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    uint64_t rng = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10) | 1;
+    double reconnect = atof(GetOption(argc, argv, "--reconnect", "0"));
+
+    GameServer server;
+    bool local = address == NULL;
+    ServerConfig config = ParseServerConfig(argc, argv);
+    NetAddress serverAddress = { 0x7F000001u, config.port };
+    if (local && !ServerStart(&server, config)) {
+        printf("could not start the server (Linux only, is the port free?)\n");
+        return 1;
+    }
+    if (!local && !NetParseAddress(address, &serverAddress)) {
+        printf("could not read %s, expected HOST:PORT\n", address);
+        return 2;
+    }
+
+    LoadBot *bots = calloc((size_t)botCount, sizeof(LoadBot));
+    int opened = 0;
+    while (bots != NULL && opened < botCount && NetOpen(&bots[opened].net, 0, (NetConditions){ 0 }, 0)) {
+        bots[opened].nextJoin = RandomRange(&rng, 0.0f, 0.2f);   // Spread the joins out a little
+        opened++;
+    }
+    if (opened < botCount) printf("only %d of %d bot sockets could be opened\n", opened, botCount);
+
+    LoadStats stats = { 0 };
+    long addresses = opened, reopenFailed = 0;
+    double *reconnectAt = calloc((size_t)(opened > 0 ? opened : 1), sizeof(double));
+    for (int i = 0; reconnectAt != NULL && i < opened; i++) reconnectAt[i] = reconnect * (i + 1) / opened;
+    double start = NowSeconds(), next = start;
+    while (next - start < seconds) {
+        SleepSeconds(next - NowSeconds());
+        double now = NowSeconds() - start;
+        for (int i = 0; i < opened; i++) {
+            if (reconnect > 0 && reconnectAt != NULL && now >= reconnectAt[i]) {
+                reconnectAt[i] += reconnect;
+                if (BotReconnect(&bots[i], now)) addresses++;
+                else reopenFailed++;
+            }
+            BotReceive(&bots[i], &stats, now);
+            BotAct(&bots[i], serverAddress, difficulty, &rng, now);
+        }
+        next += 1.0 / inputRate;
+    }
+
+    printf("bots:           %d, %ld addresses used", opened, addresses);
+    if (reopenFailed > 0) printf(", %ld sockets could not be reopened", reopenFailed);
+    printf("\n");
+    printf("bot joins:      %llu matches entered\n", (unsigned long long)stats.joined);
+    printf("states:         %.0f per second received\n", stats.states / seconds);
+    printf("state size:     %.1f bytes average, %.1f%% deltas\n",
+           stats.states ? (double)stats.bytes / stats.states : 0.0, stats.states ? 100.0 * stats.deltas / stats.states : 0.0);
+    printf("bot matches:    %llu finished\n", (unsigned long long)stats.finished);
+    printf("missing base:   %llu\n", (unsigned long long)stats.missingBase);
+    printf("corrupt:        %llu\n", (unsigned long long)stats.corrupt);
+    for (int i = 0; i < opened; i++) NetClose(&bots[i].net);
+    free(bots);
+    free(reconnectAt);
+
+    bool refused = false;
+    if (local) {
+        static ServerStats serverStats;
+        int workers = server.workerCount;
+        ServerStop(&server, &serverStats);
+        PrintServerStats(&serverStats, workers);
+        refused = serverStats.joinsRefused > 0;
+    }
+    return (stats.corrupt || refused) ? 1 : 0;
+}
+
+typedef struct Command {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+} Command;
+
+// An entrant from the command line: a preset name or SPEED:REACTION:ERROR
+static bool ParseEntrant(const char *text, size_t length, TournamentEntrant *entrant) {
+    char spec[sizeof(entrant->name)];
+    if (length == 0 || length >= sizeof(spec)) return false;
+    memcpy(spec, text, length);
+    spec[length] = '\0';
+    if (strcmp(spec, "easy") == 0 || strcmp(spec, "medium") == 0 || strcmp(spec, "hard") == 0) {
+        *entrant = TournamentPresetEntrant(ParseDifficulty(spec));
+        return true;
+    }
+    AiSkill skill;
+    if (sscanf(spec, "%f:%f:%f", &skill.speed, &skill.reaction, &skill.error) != 3) return false;
+    *entrant = (TournamentEntrant){ .skill = skill };
+    snprintf(entrant->name, sizeof(entrant->name), "%s", spec);
+    return true;
+}
+
+// Totals per difficulty from the offline reader
+static void PrintTelemetrySummary(const TelemetrySummary *summary, double seconds) {
+    static const char *names[] = { "easy", "medium", "hard" };
+    printf("files:          %lu (%lu not telemetry logs), %lu records, read in %.3f s (%.1f M records/s)\n",
+           summary->files, summary->badFiles, summary->records, seconds,
+           seconds > 0 ? summary->records / seconds / 1e6 : 0.0);
+    for (int d = EASY; d <= HARD; d++) {
+        const TelemetryTotals *totals = &summary->difficulty[d];
+        if (totals->matches == 0 && totals->finished == 0) continue;
+        unsigned long hits = totals->events[TELEMETRY_PADDLE_HIT];
+        printf("%-7s         %lu matches (%lu finished, lava %lu / ice %lu), %.0f ticks a match\n", names[d],
+               totals->matches, totals->finished, totals->wins[SIDE_LAVA], totals->wins[SIDE_ICE],
+               totals->finished ? (double)totals->ticks / totals->finished : 0.0);
+        printf("                %lu paddle hits, %lu wall, %lu obstacle, %lu goals\n", hits,
+               totals->events[TELEMETRY_WALL_HIT], totals->events[TELEMETRY_OBSTACLE_HIT], totals->events[TELEMETRY_GOAL]);
+        printf("                rally %.1f hits average, %u longest, impact speed %.0f average, %.0f fastest\n",
+               totals->rallies ? (double)totals->rallyHits / totals->rallies : 0.0, totals->longestRally,
+               hits ? totals->impactSpeed / hits : 0.0, totals->fastestImpact);
+    }
+}
+
+// telemetry: play a day's worth of matches into a telemetry log through the writer thread,
+// then read the files back and check the totals. With log files as arguments it only reads them.
+static int RunTelemetry(int argc, char **argv) {
+    long matches = atol(GetOption(argc, argv, "--matches", "2000"));
+    const char *prefix = GetOption(argc, argv, "--out", "telemetry_check");
+    long rotateKb = atol(GetOption(argc, argv, "--rotate-kb", "1024"));
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    long maxTicks = atol(GetOption(argc, argv, "--max-ticks", "200000"));
+    int stepsPerFrame = atoi(GetOption(argc, argv, "--steps-per-frame", "2"));
+
+    // Any argument that isn't an option or its value is a log to read
+    int logCount = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) i++;
+        else logCount++;
+    }
+    if (logCount > 0) {
+        TelemetrySummary summary = { 0 };
+        double start = NowSeconds();
+        for (int i = 0; i < argc; i++) {
+            if (strncmp(argv[i], "--", 2) == 0) i++;
+            else if (!TelemetrySummarize(&summary, argv[i])) printf("skipped %s, not a telemetry log\n", argv[i]);
+        }
+        PrintTelemetrySummary(&summary, NowSeconds() - start);
+        return summary.files > 0 ? 0 : 1;
+    }
+
+    static Telemetry telemetry;
+    if (!TelemetryStart(&telemetry, prefix, rotateKb * 1024)) {
+        printf("could not open a log file at %s\n", prefix);
+        return 1;
+    }
+    if (stepsPerFrame < 1) stepsPerFrame = 1;
+
+    // The game's frame loop: a frame's steps fill the batch, then it is posted in one go
+    static TelemetryBatch batch;
+    unsigned long expected[TELEMETRY_TYPE_COUNT] = { 0 };
+    double postSeconds = 0, worstPost = 0;
+    unsigned long frames = 0;
+    double start = NowSeconds();
+    for (long m = 0; m < matches; m++) {
+        Difficulty difficulty = (Difficulty)(m % 3);
+        SimState state;
+        SimInit(&state, SimDifficultyConfig(difficulty, 1280, 800), seed + (uint64_t)m);
+        while (state.winner == SIDE_NONE && state.tick < (uint32_t)maxTicks) {
+            for (int i = 0; i < stepsPerFrame && state.winner == SIDE_NONE; i++) {
+                SimState before = state;
+                TelemetryRecordStep(&batch, &before, &state, SimStep(&state, aiVsAi), difficulty, PVC);
+            }
+            for (int i = 0; i < batch.count; i++) expected[batch.events[i].type]++;
+            double postStart = NowSeconds();
+            TelemetryPost(&telemetry, &batch);
+            double post = NowSeconds() - postStart;
+            postSeconds += post;
+            if (post > worstPost) worstPost = post;
+            frames++;
+        }
+    }
+    double playSeconds = NowSeconds() - start;
+    TelemetryStop(&telemetry);
+    unsigned dropped = atomic_load(&telemetry.dropped);
+
+    printf("matches:        %ld in %.3f s, %lu frames of %d steps\n", matches, playSeconds, frames, stepsPerFrame);
+    printf("post:           %.3f us average, %.3f us worst a frame\n",
+           frames ? postSeconds / frames * 1e6 : 0.0, worstPost * 1e6);
+    printf("writer:         %lu records in %u writes to %u files, %u dropped%s\n", telemetry.written,
+           telemetry.writes, telemetry.files, dropped, telemetry.failed ? ", a write failed" : "");
+
+    TelemetrySummary summary = { 0 };
+    double readStart = NowSeconds();
+    for (unsigned i = 0; i < telemetry.files; i++) {
+        char path[600];
+        if (TelemetryFileName(path, sizeof(path), prefix, telemetry.startTime, i)) TelemetrySummarize(&summary, path);
+    }
+    PrintTelemetrySummary(&summary, NowSeconds() - readStart);
+
+    // Without drops every record made it through the ring and the files exactly once
+    int mismatches = 0;
+    for (int t = 0; t < TELEMETRY_TYPE_COUNT; t++) {
+        unsigned long read = 0;
+        for (int d = EASY; d <= HARD; d++) read += summary.difficulty[d].events[t];
+        if (read != expected[t] && dropped == 0) mismatches++;
+    }
+    printf("mismatches:     %d\n", mismatches);
+    return (mismatches == 0 && !telemetry.failed) ? 0 : 1;
+}
+
+// tournament: every pair of computer players plays a batch of matches on all cores,
+// once per thread count, and the results must come out the same every time
+static int RunTournament(int argc, char **argv) {
+    int cores = TournamentCoreCount();
+    char defaultThreads[256] = "1";
+    for (int t = 2, length = 1; t < 2 * cores && t <= TOURNAMENT_MAX_THREADS; t *= 2) {
+        length += snprintf(defaultThreads + length, sizeof(defaultThreads) - length, ",%d", t < cores ? t : cores);
+    }
+    const char *threadList = GetOption(argc, argv, "--threads", defaultThreads);
+    const char *entrantList = GetOption(argc, argv, "--entrants", "easy,medium,hard");
+
+    TournamentConfig config = { 0 };
+    config.rules = SimDifficultyConfig(ParseDifficulty(GetOption(argc, argv, "--rules", "medium")), 1280, 800);
+    config.matchesPerPairing = (uint32_t)atol(GetOption(argc, argv, "--matches", "2000"));
+    config.seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+    config.maxTicks = (uint32_t)atol(GetOption(argc, argv, "--max-ticks", "200000"));
+    for (const char *text = entrantList; *text != '\0';) {
+        size_t length = strcspn(text, ",");
+        if (config.entrantCount == TOURNAMENT_MAX_ENTRANTS || !ParseEntrant(text, length, &config.entrants[config.entrantCount])) {
+            printf("bad entrant list %s, expected up to %d of easy, medium, hard or SPEED:REACTION:ERROR\n",
+                   entrantList, TOURNAMENT_MAX_ENTRANTS);
+            return 2;
+        }
+        config.entrantCount++;
+        text += length;
+        if (*text == ',') text++;
+    }
+
+    static TournamentResult result;   // Too big for the stack
+    uint64_t firstHash = 0;
+    double baseRate = 0;
+    int runs = 0, mismatches = 0;
+    printf("%7s %10s %12s %8s %8s %9s\n", "threads", "matches", "matches/s", "speedup", "steals", "seconds");
+    for (const char *text = threadList; *text != '\0';) {
+        config.threads = atoi(text);
+        while (*text != '\0' && *text != ',') text++;
+        if (*text == ',') text++;
+        if (config.threads <= 0) continue;
+
+        double start = NowSeconds();
+        if (!TournamentRun(&config, &result)) {
+            printf("could not run the tournament on %d threads\n", config.threads);
+            return 1;
+        }
+        double seconds = NowSeconds() - start;
+        double rate = result.matches / seconds;
+        if (runs == 0) {
+            firstHash = result.hash;
+            baseRate = rate;
+        } else if (result.hash != firstHash) {
+            mismatches++;
+        }
+        runs++;
+        printf("%7d %10llu %12.0f %7.2fx %8llu %9.2f\n", config.threads, (unsigned long long)result.matches, rate,
+               rate / baseRate, (unsigned long long)result.steals, seconds);
+    }
+    if (runs == 0) return 2;
+
+    printf("\nrules: %s, %u matches per pairing, sides alternate\n", GetOption(argc, argv, "--rules", "medium"), config.matchesPerPairing);
+    printf("%-28s %7s %7s %7s %8s %8s %5s %5s %5s\n", "pairing", "a wins", "b wins", "unfin", "a win %", "rally", "p50", "p90", "p99");
+    for (int p = 0; p < result.pairingCount; p++) {
+        const TournamentPairing *pairing = &result.pairings[p];
+        char name[80];
+        snprintf(name, sizeof(name), "%s vs %s", config.entrants[pairing->entrants[0]].name, config.entrants[pairing->entrants[1]].name);
+        uint32_t decided = pairing->wins[0] + pairing->wins[1];
+        printf("%-28s %7u %7u %7u %7.1f%% %8.2f %5d %5d %5d\n", name, pairing->wins[0], pairing->wins[1], pairing->unfinished,
+               decided ? 100.0 * pairing->wins[0] / decided : 0.0,
+               pairing->points ? (double)pairing->paddleHits / pairing->points : 0.0,
+               TournamentRallyPercentile(pairing, 0.5), TournamentRallyPercentile(pairing, 0.9),
+               TournamentRallyPercentile(pairing, 0.99));
+    }
+    printf("\nrally is paddle hits per point\n");
+    printf("outcomes:       %s\n", mismatches ? "differ between thread counts" : "identical for every thread count");
+    return mismatches ? 1 : 0;
+}
+
+// vecenv: step batches of environments with random actions, and step a plain SimState
+// per env next to them with SimStep and the same restarts. Times both and checks that
+// every env matches its SimState after every step.
+static int RunVecenv(int argc, char **argv) {
+    const char *envList = GetOption(argc, argv, "--envs", "1000,10000,100000");
+    int steps = atoi(GetOption(argc, argv, "--steps", "1000"));
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    uint64_t seed = strtoull(GetOption(argc, argv, "--seed", "1"), NULL, 10);
+
+    int mismatches = 0;
+    printf("%8s %14s %14s %8s %7s %9s %8s\n", "envs", "vecenv steps/s", "SimStep steps/s", "speedup", "full", "points",
+           "matches");
+    for (const char *text = envList; *text != '\0';) {
+        int count = atoi(text);
+        while (*text != '\0' && *text != ',') text++;
+        if (*text == ',') text++;
+        if (count <= 0) continue;
+
+        VecEnv env;
+        VecEnvConfig config = VecEnvDefaultConfig(difficulty, count);
+        SimState *reference = malloc(sizeof(SimState) * (size_t)count);
+        if (reference == NULL || !VecEnvInit(&env, config, seed)) {
+            printf("could not allocate %d envs\n", count);
+            free(reference);
+            return 1;
+        }
+        for (int i = 0; i < count; i++) SimInit(&reference[i], config.sim, VecEnvSeed(seed, i));
+
+        uint64_t rng = seed;
+        double vectorSeconds = 0, referenceSeconds = 0;
+        long long points = 0, matches = 0, full = 0;
+        int firstMismatch = -1;
+        for (int s = 0; s < steps; s++) {
+            for (int i = 0; i < count; i++) env.actions[i] = (int32_t)RandomRange(&rng, 0.0f, 3.0f) - 1;
+            double start = NowSeconds();
+            full += VecEnvStep(&env);
+            double middle = NowSeconds();
+            bool same = true;
+            for (int i = 0; i < count; i++) {
+                SimInput input = { .left = { .move = env.actions[i] }, .right = { .ai = true } };
+                unsigned int events = SimStep(&reference[i], input);
+                float reward = (events & SIM_EVENT_LAVA_SCORED) ? 1.0f : ((events & SIM_EVENT_ICE_SCORED) ? -1.0f : 0.0f);
+                bool done = reference[i].winner != SIDE_NONE || reference[i].tick >= config.maxTicks;
+                if (done) SimInit(&reference[i], config.sim, reference[i].rng);
+                same &= env.rewards[i] == reward && env.dones[i] == done;
+            }
+            vectorSeconds += middle - start;
+            referenceSeconds += NowSeconds() - middle;
+
+            // Cheap fields every step, the whole state at the end
+            for (int i = 0; i < count; i++) {
+                points += env.rewards[i] != 0.0f;
+                matches += env.dones[i];
+                same &= env.ballX[i] == reference[i].ballPosition.x && env.ballY[i] == reference[i].ballPosition.y;
+            }
+            if (firstMismatch < 0 && !same) firstMismatch = s;
+        }
+        for (int i = 0; i < count && firstMismatch < 0; i++) {
+            SimState state;
+            VecEnvGetState(&env, i, &state);
+            if (SimHash(&state) != SimHash(&reference[i])) firstMismatch = steps - 1;
+        }
+
+        double vectorRate = (double)count * steps / vectorSeconds, referenceRate = (double)count * steps / referenceSeconds;
+        printf("%8d %14.0f %15.0f %7.2fx %6.2f%% %9lld %8lld\n", count, vectorRate, referenceRate, vectorRate / referenceRate,
+               100.0 * (double)full / ((double)count * steps), points, matches);
+        if (firstMismatch >= 0) {
+            printf("         vecenv and SimStep differ from step %d\n", firstMismatch);
+            mismatches++;
+        }
+        VecEnvFree(&env);
+        free(reference);
+    }
+
+    printf("\nfull is the share of env-steps that needed the whole SimStep\n");
+    printf("vecenv/SimStep: %s\n", mismatches ? "MISMATCH" : "identical state after every step");
+    return mismatches ? 1 : 0;
+}
+
+// Steer toward the ball, what a first external bot would do
+static BotCommand TrackBall(const BotState *state, SimSide side) {
+    float paddle = (side == SIDE_LAVA) ? state->leftY : state->rightY;
+    float offset = state->ballY - paddle;
+    float deadZone = state->paddleHeight / 8;
+    return (BotCommand){ .side = side, .move = offset > deadZone ? 1 : (offset < -deadZone ? -1 : 0) };
+}
+
+// Answer every state until the game goes quiet for timeout seconds, returns the states answered
+static uint64_t RunTrackingBot(BotLink *link, bool lava, bool ice, double spin, double timeout) {
+    BotState state;
+    while (BotLinkWait(link, &state, spin, timeout)) {
+        if (lava) BotLinkSend(link, &state, TrackBall(&state, SIDE_LAVA));
+        if (ice) BotLinkSend(link, &state, TrackBall(&state, SIDE_ICE));
+    }
+    return link->stats.published;
+}
+
+static void PrintBotLinkStats(const BotLinkStats *stats) {
+    printf("states sent:    %llu\n", (unsigned long long)stats->published);
+    printf("commands:       %llu (%llu lost to a full ring)\n", (unsigned long long)stats->commands,
+           (unsigned long long)stats->skipped);
+    printf("fresh steps:    %.2f%% of %llu had an answer to the newest state\n",
+           stats->botSteps ? 100.0 * stats->freshSteps / stats->botSteps : 0.0, (unsigned long long)stats->botSteps);
+    if (stats->commands == 0) return;
+    printf("round trip:     min %.1f us, avg %.1f us, p50 < %.1f us, p99 < %.1f us, max %.1f us\n",
+           stats->latencyMinNs / 1e3, (double)stats->latencyTotalNs / stats->commands / 1e3,
+           BotLinkLatencyPercentile(stats, 0.5) / 1e3, BotLinkLatencyPercentile(stats, 0.99) / 1e3,
+           stats->latencyMaxNs / 1e3);
+}
+
+// botlink: with --attach, drive paddles of a running game (pong --bot-link NAME)
+// with a ball-tracking bot. Without it, play AI matches against such a bot in a
+// forked process over the same shared memory and report the round trips.
+static int RunBotlink(int argc, char **argv) {
+#if defined(__linux__)
+    const char *attach = GetOption(argc, argv, "--attach", NULL);
+    const char *side = GetOption(argc, argv, "--side", "ice");
+    double spin = atof(GetOption(argc, argv, "--spin-us", "0")) / 1e6;
+    bool lava = strcmp(side, "lava") == 0 || strcmp(side, "both") == 0;
+    bool ice = strcmp(side, "ice") == 0 || strcmp(side, "both") == 0;
+
+    BotLink link;
+    if (attach != NULL) {
+        if (!BotLinkAttach(&link, attach)) {
+            printf("no bot link named %s, start the game with --bot-link %s\n", attach, attach);
+            return 1;
+        }
+        printf("driving %s, stops when the game is quiet for %s s\n", side, GetOption(argc, argv, "--timeout", "10"));
+        uint64_t answered = RunTrackingBot(&link, lava, ice, spin, atof(GetOption(argc, argv, "--timeout", "10")));
+        printf("states answered: %llu\n", (unsigned long long)answered);
+        BotLinkClose(&link);
+        return 0;
+    }
+
+    char defaultName[32];
+    snprintf(defaultName, sizeof(defaultName), "pong-botlink-%d", (int)getpid());
+    const char *name = GetOption(argc, argv, "--name", defaultName);
+    double seconds = atof(GetOption(argc, argv, "--seconds", "5"));
+    double tickRate = atof(GetOption(argc, argv, "--tick-rate", "120"));
+    Difficulty difficulty = ParseDifficulty(GetOption(argc, argv, "--difficulty", "medium"));
+    if (!BotLinkCreate(&link, name)) {
+        printf("could not create the shared memory object %s\n", name);
+        return 1;
+    }
+
+    fflush(stdout);
+    pid_t bot = fork();
+    if (bot == 0) {
+        BotLink botLink;
+        if (BotLinkAttach(&botLink, name)) RunTrackingBot(&botLink, true, false, spin, 1.0);
+        BotLinkClose(&botLink);
+        _exit(0);
+    }
+    if (bot < 0) {
+        printf("could not start the bot process\n");
+        BotLinkClose(&link);
+        return 1;
+    }
+
+    // Lava is the bot, Ice the built-in AI. Steps are paced to the tick rate
+    // like the game, or run flat out with --tick-rate 0.
+    SimConfig config = SimDifficultyConfig(difficulty, 1280, 800);
+    if (tickRate > 0) config.tickRate = (float)tickRate;
+    SimState state;
+    uint32_t match = 0;
+    SimInit(&state, config, match);
+    int wins[2] = { 0, 0 };
+    double start = NowSeconds();
+    for (uint64_t step = 0;; step++) {
+        double due = start + (tickRate > 0 ? step / tickRate : 0.0);
+        double now = NowSeconds();
+        if (now - start >= seconds) break;
+        SleepSeconds(due - now);
+
+        SimInput input = { .right = { .ai = true } };
+        BotLinkPoll(&link, &input);
+        SimStep(&state, input);
+        BotLinkPublish(&link, &state, match);
+        if (state.winner != SIDE_NONE) {
+            wins[state.winner == SIDE_LAVA ? 0 : 1]++;
+            SimInit(&state, config, ++match);
+        }
+    }
+    double elapsed = NowSeconds() - start;
+    waitpid(bot, NULL, 0);
+
+    printf("link:           %s, %.0f steps/s over %.1f s\n", link.name, link.stats.published / elapsed, elapsed);
+    PrintBotLinkStats(&link.stats);
+    printf("matches:        bot %d, ai %d\n", wins[0], wins[1]);
+    bool ok = link.stats.commands > 0;
+    BotLinkClose(&link);
+    return ok ? 0 : 1;
+#else
+    (void)argc;
+    (void)argv;
+    printf("the bot link needs Linux (POSIX shared memory and futexes)\n");
+    return 1;
+#endif
+}
+
+// Front and back buffers of the pipeline benchmark, like the game's FrameUpdate
+typedef struct BenchFrame {
+    const SimState *sim;
+    const ParticleSystem *particles;
+    const RainSystem *rain;
+    SimState nextSim;
+    ParticleSystem nextParticles;
+    RainSystem nextRain;
+    SimClock clock;
+    float dt;
+    double sampledAt;           // When the input of this update was read
+    uint64_t seed;
+} BenchFrame;
+
+// The benchmark's update stage: AI match steps, then the particle and raindrop updates
+static void UpdateBenchFrame(void *context) {
+    BenchFrame *frame = (BenchFrame *)context;
+    frame->nextSim = *frame->sim;
+    int steps = SimClockAdvance(&frame->clock, frame->dt);
+    for (int i = 0; i < steps; i++) {
+        if (frame->nextSim.winner != SIDE_NONE) SimInit(&frame->nextSim, frame->nextSim.config, frame->seed++);
+        SimStep(&frame->nextSim, aiVsAi);
+    }
+    ParticlesAdvance(frame->particles, &frame->nextParticles, frame->dt);
+    ParticleEmitter emitter = {
+        .x = frame->nextSim.ballPosition.x, .y = frame->nextSim.ballPosition.y, .spread = 2 * 3.14159265f,
+        .speedMin = 50, .speedMax = 600, .lifeMin = 0.3f, .lifeMax = 1.5f, .sizeMin = 1.5f, .sizeMax = 3.5f,
+        .color = 0xFF0045FF
+    };
+    ParticlesEmit(&frame->nextParticles, &emitter, frame->nextParticles.capacity - frame->nextParticles.count);
+    RainAdvance(frame->rain, &frame->nextRain, RAIN_SPLIT, frame->dt);
+}
+
+// Swap in the back buffer the update wrote
+static void SwapBenchFrame(BenchFrame *frame, SimState *sim, ParticleSystem *particles, RainSystem *rain) {
+    *sim = frame->nextSim;
+    ParticleSystem frontParticles = *particles;
+    *particles = frame->nextParticles;
+    frame->nextParticles = frontParticles;
+    RainSystem frontRain = *rain;
+    *rain = frame->nextRain;
+    frame->nextRain = frontRain;
+}
+
+// The benchmark's draw stage: build the vertex data the game hands to the GPU, four corners per particle
+static float BenchDraw(const ParticleSystem *particles, const RainSystem *rain, float *vertices, uint32_t *colors) {
+    for (int i = 0; i < particles->count; i++) {
+        float s = particles->size[i];
+        float *v = &vertices[i * 8];
+        v[0] = particles->x[i] - s; v[1] = particles->y[i] - s;
+        v[2] = particles->x[i] + s; v[3] = particles->y[i] - s;
+        v[4] = particles->x[i] + s; v[5] = particles->y[i] + s;
+        v[6] = particles->x[i] - s; v[7] = particles->y[i] + s;
+        float alpha = particles->life[i] < 1.0f ? particles->life[i] : 1.0f;
+        colors[i] = (particles->color[i] & 0x00FFFFFFu) | ((uint32_t)(alpha * 255.0f) << 24);
+    }
+    float checksum = 0;
+    for (int i = 0; i < rain->count * 2; i++) checksum += rain->y[i];
+    return checksum + vertices[0];
+}
+
+// pipeline: frames with the update and draw stages of the game, once in latency mode and
+// once pipelined, reporting frame rate and how long sampled input takes to reach the screen
+static int RunPipeline(int argc, char **argv) {
+    int frames = atoi(GetOption(argc, argv, "--frames", "600"));
+    int count = atoi(GetOption(argc, argv, "--particles", "65536"));
+    int drops = atoi(GetOption(argc, argv, "--drops", "20000"));
+    double drawExtra = atof(GetOption(argc, argv, "--draw-us", "0")) / 1e6;
+    int fps = atoi(GetOption(argc, argv, "--fps", "0"));
+
+    float *vertices = malloc(sizeof(float) * 8 * (size_t)count);
+    uint32_t *colors = malloc(sizeof(uint32_t) * (size_t)count);
+    if (vertices == NULL || colors == NULL) {
+        printf("could not allocate %d particles\n", count);
+        return 1;
+    }
+    printf("frames:         %d, %d particles, %d drops per theme, %.0f us extra draw, fps cap %d\n",
+           frames, count, drops, drawExtra * 1e6, fps);
+
+    volatile float checksum = 0;    // Keeps the draw loop from being optimized away
+    for (int pipelined = 0; pipelined <= 1; pipelined++) {
+        SimState sim;
+        SimInit(&sim, SimDifficultyConfig(MEDIUM, 1280, 800), 1);
+        ParticleSystem particles;
+        RainSystem rain;
+        static BenchFrame frame;
+        frame = (BenchFrame){ .sim = &sim, .particles = &particles, .rain = &rain, .dt = 1.0f / 60.0f, .seed = 2 };
+        if (!ParticlesInit(&particles, count, 1) || !ParticlesInit(&frame.nextParticles, count, 1) ||
+            !RainInit(&rain, drops, 1280, 800, 1) || !RainInit(&frame.nextRain, drops, 1280, 800, 1)) {
+            printf("could not allocate the buffers\n");
+            return 1;
+        }
+        particles.drag = frame.nextParticles.drag = 0.6f;
+        SimClockInit(&frame.clock, SIM_DEFAULT_TICK_RATE);
+        Pipeline pipeline;
+        if (!PipelineStart(&pipeline, UpdateBenchFrame, &frame, pipelined)) {
+            printf("could not start the update thread\n");
+            return 1;
+        }
+
+        double shownAt = 0;     // Input time of the update on screen
+        double latency = 0, worstLatency = 0, drawSeconds = 0;
+        int latencies = 0;
+        double start = NowSeconds();
+        for (int f = 0; f < frames; f++) {
+            double frameStart = NowSeconds();
+            frame.sampledAt = frameStart;
+            PipelineSubmit(&pipeline);
+            if (!pipeline.pipelined) {
+                SwapBenchFrame(&frame, &sim, &particles, &rain);
+                shownAt = frame.sampledAt;
+            }
+
+            double drawStart = NowSeconds();
+            checksum += BenchDraw(&particles, &rain, vertices, colors);
+            while (NowSeconds() - drawStart < drawExtra) {
+            }
+            double presented = NowSeconds();
+            drawSeconds += presented - drawStart;
+            if (shownAt > 0) {
+                latency += presented - shownAt;
+                if (presented - shownAt > worstLatency) worstLatency = presented - shownAt;
+                latencies++;
+            }
+
+            if (pipeline.pipelined) {
+                PipelineWait(&pipeline);
+                SwapBenchFrame(&frame, &sim, &particles, &rain);
+                shownAt = frame.sampledAt;
+            }
+            if (fps > 0) SleepSeconds(frameStart + 1.0 / fps - NowSeconds());
+        }
+        double seconds = NowSeconds() - start;
+
+        printf("%s\n", pipelined ? "pipelined:" : "latency mode:");
+        printf("  frame rate:   %.1f fps (%.3f ms a frame)\n", frames / seconds, seconds / frames * 1000.0);
+        printf("  update:       %.3f ms, draw %.3f ms, main thread waiting %.3f ms\n",
+               pipeline.workSeconds / frames * 1000.0, drawSeconds / frames * 1000.0,
+               pipeline.waitSeconds / frames * 1000.0);
+        printf("  input to screen: %.3f ms average, %.3f ms worst\n",
+               latencies ? latency / latencies * 1000.0 : 0.0, worstLatency * 1000.0);
+        PipelineStop(&pipeline);
+        ParticlesFree(&particles);
+        ParticlesFree(&frame.nextParticles);
+        RainFree(&rain);
+        RainFree(&frame.nextRain);
+    }
+    free(vertices);
+    free(colors);
+    return 0;
+}
+
+// power: an idle menu for a while, once drawing every frame and once with the idle
+// scheduler, reporting CPU time per frame and wakeups per second in each mode
+static int RunPower(int argc, char **argv) {
+    double seconds = atof(GetOption(argc, argv, "--seconds", "10"));
+    double idleSeconds = atof(GetOption(argc, argv, "--idle", "1"));
+    double freezeSeconds = atof(GetOption(argc, argv, "--freeze", "5"));
+    double inputEvery = atof(GetOption(argc, argv, "--input-every", "7"));
+    int drops = atoi(GetOption(argc, argv, "--drops", "20000"));
+    double drawExtra = atof(GetOption(argc, argv, "--draw-us", "500")) / 1e6;
+    int fps = atoi(GetOption(argc, argv, "--fps", "60"));
+    if (fps <= 0 || inputEvery <= 0.0) {
+        printf("power needs --fps and --input-every above 0\n");
+        return 2;
+    }
+
+    RainSystem rain;
+    if (!RainInit(&rain, drops, 1280, 800, 1)) {
+        printf("could not allocate %d raindrops\n", drops);
+        return 1;
+    }
+    printf("menu:           %.0f s, %d drops per theme, %.0f us extra draw, fps cap %d, a key every %.1f s\n",
+           seconds, drops, drawExtra * 1e6, fps, inputEvery);
+
+    volatile float checksum = 0;    // Keeps the draw loop from being optimized away
+    for (int scheduled = 0; scheduled <= 1; scheduled++) {
+        double start = NowSeconds();
+        PowerScheduler power;
+        PowerInit(&power, start, scheduled, idleSeconds, freezeSeconds);
+        double nextInput = start + inputEvery;
+        double latency = 0, worstLatency = 0;
+        int presses = 0;
+        unsigned wakeups = 0;      // Sleeps ended since the last frame, the last one starts the next frame
+        bool pressed = false;
+        float dt = 1.0f / fps;
+        for (double now = start; now - start < seconds; now = NowSeconds()) {
+            double frameStart = now;
+            if (pressed) {
+                // Input to the frame that answers it
+                double late = frameStart - (nextInput - inputEvery);
+                latency += late;
+                if (late > worstLatency) worstLatency = late;
+                presses++;
+            }
+
+            // The menu frame: move the drops, then walk them like the draw does
+            if (power.mode != POWER_SLEEP || pressed) RainUpdate(&rain, RAIN_SPLIT, dt);
+            for (int i = 0; i < rain.count * 2; i++) checksum += rain.y[i];
+            double drawStart = NowSeconds();
+            while (NowSeconds() - drawStart < drawExtra) {
+            }
+
+            // The wait at the end of the frame, cut short by a scripted key press
+            double until = frameStart + 1.0 / fps;
+            if (power.mode == POWER_LOW_RATE) until = frameStart + 1.0 / POWER_LOW_FPS;
+            if (power.mode == POWER_SLEEP) until = nextInput;
+            double napLength = (power.mode == POWER_LOW_RATE) ? 1.0 / POWER_POLL_HZ : until - frameStart;
+            pressed = false;
+            for (now = NowSeconds(); now < until && !pressed; now = NowSeconds()) {
+                SleepSeconds(fmin(napLength, until - now));
+                pressed = NowSeconds() >= nextInput;
+                wakeups++;
+            }
+            if (NowSeconds() >= nextInput) {
+                pressed = true;
+                nextInput += inputEvery;
+            }
+            dt = (float)(NowSeconds() - frameStart);
+
+            PowerAccount(&power, NowSeconds(), wakeups);
+            wakeups = 0;
+            PowerUpdate(&power, NowSeconds(), pressed, true, true);
+        }
+
+        printf("%s\n", scheduled ? "idle scheduler:" : "always on:");
+        for (int m = 0; m < POWER_MODE_COUNT; m++) {
+            const PowerStats *stats = &power.stats[m];
+            if (stats->frames == 0 || stats->seconds <= 0.0) continue;
+            printf("  %-9s %5.1f s, %6.1f frames/s, %6.1f wakeups/s, %.3f ms CPU a frame, %5.1f%% of a core\n",
+                   PowerModeName((PowerMode)m), stats->seconds, stats->frames / stats->seconds,
+                   stats->wakeups / stats->seconds, stats->cpuSeconds * 1000.0 / stats->frames,
+                   100.0 * stats->cpuSeconds / stats->seconds);
+        }
+        double total = 0, cpu = 0;
+        unsigned long frames = 0, allWakeups = 0;
+        for (int m = 0; m < POWER_MODE_COUNT; m++) {
+            total += power.stats[m].seconds;
+            cpu += power.stats[m].cpuSeconds;
+            frames += power.stats[m].frames;
+            allWakeups += power.stats[m].wakeups;
+        }
+        printf("  overall   %5.1f s, %6.1f frames/s, %6.1f wakeups/s, %.3f ms CPU a frame, %5.1f%% of a core\n",
+               total, frames / total, allWakeups / total, cpu * 1000.0 / frames, 100.0 * cpu / total);
+        printf("  key to frame: %.1f ms average, %.1f ms worst over %d presses\n",
+               presses ? latency / presses * 1000.0 : 0.0, worstLatency * 1000.0, presses);
+    }
+    RainFree(&rain);
+    return 0;
+}
+
+static const Command commands[] = {
+    { "ai", RunAi, "--cases N --seed S --difficulty easy|medium|hard" },
+    { "arena", RunArena, "--balls N,N,... --obstacles N --ticks T --check-every T --brute-limit N --difficulty easy|medium|hard --seed S" },
+    { "batch", RunBatch, "--matches N --difficulty easy|medium|hard --seed S --max-ticks T --tick-rate HZ --level FILE --verbose" },
+    { "botlink", RunBotlink, "--seconds S --tick-rate HZ (0 runs flat out) --spin-us US --difficulty easy|medium|hard, or --attach NAME --side lava|ice|both --timeout S" },
+    { "fuzz", RunFuzz, "--cases N --seed S --substeps K --speed-scale X" },
+    { "level", RunLevel, "--in FILE (or --shapes N,N,...) --queries N --matches N --classic FILE --seed S" },
+    { "loadgen", RunLoadgen, "--clients N --seconds S --reconnect S --server HOST:PORT (or a local server: --workers N --port P --idle-seconds S)" },
+    { "netloop", RunNetloop, "--matches N --latency-ms MS --jitter-ms MS --loss-percent P --drift-percent P --seed S" },
+    { "pack", RunPack, "--out FILE [files...], packs the game audio when no files are given" },
+    { "particles", RunParticles, "--count N --frames F" },
+    { "pipeline", RunPipeline, "--frames F --particles N --drops N --draw-us US --fps N (0 for uncapped)" },
+    { "power", RunPower, "--seconds S --idle S --freeze S --input-every S --drops N --draw-us US --fps N" },
+    { "rain", RunRain, "--drops N --frames F" },
+    { "replay", RunReplay, "--record FILE --in FILE --seed S --difficulty easy|medium|hard --level FILE --seeks N" },
+    { "resolution", RunResolution, "--budget-ms MS --fixed-ms MS --fill-ms MS --heavy X --noise-percent P --frames F --min-scale S --seed S" },
+    { "server", RunServer, "--port P --workers N --seconds S --tick-rate HZ --send-interval STEPS --idle-seconds S" },
+    { "snapshot", RunSnapshot, "--count N --matches N --out FILE --level FILE" },
+    { "stress", RunStress, "--matches N --display-hz HZ --stall-percent P --max-stall-ms MS --tick-rate HZ" },
+    { "telemetry", RunTelemetry, "--matches N --out PREFIX --rotate-kb KB --steps-per-frame N --seed S --max-ticks T, or log files to read" },
+    { "tournament", RunTournament, "--entrants easy,medium,hard,SPEED:REACTION:ERROR --rules easy|medium|hard --matches N --threads N,N,... --seed S --max-ticks T" },
+    { "vecenv", RunVecenv, "--envs N,N,... --steps N --difficulty easy|medium|hard --seed S" },
+};
+
+int main(int argc, char **argv) {
+    int commandCount = (int)(sizeof(commands) / sizeof(commands[0]));
+    if (argc >= 2) {
+        for (int i = 0; i < commandCount; i++) {
+            if (strcmp(argv[1], commands[i].name) == 0) return commands[i].run(argc - 2, argv + 2);
+        }
+    }
+
+    printf("usage: %s <command> [options]\n", argv[0]);
+    for (int i = 0; i < commandCount; i++) printf("  %-10s %s\n", commands[i].name, commands[i].help);
+    return 2;
+}
@@ -0,0 +1,331 @@
+#include "level.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEVEL_MAX_LINE 8192             // Bytes, room for a poly line of LEVEL_MAX_POLY_POINTS
+
+// FNV-1a over a run of bytes
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static bool AddShape(Level *level, int *capacity, LevelShape shape) {
+    if (level->shapeCount >= LEVEL_MAX_SHAPES) return false;
+    if (level->shapeCount == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 64;
+        LevelShape *shapes = realloc(level->shapes, sizeof(LevelShape) * (size_t)grown);
+        if (shapes == NULL) return false;
+        level->shapes = shapes;
+        *capacity = grown;
+    }
+    level->shapes[level->shapeCount++] = shape;
+    return true;
+}
+
+static SimRect PointBounds(SimVec2 a, SimVec2 b, float radius) {
+    float minX = fminf(a.x, b.x) - radius, minY = fminf(a.y, b.y) - radius;
+    return (SimRect){ minX, minY, fmaxf(a.x, b.x) + radius - minX, fmaxf(a.y, b.y) + radius - minY };
+}
+
+// Read up to max numbers from the rest of a line, returns how many were there
+static int ReadNumbers(const char *cursor, const char *end, float *numbers, int max, bool *junk) {
+    int count = 0;
+    *junk = false;
+    while (cursor < end) {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+        if (cursor >= end || *cursor == '#') break;
+        char *next;
+        float value = strtof(cursor, &next);
+        if (next == cursor || next > end || !isfinite(value) || count == max) {
+            *junk = true;
+            break;
+        }
+        numbers[count++] = value;
+        cursor = next;
+    }
+    return count;
+}
+
+static bool ParseLine(Level *level, int *capacity, const char *line, const char *end, bool *header) {
+    float numbers[2 * LEVEL_MAX_POLY_POINTS + 1];
+    const int maxNumbers = (int)(sizeof(numbers) / sizeof(numbers[0]));
+    char word[16];
+    int length = 0;
+
+    while (line < end && (*line == ' ' || *line == '\t' || *line == '\r')) line++;
+    if (line >= end || *line == '#') return true;
+    while (line < end && *line != ' ' && *line != '\t' && *line != '\r' && length < (int)sizeof(word) - 1) {
+        word[length++] = *line++;
+    }
+    word[length] = '\0';
+
+    bool junk;
+    int count = ReadNumbers(line, end, numbers, maxNumbers, &junk);
+    if (junk) return false;
+
+    if (!*header) {
+        *header = true;
+        return strcmp(word, "level") == 0 && count == 1 && numbers[0] == LEVEL_VERSION;
+    }
+    if (strcmp(word, "rect") == 0) {
+        if (count != 4 || numbers[2] <= 0.0f || numbers[3] <= 0.0f) return false;
+        LevelShape shape = { .type = LEVEL_RECT, .bounds = { numbers[0], numbers[1], numbers[2], numbers[3] } };
+        return AddShape(level, capacity, shape);
+    }
+    if (strcmp(word, "circle") == 0) {
+        if (count != 3 || numbers[2] <= 0.0f) return false;
+        SimVec2 center = { numbers[0], numbers[1] };
+        LevelShape shape = { .type = LEVEL_CIRCLE, .bounds = PointBounds(center, center, numbers[2]), .a = center, .radius = numbers[2] };
+        return AddShape(level, capacity, shape);
+    }
+    if (strcmp(word, "poly") == 0) {
+        if (count < 5 || count % 2 == 0 || numbers[0] < 0.0f) return false;
+        for (int i = 1; i + 3 < count; i += 2) {
+            SimVec2 a = { numbers[i], numbers[i + 1] };
+            SimVec2 b = { numbers[i + 2], numbers[i + 3] };
+            LevelShape shape = { .type = LEVEL_SEGMENT, .bounds = PointBounds(a, b, numbers[0]), .a = a, .b = b, .radius = numbers[0] };
+            if (!AddShape(level, capacity, shape)) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+static float Centroid(const LevelShape *shape, int axis) {
+    return axis == 0 ? shape->bounds.x + shape->bounds.width / 2 : shape->bounds.y + shape->bounds.height / 2;
+}
+
+// Reorder shapes so the one with the kth smallest centroid on axis sits at k,
+// smaller ones before it and larger ones after (quickselect)
+static void SelectShapes(LevelShape *shapes, int count, int k, int axis) {
+    int low = 0, high = count - 1;
+    while (low < high) {
+        float pivot = Centroid(&shapes[(low + high) / 2], axis);
+        int i = low, j = high;
+        while (i <= j) {
+            while (Centroid(&shapes[i], axis) < pivot) i++;
+            while (Centroid(&shapes[j], axis) > pivot) j--;
+            if (i <= j) {
+                LevelShape swap = shapes[i];
+                shapes[i++] = shapes[j];
+                shapes[j--] = swap;
+            }
+        }
+        if (k <= j) high = j;
+        else if (k >= i) low = i;
+        else return;
+    }
+}
+
+static SimRect MergeBounds(SimRect a, SimRect b) {
+    float minX = fminf(a.x, b.x), minY = fminf(a.y, b.y);
+    return (SimRect){ minX, minY, fmaxf(a.x + a.width, b.x + b.width) - minX, fmaxf(a.y + a.height, b.y + b.height) - minY };
+}
+
+// Split at the centroid median of the wider axis, so the tree is balanced whatever the layout
+static int BuildNode(Level *level, int first, int count, int depth) {
+    int index = level->nodeCount++;
+    LevelNode *node = &level->nodes[index];
+    if (depth > level->depth) level->depth = depth;
+
+    node->bounds = level->shapes[first].bounds;
+    float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+    for (int i = first; i < first + count; i++) {
+        node->bounds = MergeBounds(node->bounds, level->shapes[i].bounds);
+        minX = fminf(minX, Centroid(&level->shapes[i], 0));
+        maxX = fmaxf(maxX, Centroid(&level->shapes[i], 0));
+        minY = fminf(minY, Centroid(&level->shapes[i], 1));
+        maxY = fmaxf(maxY, Centroid(&level->shapes[i], 1));
+    }
+    if (count <= LEVEL_LEAF_SHAPES) {
+        node->first = first;
+        node->count = count;
+        return index;
+    }
+
+    int half = count / 2;
+    SelectShapes(level->shapes + first, count, half, (maxX - minX >= maxY - minY) ? 0 : 1);
+    BuildNode(level, first, half, depth + 1);
+    int second = BuildNode(level, first + half, count - half, depth + 1);
+    node->first = second;
+    node->count = 0;
+    return index;
+}
+
+bool LevelParse(Level *level, const char *text, size_t size) {
+    const char *end = text + size;
+    int capacity = 0;
+    int line = 0;
+    bool header = false;
+
+    *level = (Level){ 0 };
+    for (const char *cursor = text; cursor < end;) {
+        const char *lineEnd = memchr(cursor, '\n', (size_t)(end - cursor));
+        if (lineEnd == NULL) lineEnd = end;
+        line++;
+
+        // strtof needs a terminator, parse a copy of the line
+        char copy[LEVEL_MAX_LINE];
+        size_t length = (size_t)(lineEnd - cursor);
+        bool fits = length < sizeof(copy);
+        if (fits) {
+            memcpy(copy, cursor, length);
+            copy[length] = '\0';
+        }
+        if (!fits || !ParseLine(level, &capacity, copy, copy + length, &header)) {
+            LevelFree(level);
+            level->errorLine = line;
+            return false;
+        }
+        cursor = lineEnd + 1;
+    }
+    if (!header) {
+        LevelFree(level);
+        level->errorLine = 1;
+        return false;
+    }
+
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < level->shapeCount; i++) {
+        const LevelShape *shape = &level->shapes[i];
+        uint32_t type = (uint32_t)shape->type;
+        hash = HashBytes(hash, &type, sizeof(type));
+        hash = HashBytes(hash, &shape->bounds, sizeof(shape->bounds));
+        hash = HashBytes(hash, &shape->a, sizeof(shape->a));
+        hash = HashBytes(hash, &shape->b, sizeof(shape->b));
+        hash = HashBytes(hash, &shape->radius, sizeof(shape->radius));
+    }
+    level->hash = hash;
+
+    // A binary tree with leaves of at least one shape has fewer than 2n nodes
+    if (level->shapeCount > 0) {
+        LevelShape *shapes = realloc(level->shapes, sizeof(LevelShape) * (size_t)level->shapeCount);
+        if (shapes != NULL) level->shapes = shapes;
+        level->nodes = malloc(sizeof(LevelNode) * (size_t)(2 * level->shapeCount));
+        if (level->nodes == NULL) {
+            LevelFree(level);
+            return false;
+        }
+        BuildNode(level, 0, level->shapeCount, 1);
+        LevelNode *nodes = realloc(level->nodes, sizeof(LevelNode) * (size_t)level->nodeCount);
+        if (nodes != NULL) level->nodes = nodes;
+    }
+    return true;
+}
+
+bool LevelLoad(Level *level, const char *path) {
+    *level = (Level){ 0 };
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    char *text = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) text = malloc((size_t)size + 1);
+    bool ok = text != NULL && fread(text, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+
+    if (ok) ok = LevelParse(level, text, (size_t)size);
+    free(text);
+    return ok;
+}
+
+void LevelFree(Level *level) {
+    free(level->shapes);
+    free(level->nodes);
+    *level = (Level){ 0 };
+}
+
+static bool SweepShape(const LevelShape *shape, SimVec2 start, SimVec2 motion, float radius, float maxTime, SweepHit *hit) {
+    switch (shape->type) {
+        case LEVEL_RECT: return SweepCircleRect(start, motion, radius, shape->bounds, maxTime, hit);
+        case LEVEL_CIRCLE: return SweepCircleCircle(start, motion, radius, shape->a, shape->radius, maxTime, hit);
+        case LEVEL_SEGMENT: return SweepCircleSegment(start, motion, radius, shape->a, shape->b, shape->radius, maxTime, hit);
+    }
+    return false;
+}
+
+// Does the ball's path reach the box grown by its radius before maxTime (slab test)
+static bool PathReachesBox(SimVec2 start, SimVec2 motion, float radius, SimRect box, float maxTime) {
+    float low[2] = { box.x - radius, box.y - radius };
+    float high[2] = { box.x + box.width + radius, box.y + box.height + radius };
+    float origin[2] = { start.x, start.y };
+    float direction[2] = { motion.x, motion.y };
+    float enter = 0.0f, exit = maxTime;
+
+    for (int axis = 0; axis < 2; axis++) {
+        if (direction[axis] == 0.0f) {
+            if (origin[axis] < low[axis] || origin[axis] > high[axis]) return false;
+            continue;
+        }
+        float t1 = (low[axis] - origin[axis]) / direction[axis];
+        float t2 = (high[axis] - origin[axis]) / direction[axis];
+        if (t1 > t2) { float t = t1; t1 = t2; t2 = t; }
+        if (t1 > enter) enter = t1;
+        if (t2 < exit) exit = t2;
+        if (enter > exit) return false;
+    }
+    return true;
+}
+
+bool LevelSweep(const Level *level, SimVec2 start, SimVec2 motion, float radius, float maxTime, SweepHit *hit, int *shape) {
+    int stack[LEVEL_MAX_DEPTH];
+    int top = 0;
+    bool found = false;
+
+    if (level->nodeCount == 0) return false;
+    stack[top++] = 0;
+    while (top > 0) {
+        const LevelNode *node = &level->nodes[stack[--top]];
+        if (!PathReachesBox(start, motion, radius, node->bounds, maxTime)) continue;
+
+        if (node->count == 0) {
+            // Nearer child on top so it tightens maxTime before the other is tested
+            int first = (int)(node - level->nodes) + 1, second = node->first;
+            const LevelNode *a = &level->nodes[first], *b = &level->nodes[second];
+            float toA = (a->bounds.x + a->bounds.width / 2 - start.x) * motion.x + (a->bounds.y + a->bounds.height / 2 - start.y) * motion.y;
+            float toB = (b->bounds.x + b->bounds.width / 2 - start.x) * motion.x + (b->bounds.y + b->bounds.height / 2 - start.y) * motion.y;
+            stack[top++] = (toA <= toB) ? second : first;
+            stack[top++] = (toA <= toB) ? first : second;
+            continue;
+        }
+
+        for (int i = node->first; i < node->first + node->count; i++) {
+            SweepHit candidate;
+            if (SweepShape(&level->shapes[i], start, motion, radius, maxTime, &candidate) &&
+                (!found || candidate.time < maxTime)) {
+                *hit = candidate;
+                *shape = i;
+                maxTime = candidate.time;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+bool LevelSweepLinear(const Level *level, SimVec2 start, SimVec2 motion, float radius, float maxTime, SweepHit *hit, int *shape) {
+    bool found = false;
+    for (int i = 0; i < level->shapeCount; i++) {
+        SweepHit candidate;
+        if (SweepShape(&level->shapes[i], start, motion, radius, maxTime, &candidate) &&
+            (!found || candidate.time < maxTime)) {
+            *hit = candidate;
+            *shape = i;
+            maxTime = candidate.time;
+            found = true;
+        }
+    }
+    return found;
+}
+
+size_t LevelMemory(const Level *level) {
+    return sizeof(LevelShape) * (size_t)level->shapeCount + sizeof(LevelNode) * (size_t)level->nodeCount;
+}
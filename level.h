@@ -0,0 +1,74 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "sim.h"
+#include "collide.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Level files: the static colliders of a playfield, loaded from text and put
+// into a bounding volume hierarchy so a ball sweep visits O(log n) shapes
+// instead of all of them. A match uses a level through SimConfig.level; without
+// one it keeps the three center blocks, which levels/classic.lvl reproduces.
+//
+// File format, one shape per line, # starts a comment, coordinates in pixels:
+//   level 1                          first line, format version
+//   rect X Y WIDTH HEIGHT
+//   circle X Y RADIUS
+//   poly THICKNESS X1 Y1 X2 Y2 ...   polyline, THICKNESS is half the line width, 0 for a thin line
+
+#define LEVEL_VERSION 1
+#define LEVEL_MAX_SHAPES 65536
+#define LEVEL_MAX_POLY_POINTS 256     // Per poly line, continue longer outlines on the next line
+#define LEVEL_LEAF_SHAPES 4          // Shapes per BVH leaf
+#define LEVEL_MAX_DEPTH 64           // Traversal stack, the median split keeps depth near log2(shapes)
+
+typedef enum LevelShapeType {
+    LEVEL_RECT,
+    LEVEL_CIRCLE,
+    LEVEL_SEGMENT                    // One piece of a polyline
+} LevelShapeType;
+
+typedef struct LevelShape {
+    LevelShapeType type;
+    SimRect bounds;                  // The rect itself, or the box around a circle or segment
+    SimVec2 a;                       // Circle center, segment start
+    SimVec2 b;                       // Segment end
+    float radius;                    // Circle radius, segment half thickness
+} LevelShape;
+
+// Flattened BVH node. Inner nodes keep their first child right after them and
+// the second at index second; leaves cover shapes [first, first + count).
+typedef struct LevelNode {
+    SimRect bounds;
+    int first;                       // Leaf: first shape. Inner: second child.
+    int count;                       // 0 for inner nodes
+} LevelNode;
+
+typedef struct Level {
+    LevelShape *shapes;              // In BVH leaf order
+    int shapeCount;
+    LevelNode *nodes;
+    int nodeCount;
+    int depth;
+    uint64_t hash;                   // Of the shapes, tells replays which level they were recorded on
+    int errorLine;                   // First line LevelParse rejected, 0 when the file could not be read
+} Level;
+
+// Parse a level and build its BVH. On failure errorLine says where and nothing needs freeing.
+bool LevelParse(Level *level, const char *text, size_t size);
+bool LevelLoad(Level *level, const char *path);
+void LevelFree(Level *level);
+
+// Earliest contact of a ball moving from start by motion within [0, maxTime], same
+// contract as SweepCircleRect. Reports which shape was hit.
+bool LevelSweep(const Level *level, SimVec2 start, SimVec2 motion, float radius, float maxTime, SweepHit *hit, int *shape);
+
+// Same answer by testing every shape, to check the BVH against
+bool LevelSweepLinear(const Level *level, SimVec2 start, SimVec2 motion, float radius, float maxTime, SweepHit *hit, int *shape);
+
+// Bytes held by the shapes and the BVH
+size_t LevelMemory(const Level *level);
+
+#endif // LEVEL_H
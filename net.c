@@ -0,0 +1,178 @@
+// BSD sockets are POSIX, not C11
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "net.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOGDI
+    #define NOUSER
+    #include <winsock2.h>
+    typedef int socklen_t;
+    typedef SOCKET SocketHandle;
+    #define INVALID_HANDLE ((intptr_t)INVALID_SOCKET)
+#else
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    typedef int SocketHandle;
+    #define INVALID_HANDLE ((intptr_t)-1)
+#endif
+
+static struct sockaddr_in ToSockaddr(NetAddress address) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(address.host);
+    addr.sin_port = htons(address.port);
+    return addr;
+}
+
+// Uniform in [0, 1), xorshift64* like the match generator
+static double NextRandom(NetSocket *net) {
+    net->rng ^= net->rng >> 12;
+    net->rng ^= net->rng << 25;
+    net->rng ^= net->rng >> 27;
+    return (double)((net->rng * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+static void SendNow(NetSocket *net, NetAddress to, const void *data, int size) {
+    struct sockaddr_in addr = ToSockaddr(to);
+    sendto((SocketHandle)net->handle, (const char *)data, size, 0, (const struct sockaddr *)&addr, sizeof(addr));
+}
+
+bool NetOpen(NetSocket *net, uint16_t port, NetConditions conditions, uint64_t seed) {
+    memset(net, 0, sizeof(*net));
+    net->handle = INVALID_HANDLE;
+    net->conditions = conditions;
+    net->rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+
+#if defined(_WIN32)
+    static bool started = false;
+    WSADATA data;
+    if (!started && WSAStartup(MAKEWORD(2, 2), &data) != 0) return false;
+    started = true;
+#endif
+    SocketHandle handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if ((intptr_t)handle == INVALID_HANDLE) return false;
+    net->handle = (intptr_t)handle;
+
+    struct sockaddr_in addr = ToSockaddr((NetAddress){ INADDR_ANY, port });
+    socklen_t length = sizeof(addr);
+    bool ok = bind(handle, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+              getsockname(handle, (struct sockaddr *)&addr, &length) == 0;
+#if defined(_WIN32)
+    u_long nonBlocking = 1;
+    ok = ok && ioctlsocket(handle, FIONBIO, &nonBlocking) == 0;
+#else
+    ok = ok && fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+    net->port = ntohs(addr.sin_port);
+
+    // Only needed to hold packets back, and big enough to matter with many sockets open
+    if (ok && (conditions.latency > 0.0 || conditions.jitter > 0.0)) {
+        net->delayed = malloc(sizeof(NetDelayed) * NET_MAX_DELAYED);
+        ok = net->delayed != NULL;
+    }
+    if (!ok) {
+        NetClose(net);
+        return false;
+    }
+    return true;
+}
+
+void NetClose(NetSocket *net) {
+    if (net->handle != INVALID_HANDLE) {
+#if defined(_WIN32)
+        closesocket((SocketHandle)net->handle);
+#else
+        close((SocketHandle)net->handle);
+#endif
+    }
+    free(net->delayed);
+    net->delayed = NULL;
+    net->delayedCount = 0;
+    net->handle = INVALID_HANDLE;
+}
+
+bool NetParseAddress(const char *text, NetAddress *address) {
+    const char *colon = strrchr(text, ':');
+    if (colon == NULL) return false;
+    char host[64];
+    size_t length = (size_t)(colon - text);
+    if (length >= sizeof(host)) return false;
+    memcpy(host, text, length);
+    host[length] = '\0';
+
+    long port = strtol(colon + 1, NULL, 10);
+    if (port <= 0 || port > 65535) return false;
+    if (strcmp(host, "localhost") == 0) strcpy(host, "127.0.0.1");
+
+    // Dotted quad by hand, inet_pton is missing on older MinGW
+    uint32_t value = 0;
+    const char *c = host;
+    for (int part = 0; part < 4; part++) {
+        char *end;
+        long byte = strtol(c, &end, 10);
+        if (end == c || byte < 0 || byte > 255 || (part < 3 && *end != '.') || (part == 3 && *end != '\0')) return false;
+        value = (value << 8) | (uint32_t)byte;
+        c = end + 1;
+    }
+    address->host = value;
+    address->port = (uint16_t)port;
+    return true;
+}
+
+void NetSend(NetSocket *net, NetAddress to, const void *data, int size, double now) {
+    if (size <= 0 || size > NET_MAX_PACKET) return;
+    const NetConditions *conditions = &net->conditions;
+    net->stats.sent++;
+    net->stats.bytesSent += (uint64_t)size;
+
+    if (conditions->loss > 0.0f && NextRandom(net) < conditions->loss) {
+        net->stats.dropped++;
+        return;
+    }
+    double delay = conditions->latency + conditions->jitter * (2.0 * NextRandom(net) - 1.0);
+    if (delay <= 0.0) {
+        SendNow(net, to, data, size);
+        return;
+    }
+    if (net->delayedCount == NET_MAX_DELAYED) {
+        net->stats.dropped++;
+        return;
+    }
+    NetDelayed *packet = &net->delayed[net->delayedCount++];
+    packet->releaseTime = now + delay;
+    packet->to = to;
+    packet->size = size;
+    memcpy(packet->data, data, (size_t)size);
+}
+
+int NetReceive(NetSocket *net, NetAddress *from, void *buffer, int capacity, double now) {
+    // Release everything that is due, swap-removing from the unordered queue
+    for (int i = 0; i < net->delayedCount;) {
+        NetDelayed *packet = &net->delayed[i];
+        if (packet->releaseTime <= now) {
+            SendNow(net, packet->to, packet->data, packet->size);
+            *packet = net->delayed[--net->delayedCount];
+        } else {
+            i++;
+        }
+    }
+
+    struct sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    int size = (int)recvfrom((SocketHandle)net->handle, (char *)buffer, capacity, 0, (struct sockaddr *)&addr, &length);
+    if (size <= 0) return 0;
+    from->host = ntohl(addr.sin_addr.s_addr);
+    from->port = ntohs(addr.sin_port);
+    net->stats.received++;
+    return size;
+}
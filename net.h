@@ -0,0 +1,66 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Non-blocking UDP sockets for online play (see rollback.c). Every socket can
+// impose latency, jitter and packet loss on what it sends, so bad connections
+// can be tried out on loopback. Time is passed in by the caller, so the
+// headless runner can drive it faster than real time.
+
+#define NET_MAX_PACKET 1200     // Bytes, stays under a typical MTU
+#define NET_MAX_DELAYED 512     // Packets held back by the conditions at once
+
+// IPv4 address and port, host byte order
+typedef struct NetAddress {
+    uint32_t host;
+    uint16_t port;
+} NetAddress;
+
+// Applied to outgoing packets. Jitter spreads the delay evenly over
+// latency +/- jitter, so packets can also arrive out of order.
+typedef struct NetConditions {
+    double latency;     // Seconds, one way
+    double jitter;      // Seconds
+    float loss;         // Fraction of packets dropped, 0 to 1
+} NetConditions;
+
+typedef struct NetStats {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t dropped;   // By the conditions or a full delay queue
+    uint64_t bytesSent;
+} NetStats;
+
+typedef struct NetDelayed {
+    double releaseTime;
+    NetAddress to;
+    int size;
+    unsigned char data[NET_MAX_PACKET];
+} NetDelayed;
+
+typedef struct NetSocket {
+    intptr_t handle;
+    uint16_t port;              // Bound port, useful after binding port 0
+    NetConditions conditions;
+    NetDelayed *delayed;        // Unordered, NET_MAX_DELAYED entries, NULL without latency or jitter
+    int delayedCount;
+    uint64_t rng;
+    NetStats stats;
+} NetSocket;
+
+// Bind to port on every interface, 0 picks a free port
+bool NetOpen(NetSocket *net, uint16_t port, NetConditions conditions, uint64_t seed);
+void NetClose(NetSocket *net);
+
+// "host:port" with a dotted IPv4 host or "localhost"
+bool NetParseAddress(const char *text, NetAddress *address);
+
+// Queue a packet, it leaves once the conditions allow
+void NetSend(NetSocket *net, NetAddress to, const void *data, int size, double now);
+
+// Send whatever is due, then read one waiting packet. Returns its size, 0 when nothing is waiting.
+int NetReceive(NetSocket *net, NetAddress *from, void *buffer, int capacity, double now);
+
+#endif // NET_H
@@ -0,0 +1,63 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Pooled particle engine. Particles are stored as parallel arrays (structure of
+// arrays) and kept packed: live particles always occupy [0, count), so update
+// and draw loops run over contiguous memory with no per-element liveness test.
+
+#define PARTICLE_DEFAULT_CAPACITY (1 << 17)
+
+typedef struct ParticleSystem {
+    int capacity;
+    int count;
+    float *x;
+    float *y;
+    float *vx;          // Pixels per second
+    float *vy;
+    float *life;        // Seconds left, also used as alpha when below 1
+    float *size;        // Half extent of the quad in pixels
+    uint32_t *color;    // Packed RGBA, r in the lowest byte
+    float gravity;      // Pixels per second squared, applied to vy
+    float drag;         // Fraction of velocity lost per second
+    uint64_t rng;
+    void *block;        // Single allocation backing every array
+} ParticleSystem;
+
+// Describes one emission: where particles start and the ranges they are drawn from
+typedef struct ParticleEmitter {
+    float x;
+    float y;
+    float angle;        // Center direction in radians
+    float spread;       // Total cone width in radians, 2*pi for a full circle
+    float speedMin;
+    float speedMax;
+    float lifeMin;
+    float lifeMax;
+    float sizeMin;
+    float sizeMax;
+    uint32_t color;
+} ParticleEmitter;
+
+bool ParticlesInit(ParticleSystem *system, int capacity, uint64_t seed);
+void ParticlesFree(ParticleSystem *system);
+void ParticlesClear(ParticleSystem *system);
+
+// Spawn up to amount particles, returns how many fit in the pool
+int ParticlesEmit(ParticleSystem *system, const ParticleEmitter *emitter, int amount);
+
+// Integrate, age and compact the pool
+void ParticlesUpdate(ParticleSystem *system, float dt);
+
+// The same update written into another pool of at least the same capacity. from is
+// only read, so it can be drawn while the next frame's particles are worked out.
+void ParticlesAdvance(const ParticleSystem *from, ParticleSystem *to, float dt);
+
+// Pack a color for ParticleEmitter.color
+static inline uint32_t ParticleColor(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+#endif // PARTICLES_H
@@ -0,0 +1,122 @@
+// clock_gettime and sched_yield are POSIX, not C11 (MinGW gets them from winpthreads)
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "pipeline.h"
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+static double Seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void RunWork(Pipeline *pipeline) {
+    double start = Seconds();
+    pipeline->work(pipeline->context);
+    pipeline->workSeconds += Seconds() - start;
+}
+
+static void *PipelineThread(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    unsigned done = 0;
+    for (;;) {
+        // Spin a little first: the next frame's job is usually close behind
+        double spinUntil = Seconds() + PIPELINE_SPIN_SECONDS;
+        while (atomic_load_explicit(&pipeline->submitted, memory_order_acquire) == done &&
+               !atomic_load_explicit(&pipeline->quit, memory_order_acquire) && Seconds() < spinUntil) {
+        }
+        if (atomic_load_explicit(&pipeline->submitted, memory_order_acquire) == done) {
+            // Sequentially consistent with the main thread's submit, so either it
+            // sees the worker asleep and signals, or the worker sees the new job
+            pthread_mutex_lock(&pipeline->lock);
+            atomic_store(&pipeline->sleeping, 1);
+            while (atomic_load(&pipeline->submitted) == done && !atomic_load(&pipeline->quit)) {
+                pthread_cond_wait(&pipeline->wake, &pipeline->lock);
+            }
+            atomic_store(&pipeline->sleeping, 0);
+            pthread_mutex_unlock(&pipeline->lock);
+        }
+        if (atomic_load_explicit(&pipeline->submitted, memory_order_acquire) == done) break;   // Quit with nothing to do
+
+        RunWork(pipeline);
+        done++;
+        atomic_store_explicit(&pipeline->completed, done, memory_order_release);
+    }
+    return NULL;
+}
+
+static bool StartThread(Pipeline *pipeline) {
+    atomic_store(&pipeline->quit, false);
+    pipeline->running = (pthread_create(&pipeline->thread, NULL, PipelineThread, pipeline) == 0);
+    return pipeline->running;
+}
+
+static void StopThread(Pipeline *pipeline) {
+    if (!pipeline->running) return;
+    pthread_mutex_lock(&pipeline->lock);
+    atomic_store(&pipeline->quit, true);
+    pthread_cond_signal(&pipeline->wake);
+    pthread_mutex_unlock(&pipeline->lock);
+    pthread_join(pipeline->thread, NULL);
+    pipeline->running = false;
+}
+
+bool PipelineStart(Pipeline *pipeline, PipelineWork work, void *context, bool pipelined) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->work = work;
+    pipeline->context = context;
+    atomic_init(&pipeline->submitted, 0);
+    atomic_init(&pipeline->completed, 0);
+    atomic_init(&pipeline->sleeping, 0);
+    atomic_init(&pipeline->quit, false);
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->wake, NULL);
+    return PipelineSetPipelined(pipeline, pipelined) == pipelined;
+}
+
+void PipelineStop(Pipeline *pipeline) {
+    StopThread(pipeline);
+    pthread_cond_destroy(&pipeline->wake);
+    pthread_mutex_destroy(&pipeline->lock);
+}
+
+bool PipelineSetPipelined(Pipeline *pipeline, bool pipelined) {
+    if (pipelined && !pipeline->running) {
+        // The new worker counts jobs from zero
+        atomic_store(&pipeline->submitted, 0);
+        atomic_store(&pipeline->completed, 0);
+        if (!StartThread(pipeline)) pipelined = false;
+    } else if (!pipelined) {
+        StopThread(pipeline);
+    }
+    pipeline->pipelined = pipelined;
+    return pipelined;
+}
+
+void PipelineSubmit(Pipeline *pipeline) {
+    pipeline->frames++;
+    if (!pipeline->pipelined) {
+        RunWork(pipeline);
+        return;
+    }
+    atomic_fetch_add(&pipeline->submitted, 1);
+    if (atomic_load(&pipeline->sleeping)) {
+        pthread_mutex_lock(&pipeline->lock);
+        pthread_cond_signal(&pipeline->wake);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+}
+
+void PipelineWait(Pipeline *pipeline) {
+    if (!pipeline->pipelined) return;
+    double start = Seconds();
+    unsigned target = atomic_load_explicit(&pipeline->submitted, memory_order_relaxed);
+    for (int spins = 0; atomic_load_explicit(&pipeline->completed, memory_order_acquire) != target; spins++) {
+        if (spins > 64) sched_yield();
+    }
+    pipeline->waitSeconds += Seconds() - start;
+}
@@ -0,0 +1,59 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Two-stage frame pipeline. The frame state is double-buffered: while the main
+// thread draws the front buffer, a worker thread runs the update that fills the
+// back buffer from it, and the two swap once both are done. Frames take about
+// as long as the slower stage instead of the sum of both, at the cost of showing
+// input one frame later.
+//
+// The handoff is two counters: the main thread bumps submitted, the worker bumps
+// completed. The worker spins briefly for the next job and only then sleeps on a
+// condition variable, which the main thread signals only when it is asleep.
+//
+// In latency mode there is no worker: the update runs inside PipelineSubmit, so
+// the frame drawn right after shows the input it was given.
+
+#define PIPELINE_SPIN_SECONDS 0.0002   // Worker spin before sleeping, about a frame's input handling
+
+typedef void (*PipelineWork)(void *context);
+
+typedef struct Pipeline {
+    PipelineWork work;
+    void *context;
+    bool pipelined;                   // false runs every update inline (latency mode)
+    bool running;                     // The worker thread is up
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    alignas(64) atomic_uint submitted;
+    atomic_uint sleeping;             // The worker is waiting on wake
+    atomic_bool quit;
+    alignas(64) atomic_uint completed;
+
+    // Seconds spent, for the stats overlay and the headless benchmark
+    double workSeconds;               // Inside work, on whichever thread ran it
+    double waitSeconds;               // Main thread blocked in PipelineWait
+    unsigned frames;
+} Pipeline;
+
+// Start the worker, or run inline when pipelined is false. Returns false if the thread could not start.
+bool PipelineStart(Pipeline *pipeline, PipelineWork work, void *context, bool pipelined);
+void PipelineStop(Pipeline *pipeline);
+
+// Switch between pipelined and latency mode, only between frames (nothing submitted).
+// Returns the mode now in effect, latency mode if the worker could not start.
+bool PipelineSetPipelined(Pipeline *pipeline, bool pipelined);
+
+// Hand this frame's update to the worker, or run it now in latency mode
+void PipelineSubmit(Pipeline *pipeline);
+
+// Wait until the submitted update is done, after which the back buffer may be swapped in
+void PipelineWait(Pipeline *pipeline);
+
+#endif // PIPELINE_H
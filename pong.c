@@ -1,43 +1,258 @@
 #include "raylib.h"
+#include "sim.h"
+#include "arena.h"
+#include "level.h"
+#include "particles.h"
+#include "rain.h"
+#include "render.h"
+#include "text.h"
+#include "profiler.h"
+#include "replay.h"
+#include "resolution.h"
+#include "audio.h"
+#include "botlink.h"
+#include "pipeline.h"
+#include "power.h"
+#include "rollback.h"
+#include "telemetry.h"
+#include "world.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <math.h> // For fabsf()
-// Enum for game states
-typedef enum GameState {
-    MENU,
-    MODE_SELECT,
-    DIFFICULTY_SELECT,
-    PLAYING,
-    GAME_OVER
-} GameState;
-// Enum for game modes
-typedef enum GameMode {
-    PVP,  // Player vs Player
-    PVC   // Player vs Computer
-} GameMode;
-// Enum for difficulty levels
-typedef enum Difficulty {
-    EASY,
-    MEDIUM,
-    HARD
-} Difficulty;
-// Particle struct for effects
-typedef struct Particle {
-    Vector2 position;
-    Vector2 velocity;
-    float lifetime;
-    Color color;
-} Particle;
-// Raindrop struct for menu animation
-typedef struct Raindrop {
-    Vector2 position;
-    float speed;
-    float length;
-    Color color;
-} Raindrop;
+// Sound effects, played on the audio thread (see audio.c)
+typedef enum GameSound {
+    SOUND_GAME_OVER,
+    SOUND_ENTER,
+    SOUND_BACK,
+    SOUND_ARROW,
+    SOUND_PADDLE_HIT,
+    SOUND_WALL_HIT,
+    SOUND_COUNT
+} GameSound;
 
-int main() {
+static Rectangle ToRectangle(SimRect rec) {
+    return (Rectangle){ rec.x, rec.y, rec.width, rec.height };
+}
+
+static void SaveRecording(const Replay *replay, const char *path) {
+    if (ReplaySave(replay, path)) TraceLog(LOG_INFO, "Saved replay of %u ticks to %s", replay->tickCount, path);
+    else TraceLog(LOG_WARNING, "Could not write replay %s", path);
+}
+
+// One frame's update stage (see pipeline.c). It reads the front buffer, which the
+// main thread draws meanwhile, and writes the back buffer, swapped in afterwards.
+typedef struct FrameUpdate {
+    // Front buffer, only read
+    const SimState *sim;
+    const SimState *previousSim;
+    const SimClock *simClock;
+    const ParticleSystem *particles;
+    const RainSystem *rain;
+    const Arena *arena;
+
+    // Back buffer
+    SimState nextSim;
+    SimState nextPreviousSim;
+    SimClock nextSimClock;
+    ParticleSystem nextParticles;
+    RainSystem nextRain;
+    bool particlesAdvanced;     // The back pools were written this frame and are swapped in
+    bool rainAdvanced;
+    unsigned int events;        // SimEvent flags raised this frame
+    float trailBudget;
+
+    // This frame's input, set by the main thread before each submit
+    GameState state;
+    GameMode mode;
+    bool stepSim;               // Local match or replay, stepped here. Online and arena matches step on the main thread.
+    SimInput input;
+    float frameTime;            // Sim time to cover, scaled by the replay controls
+    float dt;                   // Wall time of the last frame, for the effects
+    unsigned int mainEvents;    // Raised by the main thread's steps
+    bool replaying;
+    bool recording;
+    Replay *replay;
+    BotLink *botLink;
+    uint32_t botMatch;
+    Difficulty difficulty;
+    TelemetryBatch telemetry;   // Records of the steps run since the main thread last posted them
+
+    // Fixed for the whole run
+    Color leftColor;
+    Color rightColor;
+    float trailRate;
+    int paddleHitBurst;
+    int goalBurst;
+    int screenWidth;
+    bool logging;               // Match telemetry is on
+} FrameUpdate;
+
+// Steady trail from each paddle, plus bursts sprayed back the way the ball came from
+static void EmitMatchParticles(FrameUpdate *frame, unsigned int events) {
+    ParticleSystem *particles = &frame->nextParticles;
+    const SimState *sim = &frame->nextSim;
+    Rectangle leftPaddle = ToRectangle(frame->mode == ARENA ? frame->arena->leftPaddle : sim->leftPaddle);
+    Rectangle rightPaddle = ToRectangle(frame->mode == ARENA ? frame->arena->rightPaddle : sim->rightPaddle);
+    Color leftColor = frame->leftColor;
+    Color rightColor = frame->rightColor;
+
+    frame->trailBudget += frame->trailRate * frame->dt;
+    int trail = (int)frame->trailBudget;
+    frame->trailBudget -= trail;
+    ParticleEmitter lavaTrail = {
+        .x = leftPaddle.x + leftPaddle.width, .y = leftPaddle.y + leftPaddle.height / 2,
+        .spread = 2 * PI, .speedMax = 170.0f, .lifeMin = 0.5f, .lifeMax = 1.0f,
+        .sizeMin = 3.0f, .sizeMax = 3.0f,
+        .color = ParticleColor(leftColor.r, leftColor.g, leftColor.b, leftColor.a)
+    };
+    ParticleEmitter iceTrail = lavaTrail;
+    iceTrail.x = rightPaddle.x;
+    iceTrail.y = rightPaddle.y + rightPaddle.height / 2;
+    iceTrail.color = ParticleColor(rightColor.r, rightColor.g, rightColor.b, rightColor.a);
+    ParticlesEmit(particles, &lavaTrail, trail);
+    ParticlesEmit(particles, &iceTrail, trail);
+
+    // The arena hits and scores every step, no bursts there
+    if (frame->mode == ARENA) return;
+    if (events & SIM_EVENT_PADDLE_HIT) {
+        bool lavaHit = sim->ballPosition.x < frame->screenWidth / 2;
+        Color hitColor = lavaHit ? leftColor : rightColor;
+        ParticleEmitter burst = {
+            .x = sim->ballPosition.x, .y = sim->ballPosition.y,
+            .angle = lavaHit ? 0.0f : PI, .spread = PI, .speedMin = 80.0f, .speedMax = 600.0f,
+            .lifeMin = 0.3f, .lifeMax = 0.9f, .sizeMin = 1.5f, .sizeMax = 3.5f,
+            .color = ParticleColor(hitColor.r, hitColor.g, hitColor.b, hitColor.a)
+        };
+        ParticlesEmit(particles, &burst, frame->paddleHitBurst);
+    }
+    if (events & (SIM_EVENT_LAVA_SCORED | SIM_EVENT_ICE_SCORED)) {
+        bool lavaScored = (events & SIM_EVENT_LAVA_SCORED) != 0;
+        Color goalColor = lavaScored ? leftColor : rightColor;
+        ParticleEmitter burst = {
+            .x = lavaScored ? (float)frame->screenWidth : 0.0f, .y = frame->nextPreviousSim.ballPosition.y,
+            .angle = lavaScored ? PI : 0.0f, .spread = PI, .speedMin = 100.0f, .speedMax = 900.0f,
+            .lifeMin = 0.5f, .lifeMax = 1.5f, .sizeMin = 1.5f, .sizeMax = 4.0f,
+            .color = ParticleColor(goalColor.r, goalColor.g, goalColor.b, goalColor.a)
+        };
+        ParticlesEmit(particles, &burst, frame->goalBurst);
+    }
+}
+
+// The update stage: fixed steps of a local match, then particles or raindrops
+static void UpdateFrame(void *context) {
+    FrameUpdate *frame = (FrameUpdate *)context;
+    frame->nextSim = *frame->sim;
+    frame->nextPreviousSim = *frame->previousSim;
+    frame->nextSimClock = *frame->simClock;
+    unsigned int events = frame->mainEvents;
+
+    // Run as many fixed steps as the frame time covers
+    if (frame->stepSim && frame->state == PLAYING) {
+        SimState *sim = &frame->nextSim;
+        int steps = SimClockAdvance(&frame->nextSimClock, frame->frameTime);
+        for (int i = 0; i < steps && sim->winner == SIDE_NONE; i++) {
+            if (frame->replaying && sim->tick >= frame->replay->tickCount) break; // Recording stopped before the match ended
+            SimInput stepInput = frame->replaying ? ReplayInput(frame->replay, sim->tick) : frame->input;
+            if (!frame->replaying) BotLinkPoll(frame->botLink, &stepInput); // Recorded with the bot's paddles, so replays still match
+            if (frame->recording) ReplayRecord(frame->replay, sim, stepInput);
+            frame->nextPreviousSim = *sim;
+            unsigned int stepEvents = SimStep(sim, stepInput);
+            events |= stepEvents;
+            if (frame->logging && !frame->replaying) {
+                TelemetryRecordStep(&frame->telemetry, &frame->nextPreviousSim, sim, stepEvents, frame->difficulty, frame->mode);
+            }
+            if (!frame->replaying) BotLinkPublish(frame->botLink, sim, frame->botMatch);
+        }
+    }
+    frame->events = events;
+
+    // Particles keep moving after the match so the final goal burst plays out
+    frame->particlesAdvanced = (frame->state == PLAYING || frame->state == GAME_OVER);
+    if (frame->particlesAdvanced) {
+        ParticlesAdvance(frame->particles, &frame->nextParticles, frame->dt);
+        if (frame->state == PLAYING) EmitMatchParticles(frame, events);
+    }
+    frame->rainAdvanced = (frame->state == MENU || frame->state == MODE_SELECT || frame->state == DIFFICULTY_SELECT);
+    if (frame->rainAdvanced) {
+        RainAdvance(frame->rain, &frame->nextRain, frame->state == MENU ? RAIN_SPLIT : RAIN_MIXED, frame->dt);
+    }
+}
+
+// Swap in the back buffer the update wrote, the next draw reads it
+static void SwapFrame(FrameUpdate *frame, SimState *sim, SimState *previousSim, SimClock *simClock,
+                      ParticleSystem *particles, RainSystem *rain) {
+    *sim = frame->nextSim;
+    *previousSim = frame->nextPreviousSim;
+    *simClock = frame->nextSimClock;
+    if (frame->particlesAdvanced) {
+        ParticleSystem front = *particles;
+        *particles = frame->nextParticles;
+        frame->nextParticles = front;
+    }
+    if (frame->rainAdvanced) {
+        RainSystem front = *rain;
+        *rain = frame->nextRain;
+        frame->nextRain = front;
+    }
+}
+
+int main(int argc, char **argv) {
+    // Command line options
+    float tickRate = SIM_DEFAULT_TICK_RATE; // --tick-rate HZ: fixed simulation rate
+    int targetFps = 60;                     // --fps N: render rate, 0 for uncapped
+    bool stressStalls = false;              // --stress: inject random frame stalls
+    int particleCapacity = PARTICLE_DEFAULT_CAPACITY; // --particles N: particle pool size
+    int numRaindrops = RAIN_DEFAULT_DROPS;            // --rain N: menu raindrops per theme
+    const char *profileCsvPath = NULL;                // --profile-csv FILE: frame timings written on exit
+    const char *profileTracePath = NULL;              // --profile-trace FILE: Chrome trace written on exit
+    const char *recordPath = NULL;                    // --record FILE: save every match as a replay
+    const char *replayPath = NULL;                    // --replay FILE: watch a recorded match
+    const char *bundlePath = "assets.pak";            // --assets FILE: packed audio, loose files if missing
+    const char *hostPort = NULL;                      // --host PORT: wait for an online PVP opponent
+    const char *joinAddress = NULL;                   // --join HOST:PORT: play online PVP against a host
+    NetConditions netConditions = { 0 };              // --net-latency-ms, --net-jitter-ms, --net-loss-percent: try a bad connection
+    int arenaBalls = ARENA_DEFAULT_BALLS;             // --arena-balls N: balls in the arena party mode
+    int arenaObstacles = ARENA_DEFAULT_OBSTACLES;     // --arena-obstacles N: obstacles scattered over the arena
+    const char *levelPath = NULL;                     // --level FILE: colliders to play on instead of the three blocks
+    const char *botLinkName = NULL;                   // --bot-link NAME: let a bot process drive paddles over shared memory
+    bool latencyMode = false;                         // --latency-mode: update and draw in turn, input shows a frame sooner
+    float frameBudgetMs = 0.0f;                       // --frame-budget MS: render the scene smaller to keep frames under MS, 0 for off
+    double idleSeconds = POWER_DEFAULT_IDLE_SECONDS;     // --idle-seconds S: slow idle screens down after S seconds without input, 0 for never
+    double freezeSeconds = POWER_DEFAULT_FREEZE_SECONDS; // --idle-freeze S: stop the menu raindrops too after S seconds, 0 for never
+    const char *telemetryPath = NULL;                 // --telemetry PREFIX: log every hit and goal of local matches to PREFIX-*.tlm
+    long telemetryRotateKb = TELEMETRY_DEFAULT_ROTATE_BYTES / 1024; // --telemetry-rotate-kb KB: start a new log file past KB
+    const char *snapshotPath = NULL;                  // --snapshot FILE: keep quick-saves on disk and resume from them on start
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) tickRate = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) particleCapacity = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rain") == 0 && i + 1 < argc) numRaindrops = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) targetFps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) profileCsvPath = argv[++i];
+        else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) profileTracePath = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) bundlePath = argv[++i];
+        else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) hostPort = argv[++i];
+        else if (strcmp(argv[i], "--join") == 0 && i + 1 < argc) joinAddress = argv[++i];
+        else if (strcmp(argv[i], "--net-latency-ms") == 0 && i + 1 < argc) netConditions.latency = atof(argv[++i]) / 1000.0;
+        else if (strcmp(argv[i], "--net-jitter-ms") == 0 && i + 1 < argc) netConditions.jitter = atof(argv[++i]) / 1000.0;
+        else if (strcmp(argv[i], "--net-loss-percent") == 0 && i + 1 < argc) netConditions.loss = (float)atof(argv[++i]) / 100.0f;
+        else if (strcmp(argv[i], "--arena-balls") == 0 && i + 1 < argc) arenaBalls = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--arena-obstacles") == 0 && i + 1 < argc) arenaObstacles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) levelPath = argv[++i];
+        else if (strcmp(argv[i], "--bot-link") == 0 && i + 1 < argc) botLinkName = argv[++i];
+        else if (strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc) frameBudgetMs = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--idle-seconds") == 0 && i + 1 < argc) idleSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--idle-freeze") == 0 && i + 1 < argc) freezeSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) telemetryPath = argv[++i];
+        else if (strcmp(argv[i], "--telemetry-rotate-kb") == 0 && i + 1 < argc) telemetryRotateKb = atol(argv[++i]);
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) snapshotPath = argv[++i];
+        else if (strcmp(argv[i], "--latency-mode") == 0) latencyMode = true;
+        else if (strcmp(argv[i], "--stress") == 0) stressStalls = true;
+    }
+    
     const int screen_width = 1280;
     const int screen_height = 800;
     InitWindow(screen_width, screen_height, "LAVA VS ICE");
@@ -47,20 +262,20 @@ int main() {
     InitAudioDevice();
     
     
-    // Load sounds and music
-    Music backgroundMusic = LoadMusicStream("background_music.mp3");
-    Sound gameOverSound = LoadSound("game_over.wav");
-    Sound enterSound = LoadSound("enter.wav");
-    Sound backSound = LoadSound("back.wav");
-    Sound arrowSound = LoadSound("arrow.wav");
-    Sound paddleHitSound = LoadSound("paddle_hit.wav");  
-    Sound wallHitSound = LoadSound("paddle_hit.wav");     
+    // Load sounds and music in the background, the menu shows up straight away.
+    // Everything audio happens on its own thread, the frame loop only posts commands.
+    const char *soundFiles[SOUND_COUNT] = {
+        "game_over.wav", "enter.wav", "back.wav", "arrow.wav", "paddle_hit.wav", "paddle_hit.wav"
+    };
+    Audio audio;
+    AudioStart(&audio, bundlePath, "background_music.mp3", soundFiles, SOUND_COUNT);
+    const float musicFade = 0.5f; // Seconds for the music volume to change between screens
     
-    // Set background music volume to high (1.0f) initially for main menu
-    SetMusicVolume(backgroundMusic, 1.5f);
+    // Play background music in loop, the audio thread starts it once it has loaded
+    AudioPlayMusic(&audio, 0.0f);
     
-    // Play background music in loop
-    PlayMusicStream(backgroundMusic);
+    // Set background music volume to high (1.0f) initially for main menu
+    AudioSetMusicVolume(&audio, 1.5f, 0.0f);
     
     // Background colors
     Color menuBackgroundColor = BLACK;
@@ -74,7 +289,6 @@ int main() {
     
     // Minecraft-style block colors for menu background
     const int blockSize = 40;
-    int gridWidth, gridHeight;
     
     // High opacity block colors for main menu
     Color leftBlockColorsHigh[4] = {
@@ -106,9 +320,18 @@ int main() {
         (Color){160, 224, 255, 60}  // Darkest blue
     };
     
-    // Calculate grid dimensions
-    gridWidth = screen_width / blockSize + 1;
-    gridHeight = screen_height / blockSize + 1;
+    // The grid never changes, so it is baked into one texture per palette (see render.c)
+    GridCache gridCache;
+    GridCacheInit(&gridCache, blockSize, leftBlockColorsHigh, rightBlockColorsHigh, leftBlockColors, rightBlockColors);
+    bool useGridCache = true;   // F2 toggles, to compare the menu grid and playfield caches against drawing shape by shape
+    bool showDrawStats = false; // F3 toggles the draw call counter
+    
+    // Frame profiler, too big for the stack (see profiler.c)
+    static Profiler profiler;
+    ProfilerInit(&profiler);
+    ProfileStats profileStats = { 0 };
+    bool showProfiler = false;  // F4 toggles the phase timing overlay
+    int statsCountdown = 0;     // Frames until the overlay stats are recomputed
     
     // Score colors - Lava (left) and Ice (right)
     Color leftScoreColor = (Color){255, 50, 50, 255};   // Bright red-orange for Lava player
@@ -117,100 +340,282 @@ int main() {
     // Back button rectangle
     Rectangle backButton = { screen_width - 150, 20, 120, 40 };
     
-    // Ball settings
-    Vector2 ballPosition = { screen_width / 2.0f, screen_height / 2.0f };
-    Vector2 ballSpeed = { 5.0f, 5.0f };
-    int ballRadius = 20;
+    // Ball colors
     Color ballColor = (Color){100, 300, 10, 255}; 
     Color ballGlow = (Color){255, 50, 0, 255}; 
     
-    // Paddle settings
-    Rectangle leftPaddle = { 50, screen_height / 2 - 50, 20, 100 };
-    Rectangle rightPaddle = { screen_width - 70, screen_height / 2 - 50, 20, 100 };
+    // Paddle colors
     Color leftColor = (Color){255, 69, 0, 255};   // Fiery orange
     Color rightColor = (Color){0, 191, 255, 255}; // Icy blue
-    float paddleSpeed = 6.0f;
-    float aiSpeed = 5.0f;
-    
-    // Obstacles in the middle
-    Rectangle obstacles[3] = {
-        { screen_width / 2 - 10, 100, 20, 50 },
-        { screen_width / 2 - 10, 300, 20, 50 },
-        { screen_width / 2 - 10, 500, 20, 50 }
-    };
     
-    int leftScore = 0;
-    int rightScore = 0;
-    const int winScore = 5;
-    float maxSpeed = 12.0f;
+    // Level file (see level.c), local matches and replays play on it
+    Level level = { 0 };
+    if (levelPath != NULL && !LevelLoad(&level, levelPath)) {
+        if (level.errorLine > 0) TraceLog(LOG_ERROR, "Could not parse level %s, line %d", levelPath, level.errorLine);
+        else TraceLog(LOG_ERROR, "Could not read level %s", levelPath);
+        return 1;
+    }
     
+    // Match state: ball, paddles, obstacles and scores (see sim.c)
     srand(time(NULL));
-    GameState currentState = MENU;
-    GameMode currentMode = PVP;
-    Difficulty currentDifficulty = EASY;
+    SimConfig simConfig = SimDifficultyConfig(MEDIUM, screen_width, screen_height);
+    simConfig.tickRate = tickRate;
+    simConfig.level = (levelPath != NULL) ? &level : NULL;
+    // Screen, menu selections and match in one block, snapshotted by F6 (see world.c)
+    World world;
+    WorldInit(&world);
+    SimInit(&world.sim, simConfig, (uint64_t)rand());
+    world.previousSim = world.sim;
+    SimClockInit(&world.clock, tickRate);
+    
+    // Arena party mode, set up when a difficulty is picked. Balls are drawn from one soft round sprite.
+    Arena arena = { 0 };
+    Image arenaBallImage = GenImageGradientRadial(32, 32, 0.5f, WHITE, BLANK);
+    Texture2D arenaBallTexture = LoadTextureFromImage(arenaBallImage);
+    UnloadImage(arenaBallImage);
+    
+    // Replays (see replay.c): matches are recorded as their start state plus per-step input
+    Replay replay = { 0 };
+    bool recording = false;     // A match is being recorded to recordPath
+    bool replaying = false;     // Steps take their input from the replay instead of the keyboard
+    bool replayPaused = false;
+    if (replayPath != NULL) {
+        if (!ReplayLoad(&replay, replayPath)) {
+            TraceLog(LOG_ERROR, "Could not read replay %s", replayPath);
+            return 1;
+        }
+        if (!ReplaySetLevel(&replay, simConfig.level)) {
+            TraceLog(LOG_ERROR, "Replay %s was recorded on a different level, pass it with --level", replayPath);
+            return 1;
+        }
+        world.sim = replay.keyframes[0];
+        world.previousSim = world.sim;
+        SimClockInit(&world.clock, world.sim.config.tickRate); // Play back at the rate it was recorded
+        replaying = true;
+        world.screen = PLAYING;
+    }
     
-    // Menu selection variables
-    int modeSelection = 0; // 0: PvP, 1: PvAI
-    int difficultySelection = 0; // 0: Easy, 1: Medium, 2: Hard
+    // Online PVP (see rollback.c): the host picks PVP and a difficulty, the joining side follows
+    NetSocket netSocket = { 0 };
+    static Rollback session;    // Too big for the stack
+    bool online = false;
+    bool onlineMatch = false;   // The current match is played over the network
+    if (hostPort != NULL || joinAddress != NULL) {
+        NetAddress hostAddress = { 0 };
+        if (joinAddress != NULL && !NetParseAddress(joinAddress, &hostAddress)) {
+            TraceLog(LOG_ERROR, "Could not read address %s, expected HOST:PORT", joinAddress);
+            return 1;
+        }
+        if (!NetOpen(&netSocket, hostPort != NULL ? (uint16_t)atoi(hostPort) : 0, netConditions, (uint64_t)rand())) {
+            TraceLog(LOG_ERROR, "Could not open a UDP socket");
+            return 1;
+        }
+        if (joinAddress != NULL) RollbackJoin(&session, &netSocket, hostAddress);
+        else RollbackHost(&session, &netSocket);
+        online = true;
+        TraceLog(LOG_INFO, "Online PVP on UDP port %u as %s", netSocket.port, session.host ? "host (Lava)" : "guest (Ice)");
+    }
+    
+    // Bot link (see botlink.c): local matches publish every step, a bot process answers with paddle commands
+    BotLink botLink = { 0 };
+    uint32_t botMatch = 0;      // Match number the bot sees, goes up with every match started
+    if (botLinkName != NULL) {
+        if (!BotLinkCreate(&botLink, botLinkName)) {
+            TraceLog(LOG_ERROR, "Could not create the bot link %s (needs Linux)", botLinkName);
+            return 1;
+        }
+        TraceLog(LOG_INFO, "Bot link %s is open, run: pong_headless botlink --attach %s", botLink.name, botLinkName);
+    }
     
     const char* winnerText = NULL;
     
-    // Star background
-    const int numStars = 200;
-    Vector2 stars[numStars];
-    for (int i = 0; i < numStars; i++) {
-        stars[i].x = (float)GetRandomValue(0, screen_width);
-        stars[i].y = (float)GetRandomValue(0, screen_height);
+    // Menu and HUD text measured once (see text.c)
+    const int centerX = screen_width / 2;
+    TextLabel pressEnterLabel = LayoutCenteredText("Press ENTER to start", 40, centerX, screen_height / 2);
+    TextLabel selectModeLabel = LayoutCenteredText("Select Game Mode", 60, centerX, 100);
+    TextLabel modeHelpLabel = LayoutCenteredText("Use Up/Down Arrows to select, Enter to choose", 25, centerX, 450);
+    TextLabel selectDifficultyLabel = LayoutCenteredText("Select Difficulty", 60, centerX, 100);
+    TextLabel difficultyHelpLabel = LayoutCenteredText("Use Up/Down Arrows to select, Enter to start", 25, centerX, 450);
+    TextLabel backHelpLabel = LayoutCenteredText("Press Backspace or click Back to go back", 25, centerX, 490);
+    TextLabel returnHelpLabel = LayoutCenteredText("Press Enter to return to mode selection", 30, centerX, screen_height / 2 + 50);
+    TextLabel menuHelpLabel = LayoutCenteredText("or click Back to return to main menu", 30, centerX, screen_height / 2 + 80);
+    TextLabel winnerLabel = { 0 };
+    TextNumber leftScoreText = { 0 };
+    TextNumber rightScoreText = { 0 };
+    
+    // Draw colorful title with gradient effect, baked once
+    TitleCache title = { 0 };
+    TitleCacheBake(&title, 80, centerX, screen_height / 3);
+    
+    // Star background, kept in the world so a snapshot brings the same sky back
+    for (int i = 0; i < WORLD_STARS; i++) {
+        world.stars[i].x = (float)GetRandomValue(0, screen_width);
+        world.stars[i].y = (float)GetRandomValue(0, screen_height);
     }
+    const Vector2 *stars = (const Vector2 *)world.stars;   // SimVec2 is laid out like Vector2
+    const int numStars = WORLD_STARS;
+    
+    // Background, stars, obstacles and center line of the match screens, baked per match (see render.c)
+    PlayfieldTheme playfieldTheme = {
+        .lavaBackground = leftBackgroundColor, .iceBackground = rightBackgroundColor,
+        .gameOverBackground = gameOverBackgroundColor,
+        .lavaStar = (Color){255, 165, 0, 255}, .iceStar = (Color){135, 206, 235, 255}, .gameOverStar = Fade(WHITE, 0.5f),
+        .lavaObstacle = Fade(leftColor, 0.5f), .iceObstacle = Fade(rightColor, 0.5f),
+        .centerLine = Fade(WHITE, 0.2f)
+    };
+    PlayfieldCache playfield;
+    PlayfieldCacheInit(&playfield, playfieldTheme, stars, numStars);
     
-    // Particle effects
-    const int maxParticles = 10;
-    Particle lavaParticles[maxParticles];
-    Particle iceParticles[maxParticles];
-    for (int i = 0; i < maxParticles; i++) {
-        lavaParticles[i].lifetime = 0;
-        iceParticles[i].lifetime = 0;
+    // Particle effects: paddle trails plus bursts on every paddle hit and goal
+    ParticleSystem particles;
+    if (!ParticlesInit(&particles, particleCapacity, (uint64_t)rand())) {
+        TraceLog(LOG_ERROR, "Could not allocate %d particles", particleCapacity);
+        return 1;
     }
+    particles.drag = 0.6f;
+    const float trailRate = 30.0f;                   // Particles per second from each paddle
+    const int paddleHitBurst = particleCapacity / 64;
+    const int goalBurst = particleCapacity / 8;
     
-    // Raindrop animation for menu
-    const int numRaindrops = 100;
-    Raindrop lavaRaindrops[numRaindrops];
-    Raindrop iceRaindrops[numRaindrops];
-    
-    // Initialize raindrops
-    for (int i = 0; i < numRaindrops; i++) {
-        // Lava raindrops (will be on the right side in main menu)
-        lavaRaindrops[i].position = (Vector2){
-            (float)GetRandomValue(screen_width / 2, screen_width),
-            (float)GetRandomValue(-screen_height, 0)
-        };
-        lavaRaindrops[i].speed = (float)GetRandomValue(5, 15);
-        lavaRaindrops[i].length = (float)GetRandomValue(15, 30); // Increased length
-        lavaRaindrops[i].color = (Color){255, 100, 0, 180}; // Orange with more opacity
-        
-        // Ice raindrops (will be on the left side in main menu)
-        iceRaindrops[i].position = (Vector2){
-            (float)GetRandomValue(0, screen_width / 2),
-            (float)GetRandomValue(-screen_height, 0)
-        };
-        iceRaindrops[i].speed = (float)GetRandomValue(5, 15);
-        iceRaindrops[i].length = (float)GetRandomValue(15, 30); // Increased length
-        iceRaindrops[i].color = (Color){0, 150, 255, 180}; // Light blue with more opacity
+    // Raindrop animation for menu (see rain.c)
+    RainSystem rain;
+    if (!RainInit(&rain, numRaindrops, screen_width, screen_height, (uint32_t)rand())) {
+        TraceLog(LOG_ERROR, "Could not allocate %d raindrops", numRaindrops);
+        return 1;
     }
+    Color lavaRainColor = (Color){255, 100, 0, 180}; // Orange with more opacity
+    Color iceRainColor = (Color){0, 150, 255, 180};  // Light blue with more opacity
     
-    SetTargetFPS(60);
+    // Quick-save (F6) and quick-resume (F7). With --snapshot the save also goes to disk after
+    // every goal, and a game started again after a crash picks up from it.
+    World quickSave;
+    bool haveQuickSave = false;
+    bool resumeSnapshot = false;
+    if (snapshotPath != NULL && replayPath == NULL && !online && WorldLoad(&quickSave, snapshotPath)) {
+        haveQuickSave = true;
+        resumeSnapshot = true;
+    }
+    
+    // Match telemetry (see telemetry.c): the update stage collects the records of a frame's
+    // steps, this thread posts them once a frame and a writer thread puts them on disk
+    static Telemetry telemetry;     // Ring and write buffer, kept off the stack
+    bool logging = telemetryPath != NULL && TelemetryStart(&telemetry, telemetryPath, telemetryRotateKb * 1024);
+    if (telemetryPath != NULL && !logging) TraceLog(LOG_WARNING, "Could not start the telemetry log %s", telemetryPath);
+    
+    // Frame pipeline (see pipeline.c): a worker updates into a second set of particles,
+    // raindrops and match state while this thread draws the first. F5 toggles latency mode.
+    static FrameUpdate frame;   // Holds two match states, kept off the stack
+    frame = (FrameUpdate){
+        .sim = &world.sim, .previousSim = &world.previousSim, .simClock = &world.clock,
+        .particles = &particles, .rain = &rain, .arena = &arena,
+        .replay = &replay, .botLink = &botLink,
+        .leftColor = leftColor, .rightColor = rightColor, .trailRate = trailRate,
+        .paddleHitBurst = paddleHitBurst, .goalBurst = goalBurst, .screenWidth = screen_width,
+        .logging = logging
+    };
+    if (!ParticlesInit(&frame.nextParticles, particleCapacity, 0) ||
+        !RainInit(&frame.nextRain, numRaindrops, screen_width, screen_height, 0)) {
+        TraceLog(LOG_ERROR, "Could not allocate the second particle and raindrop buffers");
+        return 1;
+    }
+    frame.nextParticles.drag = particles.drag;
+    Pipeline pipeline;
+    if (!PipelineStart(&pipeline, UpdateFrame, &frame, !latencyMode)) {
+        TraceLog(LOG_WARNING, "Could not start the update thread, running in latency mode");
+    }
+    latencyMode = !pipeline.pipelined;
+    
+    // Dynamic resolution (see resolution.c): the scene is drawn into the top-left corner of an
+    // offscreen target, shrunk by a camera zoom, and stretched over the window. The frame rate
+    // cap moves to the end of the loop then, so the controller measures frames without its wait.
+    bool dynamicResolution = frameBudgetMs > 0.0f;
+    Resolution resolution;
+    ResolutionInit(&resolution, frameBudgetMs / 1000.0f, 0.5f, 1.0f);
+    RenderTexture2D sceneTarget = { 0 };
+    if (dynamicResolution) {
+        sceneTarget = LoadRenderTexture(screen_width, screen_height);
+        SetTextureFilter(sceneTarget.texture, TEXTURE_FILTER_BILINEAR);
+    }
+    
+    SetTargetFPS(dynamicResolution ? 0 : targetFps);
+    
+    // Menus and the game-over screen slow down or stop drawing when nobody is playing (see power.c)
+    PowerScheduler power;
+    PowerInit(&power, GetTime(), idleSeconds > 0.0, idleSeconds, freezeSeconds);
+    unsigned powerWakeups = 0;      // Extra wakeups of the main thread since the last PowerAccount
+    bool powerInput = false;        // Input seen while sleeping out a slow frame
+    bool waitedForEvents = false;   // The last EndDrawing blocked until an input event
     
     while (!WindowShouldClose()) {
-        // Update music stream
-        UpdateMusicStream(backgroundMusic);
+        ProfilerFrameBegin(&profiler);
+        double frameStart = GetTime();
+        ResetDrawCallCount();
+        if (IsKeyPressed(KEY_F2)) useGridCache = !useGridCache;
+        if (IsKeyPressed(KEY_F3)) showDrawStats = !showDrawStats;
+        if (IsKeyPressed(KEY_F4)) showProfiler = !showProfiler;
+        if (IsKeyPressed(KEY_F5)) latencyMode = !PipelineSetPipelined(&pipeline, latencyMode);
+        frame.stepSim = false;
+        frame.mainEvents = 0;
+        
+        // Online, arena and replayed matches have state outside the world, only their menus can be saved
+        bool matchScreen = (world.screen == PLAYING || world.screen == GAME_OVER);
+        bool canSnapshot = !matchScreen || (!onlineMatch && !replaying && world.mode != ARENA);
+        if (IsKeyPressed(KEY_F6)) {
+            if (canSnapshot) {
+                WorldSnapshot(&world, &quickSave);
+                haveQuickSave = true;
+                if (snapshotPath != NULL && !WorldSave(&quickSave, snapshotPath)) TraceLog(LOG_WARNING, "Could not write %s", snapshotPath);
+            } else {
+                TraceLog(LOG_WARNING, "Online, arena and replayed matches can't be quick-saved");
+            }
+        }
+        if ((IsKeyPressed(KEY_F7) || resumeSnapshot) && haveQuickSave && !onlineMatch) {
+            GameState before = world.screen;
+            if (WorldRestore(&world, &quickSave, levelPath != NULL ? &level : NULL)) {
+                if (recording) SaveRecording(&replay, recordPath);
+                recording = false;
+                replaying = false;
+                ParticlesClear(&particles);
+                PlayfieldCacheInvalidate(&playfield);
+                winnerText = NULL;
+                if (world.screen == GAME_OVER) {
+                    SimSide winner = world.sim.winner;
+                    winnerText = (winner == SIDE_LAVA) ? "Lava Wins!" : (winner == SIDE_ICE) ? "Ice Wins!" : "Draw!";
+                    winnerLabel = LayoutCenteredText(winnerText, 60, centerX, screen_height / 2 - 30);
+                    if (before != GAME_OVER) AudioStopMusic(&audio, musicFade);
+                } else {
+                    if (before == GAME_OVER) AudioPlayMusic(&audio, musicFade);
+                    AudioSetMusicVolume(&audio, (world.screen == MODE_SELECT || world.screen == DIFFICULTY_SELECT) ? 0.6f : 1.0f, musicFade);
+                }
+            } else {
+                TraceLog(LOG_WARNING, "The quick-save is from another build or level, not resumed");
+            }
+            resumeSnapshot = false;
+        }
         
-        switch (currentState) {
+        // The host started an online match, follow it from whatever screen this is
+        if (online && RollbackPoll(&session, GetTime())) {
+            world.sim = session.state;
+            world.previousSim = world.sim;
+            SimClockInit(&world.clock, world.sim.config.tickRate);
+            ParticlesClear(&particles);
+            PlayfieldCacheInvalidate(&playfield);
+            AudioSetMusicVolume(&audio, 1.0f, musicFade);
+            world.mode = PVP;
+            onlineMatch = true;
+            winnerText = NULL;
+            replaying = false;
+            world.screen = PLAYING;
+        }
+        
+        ProfileBegin(&profiler, PHASE_INPUT);
+        switch (world.screen) {
             case MENU:
                 if (IsKeyPressed(KEY_ENTER)) {
-                    PlaySound(enterSound); // Play enter sound
+                    AudioPlaySound(&audio, SOUND_ENTER); // Play enter sound
                     // Set volume to medium for mode selection
-                    SetMusicVolume(backgroundMusic, 0.6f);
-                    currentState = MODE_SELECT;
+                    AudioSetMusicVolume(&audio, 0.6f, musicFade);
+                    world.screen = MODE_SELECT;
                 }
                 // Back button check (though not needed in main menu)
                 if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), backButton)) {
@@ -220,423 +625,277 @@ int main() {
                 
             case MODE_SELECT:
                 if (IsKeyPressed(KEY_DOWN)) {
-                    PlaySound(arrowSound); // Play arrow sound
-                    modeSelection = (modeSelection + 1) % 2;
+                    AudioPlaySound(&audio, SOUND_ARROW); // Play arrow sound
+                    world.modeSelection = (world.modeSelection + 1) % 3;
                 }
                 if (IsKeyPressed(KEY_UP)) {
-                    PlaySound(arrowSound); // Play arrow sound
-                    modeSelection = (modeSelection - 1 + 2) % 2;
+                    AudioPlaySound(&audio, SOUND_ARROW); // Play arrow sound
+                    world.modeSelection = (world.modeSelection - 1 + 3) % 3;
                 }
                 if (IsKeyPressed(KEY_ENTER)) {
-                    PlaySound(enterSound); // Play enter sound
-                    currentMode = (modeSelection == 0) ? PVP : PVC;
-                    currentState = DIFFICULTY_SELECT;
-                    difficultySelection = 0; // Reset to Easy
+                    AudioPlaySound(&audio, SOUND_ENTER); // Play enter sound
+                    world.mode = (world.modeSelection == 0) ? PVP : (world.modeSelection == 1) ? PVC : ARENA;
+                    world.screen = DIFFICULTY_SELECT;
+                    world.difficultySelection = 0; // Reset to Easy
                 }
                 if (IsKeyPressed(KEY_BACKSPACE)) {
-                    PlaySound(backSound); // Play back sound
+                    AudioPlaySound(&audio, SOUND_BACK); // Play back sound
                     // Set volume to high for main menu
-                    SetMusicVolume(backgroundMusic, 1.0f);
-                    currentState = MENU;
+                    AudioSetMusicVolume(&audio, 1.0f, musicFade);
+                    world.screen = MENU;
                 }
                 // Back button mouse click
                 if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), backButton)) {
-                    PlaySound(backSound); // Play back sound
+                    AudioPlaySound(&audio, SOUND_BACK); // Play back sound
                     // Set volume to high for main menu
-                    SetMusicVolume(backgroundMusic, 1.0f);
-                    currentState = MENU;
+                    AudioSetMusicVolume(&audio, 1.0f, musicFade);
+                    world.screen = MENU;
                 }
                 break;
                 
             case DIFFICULTY_SELECT:
                 if (IsKeyPressed(KEY_DOWN)) {
-                    PlaySound(arrowSound); // Play arrow sound
-                    difficultySelection = (difficultySelection + 1) % 3;
+                    AudioPlaySound(&audio, SOUND_ARROW); // Play arrow sound
+                    world.difficultySelection = (world.difficultySelection + 1) % 3;
                 }
                 if (IsKeyPressed(KEY_UP)) {
-                    PlaySound(arrowSound); // Play arrow sound
-                    difficultySelection = (difficultySelection - 1 + 3) % 3;
+                    AudioPlaySound(&audio, SOUND_ARROW); // Play arrow sound
+                    world.difficultySelection = (world.difficultySelection - 1 + 3) % 3;
                 }
                 if (IsKeyPressed(KEY_ENTER)) {
-                    PlaySound(enterSound); // Play enter sound
-                    currentDifficulty = (Difficulty)difficultySelection;
+                    AudioPlaySound(&audio, SOUND_ENTER); // Play enter sound
+                    world.difficulty = (Difficulty)world.difficultySelection;
                     
-                    // Set parameters by difficulty
-                    if (currentDifficulty == EASY) {
-                        ballSpeed = (Vector2){4.0f, 4.0f};
-                        maxSpeed = 8.0f;
-                        paddleSpeed = 7.0f;
-                        aiSpeed = 3.0f;
-                        leftPaddle.height = 150;
-                        rightPaddle.height = 150;
-                    } else if (currentDifficulty == MEDIUM) {
-                        ballSpeed = (Vector2){5.0f, 5.0f};
-                        maxSpeed = 12.0f;
-                        paddleSpeed = 6.0f;
-                        aiSpeed = 5.0f;
-                        leftPaddle.height = 100;
-                        rightPaddle.height = 100;
-                    } else if (currentDifficulty == HARD) {
-                        ballSpeed = (Vector2){7.0f, 7.0f};
-                        maxSpeed = 15.0f;
-                        paddleSpeed = 5.0f;
-                        aiSpeed = 7.0f;
-                        leftPaddle.height = 70;
-                        rightPaddle.height = 70;
+                    // Set parameters by difficulty, reset scores and serve
+                    simConfig = SimDifficultyConfig(world.difficulty, screen_width, screen_height);
+                    simConfig.tickRate = tickRate;
+                    onlineMatch = online && session.host && world.mode == PVP;
+                    simConfig.level = (levelPath != NULL && !onlineMatch) ? &level : NULL; // Online matches use the classic layout
+                    uint64_t matchSeed = (uint64_t)rand();
+                    SimInit(&world.sim, simConfig, matchSeed);
+                    botMatch++;
+                    world.previousSim = world.sim;
+                    if (world.mode == ARENA) {
+                        ArenaConfig arenaConfig = ArenaDefaultConfig(world.difficulty, screen_width, screen_height);
+                        arenaConfig.sim.tickRate = tickRate;
+                        arenaConfig.balls = arenaBalls;
+                        arenaConfig.obstacles = arenaObstacles;
+                        ArenaFree(&arena);
+                        if (!ArenaInit(&arena, arenaConfig, matchSeed)) {
+                            TraceLog(LOG_WARNING, "Could not allocate an arena of %d balls", arenaBalls);
+                            break;
+                        }
                     }
-                    
-                    leftScore = 0;
-                    rightScore = 0;
-                    ballPosition = (Vector2){ screen_width / 2.0f, screen_height / 2.0f };
-                    int dirX = (rand() % 2 == 0) ? 1 : -1;
-                    int dirY = (rand() % 2 == 0) ? 1 : -1;
-                    ballSpeed.x = fabsf(ballSpeed.x) * dirX;
-                    ballSpeed.y = fabsf(ballSpeed.y) * dirY;
-                    leftPaddle.y = screen_height / 2 - leftPaddle.height / 2;
-                    rightPaddle.y = screen_height / 2 - rightPaddle.height / 2;
+                    if (onlineMatch) {
+                        RollbackMatch setup = { matchSeed, (int32_t)world.difficulty, screen_width, screen_height, tickRate };
+                        RollbackStart(&session, setup, GetTime());
+                    }
+                    PlayfieldCacheInvalidate(&playfield);
+                    if (recordPath != NULL && !onlineMatch && world.mode != ARENA) {
+                        ReplayFree(&replay);
+                        recording = ReplayBegin(&replay, &world.sim, matchSeed, 0);
+                    }
+                    SimClockInit(&world.clock, tickRate);
+                    ParticlesClear(&particles);
                     
                     // Set volume to low for gameplay
-                    SetMusicVolume(backgroundMusic, 1.0f);
+                    AudioSetMusicVolume(&audio, 1.0f, musicFade);
                     
-                    currentState = PLAYING;
+                    world.screen = PLAYING;
                 }
                 if (IsKeyPressed(KEY_BACKSPACE)) {
-                    PlaySound(backSound); // Play back sound
-                    currentState = MODE_SELECT;
+                    AudioPlaySound(&audio, SOUND_BACK); // Play back sound
+                    world.screen = MODE_SELECT;
                 }
                 // Back button mouse click
                 if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), backButton)) {
-                    PlaySound(backSound); // Play back sound
-                    currentState = MODE_SELECT;
+                    AudioPlaySound(&audio, SOUND_BACK); // Play back sound
+                    world.screen = MODE_SELECT;
                 }
                 break;
                 
-            case PLAYING:
-                ballPosition.x += ballSpeed.x;
-                ballPosition.y += ballSpeed.y;
-                
-                if (ballPosition.x >= screen_width - ballRadius) {
-                    leftScore++;
-                    if (leftScore >= winScore) {
-                        PlaySound(gameOverSound); // Play game over sound
-                        StopMusicStream(backgroundMusic); // Stop background music
-                        currentState = GAME_OVER;
-                        winnerText = "Lava Wins!";
-                    } else {
-                        ballPosition = (Vector2){ screen_width / 2.0f, screen_height / 2.0f };
-                        int dirX = (rand() % 2 == 0) ? 1 : -1;
-                        int dirY = (rand() % 2 == 0) ? 1 : -1;
-                        float speed = (currentDifficulty == EASY ? 4.0f : 
-                                      (currentDifficulty == MEDIUM ? 5.0f : 7.0f));
-                        ballSpeed.x = speed * dirX;
-                        ballSpeed.y = speed * dirY;
+            case PLAYING: {
+                // --- Paddle Controls ---
+                SimInput input = { 0 };
+                float frameTime = GetFrameTime();
+                if (replaying) {
+                    // Playback controls: pause, fast-forward, seek
+                    if (IsKeyPressed(KEY_SPACE)) replayPaused = !replayPaused;
+                    if (IsKeyDown(KEY_TAB)) frameTime *= 8.0f;
+                    if (replayPaused) frameTime = 0.0f;
+                    int seekTicks = 0;
+                    if (IsKeyPressed(KEY_RIGHT)) seekTicks = (int)(5 * world.sim.config.tickRate);
+                    if (IsKeyPressed(KEY_LEFT)) seekTicks = -(int)(5 * world.sim.config.tickRate);
+                    if (IsKeyPressed(KEY_HOME)) seekTicks = -(int)world.sim.tick;
+                    if (seekTicks != 0) {
+                        int target = (int)world.sim.tick + seekTicks;
+                        ReplaySeek(&replay, target < 0 ? 0 : (uint32_t)target, &world.sim);
+                        world.previousSim = world.sim;
+                        ParticlesClear(&particles);
                     }
-                }
-                
-                if (ballPosition.x <= ballRadius) {
-                    rightScore++;
-                    if (rightScore >= winScore) {
-                        PlaySound(gameOverSound); // Play game over sound
-                        StopMusicStream(backgroundMusic); // Stop background music
-                        currentState = GAME_OVER;
-                        winnerText = "Ice Wins!";
+                } else if (onlineMatch) {
+                    // Online: each side keeps its PVP controls, the other paddle comes over the network
+                    if (session.host) {
+                        input.left.useTarget = true;
+                        input.left.targetY = (float)GetMouseY();
                     } else {
-                        ballPosition = (Vector2){ screen_width / 2.0f, screen_height / 2.0f };
-                        int dirX = (rand() % 2 == 0) ? 1 : -1;
-                        int dirY = (rand() % 2 == 0) ? 1 : -1;
-                        float speed = (currentDifficulty == EASY ? 4.0f : 
-                                      (currentDifficulty == MEDIUM ? 5.0f : 7.0f));
-                        ballSpeed.x = speed * dirX;
-                        ballSpeed.y = speed * dirY;
+                        input.right.move = IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP);
                     }
-                }
-                
-                // Wall collision (top and bottom)
-                if (ballPosition.y >= screen_height - ballRadius || ballPosition.y <= ballRadius) {
-                    ballSpeed.y *= -1;
-                    PlaySound(wallHitSound); // Play wall hit sound
-                }
-                
-                // --- Paddle Controls ---
-                if (currentMode == PVP) {
+                } else if (world.mode == PVP || world.mode == ARENA) {
                     // Player 1: Mouse controls left paddle
-                    leftPaddle.y = GetMouseY() - leftPaddle.height / 2;
+                    input.left.useTarget = true;
+                    input.left.targetY = (float)GetMouseY();
                     // Player 2: Arrow keys control right paddle
-                    if (IsKeyDown(KEY_UP)) rightPaddle.y -= paddleSpeed;
-                    if (IsKeyDown(KEY_DOWN)) rightPaddle.y += paddleSpeed;
-                } else if (currentMode == PVC) {
+                    input.right.move = IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP);
+                } else if (world.mode == PVC) {
                     // Player: W/S keys for left paddle
-                    if (IsKeyDown(KEY_W)) leftPaddle.y -= paddleSpeed;
-                    if (IsKeyDown(KEY_S)) leftPaddle.y += paddleSpeed;
+                    input.left.move = IsKeyDown(KEY_S) - IsKeyDown(KEY_W);
                     // AI for right paddle
-                    if (rightPaddle.y + rightPaddle.height / 2 < ballPosition.y) {
-                        rightPaddle.y += aiSpeed;
-                    } else if (rightPaddle.y + rightPaddle.height / 2 > ballPosition.y) {
-                        rightPaddle.y -= aiSpeed;
-                    }
-                }
-                
-                // Clamp paddles
-                if (leftPaddle.y < 0) leftPaddle.y = 0;
-                if (leftPaddle.y + leftPaddle.height > screen_height) leftPaddle.y = screen_height - leftPaddle.height;
-                if (rightPaddle.y < 0) rightPaddle.y = 0;
-                if (rightPaddle.y + rightPaddle.height > screen_height) rightPaddle.y = screen_height - rightPaddle.height;
-                
-                // Ball-paddle collision
-                if (CheckCollisionCircleRec(ballPosition, ballRadius, leftPaddle)) {
-                    ballSpeed.x *= -1;
-                    ballPosition.x = leftPaddle.x + leftPaddle.width + ballRadius;
-                    ballSpeed.y += (ballSpeed.y > 0 ? 0.5f : -0.5f);
-                    PlaySound(paddleHitSound); // Play paddle hit sound
-                }
-                
-                if (CheckCollisionCircleRec(ballPosition, ballRadius, rightPaddle)) {
-                    ballSpeed.x *= -1;
-                    ballPosition.x = rightPaddle.x - ballRadius;
-                    ballSpeed.y += (ballSpeed.y > 0 ? 0.5f : -0.5f);
-                    PlaySound(paddleHitSound); // Play paddle hit sound
+                    input.right.ai = true;
                 }
                 
-                // Ball-obstacle collision
-                for (int i = 0; i < 3; i++) {
-                    if (CheckCollisionCircleRec(ballPosition, ballRadius, obstacles[i])) {
-                        ballSpeed.x *= -1;
-                        ballSpeed.y *= -1;
-                        ballPosition.x += ballSpeed.x;
-                        ballPosition.y += ballSpeed.y;
-                        PlaySound(wallHitSound); // Play wall hit sound for obstacles too
+                // Online and arena matches step here, local ones and replays in the update stage below
+                frame.input = input;
+                frame.frameTime = frameTime;
+                frame.stepSim = !onlineMatch && world.mode != ARENA;
+                if (!frame.stepSim) {
+                    ProfileEnd(&profiler, PHASE_INPUT);
+                    ProfileBegin(&profiler, PHASE_SIM);
+                    unsigned int events = 0;
+                    int steps = SimClockAdvance(&world.clock, frameTime);
+                    for (int i = 0; i < steps && world.mode == ARENA && !arena.finished; i++) {
+                        events |= ArenaStep(&arena, input);
                     }
-                }
-                
-                if (ballSpeed.y > maxSpeed) ballSpeed.y = maxSpeed;
-                if (ballSpeed.y < -maxSpeed) ballSpeed.y = -maxSpeed;
-                
-                // Particle effects
-                for (int i = 0; i < maxParticles; i++) {
-                    if (lavaParticles[i].lifetime > 0) {
-                        lavaParticles[i].position.x += lavaParticles[i].velocity.x;
-                        lavaParticles[i].position.y += lavaParticles[i].velocity.y;
-                        lavaParticles[i].lifetime -= GetFrameTime();
-                    } else if (GetRandomValue(0, 100) < 5) {
-                        lavaParticles[i].position = (Vector2){leftPaddle.x + leftPaddle.width, leftPaddle.y + leftPaddle.height / 2};
-                        lavaParticles[i].velocity = (Vector2){GetRandomValue(-2, 2), GetRandomValue(-2, 2)};
-                        lavaParticles[i].lifetime = GetRandomValue(5, 10) / 10.0f;
-                        lavaParticles[i].color = leftColor;
+                    for (int i = 0; i < steps && onlineMatch; i++) {
+                        // A guessed step can still be taken back, so only the confirmed state ends the match
+                        SimState before = world.sim;
+                        if (!RollbackAdvance(&session, session.host ? input.left : input.right, GetTime())) break;
+                        world.previousSim = before;
+                        world.sim = session.state;
+                        events |= session.events & ~SIM_EVENT_GAME_OVER;
                     }
-                    
-                    if (iceParticles[i].lifetime > 0) {
-                        iceParticles[i].position.x += iceParticles[i].velocity.x;
-                        iceParticles[i].position.y += iceParticles[i].velocity.y;
-                        iceParticles[i].lifetime -= GetFrameTime();
-                    } else if (GetRandomValue(0, 100) < 5) {
-                        iceParticles[i].position = (Vector2){rightPaddle.x, rightPaddle.y + rightPaddle.height / 2};
-                        iceParticles[i].velocity = (Vector2){GetRandomValue(-2, 2), GetRandomValue(-2, 2)};
-                        iceParticles[i].lifetime = GetRandomValue(5, 10) / 10.0f;
-                        iceParticles[i].color = rightColor;
+                    if (onlineMatch && RollbackConfirmed(&session)->winner != SIDE_NONE) {
+                        world.sim = *RollbackConfirmed(&session);
+                        world.previousSim = world.sim;
+                        events |= SIM_EVENT_GAME_OVER;
                     }
+                    frame.mainEvents = events;
+                    ProfileEnd(&profiler, PHASE_SIM);
+                    ProfileBegin(&profiler, PHASE_INPUT);
                 }
                 
                 // Back button - Return to difficulty selection instead of main menu
                 if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), backButton)) {
-                    PlaySound(backSound); // Play back sound
-                    currentState = DIFFICULTY_SELECT;
+                    AudioPlaySound(&audio, SOUND_BACK); // Play back sound
+                    world.screen = DIFFICULTY_SELECT;
+                    if (recording) SaveRecording(&replay, recordPath);
+                    recording = false;
+                    replaying = false;
                 }
                 break;
+            }
                 
             case GAME_OVER:
+                // Keep sending input until the other side has confirmed the end as well
+                if (onlineMatch) RollbackAdvance(&session, (SimPaddleInput){ 0 }, GetTime());
                 // Enter key returns to mode selection instead of main menu
                 if (IsKeyPressed(KEY_ENTER)) {
-                    PlaySound(enterSound); // Play enter sound
-                    PlayMusicStream(backgroundMusic); // Restart background music
+                    AudioPlaySound(&audio, SOUND_ENTER); // Play enter sound
+                    AudioPlayMusic(&audio, musicFade); // Restart background music
                     // Set volume to medium for mode selection
-                    SetMusicVolume(backgroundMusic, 0.65f);
-                    currentState = MODE_SELECT;
+                    AudioSetMusicVolume(&audio, 0.65f, musicFade);
+                    world.screen = MODE_SELECT;
                     winnerText = NULL;
+                    replaying = false;
                 }
                 // Back button still returns to main menu
                 if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), backButton)) {
-                    PlaySound(backSound); // Play back sound
-                    PlayMusicStream(backgroundMusic); // Restart background music
+                    AudioPlaySound(&audio, SOUND_BACK); // Play back sound
+                    AudioPlayMusic(&audio, musicFade); // Restart background music
                     // Set volume to high for main menu
-                    SetMusicVolume(backgroundMusic, 1.0f);
-                    currentState = MENU;
+                    AudioSetMusicVolume(&audio, 1.0f, musicFade);
+                    world.screen = MENU;
                     winnerText = NULL;
+                    replaying = false;
                 }
                 break;
         }
+        ProfileEnd(&profiler, PHASE_INPUT);
+        
+        // Update stage: local steps, particles and raindrops. Pipelined it runs on the worker
+        // while this frame draws the last update, in latency mode it runs here before drawing.
+        frame.state = world.screen;
+        frame.mode = world.mode;
+        frame.dt = waitedForEvents ? 0.0f : GetFrameTime();   // Frozen screens stay frozen when the mouse wakes them
+        frame.replaying = replaying;
+        frame.recording = recording;
+        frame.botMatch = botMatch;
+        frame.difficulty = world.difficulty;
+        ProfileBegin(&profiler, PHASE_SIM);
+        PipelineSubmit(&pipeline);
+        if (!pipeline.pipelined) SwapFrame(&frame, &world.sim, &world.previousSim, &world.clock, &particles, &rain);
+        ProfileEnd(&profiler, PHASE_SIM);
+        
+        // Bake the menu grid before drawing starts, only does work on first use or resize
+        ProfileBegin(&profiler, PHASE_BACKGROUND);
+        if (useGridCache && (world.screen == MENU || world.screen == MODE_SELECT || world.screen == DIFFICULTY_SELECT)) {
+            GridCacheUpdate(&gridCache, GetScreenWidth(), GetScreenHeight());
+        }
+        // Same for the match screens, which rebake when a new match brings other obstacles
+        const SimRect *fieldObstacles = (world.mode == ARENA) ? arena.obstacles : world.sim.obstacles;
+        int fieldObstacleCount = (world.mode == ARENA) ? arena.obstacleCount : world.sim.obstacleCount;
+        const Level *fieldLevel = (world.mode == ARENA) ? NULL : world.sim.config.level;
+        if (useGridCache && (world.screen == PLAYING || world.screen == GAME_OVER)) {
+            PlayfieldCacheUpdate(&playfield, screen_width, screen_height, fieldObstacles, fieldObstacleCount, fieldLevel);
+        }
         
         BeginDrawing();
+        // Everything below keeps drawing in window coordinates, the zoom maps them onto the smaller scene
+        if (dynamicResolution) {
+            BeginTextureMode(sceneTarget);
+            BeginMode2D((Camera2D){ .zoom = resolution.scale });
+        }
         
         // Draw background based on game state
-        if (currentState == MENU || currentState == MODE_SELECT || currentState == DIFFICULTY_SELECT) {
+        if (world.screen == MENU || world.screen == MODE_SELECT || world.screen == DIFFICULTY_SELECT) {
             // Draw Minecraft-style block background for menu screens
             ClearBackground(BLACK);
             
             // Draw block background with different opacity based on state
-            for (int y = 0; y < gridHeight; y++) {
-                for (int x = 0; x < gridWidth; x++) {
-                    int blockX = x * blockSize;
-                    int blockY = y * blockSize;
-                    
-                    // Create a pattern with blocks
-                    int pattern = (x + y) % 4;
-                    
-                    if (blockX < screen_width / 2) {
-                        // Left side - lava theme
-                        if (currentState == MENU) {
-                            DrawRectangle(blockX, blockY, blockSize, blockSize, leftBlockColorsHigh[pattern]);
-                        } else {
-                            DrawRectangle(blockX, blockY, blockSize, blockSize, leftBlockColors[pattern]);
-                        }
-                        DrawRectangleLines(blockX, blockY, blockSize, blockSize, Fade(BLACK, 0.2f));
-                    } else {
-                        // Right side - ice theme
-                        if (currentState == MENU) {
-                            DrawRectangle(blockX, blockY, blockSize, blockSize, rightBlockColorsHigh[pattern]);
-                        } else {
-                            DrawRectangle(blockX, blockY, blockSize, blockSize, rightBlockColors[pattern]);
-                        }
-                        DrawRectangleLines(blockX, blockY, blockSize, blockSize, Fade(BLACK, 0.2f));
-                    }
-                }
+            GridPalette palette = (world.screen == MENU) ? GRID_PALETTE_HIGH : GRID_PALETTE_LOW;
+            if (useGridCache) {
+                GridCacheDraw(&gridCache, palette);
+            } else {
+                DrawBlockGrid(GetScreenWidth(), GetScreenHeight(), blockSize,
+                              gridCache.leftColors[palette], gridCache.rightColors[palette]);
             }
-        } else if (currentState == PLAYING) {
-            // Draw split background with mild red on left and very mild sky blue on right
-            DrawRectangle(0, 0, screen_width / 2, screen_height, leftBackgroundColor);
-            DrawRectangle(screen_width / 2, 0, screen_width / 2, screen_height, rightBackgroundColor);
-        } else if (currentState == GAME_OVER) {
-            ClearBackground(gameOverBackgroundColor);
-        }
-        
-        // Draw stars only in PLAYING and GAME_OVER states
-        if (currentState == PLAYING || currentState == GAME_OVER) {
-            for (int i = 0; i < numStars; i++) {
-                Color starColor;
-                if (currentState == PLAYING) {
-                    if (stars[i].x < screen_width / 2) {
-                        starColor = Fade((Color){255, 165, 0, 255}, 1.0f);
-                    } else {
-                        starColor = Fade((Color){135, 206, 235, 255}, 1.0f);
-                    }
-                } else { // GAME_OVER
-                    starColor = Fade(WHITE, 0.5f);
-                }
-                DrawPixelV(stars[i], starColor);
+        } else {
+            // Split background with stars while playing, dark red after the match, with
+            // the obstacles, level and center line on top of both
+            PlayfieldLayer layer = (world.screen == PLAYING) ? PLAYFIELD_PLAYING : PLAYFIELD_GAME_OVER;
+            if (useGridCache) {
+                PlayfieldCacheDraw(&playfield, layer);
+            } else {
+                DrawPlayfield(screen_width, screen_height, layer, &playfield.theme, stars, numStars,
+                              fieldObstacles, fieldObstacleCount, fieldLevel);
             }
         }
+        ProfileEnd(&profiler, PHASE_BACKGROUND);
         
         // Draw raindrops in MENU, MODE_SELECT, and DIFFICULTY_SELECT states
-        if (currentState == MENU || currentState == MODE_SELECT || currentState == DIFFICULTY_SELECT) {
-            if (currentState == MENU) {
-                // In main menu: swap sides - lava raindrops on right, ice raindrops on left
-                // Use largest raindrops for main menu
-                
-                // Update and draw lava raindrops (right side)
-                for (int i = 0; i < numRaindrops; i++) {
-                    // Update position
-                    lavaRaindrops[i].position.y += lavaRaindrops[i].speed;
-                    
-                    // Reset if off screen
-                    if (lavaRaindrops[i].position.y > screen_height) {
-                        lavaRaindrops[i].position = (Vector2){
-                            (float)GetRandomValue(screen_width / 2, screen_width),
-                            (float)GetRandomValue(-50, -10)
-                        };
-                        lavaRaindrops[i].speed = (float)GetRandomValue(5, 15);
-                        lavaRaindrops[i].length = (float)GetRandomValue(15, 30);
-                    }
-                    
-                    // Draw raindrop as a line with largest thickness for main menu
-                    DrawLineEx(
-                        (Vector2){lavaRaindrops[i].position.x, lavaRaindrops[i].position.y},
-                        (Vector2){lavaRaindrops[i].position.x, lavaRaindrops[i].position.y + lavaRaindrops[i].length},
-                        5.0f, // Largest thickness for main menu
-                        lavaRaindrops[i].color
-                    );
-                }
-                
-                // Update and draw ice raindrops (left side)
-                for (int i = 0; i < numRaindrops; i++) {
-                    // Update position
-                    iceRaindrops[i].position.y += iceRaindrops[i].speed;
-                    
-                    // Reset if off screen
-                    if (iceRaindrops[i].position.y > screen_height) {
-                        iceRaindrops[i].position = (Vector2){
-                            (float)GetRandomValue(0, screen_width / 2),
-                            (float)GetRandomValue(-50, -10)
-                        };
-                        iceRaindrops[i].speed = (float)GetRandomValue(5, 15);
-                        iceRaindrops[i].length = (float)GetRandomValue(15, 30);
-                    }
-                    
-                    // Draw raindrop as a line with largest thickness for main menu
-                    DrawLineEx(
-                        (Vector2){iceRaindrops[i].position.x, iceRaindrops[i].position.y},
-                        (Vector2){iceRaindrops[i].position.x, iceRaindrops[i].position.y + iceRaindrops[i].length},
-                        5.0f, // Largest thickness for main menu
-                        iceRaindrops[i].color
-                    );
-                }
-            } else {
-                // In mode and difficulty selection: mixed raindrops on both sides
-                // Use medium-sized raindrops for other menus
-                
-                // Draw lava raindrops on both sides
-                for (int i = 0; i < numRaindrops; i++) {
-                    // Update position
-                    lavaRaindrops[i].position.y += lavaRaindrops[i].speed;
-                    
-                    // Reset if off screen
-                    if (lavaRaindrops[i].position.y > screen_height) {
-                        lavaRaindrops[i].position = (Vector2){
-                            (float)GetRandomValue(0, screen_width),
-                            (float)GetRandomValue(-50, -10)
-                        };
-                        lavaRaindrops[i].speed = (float)GetRandomValue(5, 15);
-                        lavaRaindrops[i].length = (float)GetRandomValue(12, 25); // Increased length
-                    }
-                    
-                    // Draw raindrop as a line with medium thickness
-                    DrawLineEx(
-                        (Vector2){lavaRaindrops[i].position.x, lavaRaindrops[i].position.y},
-                        (Vector2){lavaRaindrops[i].position.x, lavaRaindrops[i].position.y + lavaRaindrops[i].length},
-                        4.0f, // Increased thickness for mode and difficulty selection
-                        lavaRaindrops[i].color
-                    );
-                }
-                
-                // Draw ice raindrops on both sides
-                for (int i = 0; i < numRaindrops; i++) {
-                    // Update position
-                    iceRaindrops[i].position.y += iceRaindrops[i].speed;
-                    
-                    // Reset if off screen
-                    if (iceRaindrops[i].position.y > screen_height) {
-                        iceRaindrops[i].position = (Vector2){
-                            (float)GetRandomValue(0, screen_width),
-                            (float)GetRandomValue(-50, -10)
-                        };
-                        iceRaindrops[i].speed = (float)GetRandomValue(5, 15);
-                        iceRaindrops[i].length = (float)GetRandomValue(12, 25); // Increased length
-                    }
-                    
-                    // Draw raindrop as a line with medium thickness
-                    DrawLineEx(
-                        (Vector2){iceRaindrops[i].position.x, iceRaindrops[i].position.y},
-                        (Vector2){iceRaindrops[i].position.x, iceRaindrops[i].position.y + iceRaindrops[i].length},
-                        4.0f, // Increased thickness for mode and difficulty selection
-                        iceRaindrops[i].color
-                    );
-                }
-            }
+        if (world.screen == MENU || world.screen == MODE_SELECT || world.screen == DIFFICULTY_SELECT) {
+            // Largest raindrops for main menu, medium-sized for the other menus
+            ProfileBegin(&profiler, PHASE_EFFECTS);
+            DrawRain(&rain, world.screen == MENU ? 5.0f : 4.0f, lavaRainColor, iceRainColor);
+            ProfileEnd(&profiler, PHASE_EFFECTS);
         }
         
+        ProfileBegin(&profiler, PHASE_HUD);
         // Draw back button in all screens except main menu
-        if (currentState == MODE_SELECT || currentState == DIFFICULTY_SELECT || currentState == GAME_OVER || currentState == PLAYING) {
+        if (world.screen == MODE_SELECT || world.screen == DIFFICULTY_SELECT || world.screen == GAME_OVER || world.screen == PLAYING) {
             // Use a mild color for the back button in playing state
             Color buttonColor = GRAY;
-            if (currentState == PLAYING) {
+            if (world.screen == PLAYING) {
                 buttonColor = (Color){80, 80, 80, 180}; // Semi-transparent gray
             }
             DrawRectangleRec(backButton, buttonColor);
@@ -644,97 +903,232 @@ int main() {
         }
         
         // Draw game elements
-        if (currentState == MENU) {
-            // Draw colorful title with gradient effect
-            int titleFontSize = 80;
-            int titleY = screen_height / 3;
-            
-            // Calculate positions for each part of the title
-            int lavaWidth = MeasureText("LAVA", titleFontSize);
-            int vsWidth = MeasureText(" VS ", titleFontSize);
-            int iceWidth = MeasureText("ICE", titleFontSize);
-            int totalWidth = lavaWidth + vsWidth + iceWidth;
-            int startX = screen_width / 2 - totalWidth / 2;
-            
-            // Draw LAVA with fiery gradient
-            for (int i = 0; i < 5; i++) {
-                Color lavaColor = ColorLerp((Color){255, 50, 0, 255}, (Color){255, 200, 0, 255}, i / 4.0f);
-                DrawText("LAVA", startX - i, titleY - i, titleFontSize, Fade(lavaColor, 1.0f - i * 0.15f));
-            }
-            
-            // Draw " VS " in white
-            DrawText(" VS ", startX + lavaWidth, titleY, titleFontSize, WHITE);
-            
-            // Draw ICE with icy gradient
-            for (int i = 0; i < 5; i++) {
-                Color iceColor = ColorLerp((Color){0, 150, 255, 255}, (Color){150, 220, 255, 255}, i / 4.0f);
-                DrawText("ICE", startX + lavaWidth + vsWidth - i, titleY - i, titleFontSize, Fade(iceColor, 1.0f - i * 0.15f));
-            }
+        if (world.screen == MENU) {
+            TitleCacheDraw(&title);
             
             // Draw instruction text with better visibility
-            DrawText("Press ENTER to start", screen_width / 2 - MeasureText("Press ENTER to start", 40) / 2, screen_height / 2, 40, WHITE);
-        } else if (currentState == MODE_SELECT) {
-            DrawText("Select Game Mode", screen_width / 2 - MeasureText("Select Game Mode", 60) / 2, 100, 60, WHITE);
-            DrawText(modeSelection == 0 ? "> Player Vs Player" : "Player Vs Player", screen_width / 2 - 180, 250, 40, (modeSelection == 0) ? YELLOW : WHITE);
-            DrawText(modeSelection == 1 ? "> Player Vs AI" : "Player Vs AI", screen_width / 2 - 180, 320, 40, (modeSelection == 1) ? YELLOW : WHITE);
-            DrawText("Use Up/Down Arrows to select, Enter to choose", screen_width / 2 - MeasureText("Use Up/Down Arrows to select, Enter to choose", 25) / 2, 450, 25, GRAY);
-            DrawText("Press Backspace or click Back to go back", screen_width / 2 - MeasureText("Press Backspace or click Back to go back", 25) / 2, 490, 25, GRAY);
-        } else if (currentState == DIFFICULTY_SELECT) {
-            DrawText("Select Difficulty", screen_width / 2 - MeasureText("Select Difficulty", 60) / 2, 100, 60, WHITE);
-            DrawText(difficultySelection == 0 ? "> Easy" : "Easy", screen_width / 2 - 180, 250, 40, (difficultySelection == 0) ? YELLOW : WHITE);
-            DrawText(difficultySelection == 1 ? "> Medium" : "Medium", screen_width / 2 - 180, 320, 40, (difficultySelection == 1) ? YELLOW : WHITE);
-            DrawText(difficultySelection == 2 ? "> Hard" : "Hard", screen_width / 2 - 180, 390, 40, (difficultySelection == 2) ? YELLOW : WHITE);
-            DrawText("Use Up/Down Arrows to select, Enter to start", screen_width / 2 - MeasureText("Use Up/Down Arrows to select, Enter to start", 25) / 2, 450, 25, GRAY);
-            DrawText("Press Backspace or click Back to go back", screen_width / 2 - MeasureText("Press Backspace or click Back to go back", 25) / 2, 490, 25, GRAY);
+            DrawTextLabel(&pressEnterLabel, WHITE);
+        } else if (world.screen == MODE_SELECT) {
+            DrawTextLabel(&selectModeLabel, WHITE);
+            DrawText(world.modeSelection == 0 ? "> Player Vs Player" : "Player Vs Player", screen_width / 2 - 180, 250, 40, (world.modeSelection == 0) ? YELLOW : WHITE);
+            DrawText(world.modeSelection == 1 ? "> Player Vs AI" : "Player Vs AI", screen_width / 2 - 180, 320, 40, (world.modeSelection == 1) ? YELLOW : WHITE);
+            DrawText(world.modeSelection == 2 ? "> Arena Party" : "Arena Party", screen_width / 2 - 180, 390, 40, (world.modeSelection == 2) ? YELLOW : WHITE);
+            DrawTextLabel(&modeHelpLabel, GRAY);
+            DrawTextLabel(&backHelpLabel, GRAY);
+        } else if (world.screen == DIFFICULTY_SELECT) {
+            DrawTextLabel(&selectDifficultyLabel, WHITE);
+            DrawText(world.difficultySelection == 0 ? "> Easy" : "Easy", screen_width / 2 - 180, 250, 40, (world.difficultySelection == 0) ? YELLOW : WHITE);
+            DrawText(world.difficultySelection == 1 ? "> Medium" : "Medium", screen_width / 2 - 180, 320, 40, (world.difficultySelection == 1) ? YELLOW : WHITE);
+            DrawText(world.difficultySelection == 2 ? "> Hard" : "Hard", screen_width / 2 - 180, 390, 40, (world.difficultySelection == 2) ? YELLOW : WHITE);
+            DrawTextLabel(&difficultyHelpLabel, GRAY);
+            DrawTextLabel(&backHelpLabel, GRAY);
         } else {
-            // Draw gold ball with yellow glow that suits the LAVA VS ICE theme
-            DrawCircleGradient((int)ballPosition.x, (int)ballPosition.y, ballRadius, ballColor, ballGlow);
-            // Add an extra glow ring for stronger effect
-            DrawCircleLines((int)ballPosition.x, (int)ballPosition.y, ballRadius + 2, ballGlow);
-            
-            DrawRectangleRec(leftPaddle, leftColor);
-            DrawRectangleRec(rightPaddle, rightColor);
-            
-            for (int i = 0; i < 3; i++) {
-                Color obsColor = (obstacles[i].x < screen_width / 2) ? Fade(leftColor, 0.5f) : Fade(rightColor, 0.5f);
-                DrawRectangleRec(obstacles[i], obsColor);
-            }
-            
-            for (int i = 0; i < screen_height; i += 20) {
-                DrawLine(screen_width / 2, i, screen_width / 2, i + 10, Fade(WHITE, 0.2f));
-            }
-            
-            for (int i = 0; i < maxParticles; i++) {
-                if (lavaParticles[i].lifetime > 0) {
-                    DrawCircleV(lavaParticles[i].position, 3, Fade(lavaParticles[i].color, lavaParticles[i].lifetime));
-                }
-                if (iceParticles[i].lifetime > 0) {
-                    DrawCircleV(iceParticles[i].position, 3, Fade(iceParticles[i].color, iceParticles[i].lifetime));
-                }
+            ProfileEnd(&profiler, PHASE_HUD);
+            ProfileBegin(&profiler, PHASE_OBJECTS);
+            if (world.mode == ARENA) {
+                // Balls are re-sorted every step, so the arena is drawn as of the last step without blending
+                DrawArenaBalls(&arena, arenaBallTexture, ballGlow, rightColor);
+                DrawRectangleRec(ToRectangle(arena.leftPaddle), leftColor);
+                DrawRectangleRec(ToRectangle(arena.rightPaddle), rightColor);
+            } else {
+                // Blend the last two fixed steps so motion stays smooth at any refresh rate
+                float alpha = (world.screen == PLAYING) ? SimClockAlpha(&world.clock) : 1.0f;
+                SimState view = SimInterpolate(&world.previousSim, &world.sim, alpha);
+                // Draw gold ball with yellow glow that suits the LAVA VS ICE theme
+                float ballRadius = world.sim.config.ballRadius;
+                DrawCircleGradient((int)view.ballPosition.x, (int)view.ballPosition.y, ballRadius, ballColor, ballGlow);
+                // Add an extra glow ring for stronger effect
+                DrawCircleLines((int)view.ballPosition.x, (int)view.ballPosition.y, ballRadius + 2, ballGlow);
+                DrawRectangleRec(ToRectangle(view.leftPaddle), leftColor);
+                DrawRectangleRec(ToRectangle(view.rightPaddle), rightColor);
             }
-            
+            ProfileEnd(&profiler, PHASE_OBJECTS);
+            ProfileBegin(&profiler, PHASE_EFFECTS);
+            DrawParticles(&particles);
+            ProfileEnd(&profiler, PHASE_EFFECTS);
+            ProfileBegin(&profiler, PHASE_HUD);
             // Draw scores with theme-appropriate colors
-            DrawText(TextFormat("%d", leftScore), screen_width / 4, 20, 40, leftScoreColor);
-            DrawText(TextFormat("%d", rightScore), 3 * screen_width / 4, 20, 40, rightScoreColor);
+            int leftScore = (world.mode == ARENA) ? arena.leftScore : world.sim.leftScore;
+            int rightScore = (world.mode == ARENA) ? arena.rightScore : world.sim.rightScore;
+            DrawText(TextNumberGet(&leftScoreText, leftScore), screen_width / 4, 20, 40, leftScoreColor);
+            DrawText(TextNumberGet(&rightScoreText, rightScore), 3 * screen_width / 4, 20, 40, rightScoreColor);
             
-            if (currentState == GAME_OVER) {
-                DrawText(winnerText, screen_width / 2 - MeasureText(winnerText, 60) / 2, screen_height / 2 - 30, 60, YELLOW);
-                DrawText("Press Enter to return to mode selection", screen_width / 2 - MeasureText("Press Enter to return to mode selection", 30) / 2, screen_height / 2 + 50, 30, GRAY);
-                DrawText("or click Back to return to main menu", screen_width / 2 - MeasureText("or click Back to return to main menu", 30) / 2, screen_height / 2 + 80, 30, GRAY);
+            if (world.screen == GAME_OVER) {
+                DrawTextLabel(&winnerLabel, YELLOW);
+                DrawTextLabel(&returnHelpLabel, GRAY);
+                DrawTextLabel(&menuHelpLabel, GRAY);
             }
         }
         
+        if (showDrawStats) {
+            DrawText(TextFormat("Draw calls: %d (backgrounds %s, update %s)", GetDrawCallCount(),
+                                useGridCache ? "cached" : "per shape", pipeline.pipelined ? "pipelined" : "in latency mode"),
+                     10, screen_height - 30, 20, GREEN);
+        }
+        
+        if (showDrawStats && dynamicResolution) {
+            DrawText(TextFormat("Render scale %d%% for a %.1f ms budget", (int)roundf(resolution.scale * 100.0f), frameBudgetMs),
+                     10, screen_height - 90, 20, GREEN);
+        }
+        
+        if (onlineMatch && world.screen == PLAYING && !session.running) {
+            DrawText("Waiting for opponent...", 10, screen_height - 60, 20, YELLOW);
+        }
+        
+        if (replaying) {
+            DrawText(TextFormat("REPLAY %.1f / %.1f s%s   [Space] pause  [Tab] fast-forward  [Left/Right] seek  [Home] restart",
+                                world.sim.tick / world.sim.config.tickRate, replay.tickCount / world.sim.config.tickRate, replayPaused ? "  PAUSED" : ""),
+                     10, screen_height - 60, 20, YELLOW);
+        }
+        
+        // Stats are sorted over the whole history, so refresh them twice a second rather than every frame
+        if (showProfiler) {
+            if (--statsCountdown <= 0) {
+                ProfilerComputeStats(&profiler, &profileStats);
+                statsCountdown = 30;
+            }
+            DrawProfilerOverlay(&profiler, &profileStats, 10, 70);
+        }
+        ProfileEnd(&profiler, PHASE_HUD);
+        
+        // Stretch the scene over the window. Render textures are stored bottom-up, hence the negative height.
+        if (dynamicResolution) {
+            EndMode2D();
+            EndTextureMode();
+            float sceneWidth = roundf(screen_width * resolution.scale);
+            float sceneHeight = roundf(screen_height * resolution.scale);
+            DrawTexturePro(sceneTarget.texture, (Rectangle){ 0, screen_height - sceneHeight, sceneWidth, -sceneHeight },
+                           (Rectangle){ 0, 0, (float)GetScreenWidth(), (float)GetScreenHeight() }, (Vector2){ 0 }, 0.0f, WHITE);
+        }
+        
+        // Includes the wait for the frame rate cap or vsync, and for input while sleeping
+        ProfileBegin(&profiler, PHASE_PRESENT);
+        waitedForEvents = (power.mode == POWER_SLEEP);
         EndDrawing();
+        ProfileEnd(&profiler, PHASE_PRESENT);
+        
+        // Stress mode: stall some frames to show gameplay speed no longer depends on frame rate
+        if (stressStalls && GetRandomValue(0, 100) < 5) {
+            WaitTime(GetRandomValue(20, 200) / 1000.0);
+        }
+        
+        // Nothing may touch the front buffer until here while the worker is busy
+        if (pipeline.pipelined) {
+            ProfileBegin(&profiler, PHASE_SIM);
+            PipelineWait(&pipeline);
+            SwapFrame(&frame, &world.sim, &world.previousSim, &world.clock, &particles, &rain);
+            ProfileEnd(&profiler, PHASE_SIM);
+        }
+        
+        // Sounds and the end of the match, for what this frame's steps raised
+        unsigned int events = (frame.state == PLAYING && world.screen == PLAYING) ? frame.events : 0;
+        if (events & (SIM_EVENT_WALL_HIT | SIM_EVENT_OBSTACLE_HIT)) {
+            AudioPlaySound(&audio, SOUND_WALL_HIT); // Play wall hit sound for obstacles too
+        }
+        if (events & SIM_EVENT_PADDLE_HIT) {
+            AudioPlaySound(&audio, SOUND_PADDLE_HIT); // Play paddle hit sound
+        }
+        if (events & SIM_EVENT_GAME_OVER) {
+            AudioPlaySound(&audio, SOUND_GAME_OVER); // Play game over sound
+            AudioStopMusic(&audio, musicFade); // Stop background music
+            world.screen = GAME_OVER;
+            SimSide winner = (world.mode == ARENA) ? arena.winner : world.sim.winner;
+            winnerText = (winner == SIDE_LAVA) ? "Lava Wins!" : (winner == SIDE_ICE) ? "Ice Wins!" : "Draw!";
+            winnerLabel = LayoutCenteredText(winnerText, 60, centerX, screen_height / 2 - 30);
+            if (recording) SaveRecording(&replay, recordPath);
+            recording = false;
+        }
+        // Hand the records of this frame's steps to the telemetry writer, never waits
+        if (logging) TelemetryPost(&telemetry, &frame.telemetry);
+        // Kiosk crash recovery: the saved world never lags more than a point behind
+        if (snapshotPath != NULL && !onlineMatch && !replaying && world.mode != ARENA && (events & (SIM_EVENT_LAVA_SCORED | SIM_EVENT_ICE_SCORED | SIM_EVENT_GAME_OVER))) {
+            WorldSnapshot(&world, &quickSave);
+            haveQuickSave = true;
+            if (!WorldSave(&quickSave, snapshotPath)) TraceLog(LOG_WARNING, "Could not write %s", snapshotPath);
+        }
+        
+        // Pick the next frame's scale from this frame's busy time, then hold the frame rate cap
+        if (dynamicResolution) {
+            ResolutionUpdate(&resolution, (float)(GetTime() - frameStart));
+            ProfileBegin(&profiler, PHASE_PRESENT);
+            double remaining = (targetFps > 0) ? 1.0 / targetFps - (GetTime() - frameStart) : 0.0;
+            if (remaining > 0.0) WaitTime(remaining);
+            ProfileEnd(&profiler, PHASE_PRESENT);
+        }
+        
+        // Idle screens drop to a low frame rate, or stop drawing until the next input event
+        PowerAccount(&power, GetTime(), powerWakeups + 1);
+        powerWakeups = 0;
+        bool pressed = powerInput || GetKeyPressed() != 0 || IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+        powerInput = false;
+        bool moving = (world.screen == GAME_OVER) ? particles.count > 0 : true;
+        PowerMode lastMode = power.mode;
+        PowerMode mode = PowerUpdate(&power, GetTime(), pressed, !online && world.screen != PLAYING, moving);
+        if (mode == POWER_SLEEP && lastMode != POWER_SLEEP) EnableEventWaiting();
+        if (mode != POWER_SLEEP && lastMode == POWER_SLEEP) DisableEventWaiting();
+        if ((mode == POWER_ACTIVE) != (lastMode == POWER_ACTIVE)) AudioSetIdle(&audio, mode != POWER_ACTIVE);
+        if (mode == POWER_LOW_RATE) {
+            // Sleep out the rest of a slow frame in short naps, a press ends it at once
+            ProfileBegin(&profiler, PHASE_PRESENT);
+            double nextFrame = frameStart + 1.0 / POWER_LOW_FPS;
+            for (double now = GetTime(); now < nextFrame && !powerInput; now = GetTime()) {
+                WaitTime(fmin(1.0 / POWER_POLL_HZ, nextFrame - now));
+                PollInputEvents();
+                powerWakeups++;
+                powerInput = GetKeyPressed() != 0 || IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+            }
+            ProfileEnd(&profiler, PHASE_PRESENT);
+        }
+    }
+    
+    ProfilerFrameBegin(&profiler); // Publish the last frame
+    if (profileCsvPath != NULL && !ProfilerWriteCsv(&profiler, profileCsvPath)) {
+        TraceLog(LOG_WARNING, "Could not write %s", profileCsvPath);
+    }
+    if (profileTracePath != NULL && !ProfilerWriteChromeTrace(&profiler, profileTracePath)) {
+        TraceLog(LOG_WARNING, "Could not write %s", profileTracePath);
     }
     
-    // Unload sounds and music
-    UnloadMusicStream(backgroundMusic);
-    UnloadSound(gameOverSound);
-    UnloadSound(enterSound);
-    UnloadSound(backSound);
-    UnloadSound(arrowSound);
-    UnloadSound(paddleHitSound);  // Unload paddle hit sound
-    UnloadSound(wallHitSound);    // Unload wall hit sound
+    for (int m = 0; m < POWER_MODE_COUNT; m++) {
+        const PowerStats *stats = &power.stats[m];
+        if (stats->frames == 0 || stats->seconds <= 0.0) continue;
+        TraceLog(LOG_INFO, "Power, %s: %.0f s, %.1f frames/s, %.1f wakeups/s, %.2f ms CPU per frame (%.1f%% of a core)",
+                 PowerModeName((PowerMode)m), stats->seconds, stats->frames / stats->seconds, stats->wakeups / stats->seconds,
+                 stats->cpuSeconds * 1000.0 / stats->frames, 100.0 * stats->cpuSeconds / stats->seconds);
+    }
+    
+    if (recording) SaveRecording(&replay, recordPath); // Window closed mid-match
+    ReplayFree(&replay);
+    if (online) NetClose(&netSocket);
+    if (botLink.stats.commands > 0) {
+        const BotLinkStats *stats = &botLink.stats;
+        TraceLog(LOG_INFO, "Bot link: %llu commands, round trip avg %.1f us, p99 < %.1f us, max %.1f us, %.1f%% of steps fresh",
+                 (unsigned long long)stats->commands, (double)stats->latencyTotalNs / stats->commands / 1e3,
+                 BotLinkLatencyPercentile(stats, 0.99) / 1e3, stats->latencyMaxNs / 1e3,
+                 100.0 * stats->freshSteps / stats->botSteps);
+    }
+    BotLinkClose(&botLink);
+    if (logging) {
+        TelemetryStop(&telemetry);
+        TraceLog(LOG_INFO, "Telemetry: %lu records in %u writes to %u files, %u dropped%s", telemetry.written,
+                 telemetry.writes, telemetry.files, atomic_load(&telemetry.dropped), telemetry.failed ? ", a write failed" : "");
+    }
+    
+    ArenaFree(&arena);
+    LevelFree(&level);
+    UnloadTexture(arenaBallTexture);
+    PipelineStop(&pipeline);
+    ParticlesFree(&particles);
+    ParticlesFree(&frame.nextParticles);
+    RainFree(&rain);
+    RainFree(&frame.nextRain);
+    if (dynamicResolution) UnloadRenderTexture(sceneTarget);
+    GridCacheUnload(&gridCache);
+    PlayfieldCacheUnload(&playfield);
+    TitleCacheUnload(&title);
+    
+    // Stop the audio thread, unload sounds and music
+    AudioStop(&audio);
     
     // Close audio system
     CloseAudioDevice();
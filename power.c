@@ -0,0 +1,37 @@
+#include "power.h"
+
+void PowerInit(PowerScheduler *power, double now, bool enabled, double idleSeconds, double freezeSeconds) {
+    *power = (PowerScheduler){
+        .enabled = enabled, .idleSeconds = idleSeconds, .freezeSeconds = freezeSeconds,
+        .lastInput = now, .mode = POWER_ACTIVE, .lastAccount = now, .lastCpu = clock()
+    };
+}
+
+PowerMode PowerUpdate(PowerScheduler *power, double now, bool input, bool idleScreen, bool moving) {
+    if (input || !idleScreen) power->lastInput = now;
+    double idle = now - power->lastInput;
+    if (!power->enabled || idle < power->idleSeconds) power->mode = POWER_ACTIVE;
+    else if (!moving || (power->freezeSeconds > 0.0 && idle >= power->freezeSeconds)) power->mode = POWER_SLEEP;
+    else power->mode = POWER_LOW_RATE;
+    return power->mode;
+}
+
+void PowerAccount(PowerScheduler *power, double now, unsigned wakeups) {
+    clock_t cpu = clock();
+    PowerStats *stats = &power->stats[power->mode];
+    stats->seconds += now - power->lastAccount;
+    stats->cpuSeconds += (double)(cpu - power->lastCpu) / CLOCKS_PER_SEC;
+    stats->frames++;
+    stats->wakeups += wakeups;
+    power->lastAccount = now;
+    power->lastCpu = cpu;
+}
+
+const char *PowerModeName(PowerMode mode) {
+    switch (mode) {
+        case POWER_ACTIVE: return "active";
+        case POWER_LOW_RATE: return "low rate";
+        case POWER_SLEEP: return "sleeping";
+        default: return "?";
+    }
+}
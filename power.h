@@ -0,0 +1,60 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdbool.h>
+#include <time.h>
+
+// Frame scheduling for screens that only wait for the player (the menus and the
+// game-over screen). After a few seconds without a key press or click, screens
+// where something still moves (raindrops, the last particles) drop to a low
+// frame rate and check for input between frames, so a press still gets through
+// within a poll interval. Screens where nothing moves stop drawing altogether
+// until the next input event. After a longer idle the raindrops freeze as well.
+// Any press goes back to the full frame rate on the next frame.
+//
+// The scheduler only picks the mode and keeps the books. Waiting is the front
+// end's job (raylib's event waiting in the game, plain sleeps in headless.c).
+
+#define POWER_DEFAULT_IDLE_SECONDS 3.0     // Without input before slowing down
+#define POWER_DEFAULT_FREEZE_SECONDS 60.0  // Without input before moving screens stop too
+#define POWER_LOW_FPS 15                   // Frames per second while slowed down
+#define POWER_POLL_HZ 30                   // Input checks per second between those frames
+
+typedef enum PowerMode {
+    POWER_ACTIVE,       // Full frame rate
+    POWER_LOW_RATE,     // POWER_LOW_FPS frames a second, input polled in between
+    POWER_SLEEP,        // No frames until an input event
+    POWER_MODE_COUNT
+} PowerMode;
+
+// Time, frames, thread wakeups and process CPU time spent in one mode
+typedef struct PowerStats {
+    double seconds;
+    double cpuSeconds;
+    unsigned long frames;
+    unsigned long wakeups;
+} PowerStats;
+
+typedef struct PowerScheduler {
+    bool enabled;                   // false stays active, for comparing
+    double idleSeconds;
+    double freezeSeconds;           // 0 never freezes
+    double lastInput;
+    PowerMode mode;
+    double lastAccount;             // Wall and CPU time of the last PowerAccount
+    clock_t lastCpu;
+    PowerStats stats[POWER_MODE_COUNT];
+} PowerScheduler;
+
+void PowerInit(PowerScheduler *power, double now, bool enabled, double idleSeconds, double freezeSeconds);
+
+// Pick the mode for the next frame. idleScreen: the screen only waits for input,
+// moving: something on it is still animating.
+PowerMode PowerUpdate(PowerScheduler *power, double now, bool input, bool idleScreen, bool moving);
+
+// Book the frame just finished, with the wakeups it took, under the current mode
+void PowerAccount(PowerScheduler *power, double now, unsigned wakeups);
+
+const char *PowerModeName(PowerMode mode);
+
+#endif // POWER_H
@@ -0,0 +1,186 @@
+// clock_gettime is POSIX, not C11
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "profiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOGDI
+    #define NOUSER
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "input", "sim", "background", "objects", "effects", "hud", "present"
+};
+
+uint64_t ProfilerNow(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+const char *ProfilePhaseName(ProfilePhase phase) {
+    return (phase >= 0 && phase < PHASE_COUNT) ? phaseNames[phase] : "?";
+}
+
+void ProfilerInit(Profiler *profiler) {
+    memset(profiler, 0, sizeof(*profiler));
+    atomic_init(&profiler->published, 0);
+}
+
+void ProfilerFrameBegin(Profiler *profiler) {
+    uint64_t now = ProfilerNow();
+
+    if (profiler->running) {
+        // Publish the finished frame: fill the slot first, then bump the counter
+        uint64_t published = atomic_load_explicit(&profiler->published, memory_order_relaxed);
+        profiler->current.index = published;
+        profiler->current.total = (uint32_t)(now - profiler->current.start);
+        profiler->frames[published & (PROFILER_HISTORY - 1)] = profiler->current;
+        atomic_store_explicit(&profiler->published, published + 1, memory_order_release);
+    }
+
+    memset(&profiler->current, 0, sizeof(profiler->current));
+    profiler->current.start = now;
+    profiler->running = true;
+}
+
+void ProfileBegin(Profiler *profiler, ProfilePhase phase) {
+    profiler->phaseStart[phase] = ProfilerNow();
+}
+
+void ProfileEnd(Profiler *profiler, ProfilePhase phase) {
+    uint64_t now = ProfilerNow();
+    uint32_t duration = (uint32_t)(now - profiler->phaseStart[phase]);
+    ProfileFrame *frame = &profiler->current;
+
+    frame->phase[phase] += duration;
+    if (frame->spanCount < PROFILER_MAX_SPANS) {
+        ProfileSpan *span = &frame->spans[frame->spanCount++];
+        span->phase = (uint8_t)phase;
+        span->start = (uint32_t)(profiler->phaseStart[phase] - frame->start);
+        span->duration = duration;
+    }
+}
+
+bool ProfilerGetFrame(const Profiler *profiler, int age, ProfileFrame *frame) {
+    uint64_t published = atomic_load_explicit(&profiler->published, memory_order_acquire);
+    if (age < 0 || (uint64_t)age >= published || age >= PROFILER_HISTORY) return false;
+
+    uint64_t index = published - 1 - (uint64_t)age;
+    *frame = profiler->frames[index & (PROFILER_HISTORY - 1)];
+
+    // The writer may have lapped us while copying, like a seqlock check the counter again
+    uint64_t after = atomic_load_explicit(&profiler->published, memory_order_acquire);
+    return after - index < PROFILER_HISTORY && frame->index == index;
+}
+
+static int CompareFloat(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+void ProfilerComputeStats(const Profiler *profiler, ProfileStats *stats) {
+    static float samples[PHASE_COUNT + 1][PROFILER_HISTORY];
+    ProfileFrame frame;
+    int count = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    for (int age = 0; age < PROFILER_HISTORY; age++) {
+        if (!ProfilerGetFrame(profiler, age, &frame)) break;
+        for (int p = 0; p < PHASE_COUNT; p++) samples[p][count] = frame.phase[p] / 1e6f;
+        samples[PHASE_COUNT][count] = frame.total / 1e6f;
+        count++;
+    }
+    stats->frames = count;
+    if (count == 0) return;
+
+    for (int p = 0; p <= PHASE_COUNT; p++) {
+        qsort(samples[p], (size_t)count, sizeof(float), CompareFloat);
+        float sum = 0;
+        for (int i = 0; i < count; i++) sum += samples[p][i];
+        stats->min[p] = samples[p][0];
+        stats->avg[p] = sum / count;
+        stats->p99[p] = samples[p][(count * 99) / 100];
+    }
+}
+
+// Oldest surviving frame first
+static int CollectFrames(const Profiler *profiler, ProfileFrame **out) {
+    ProfileFrame *frames = malloc(sizeof(ProfileFrame) * PROFILER_HISTORY);
+    int count = 0;
+    if (frames == NULL) return 0;
+
+    ProfileFrame frame;
+    for (int age = PROFILER_HISTORY - 1; age >= 0; age--) {
+        if (ProfilerGetFrame(profiler, age, &frame)) frames[count++] = frame;
+    }
+    *out = frames;
+    return count;
+}
+
+bool ProfilerWriteCsv(const Profiler *profiler, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return false;
+
+    ProfileFrame *frames = NULL;
+    int count = CollectFrames(profiler, &frames);
+
+    fprintf(file, "frame");
+    for (int p = 0; p < PHASE_COUNT; p++) fprintf(file, ",%s_ms", phaseNames[p]);
+    fprintf(file, ",total_ms\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%llu", (unsigned long long)frames[i].index);
+        for (int p = 0; p < PHASE_COUNT; p++) fprintf(file, ",%.4f", frames[i].phase[p] / 1e6);
+        fprintf(file, ",%.4f\n", frames[i].total / 1e6);
+    }
+
+    free(frames);
+    fclose(file);
+    return true;
+}
+
+bool ProfilerWriteChromeTrace(const Profiler *profiler, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return false;
+
+    ProfileFrame *frames = NULL;
+    int count = CollectFrames(profiler, &frames);
+    uint64_t origin = count ? frames[0].start : 0;
+    bool first = true;
+
+    // Chrome trace event format, load in chrome://tracing or Perfetto
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (int i = 0; i < count; i++) {
+        double frameStart = (frames[i].start - origin) / 1e3;
+        fprintf(file, "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", frameStart, frames[i].total / 1e3);
+        first = false;
+        for (int s = 0; s < frames[i].spanCount; s++) {
+            const ProfileSpan *span = &frames[i].spans[s];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    phaseNames[span->phase], frameStart + span->start / 1e3, span->duration / 1e3);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    free(frames);
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Per-phase frame profiler. The frame loop brackets each phase with
+// ProfileBegin/ProfileEnd; finished frames go into a ring buffer that other
+// threads (overlay, exporters) can read without locking.
+
+#define PROFILER_HISTORY 2048        // Frames kept, power of two
+#define PROFILER_MAX_SPANS 32        // Begin/End pairs recorded per frame
+
+typedef enum ProfilePhase {
+    PHASE_INPUT,
+    PHASE_SIM,
+    PHASE_BACKGROUND,
+    PHASE_OBJECTS,
+    PHASE_EFFECTS,
+    PHASE_HUD,
+    PHASE_PRESENT,
+    PHASE_COUNT
+} ProfilePhase;
+
+// One Begin/End pair, times in nanoseconds from the frame start
+typedef struct ProfileSpan {
+    uint8_t phase;
+    uint32_t start;
+    uint32_t duration;
+} ProfileSpan;
+
+typedef struct ProfileFrame {
+    uint64_t index;
+    uint64_t start;                  // Profiler clock at frame start
+    uint32_t total;                  // Nanoseconds from this frame start to the next
+    uint32_t phase[PHASE_COUNT];     // Nanoseconds spent per phase
+    int spanCount;
+    ProfileSpan spans[PROFILER_MAX_SPANS];
+} ProfileFrame;
+
+typedef struct Profiler {
+    ProfileFrame frames[PROFILER_HISTORY];
+    atomic_uint_fast64_t published;  // Frames written so far, newest is published - 1
+    ProfileFrame current;
+    uint64_t phaseStart[PHASE_COUNT];
+    bool running;
+} Profiler;
+
+// Summary over the frames in the ring, in milliseconds. Index PHASE_COUNT is the whole frame.
+typedef struct ProfileStats {
+    int frames;
+    float min[PHASE_COUNT + 1];
+    float avg[PHASE_COUNT + 1];
+    float p99[PHASE_COUNT + 1];
+} ProfileStats;
+
+// Monotonic clock in nanoseconds
+uint64_t ProfilerNow(void);
+
+void ProfilerInit(Profiler *profiler);
+
+// Close the previous frame (publishing it) and open a new one
+void ProfilerFrameBegin(Profiler *profiler);
+
+void ProfileBegin(Profiler *profiler, ProfilePhase phase);
+void ProfileEnd(Profiler *profiler, ProfilePhase phase);
+
+// Copy of a published frame, age 0 is the newest. Returns false if it was overwritten.
+bool ProfilerGetFrame(const Profiler *profiler, int age, ProfileFrame *frame);
+
+void ProfilerComputeStats(const Profiler *profiler, ProfileStats *stats);
+
+const char *ProfilePhaseName(ProfilePhase phase);
+
+// Write the frames still in the ring, returns false if the file can't be opened
+bool ProfilerWriteCsv(const Profiler *profiler, const char *path);
+bool ProfilerWriteChromeTrace(const Profiler *profiler, const char *path);
+
+#endif // PROFILER_H
@@ -0,0 +1,110 @@
+#include "rain.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Stateless integer hash (lowbias32). Each drop hashes its own index with the
+// frame number, so the respawn loop has no shared generator state and
+// vectorizes like the rest of the update.
+static inline uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Top 24 bits of a hash as [0, 1)
+static inline float HashUnit(uint32_t x) {
+    return (float)(int32_t)(Hash(x) >> 8) * (1.0f / 16777216.0f);
+}
+
+// One byte of an already computed hash as [0, 1), plenty for speed and length
+static inline float ByteUnit(uint32_t hash, int byte) {
+    return (float)(int32_t)((hash >> (byte * 8)) & 0xFF) * (1.0f / 256.0f);
+}
+
+bool RainInit(RainSystem *rain, int dropsPerTheme, float width, float height, uint32_t seed) {
+    int total = dropsPerTheme * 2;
+
+    *rain = (RainSystem){ 0 };
+    rain->block = malloc(sizeof(float) * (size_t)total * 4);
+    if (rain->block == NULL) return false;
+
+    float *memory = (float *)rain->block;
+    rain->x = memory;
+    rain->y = memory + total;
+    rain->speed = memory + total * 2;
+    rain->length = memory + total * 3;
+    rain->count = dropsPerTheme;
+    rain->width = width;
+    rain->height = height;
+    rain->seed = seed;
+
+    // Start above the screen, lava on the right half and ice on the left like the main menu
+    for (int i = 0; i < total; i++) {
+        uint32_t key = seed ^ ((uint32_t)i * 0x9E3779B1u);
+        float left = (i < dropsPerTheme) ? width / 2 : 0;
+        rain->x[i] = left + HashUnit(key) * width / 2;
+        rain->y[i] = -HashUnit(key + 1) * height;
+        rain->speed[i] = (5.0f + HashUnit(key + 2) * 10.0f) * 60.0f;
+        rain->length[i] = 15.0f + HashUnit(key + 3) * 15.0f;
+    }
+    return true;
+}
+
+void RainFree(RainSystem *rain) {
+    free(rain->block);
+    *rain = (RainSystem){ 0 };
+}
+
+// Update one theme's drops, respawning into [left, left + span)
+static void UpdateDrops(RainSystem *rain, int first, int count, float left, float span,
+                        float minLength, float lengthRange, float dt) {
+    float *restrict x = rain->x + first;
+    float *restrict y = rain->y + first;
+    float *restrict speed = rain->speed + first;
+    float *restrict length = rain->length + first;
+    const float height = rain->height;
+    const uint32_t frameKey = rain->seed ^ (rain->frame * 0x85EBCA6Bu);
+
+    // Every drop computes its respawn values and blends them in only if it fell
+    // off, arithmetic instead of branches so the loop stays SIMD
+    for (int i = 0; i < count; i++) {
+        uint32_t key = frameKey ^ ((uint32_t)(first + i) * 0x9E3779B1u);
+        float fallenY = y[i] + speed[i] * dt;
+        uint32_t bits = Hash(key + 1);
+        float spawnX = left + HashUnit(key) * span;
+        float spawnY = -10.0f - ByteUnit(bits, 0) * 40.0f;
+        float spawnSpeed = (5.0f + ByteUnit(bits, 1) * 10.0f) * 60.0f;
+        float spawnLength = minLength + ByteUnit(bits, 2) * lengthRange;
+        float respawn = (fallenY > height) ? 1.0f : 0.0f;
+        x[i] += respawn * (spawnX - x[i]);
+        y[i] = fallenY + respawn * (spawnY - fallenY);
+        speed[i] += respawn * (spawnSpeed - speed[i]);
+        length[i] += respawn * (spawnLength - length[i]);
+    }
+}
+
+void RainUpdate(RainSystem *rain, RainLayout layout, float dt) {
+    const float width = rain->width;
+    rain->frame++;
+
+    if (layout == RAIN_SPLIT) {
+        // In main menu: swap sides - lava raindrops on right, ice raindrops on left
+        UpdateDrops(rain, 0, rain->count, width / 2, width / 2, 15.0f, 15.0f, dt);
+        UpdateDrops(rain, rain->count, rain->count, 0, width / 2, 15.0f, 15.0f, dt);
+    } else {
+        // In mode and difficulty selection: mixed raindrops on both sides
+        UpdateDrops(rain, 0, rain->count, 0, width, 12.0f, 13.0f, dt);
+        UpdateDrops(rain, rain->count, rain->count, 0, width, 12.0f, 13.0f, dt);
+    }
+}
+
+void RainAdvance(const RainSystem *from, RainSystem *to, RainLayout layout, float dt) {
+    // Drops are few next to particles, copying and updating in place costs less than a second code path
+    memcpy(to->block, from->block, sizeof(float) * (size_t)from->count * 2 * 4);
+    to->frame = from->frame;
+    to->seed = from->seed;
+    RainUpdate(to, layout, dt);
+}
@@ -0,0 +1,40 @@
+#ifndef RAIN_H
+#define RAIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Menu raindrop animation. Drops are stored as parallel arrays, lava drops in
+// [0, count) and ice drops in [count, 2 * count), and updated in one pass.
+
+#define RAIN_DEFAULT_DROPS 100
+
+// Where drops respawn: main menu splits the themes, the sub menus mix them
+typedef enum RainLayout {
+    RAIN_SPLIT,   // Lava drops on the right half, ice drops on the left half
+    RAIN_MIXED    // Both themes across the whole width
+} RainLayout;
+
+typedef struct RainSystem {
+    int count;          // Drops per theme
+    float width;
+    float height;
+    float *x;
+    float *y;           // Top of the drop
+    float *speed;       // Pixels per second
+    float *length;
+    uint32_t frame;     // Advances every update, seeds the respawn hash
+    uint32_t seed;
+    void *block;        // Single allocation backing every array
+} RainSystem;
+
+bool RainInit(RainSystem *rain, int dropsPerTheme, float width, float height, uint32_t seed);
+void RainFree(RainSystem *rain);
+
+// Move every drop and respawn the ones that fell off the bottom
+void RainUpdate(RainSystem *rain, RainLayout layout, float dt);
+
+// The same update written into another system made with the same size, from is only read
+void RainAdvance(const RainSystem *from, RainSystem *to, RainLayout layout, float dt);
+
+#endif // RAIN_H
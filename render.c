@@ -0,0 +1,338 @@
+#include "render.h"
+#include "rlgl.h"
+#include <math.h>
+
+// Quads submitted between batch limit checks
+#define QUADS_PER_CHUNK 1024
+
+static int drawCalls = 0;
+
+void CountDrawCalls(int calls) {
+    drawCalls += calls;
+}
+
+int GetDrawCallCount(void) {
+    return drawCalls;
+}
+
+void ResetDrawCallCount(void) {
+    drawCalls = 0;
+}
+
+void DrawParticles(const ParticleSystem *system) {
+    if (system->count == 0) return;
+
+    // Sample the middle of raylib's white shapes texel so quads batch with other shapes
+    Texture2D shapes = GetShapesTexture();
+    Rectangle source = GetShapesTextureRectangle();
+    float u = (source.x + source.width / 2.0f) / shapes.width;
+    float v = (source.y + source.height / 2.0f) / shapes.height;
+
+    CountDrawCalls(1);
+    rlSetTexture(shapes.id);
+    for (int start = 0; start < system->count; start += QUADS_PER_CHUNK) {
+        int end = start + QUADS_PER_CHUNK;
+        if (end > system->count) end = system->count;
+
+        // Flushes the batch first if these quads would overflow it
+        rlCheckRenderBatchLimit(4 * (end - start));
+        rlBegin(RL_QUADS);
+        for (int i = start; i < end; i++) {
+            uint32_t color = system->color[i];
+            float fade = system->life[i] < 1.0f ? system->life[i] : 1.0f;
+            float x = system->x[i];
+            float y = system->y[i];
+            float s = system->size[i];
+
+            rlColor4ub(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, (unsigned char)((color >> 24) * fade));
+            rlTexCoord2f(u, v);
+            rlVertex2f(x - s, y - s);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x - s, y + s);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x + s, y + s);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x + s, y - s);
+        }
+        rlEnd();
+    }
+    rlSetTexture(0);
+}
+
+void DrawRain(const RainSystem *rain, float thickness, Color lavaColor, Color iceColor) {
+    Texture2D shapes = GetShapesTexture();
+    Rectangle source = GetShapesTextureRectangle();
+    float u = (source.x + source.width / 2.0f) / shapes.width;
+    float v = (source.y + source.height / 2.0f) / shapes.height;
+    float half = thickness / 2.0f;
+    int total = rain->count * 2;
+
+    CountDrawCalls(1);
+    rlSetTexture(shapes.id);
+    for (int start = 0; start < total; start += QUADS_PER_CHUNK) {
+        int end = start + QUADS_PER_CHUNK;
+        if (end > total) end = total;
+
+        rlCheckRenderBatchLimit(4 * (end - start));
+        rlBegin(RL_QUADS);
+        for (int i = start; i < end; i++) {
+            Color color = (i < rain->count) ? lavaColor : iceColor;
+            float x = rain->x[i];
+            float top = rain->y[i];
+            float bottom = top + rain->length[i];
+
+            rlColor4ub(color.r, color.g, color.b, color.a);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x - half, top);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x - half, bottom);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x + half, bottom);
+            rlTexCoord2f(u, v);
+            rlVertex2f(x + half, top);
+        }
+        rlEnd();
+    }
+    rlSetTexture(0);
+}
+
+void DrawArenaBalls(const Arena *arena, Texture2D ball, Color lavaColor, Color iceColor) {
+    const float half = arena->config.radius * 1.5f;
+    const float middle = arena->config.sim.width / 2;
+    if (arena->ballCount == 0) return;
+
+    CountDrawCalls(1);
+    rlSetTexture(ball.id);
+    for (int start = 0; start < arena->ballCount; start += QUADS_PER_CHUNK) {
+        int end = start + QUADS_PER_CHUNK;
+        if (end > arena->ballCount) end = arena->ballCount;
+
+        rlCheckRenderBatchLimit(4 * (end - start));
+        rlBegin(RL_QUADS);
+        for (int i = start; i < end; i++) {
+            Color color = (arena->x[i] < middle) ? lavaColor : iceColor;
+            float x = arena->x[i];
+            float y = arena->y[i];
+
+            rlColor4ub(color.r, color.g, color.b, color.a);
+            rlTexCoord2f(0.0f, 0.0f);
+            rlVertex2f(x - half, y - half);
+            rlTexCoord2f(0.0f, 1.0f);
+            rlVertex2f(x - half, y + half);
+            rlTexCoord2f(1.0f, 1.0f);
+            rlVertex2f(x + half, y + half);
+            rlTexCoord2f(1.0f, 0.0f);
+            rlVertex2f(x + half, y - half);
+        }
+        rlEnd();
+    }
+    rlSetTexture(0);
+}
+
+void DrawLevel(const Level *level, float middle, Color lavaColor, Color iceColor) {
+    CountDrawCalls(level->shapeCount);
+    for (int i = 0; i < level->shapeCount; i++) {
+        const LevelShape *shape = &level->shapes[i];
+        Color color = (shape->bounds.x + shape->bounds.width / 2 < middle) ? lavaColor : iceColor;
+        Vector2 a = { shape->a.x, shape->a.y };
+        Vector2 b = { shape->b.x, shape->b.y };
+        if (shape->type == LEVEL_RECT) {
+            DrawRectangleRec((Rectangle){ shape->bounds.x, shape->bounds.y, shape->bounds.width, shape->bounds.height }, color);
+        } else if (shape->type == LEVEL_CIRCLE) {
+            DrawCircleV(a, shape->radius, color);
+        } else {
+            // Segments collide as capsules, round the ends so joints in a polyline close up
+            DrawLineEx(a, b, fmaxf(2.0f * shape->radius, 2.0f), color);
+            if (shape->radius > 0.0f) {
+                DrawCircleV(a, shape->radius, color);
+                DrawCircleV(b, shape->radius, color);
+            }
+        }
+    }
+}
+
+void DrawProfilerOverlay(const Profiler *profiler, const ProfileStats *stats, int x, int y) {
+    const int rowHeight = 18;
+    const int graphFrames = 240;
+    const int graphHeight = 80;
+    const float graphScaleMs = 33.3f;   // Top of the graph
+    int width = 360;
+    int height = rowHeight * (PHASE_COUNT + 3) + graphHeight + 10;
+
+    DrawRectangle(x, y, width, height, Fade(BLACK, 0.75f));
+    DrawText(TextFormat("%-11s %7s %7s %7s", "phase (ms)", "min", "avg", "p99"), x + 8, y + 4, 16, YELLOW);
+    for (int p = 0; p <= PHASE_COUNT; p++) {
+        const char *name = (p == PHASE_COUNT) ? "frame" : ProfilePhaseName((ProfilePhase)p);
+        DrawText(TextFormat("%-11s %7.2f %7.2f %7.2f", name, stats->min[p], stats->avg[p], stats->p99[p]),
+                 x + 8, y + 4 + rowHeight * (p + 1), 16, (p == PHASE_COUNT) ? WHITE : LIGHTGRAY);
+    }
+
+    // Frame time graph, newest on the right, with the 60 FPS budget marked
+    int graphY = y + rowHeight * (PHASE_COUNT + 2) + 6;
+    int graphBottom = graphY + graphHeight;
+    float step = (float)(width - 16) / graphFrames;
+    int budgetY = graphBottom - (int)(16.6f / graphScaleMs * graphHeight);
+    DrawLine(x + 8, budgetY, x + width - 8, budgetY, Fade(GREEN, 0.6f));
+
+    ProfileFrame frame;
+    for (int age = 0; age < graphFrames; age++) {
+        if (!ProfilerGetFrame(profiler, age, &frame)) break;
+        float ms = frame.total / 1e6f;
+        int barHeight = (int)(fminf(ms / graphScaleMs, 1.0f) * graphHeight);
+        int barX = x + width - 8 - (int)((age + 1) * step);
+        DrawRectangle(barX, graphBottom - barHeight, (int)step + 1, barHeight, ms > 16.7f ? RED : SKYBLUE);
+    }
+}
+
+void DrawBlockGrid(int width, int height, int blockSize, const Color *leftColors, const Color *rightColors) {
+    int gridWidth = width / blockSize + 1;
+    int gridHeight = height / blockSize + 1;
+
+    for (int y = 0; y < gridHeight; y++) {
+        for (int x = 0; x < gridWidth; x++) {
+            int blockX = x * blockSize;
+            int blockY = y * blockSize;
+
+            // Create a pattern with blocks, lava theme on the left and ice on the right
+            int pattern = (x + y) % 4;
+            Color color = (blockX < width / 2) ? leftColors[pattern] : rightColors[pattern];
+            DrawRectangle(blockX, blockY, blockSize, blockSize, color);
+            DrawRectangleLines(blockX, blockY, blockSize, blockSize, Fade(BLACK, 0.2f));
+        }
+    }
+    CountDrawCalls(2 * gridWidth * gridHeight);
+}
+
+void GridCacheInit(GridCache *cache, int blockSize, const Color *leftHigh, const Color *rightHigh,
+                   const Color *leftLow, const Color *rightLow) {
+    *cache = (GridCache){ 0 };
+    cache->blockSize = blockSize;
+    cache->leftColors[GRID_PALETTE_HIGH] = leftHigh;
+    cache->rightColors[GRID_PALETTE_HIGH] = rightHigh;
+    cache->leftColors[GRID_PALETTE_LOW] = leftLow;
+    cache->rightColors[GRID_PALETTE_LOW] = rightLow;
+    cache->dirty = true;
+}
+
+void GridCacheUnload(GridCache *cache) {
+    for (int i = 0; i < GRID_PALETTE_COUNT; i++) {
+        if (cache->layers[i].id != 0) UnloadRenderTexture(cache->layers[i]);
+        cache->layers[i] = (RenderTexture2D){ 0 };
+    }
+    cache->dirty = true;
+}
+
+void GridCacheInvalidate(GridCache *cache) {
+    cache->dirty = true;
+}
+
+void GridCacheUpdate(GridCache *cache, int width, int height) {
+    if (!cache->dirty && cache->width == width && cache->height == height) return;
+
+    GridCacheUnload(cache);
+    cache->width = width;
+    cache->height = height;
+
+    for (int i = 0; i < GRID_PALETTE_COUNT; i++) {
+        cache->layers[i] = LoadRenderTexture(width, height);
+        BeginTextureMode(cache->layers[i]);
+        ClearBackground(BLACK);
+        // Blend color as usual but keep the texture opaque, so drawing it later
+        // gives the same pixels as drawing the blocks over a black screen
+        rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE, RL_FUNC_ADD, RL_FUNC_ADD);
+        BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+        DrawBlockGrid(width, height, cache->blockSize, cache->leftColors[i], cache->rightColors[i]);
+        EndBlendMode();
+        EndTextureMode();
+    }
+    cache->dirty = false;
+}
+
+void GridCacheDraw(const GridCache *cache, GridPalette palette) {
+    Texture2D texture = cache->layers[palette].texture;
+    // Render textures are stored upside down
+    DrawTextureRec(texture, (Rectangle){ 0, 0, (float)texture.width, (float)-texture.height }, (Vector2){ 0, 0 }, WHITE);
+    CountDrawCalls(1);
+}
+
+void DrawPlayfield(int width, int height, PlayfieldLayer layer, const PlayfieldTheme *theme, const Vector2 *stars, int starCount,
+                   const SimRect *obstacles, int obstacleCount, const Level *level) {
+    bool playing = (layer == PLAYFIELD_PLAYING);
+    if (playing) {
+        DrawRectangle(0, 0, width / 2, height, theme->lavaBackground);
+        DrawRectangle(width / 2, 0, width / 2, height, theme->iceBackground);
+    } else {
+        ClearBackground(theme->gameOverBackground);
+    }
+    for (int i = 0; i < starCount; i++) {
+        Color color = !playing ? theme->gameOverStar : (stars[i].x < width / 2) ? theme->lavaStar : theme->iceStar;
+        DrawPixelV(stars[i], color);
+    }
+    for (int i = 0; i < obstacleCount; i++) {
+        Color color = (obstacles[i].x < width / 2) ? theme->lavaObstacle : theme->iceObstacle;
+        DrawRectangleRec((Rectangle){ obstacles[i].x, obstacles[i].y, obstacles[i].width, obstacles[i].height }, color);
+    }
+    if (level != NULL) DrawLevel(level, width / 2.0f, theme->lavaObstacle, theme->iceObstacle);
+    int dashes = 0;
+    for (int y = 0; y < height; y += 20, dashes++) {
+        DrawLine(width / 2, y, width / 2, y + 10, theme->centerLine);
+    }
+    CountDrawCalls((playing ? 2 : 1) + starCount + obstacleCount + dashes);
+}
+
+void PlayfieldCacheInit(PlayfieldCache *cache, PlayfieldTheme theme, const Vector2 *stars, int starCount) {
+    *cache = (PlayfieldCache){ 0 };
+    cache->theme = theme;
+    cache->stars = stars;
+    cache->starCount = starCount;
+    cache->dirty = true;
+}
+
+void PlayfieldCacheUnload(PlayfieldCache *cache) {
+    for (int i = 0; i < PLAYFIELD_LAYER_COUNT; i++) {
+        if (cache->layers[i].id != 0) UnloadRenderTexture(cache->layers[i]);
+        cache->layers[i] = (RenderTexture2D){ 0 };
+    }
+    cache->dirty = true;
+}
+
+void PlayfieldCacheInvalidate(PlayfieldCache *cache) {
+    cache->dirty = true;
+}
+
+void PlayfieldCacheUpdate(PlayfieldCache *cache, int width, int height, const SimRect *obstacles, int obstacleCount,
+                          const Level *level) {
+    if (!cache->dirty && cache->width == width && cache->height == height && cache->obstacles == obstacles &&
+        cache->obstacleCount == obstacleCount && cache->level == level) {
+        return;
+    }
+
+    // Same size as before: draw over the old textures instead of reallocating them every match
+    if (cache->width != width || cache->height != height) PlayfieldCacheUnload(cache);
+    cache->width = width;
+    cache->height = height;
+    cache->obstacles = obstacles;
+    cache->obstacleCount = obstacleCount;
+    cache->level = level;
+
+    for (int i = 0; i < PLAYFIELD_LAYER_COUNT; i++) {
+        if (cache->layers[i].id == 0) cache->layers[i] = LoadRenderTexture(width, height);
+        BeginTextureMode(cache->layers[i]);
+        ClearBackground(BLACK);
+        // Opaque texture, as with the grid (see GridCacheUpdate)
+        rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE, RL_FUNC_ADD, RL_FUNC_ADD);
+        BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+        DrawPlayfield(width, height, (PlayfieldLayer)i, &cache->theme, cache->stars, cache->starCount,
+                      obstacles, obstacleCount, level);
+        EndBlendMode();
+        EndTextureMode();
+    }
+    cache->dirty = false;
+}
+
+void PlayfieldCacheDraw(const PlayfieldCache *cache, PlayfieldLayer layer) {
+    Texture2D texture = cache->layers[layer].texture;
+    // Render textures are stored upside down
+    DrawTextureRec(texture, (Rectangle){ 0, 0, (float)texture.width, (float)-texture.height }, (Vector2){ 0, 0 }, WHITE);
+    CountDrawCalls(1);
+}
@@ -0,0 +1,119 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+#include "arena.h"
+#include "level.h"
+#include "particles.h"
+#include "rain.h"
+#include "profiler.h"
+
+// Batched drawing on top of rlgl: one vertex stream per system instead of a
+// raylib draw call per element
+
+// Draw every live particle as a solid quad, alpha fades with the last second of life
+void DrawParticles(const ParticleSystem *system);
+
+// Draw every raindrop as a vertical bar of the given thickness in one submission
+void DrawRain(const RainSystem *rain, float thickness, Color lavaColor, Color iceColor);
+
+// Draw every arena ball as a textured quad one diameter and a half wide, lava colored on the
+// left half of the field and ice colored on the right, in one submission
+void DrawArenaBalls(const Arena *arena, Texture2D ball, Color lavaColor, Color iceColor);
+
+// Draw a level's shapes with raylib's shape calls, lava colored left of middle and ice colored right of it
+void DrawLevel(const Level *level, float middle, Color lavaColor, Color iceColor);
+
+// Profiler table (min/avg/p99 per phase) and frame time graph with its top-left corner at x, y
+void DrawProfilerOverlay(const Profiler *profiler, const ProfileStats *stats, int x, int y);
+
+// Draw calls issued this frame by the code that reports them, for the debug overlay
+void CountDrawCalls(int calls);
+int GetDrawCallCount(void);
+void ResetDrawCallCount(void);
+
+// Menu block palettes: high opacity for the main menu, low for the sub menus
+typedef enum GridPalette {
+    GRID_PALETTE_HIGH,
+    GRID_PALETTE_LOW,
+    GRID_PALETTE_COUNT
+} GridPalette;
+
+// Minecraft-style menu background baked into one render texture per palette
+typedef struct GridCache {
+    RenderTexture2D layers[GRID_PALETTE_COUNT];
+    const Color *leftColors[GRID_PALETTE_COUNT];   // 4 colors each
+    const Color *rightColors[GRID_PALETTE_COUNT];
+    int blockSize;
+    int width;
+    int height;
+    bool dirty;
+} GridCache;
+
+// The palettes are kept by pointer, call GridCacheInvalidate after changing them
+void GridCacheInit(GridCache *cache, int blockSize, const Color *leftHigh, const Color *rightHigh,
+                   const Color *leftLow, const Color *rightLow);
+void GridCacheUnload(GridCache *cache);
+void GridCacheInvalidate(GridCache *cache);
+
+// Rebake if the screen size or palettes changed, call outside BeginDrawing/EndDrawing
+void GridCacheUpdate(GridCache *cache, int width, int height);
+
+// One textured quad for the whole grid
+void GridCacheDraw(const GridCache *cache, GridPalette palette);
+
+// The grid block by block, used for baking and to compare against the cache
+void DrawBlockGrid(int width, int height, int blockSize, const Color *leftColors, const Color *rightColors);
+
+// Match screen backdrops: the split background while playing, the dark red one after the match
+typedef enum PlayfieldLayer {
+    PLAYFIELD_PLAYING,
+    PLAYFIELD_GAME_OVER,
+    PLAYFIELD_LAYER_COUNT
+} PlayfieldLayer;
+
+typedef struct PlayfieldTheme {
+    Color lavaBackground;        // Left half while playing
+    Color iceBackground;         // Right half while playing
+    Color gameOverBackground;
+    Color lavaStar;
+    Color iceStar;
+    Color gameOverStar;
+    Color lavaObstacle;          // Obstacles and level shapes left of the middle
+    Color iceObstacle;
+    Color centerLine;
+} PlayfieldTheme;
+
+// Everything on the match screens that doesn't move (background, stars, obstacles,
+// level shapes and the dashed center line) baked into one render texture per layer
+typedef struct PlayfieldCache {
+    RenderTexture2D layers[PLAYFIELD_LAYER_COUNT];
+    PlayfieldTheme theme;
+    const Vector2 *stars;        // Kept by pointer like the grid palettes
+    int starCount;
+    const SimRect *obstacles;    // What the layers were baked with
+    int obstacleCount;
+    const Level *level;
+    int width;
+    int height;
+    bool dirty;
+} PlayfieldCache;
+
+void PlayfieldCacheInit(PlayfieldCache *cache, PlayfieldTheme theme, const Vector2 *stars, int starCount);
+void PlayfieldCacheUnload(PlayfieldCache *cache);
+
+// Call when a match starts, its obstacles may sit where the last match's did but be different
+void PlayfieldCacheInvalidate(PlayfieldCache *cache);
+
+// Rebake if invalidated or the screen size, obstacle list or level changed, call outside BeginDrawing/EndDrawing
+void PlayfieldCacheUpdate(PlayfieldCache *cache, int width, int height, const SimRect *obstacles, int obstacleCount,
+                          const Level *level);
+
+// One textured quad for the whole layer
+void PlayfieldCacheDraw(const PlayfieldCache *cache, PlayfieldLayer layer);
+
+// The layer shape by shape, used for baking and to compare against the cache
+void DrawPlayfield(int width, int height, PlayfieldLayer layer, const PlayfieldTheme *theme, const Vector2 *stars, int starCount,
+                   const SimRect *obstacles, int obstacleCount, const Level *level);
+
+#endif // RENDER_H
@@ -0,0 +1,235 @@
+#include "replay.h"
+#include "level.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAGIC 0x4C505250u   // "PRPL"
+#define REPLAY_VERSION 2u
+
+// Paddle input flags as stored in the file
+#define INPUT_MOVE_MASK 0x03u      // move + 1
+#define INPUT_USE_TARGET 0x04u
+#define INPUT_AI 0x08u
+
+typedef struct ReplayHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stateSize;            // Rejects files written by a build with a different SimState
+    uint32_t keyframeInterval;
+    uint64_t seed;
+    uint32_t tickCount;
+    uint32_t keyframeCount;
+    uint32_t runCount;
+    uint32_t reserved;
+    uint64_t levelHash;
+} ReplayHeader;
+
+// Grow an array to hold at least needed items
+static bool Reserve(void **items, uint32_t *capacity, uint32_t needed, size_t itemSize) {
+    if (needed <= *capacity) return true;
+    uint32_t grown = *capacity ? *capacity * 2 : 1024;
+    while (grown < needed) grown *= 2;
+    void *resized = realloc(*items, grown * itemSize);
+    if (resized == NULL) return false;
+    *items = resized;
+    *capacity = grown;
+    return true;
+}
+
+static bool PushKeyframe(Replay *replay, const SimState *state) {
+    if (!Reserve((void **)&replay->keyframes, &replay->keyframeCapacity, replay->keyframeCount + 1, sizeof(SimState))) {
+        return false;
+    }
+    replay->keyframes[replay->keyframeCount++] = *state;
+    return true;
+}
+
+bool ReplayBegin(Replay *replay, const SimState *initial, uint64_t seed, int keyframeInterval) {
+    *replay = (Replay){ 0 };
+    replay->seed = seed;
+    replay->keyframeInterval = keyframeInterval > 0 ? keyframeInterval : REPLAY_KEYFRAME_INTERVAL;
+    replay->levelHash = (initial->config.level != NULL) ? initial->config.level->hash : 0;
+    return PushKeyframe(replay, initial);
+}
+
+void ReplayFree(Replay *replay) {
+    free(replay->inputs);
+    free(replay->keyframes);
+    *replay = (Replay){ 0 };
+}
+
+bool ReplayRecord(Replay *replay, const SimState *state, SimInput input) {
+    // Steps after the match ended don't change anything, nothing to record
+    if (state->winner != SIDE_NONE || state->tick != replay->tickCount) return false;
+
+    if (state->tick > 0 && state->tick % replay->keyframeInterval == 0) {
+        if (!PushKeyframe(replay, state)) return false;
+    }
+    if (!Reserve((void **)&replay->inputs, &replay->tickCapacity, replay->tickCount + 1, sizeof(SimInput))) {
+        return false;
+    }
+    replay->inputs[replay->tickCount++] = input;
+    return true;
+}
+
+SimInput ReplayInput(const Replay *replay, uint32_t tick) {
+    if (tick >= replay->tickCount) return (SimInput){ 0 };
+    return replay->inputs[tick];
+}
+
+uint32_t ReplaySeek(const Replay *replay, uint32_t tick, SimState *state) {
+    if (tick > replay->tickCount) tick = replay->tickCount;
+
+    uint32_t keyframe = tick / (uint32_t)replay->keyframeInterval;
+    if (keyframe >= replay->keyframeCount) keyframe = replay->keyframeCount - 1;
+    *state = replay->keyframes[keyframe];
+
+    // At most keyframeInterval steps from here
+    while (state->tick < tick && state->winner == SIDE_NONE) {
+        SimStep(state, replay->inputs[state->tick]);
+    }
+    return state->tick;
+}
+
+static uint8_t PackPaddle(SimPaddleInput input) {
+    uint8_t flags = (uint8_t)((input.move + 1) & INPUT_MOVE_MASK);
+    if (input.useTarget) flags |= INPUT_USE_TARGET;
+    if (input.ai) flags |= INPUT_AI;
+    return flags;
+}
+
+static SimPaddleInput UnpackPaddle(uint8_t flags, float targetY) {
+    SimPaddleInput input = { 0 };
+    input.move = (int)(flags & INPUT_MOVE_MASK) - 1;
+    input.useTarget = (flags & INPUT_USE_TARGET) != 0;
+    input.targetY = input.useTarget ? targetY : 0.0f;
+    input.ai = (flags & INPUT_AI) != 0;
+    return input;
+}
+
+// Same input as far as SimStep is concerned
+static bool PaddleInputEqual(SimPaddleInput a, SimPaddleInput b) {
+    if (PackPaddle(a) != PackPaddle(b)) return false;
+    return !a.useTarget || memcmp(&a.targetY, &b.targetY, sizeof(float)) == 0;
+}
+
+static bool InputEqual(SimInput a, SimInput b) {
+    return PaddleInputEqual(a.left, b.left) && PaddleInputEqual(a.right, b.right);
+}
+
+static void WriteVarint(FILE *file, uint32_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool ReadVarint(FILE *file, uint32_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) return false;
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void WritePaddle(FILE *file, SimPaddleInput input) {
+    fputc(PackPaddle(input), file);
+    if (input.useTarget) fwrite(&input.targetY, sizeof(float), 1, file);
+}
+
+static bool ReadPaddle(FILE *file, SimPaddleInput *input) {
+    int flags = fgetc(file);
+    float targetY = 0.0f;
+    if (flags == EOF) return false;
+    if ((flags & INPUT_USE_TARGET) && fread(&targetY, sizeof(float), 1, file) != 1) return false;
+    *input = UnpackPaddle((uint8_t)flags, targetY);
+    return true;
+}
+
+bool ReplaySave(const Replay *replay, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    uint32_t runCount = 0;
+    for (uint32_t t = 0; t < replay->tickCount; t++) {
+        if (t == 0 || !InputEqual(replay->inputs[t], replay->inputs[t - 1])) runCount++;
+    }
+
+    ReplayHeader header = {
+        .magic = REPLAY_MAGIC, .version = REPLAY_VERSION, .stateSize = sizeof(SimState),
+        .keyframeInterval = (uint32_t)replay->keyframeInterval, .seed = replay->seed,
+        .tickCount = replay->tickCount, .keyframeCount = replay->keyframeCount, .runCount = runCount,
+        .levelHash = replay->levelHash
+    };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(replay->keyframes, sizeof(SimState), replay->keyframeCount, file);
+
+    for (uint32_t t = 0; t < replay->tickCount; ) {
+        uint32_t run = 1;
+        while (t + run < replay->tickCount && InputEqual(replay->inputs[t + run], replay->inputs[t])) run++;
+        WriteVarint(file, run);
+        WritePaddle(file, replay->inputs[t].left);
+        WritePaddle(file, replay->inputs[t].right);
+        t += run;
+    }
+
+    bool ok = !ferror(file);
+    return (fclose(file) == 0) && ok;
+}
+
+bool ReplayLoad(Replay *replay, const char *path) {
+    FILE *file = fopen(path, "rb");
+    ReplayHeader header;
+    *replay = (Replay){ 0 };
+    if (file == NULL) return false;
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              header.magic == REPLAY_MAGIC && header.version == REPLAY_VERSION &&
+              header.stateSize == sizeof(SimState) && header.keyframeInterval > 0 &&
+              header.keyframeCount > 0 &&
+              header.keyframeCount <= header.tickCount / header.keyframeInterval + 1;
+    if (ok) {
+        replay->seed = header.seed;
+        replay->levelHash = header.levelHash;
+        replay->keyframeInterval = (int)header.keyframeInterval;
+        replay->keyframeCount = replay->keyframeCapacity = header.keyframeCount;
+        replay->tickCount = replay->tickCapacity = header.tickCount;
+        replay->keyframes = malloc(sizeof(SimState) * header.keyframeCount);
+        replay->inputs = malloc(sizeof(SimInput) * (header.tickCount ? header.tickCount : 1));
+        ok = replay->keyframes != NULL && replay->inputs != NULL &&
+             fread(replay->keyframes, sizeof(SimState), header.keyframeCount, file) == header.keyframeCount;
+    }
+
+    // Expand the input runs back to one entry per tick
+    uint32_t tick = 0;
+    for (uint32_t r = 0; ok && r < header.runCount; r++) {
+        uint32_t run;
+        SimInput input;
+        ok = ReadVarint(file, &run) && run <= header.tickCount - tick &&
+             ReadPaddle(file, &input.left) && ReadPaddle(file, &input.right);
+        for (uint32_t i = 0; ok && i < run; i++) replay->inputs[tick++] = input;
+    }
+    ok = ok && tick == header.tickCount;
+
+    // The level pointer was only valid in the process that recorded, see ReplaySetLevel.
+    // ReplaySeek steps from any keyframe, so one bad keyframe rejects the file.
+    for (uint32_t k = 0; ok && k < replay->keyframeCount; k++) {
+        replay->keyframes[k].config.level = NULL;
+        ok = SimStateValid(&replay->keyframes[k]);
+    }
+
+    fclose(file);
+    if (!ok) ReplayFree(replay);
+    return ok;
+}
+
+bool ReplaySetLevel(Replay *replay, const Level *level) {
+    if (replay->levelHash != (level != NULL ? level->hash : 0)) return false;
+    for (uint32_t k = 0; k < replay->keyframeCount; k++) replay->keyframes[k].config.level = level;
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Match recording. A match is fully decided by its starting state and the
+// input fed to every SimStep, so a replay stores exactly that, plus a full
+// SimState every keyframeInterval ticks so playback can jump anywhere by
+// restoring the nearest keyframe and stepping forward from there.
+//
+// File layout (host byte order, version 2):
+//   header      magic "PRPL", version, sizeof(SimState), seed, keyframe interval,
+//               tick count, keyframe count, input run count, level hash (0 for the classic layout)
+//   keyframes   raw SimState, keyframe k holds the state at tick k * interval
+//   input runs  varint length, flags byte per paddle, targetY per paddle that uses it
+// Consecutive identical inputs are stored once, so held keys and AI-only
+// paddles cost a few bytes per run instead of per tick.
+
+#define REPLAY_KEYFRAME_INTERVAL 600   // Five seconds at the default tick rate
+
+typedef struct Level Level;
+
+typedef struct Replay {
+    uint64_t seed;
+    uint64_t levelHash;        // Level.hash of the level played, 0 for the classic layout
+    int keyframeInterval;
+    SimInput *inputs;          // Input for the step leaving tick t
+    uint32_t tickCount;
+    uint32_t tickCapacity;
+    SimState *keyframes;
+    uint32_t keyframeCount;
+    uint32_t keyframeCapacity;
+} Replay;
+
+// Start a recording from the state SimInit produced, keyframeInterval 0 uses the default
+bool ReplayBegin(Replay *replay, const SimState *initial, uint64_t seed, int keyframeInterval);
+void ReplayFree(Replay *replay);
+
+// Append the input about to be passed to SimStep, with the state it will be applied to
+bool ReplayRecord(Replay *replay, const SimState *state, SimInput input);
+
+// Input recorded for the step leaving tick, idle past the end
+SimInput ReplayInput(const Replay *replay, uint32_t tick);
+
+// Rebuild the state at tick (clamped to the recording) from the nearest keyframe.
+// Returns the tick reached, which is earlier if the match ended first.
+uint32_t ReplaySeek(const Replay *replay, uint32_t tick, SimState *state);
+
+bool ReplaySave(const Replay *replay, const char *path);
+bool ReplayLoad(Replay *replay, const char *path);
+
+// Loaded keyframes have no level. Attach the one the match was played on, returns
+// false (and changes nothing) if level is not that one. NULL for the classic layout.
+bool ReplaySetLevel(Replay *replay, const Level *level);
+
+#endif // REPLAY_H
@@ -0,0 +1,48 @@
+#include "resolution.h"
+#include <math.h>
+
+void ResolutionInit(Resolution *resolution, float budgetSeconds, float minScale, float maxScale) {
+    *resolution = (Resolution){
+        .budget = budgetSeconds, .minScale = minScale, .maxScale = maxScale, .scale = maxScale
+    };
+}
+
+// Whole steps only, so the scale doesn't wander by fractions of a pixel
+static float Quantize(const Resolution *resolution, float scale) {
+    scale = floorf(scale / RESOLUTION_STEP + 0.001f) * RESOLUTION_STEP;
+    if (scale < resolution->minScale) scale = resolution->minScale;
+    if (scale > resolution->maxScale) scale = resolution->maxScale;
+    return scale;
+}
+
+bool ResolutionUpdate(Resolution *resolution, float frameSeconds) {
+    // A slow frame counts at once, a fast one only slowly, so one quick frame doesn't start a climb
+    if (resolution->smoothed <= 0.0f) resolution->smoothed = frameSeconds;
+    float rate = (frameSeconds > resolution->smoothed) ? 0.5f : 0.05f;
+    resolution->smoothed += (frameSeconds - resolution->smoothed) * rate;
+    if (resolution->settle > 0) {
+        resolution->settle--;
+        return false;
+    }
+
+    float scale = resolution->scale;
+    float target = RESOLUTION_TARGET * resolution->budget;
+    if (resolution->smoothed > resolution->budget) {
+        // At least one step down, more if the pixel model says so
+        float fit = Quantize(resolution, scale * sqrtf(target / resolution->smoothed));
+        scale = fminf(fit, Quantize(resolution, scale - RESOLUTION_STEP));
+    } else {
+        // One step up if the model says it still fits, it overestimates when little of the frame is fill
+        float up = Quantize(resolution, scale + RESOLUTION_STEP);
+        if (resolution->smoothed * (up / scale) * (up / scale) < target) scale = up;
+    }
+    if (scale == resolution->scale) return false;
+
+    // Start from what the new scale should cost instead of waiting for the average to catch up
+    float ratio = scale / resolution->scale;
+    resolution->smoothed *= ratio * ratio;
+    resolution->scale = scale;
+    resolution->settle = RESOLUTION_SETTLE_FRAMES;
+    resolution->changes++;
+    return true;
+}
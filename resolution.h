@@ -0,0 +1,38 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <stdbool.h>
+
+// Dynamic resolution: picks the size the scene is rendered at so frames stay
+// inside a time budget. The scene goes into an offscreen target at scale times
+// the window size and is stretched over the window, gameplay keeps using window
+// coordinates throughout.
+//
+// The controller smooths the measured frame time, rising quickly on a slow frame
+// and falling slowly, and assumes the part that depends on resolution grows with
+// the pixel count, the square of the scale. Over budget it jumps straight to the
+// scale the model predicts fits; under budget it climbs back one step at a time
+// while the model says the step still fits. After every change it waits a few frames for the new cost to show up.
+// No raylib here, so headless.c can run the controller against a cost model.
+
+#define RESOLUTION_STEP 0.05f           // Scale changes in steps of 5% per axis
+#define RESOLUTION_SETTLE_FRAMES 10     // Frames after a change before the next one
+#define RESOLUTION_TARGET 0.9f          // Aim for this share of the budget, the rest absorbs noise
+
+typedef struct Resolution {
+    float budget;           // Seconds a frame may take
+    float minScale;
+    float maxScale;
+    float scale;            // Render size over window size, per axis
+    float smoothed;         // Frame seconds, smoothed
+    int settle;             // Frames left before the scale may change again
+    unsigned changes;
+} Resolution;
+
+void ResolutionInit(Resolution *resolution, float budgetSeconds, float minScale, float maxScale);
+
+// Feed the busy time of the frame just finished (without the frame rate cap wait).
+// Returns true when the scale changed.
+bool ResolutionUpdate(Resolution *resolution, float frameSeconds);
+
+#endif // RESOLUTION_H
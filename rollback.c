@@ -0,0 +1,320 @@
+#include "rollback.h"
+#include <math.h>
+#include <string.h>
+
+// Packets (host byte order, both peers run the same build):
+//   PacketHeader, then for START a RollbackMatch,
+//   for INPUT an InputHeader and count paddle inputs from frame first on,
+//   each a flags byte followed by targetY when INPUT_USE_TARGET is set
+#define PACKET_MAGIC 0x54454E50u   // "PNET"
+#define PACKET_VERSION 2
+
+#define RING_MASK (ROLLBACK_RING - 1)
+#define HANDSHAKE_SECONDS 0.1      // Between HELLO or START resends
+#define WAIT_COOLDOWN 10           // Steps between two catch-up waits, so waiting never stutters
+#define ADVANTAGE_SMOOTHING 0.02f  // Weight of each new sample, jitter makes single samples noisy
+
+// Same flag layout as replay files
+#define INPUT_MOVE_MASK 0x03       // move + 1
+#define INPUT_USE_TARGET 0x04
+
+typedef enum PacketType {
+    PACKET_HELLO,
+    PACKET_START,
+    PACKET_INPUT
+} PacketType;
+
+typedef struct PacketHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t match;
+} PacketHeader;
+
+typedef struct InputHeader {
+    uint32_t frame;                // Sender's step count
+    int32_t ackFrame;              // Newest input the sender has from us
+    uint32_t first;                // Step of the first input in the packet
+    uint32_t syncFrame;            // Sender's newest confirmed state and its hash
+    uint64_t syncHash;
+    uint16_t count;
+    uint16_t reserved;
+} InputHeader;
+
+_Static_assert(sizeof(PacketHeader) + sizeof(InputHeader) + ROLLBACK_RING * 5 <= NET_MAX_PACKET, "INPUT packet too big");
+
+static bool PaddleInputEqual(SimPaddleInput a, SimPaddleInput b) {
+    return a.move == b.move && a.useTarget == b.useTarget && a.ai == b.ai && (!a.useTarget || a.targetY == b.targetY);
+}
+
+// The host always drives the left paddle
+static SimInput StepInput(const Rollback *session, uint32_t frame, SimPaddleInput remote) {
+    SimPaddleInput local = session->localInputs[frame & RING_MASK];
+    return session->host ? (SimInput){ local, remote } : (SimInput){ remote, local };
+}
+
+// Real input when it has arrived, otherwise the newest one repeated
+static SimPaddleInput Guess(const Rollback *session, uint32_t frame) {
+    if ((int32_t)frame <= session->remoteFrame) return session->remoteInputs[frame & RING_MASK];
+    if (session->remoteFrame >= 0) return session->remoteInputs[session->remoteFrame & RING_MASK];
+    return (SimPaddleInput){ 0 };
+}
+
+static void Reset(Rollback *session, const SimState *initial, uint16_t match) {
+    session->match = match;
+    session->state = *initial;
+    session->events = 0;
+    session->frame = 0;
+    session->remoteFrame = -1;
+    session->ackedFrame = -1;
+    session->syncFrame = 0;
+    session->checkedFrame = 0;
+    session->rollbackFrom = UINT32_MAX;
+    session->remoteAdvantage = 0;
+    session->advantage = 0.0f;
+    session->waitCooldown = 0;
+    session->states[0] = *initial;
+    session->hashes[0] = SimHash(initial);
+    memset(&session->stats, 0, sizeof(session->stats));
+}
+
+static void SendHeader(Rollback *session, PacketType type, const void *body, int bodySize, double now) {
+    unsigned char packet[NET_MAX_PACKET];
+    PacketHeader header = { PACKET_MAGIC, PACKET_VERSION, (uint8_t)type, session->match };
+    memcpy(packet, &header, sizeof(header));
+    if (bodySize > 0) memcpy(packet + sizeof(header), body, (size_t)bodySize);
+    NetSend(session->net, session->peer, packet, (int)sizeof(header) + bodySize, now);
+}
+
+// Every local input the other peer has not acknowledged yet
+static void SendInput(Rollback *session, double now) {
+    unsigned char body[NET_MAX_PACKET - sizeof(PacketHeader)];
+    uint32_t first = (uint32_t)(session->ackedFrame + 1);
+    InputHeader header = {
+        .frame = session->frame, .ackFrame = session->remoteFrame, .first = first,
+        .syncFrame = session->syncFrame, .syncHash = session->hashes[session->syncFrame & RING_MASK],
+        .count = (uint16_t)(session->frame - first)
+    };
+    memcpy(body, &header, sizeof(header));
+    unsigned char *c = body + sizeof(header);
+    for (uint32_t frame = first; frame < session->frame; frame++) {
+        SimPaddleInput input = session->localInputs[frame & RING_MASK];
+        *c++ = (uint8_t)(((input.move + 1) & INPUT_MOVE_MASK) | (input.useTarget ? INPUT_USE_TARGET : 0));
+        if (input.useTarget) {
+            memcpy(c, &input.targetY, sizeof(float));
+            c += sizeof(float);
+        }
+    }
+    SendHeader(session, PACKET_INPUT, body, (int)(c - body), now);
+}
+
+static void ReadInput(Rollback *session, const unsigned char *data, int size) {
+    InputHeader header;
+    if (size < (int)sizeof(header)) return;
+    memcpy(&header, data, sizeof(header));
+    const unsigned char *c = data + sizeof(header);
+    const unsigned char *end = data + size;
+
+    for (uint32_t i = 0; i < header.count && c < end; i++) {
+        SimPaddleInput input = { 0 };
+        uint8_t flags = *c++;
+        input.move = (int)(flags & INPUT_MOVE_MASK) - 1;
+        input.useTarget = (flags & INPUT_USE_TARGET) != 0;
+        if (input.useTarget) {
+            if (end - c < (long)sizeof(float)) return;
+            memcpy(&input.targetY, c, sizeof(float));
+            c += sizeof(float);
+        }
+
+        // Inputs repeat across packets and packets arrive out of order, take each step once and in order
+        uint32_t frame = header.first + i;
+        if ((int32_t)frame != session->remoteFrame + 1) continue;
+        session->remoteInputs[frame & RING_MASK] = input;
+        session->remoteFrame = (int32_t)frame;
+        if (frame < session->frame && frame < session->rollbackFrom &&
+            !PaddleInputEqual(input, session->guesses[frame & RING_MASK])) {
+            session->rollbackFrom = frame;
+        }
+    }
+
+    if (header.ackFrame > session->ackedFrame && header.ackFrame < (int32_t)session->frame) {
+        session->ackedFrame = header.ackFrame;
+    }
+    session->remoteAdvantage = (int32_t)header.frame - (header.ackFrame + 1);
+
+    // Both sides hash a confirmed state from the same input, they must agree
+    if (header.syncFrame > session->checkedFrame && header.syncFrame <= session->syncFrame &&
+        session->syncFrame - header.syncFrame < ROLLBACK_RING) {
+        session->checkedFrame = header.syncFrame;
+        session->stats.hashChecks++;
+        if (session->hashes[header.syncFrame & RING_MASK] != header.syncHash) session->stats.desyncs++;
+    }
+}
+
+void RollbackHost(Rollback *session, NetSocket *net) {
+    memset(session, 0, sizeof(*session));
+    session->net = net;
+    session->host = true;
+    session->lastHandshake = -1e9;
+}
+
+void RollbackJoin(Rollback *session, NetSocket *net, NetAddress host) {
+    memset(session, 0, sizeof(*session));
+    session->net = net;
+    session->peer = host;
+    session->hasPeer = true;
+    session->lastHandshake = -1e9;
+}
+
+static void Receive(Rollback *session, double now) {
+    unsigned char packet[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+
+    while ((size = NetReceive(session->net, &from, packet, sizeof(packet), now)) > 0) {
+        PacketHeader header;
+        if (size < (int)sizeof(header)) continue;
+        memcpy(&header, packet, sizeof(header));
+        if (header.magic != PACKET_MAGIC || header.version != PACKET_VERSION) continue;
+        if (session->hasPeer && (from.host != session->peer.host || from.port != session->peer.port)) continue;
+        const unsigned char *body = packet + sizeof(header);
+        int bodySize = size - (int)sizeof(header);
+
+        switch (header.type) {
+            case PACKET_HELLO:
+                if (session->host && !session->hasPeer) {
+                    session->peer = from;
+                    session->hasPeer = true;
+                    session->lastHandshake = -1e9;   // Answer a pending START right away
+                }
+                break;
+            case PACKET_START:
+                if (!session->host && bodySize >= (int)sizeof(RollbackMatch) && (!session->running || header.match != session->match)) {
+                    RollbackMatch setup;
+                    SimState initial;
+                    memcpy(&setup, body, sizeof(setup));
+                    if (!RollbackMatchState(setup, &initial)) break;
+                    session->setup = setup;
+                    Reset(session, &initial, header.match);
+                    session->running = true;
+                    session->newMatch = true;
+                    SendInput(session, now);   // Tells the host we are in
+                }
+                break;
+            case PACKET_INPUT:
+                if (header.match != session->match) break;
+                if (session->host && session->starting) {
+                    session->running = true;
+                    session->starting = false;
+                }
+                if (session->running) ReadInput(session, body, bodySize);
+                break;
+        }
+    }
+
+    if (!session->running && now - session->lastHandshake >= HANDSHAKE_SECONDS) {
+        if (!session->host) {
+            SendHeader(session, PACKET_HELLO, NULL, 0, now);
+        } else if (session->hasPeer && session->starting) {
+            SendHeader(session, PACKET_START, &session->setup, (int)sizeof(RollbackMatch), now);
+        }
+        session->lastHandshake = now;
+    }
+}
+
+bool RollbackPoll(Rollback *session, double now) {
+    Receive(session, now);
+    bool started = session->newMatch;
+    session->newMatch = false;
+    return started;
+}
+
+bool RollbackMatchState(RollbackMatch setup, SimState *state) {
+    bool sized = isfinite(setup.width) && setup.width > 0.0f && isfinite(setup.height) && setup.height > 0.0f &&
+                 isfinite(setup.tickRate) && setup.tickRate > 0.0f;
+    if (!sized || setup.difficulty < EASY || setup.difficulty > HARD) return false;
+    // Online matches use the classic layout
+    SimConfig config = SimDifficultyConfig((Difficulty)setup.difficulty, setup.width, setup.height);
+    config.tickRate = setup.tickRate;
+    SimInit(state, config, setup.seed);
+    return SimStateValid(state);
+}
+
+bool RollbackStart(Rollback *session, RollbackMatch setup, double now) {
+    SimState initial;
+    if (!session->host || !RollbackMatchState(setup, &initial)) return false;
+    session->setup = setup;
+    Reset(session, &initial, (uint16_t)(session->match + 1));
+    session->running = false;
+    session->starting = true;
+    session->lastHandshake = -1e9;
+    Receive(session, now);
+    return true;
+}
+
+bool RollbackAdvance(Rollback *session, SimPaddleInput local, double now) {
+    session->events = 0;
+    Receive(session, now);   // A new match is left for RollbackPoll to report
+    if (!session->running) return false;
+
+    // Go back to the first wrong guess and simulate forward with what is known now.
+    // Events from these steps were already reported the first time round.
+    if (session->rollbackFrom < session->frame) {
+        uint32_t from = session->rollbackFrom;
+        SimState state = session->states[from & RING_MASK];
+        for (uint32_t frame = from; frame < session->frame; frame++) {
+            SimPaddleInput guess = Guess(session, frame);
+            session->guesses[frame & RING_MASK] = guess;
+            SimStep(&state, StepInput(session, frame, guess));
+            session->states[(frame + 1) & RING_MASK] = state;
+        }
+        session->state = state;
+        uint32_t depth = session->frame - from;
+        session->stats.rollbacks++;
+        session->stats.resimulated += depth;
+        if (depth > session->stats.deepest) session->stats.deepest = depth;
+    }
+    session->rollbackFrom = UINT32_MAX;
+
+    // States before the newest real remote input are final now
+    uint32_t confirmed = (uint32_t)(session->remoteFrame + 1);
+    if (confirmed > session->frame) confirmed = session->frame;
+    while (session->syncFrame < confirmed) {
+        session->syncFrame++;
+        session->hashes[session->syncFrame & RING_MASK] = SimHash(&session->states[session->syncFrame & RING_MASK]);
+    }
+
+    // Hold back when too far ahead, and now and then skip a step when the other peer is
+    // slower, so neither side ends up always guessing
+    int32_t localAdvantage = (int32_t)session->frame - (session->remoteFrame + 1);
+    session->advantage += ((float)(localAdvantage - session->remoteAdvantage) - session->advantage) * ADVANTAGE_SMOOTHING;
+    bool advance = true;
+    if (localAdvantage >= ROLLBACK_MAX_FRAMES || (int32_t)session->frame - session->ackedFrame >= ROLLBACK_RING - 1) {
+        session->stats.stalls++;
+        advance = false;
+    } else if (session->waitCooldown == 0 && session->advantage >= 2.0f) {
+        // Half the difference is how far this peer is ahead in time
+        session->stats.waits++;
+        session->waitCooldown = WAIT_COOLDOWN;
+        session->advantage -= 2.0f;
+        advance = false;
+    } else if (session->waitCooldown > 0) {
+        session->waitCooldown--;
+    }
+
+    if (advance) {
+        uint32_t frame = session->frame;
+        SimPaddleInput guess = Guess(session, frame);
+        session->localInputs[frame & RING_MASK] = local;
+        session->guesses[frame & RING_MASK] = guess;
+        session->events = SimStep(&session->state, StepInput(session, frame, guess));
+        session->frame++;
+        session->states[session->frame & RING_MASK] = session->state;
+    }
+    SendInput(session, now);
+    return advance;
+}
+
+const SimState *RollbackConfirmed(const Rollback *session) {
+    return &session->states[session->syncFrame & RING_MASK];
+}
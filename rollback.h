@@ -0,0 +1,97 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "sim.h"
+#include "net.h"
+
+// Rollback netcode for online PVP. Each peer steps the match as soon as its own
+// input is in, guessing that the other paddle keeps doing what it last did. When
+// the real input arrives and differs, the peer restores the state from before
+// that step and simulates forward again, so local input is never delayed.
+//
+// The host is Lava (left paddle), the peer that joins is Ice (right paddle).
+// Every input packet repeats all the input the other side has not acknowledged,
+// so a lost packet only costs time, and carries the hash of the newest state both
+// sides agree on so a desync is caught the moment it happens.
+
+#define ROLLBACK_MAX_FRAMES 32   // Steps one peer may run ahead of the other's input
+#define ROLLBACK_RING 128        // Steps of state and input kept, power of two
+
+typedef struct RollbackStats {
+    uint32_t rollbacks;          // Corrections after a wrong guess
+    uint32_t resimulated;        // Steps run again by those corrections
+    uint32_t deepest;            // Most steps undone at once
+    uint32_t stalls;             // Steps held back waiting for the other peer
+    uint32_t waits;              // Steps skipped to let a slower peer catch up
+    uint32_t hashChecks;         // States compared with the other peer
+    uint32_t desyncs;            // Comparisons that differed
+} RollbackStats;
+
+// Everything the first state of an online match is built from. START carries
+// this instead of a state, so a peer can't hand the other one a state SimStep
+// would choke on.
+typedef struct RollbackMatch {
+    uint64_t seed;
+    int32_t difficulty;          // Difficulty preset
+    float width;                 // Field size
+    float height;
+    float tickRate;
+} RollbackMatch;
+
+typedef struct Rollback {
+    NetSocket *net;
+    NetAddress peer;
+    bool hasPeer;
+    bool host;
+    bool starting;               // Host sent START and waits for the first input back
+    bool running;                // Both peers are in the same match
+    bool newMatch;               // Joined a match RollbackPoll has not reported yet
+    uint16_t match;              // Counts up with every match the host starts
+    RollbackMatch setup;         // What the current match was started from
+    double lastHandshake;
+
+    SimState state;              // Newest state, partly guessed
+    unsigned int events;         // SimEvent flags from the last RollbackAdvance
+    uint32_t frame;              // Steps taken
+    int32_t remoteFrame;         // Newest step with the other peer's input, -1 for none
+    int32_t ackedFrame;          // Newest local input the other peer has, -1 for none
+    uint32_t syncFrame;          // States up to here used real input only
+    uint32_t checkedFrame;       // Newest state compared with the other peer
+    uint32_t rollbackFrom;       // Earliest step simulated with a wrong guess
+    int32_t remoteAdvantage;     // How far the other peer runs ahead of our input
+    float advantage;             // Smoothed local minus remote advantage, in steps
+    uint32_t waitCooldown;
+
+    SimState states[ROLLBACK_RING];              // State before each step
+    SimPaddleInput localInputs[ROLLBACK_RING];
+    SimPaddleInput remoteInputs[ROLLBACK_RING];
+    SimPaddleInput guesses[ROLLBACK_RING];       // Remote input each step was last simulated with
+    uint64_t hashes[ROLLBACK_RING];              // SimHash of each confirmed state
+    RollbackStats stats;
+} Rollback;
+
+// Host side: wait for a peer, RollbackStart sends it each new match
+void RollbackHost(Rollback *session, NetSocket *net);
+
+// Joining side: say hello to the host until it starts a match
+void RollbackJoin(Rollback *session, NetSocket *net, NetAddress host);
+
+// Host only, start a match once the peer is there. Returns false, and starts
+// nothing, if the setup does not give a valid state.
+bool RollbackStart(Rollback *session, RollbackMatch setup, double now);
+
+// The first state of a match, the way both peers build it. False if the setup is invalid.
+bool RollbackMatchState(RollbackMatch setup, SimState *state);
+
+// Read packets and keep the handshake going. Returns true when the joining
+// side has just been put into a new match.
+bool RollbackPoll(Rollback *session, double now);
+
+// Correct any wrong guesses, then take one step with the local paddle's input.
+// Returns false when the step has to wait for the other peer.
+bool RollbackAdvance(Rollback *session, SimPaddleInput local, double now);
+
+// Newest state both peers are certain of, use it to decide the match
+const SimState *RollbackConfirmed(const Rollback *session);
+
+#endif // ROLLBACK_H
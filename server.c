@@ -0,0 +1,631 @@
+// recvmmsg, sendmmsg and SOCK_NONBLOCK are Linux extensions
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include "server.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIENT_TABLE_SIZE (2 * SERVER_MAX_CLIENTS)
+#define FINAL_STATES 5                    // Sent after a match ends, in case some are lost
+#define BATCH 64                          // Packets per recvmmsg / sendmmsg call
+#define PACKET_SIZE 512
+#define TABLE_EMPTY -1
+#define TABLE_REMOVED -2                  // Tombstone, keeps probe chains through a reclaimed client intact
+#define SWEEP_CLIENTS 64                  // Clients checked for reclaiming per tick
+
+ServerConfig ServerDefaultConfig(void) {
+    ServerConfig config = { 0 };
+    config.port = 7777;
+    config.workers = 0;                   // One per core
+    config.tickRate = SIM_DEFAULT_TICK_RATE;
+    config.sendInterval = 2;
+    config.soloSeconds = 1.0;
+    config.idleSeconds = 5.0;
+    return config;
+}
+
+void SnapshotCapture(Snapshot *snapshot, const SimState *state) {
+    uint32_t *f = snapshot->fields;
+    memset(snapshot, 0, sizeof(*snapshot));
+    f[FIELD_TICK] = state->tick;
+    memcpy(&f[FIELD_BALL_X], &state->ballPosition.x, 4);
+    memcpy(&f[FIELD_BALL_Y], &state->ballPosition.y, 4);
+    memcpy(&f[FIELD_BALL_SPEED_X], &state->ballSpeed.x, 4);
+    memcpy(&f[FIELD_BALL_SPEED_Y], &state->ballSpeed.y, 4);
+    memcpy(&f[FIELD_LEFT_Y], &state->leftPaddle.y, 4);
+    memcpy(&f[FIELD_RIGHT_Y], &state->rightPaddle.y, 4);
+    memcpy(&f[FIELD_PADDLE_HEIGHT], &state->config.paddleHeight, 4);
+    f[FIELD_LEFT_SCORE] = (uint32_t)state->leftScore;
+    f[FIELD_RIGHT_SCORE] = (uint32_t)state->rightScore;
+    f[FIELD_WIN_SCORE] = (uint32_t)state->config.winScore;
+    f[FIELD_WINNER] = (uint32_t)state->winner;
+    f[FIELD_OBSTACLE_COUNT] = (uint32_t)state->obstacleCount;
+    for (int i = 0; i < state->obstacleCount; i++) memcpy(&f[FIELD_OBSTACLES + 4 * i], &state->obstacles[i], 16);
+}
+
+uint32_t SnapshotChecksum(const Snapshot *snapshot) {
+    uint32_t hash = 2166136261u;
+    const unsigned char *bytes = (const unsigned char *)snapshot->fields;
+    for (size_t i = 0; i < sizeof(snapshot->fields); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Body: base tick, mask of fields that differ from the base, those fields, checksum of the whole state
+int SnapshotEncode(unsigned char *out, const Snapshot *base, const Snapshot *current) {
+    uint32_t baseTick = base ? base->fields[FIELD_TICK] : SERVER_NO_BASE;
+    uint32_t mask = 0;
+    unsigned char *c = out + 8;
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        if (base == NULL ? current->fields[i] != 0 : current->fields[i] != base->fields[i]) {
+            mask |= 1u << i;
+            memcpy(c, &current->fields[i], 4);
+            c += 4;
+        }
+    }
+    uint32_t checksum = SnapshotChecksum(current);
+    memcpy(out, &baseTick, 4);
+    memcpy(out + 4, &mask, 4);
+    memcpy(c, &checksum, 4);
+    return (int)(c + 4 - out);
+}
+
+bool SnapshotBaseTick(const unsigned char *data, int size, uint32_t *tick) {
+    if (size < 12) return false;
+    memcpy(tick, data, 4);
+    return true;
+}
+
+bool SnapshotDecode(const unsigned char *data, int size, const Snapshot *base, Snapshot *current) {
+    uint32_t mask, checksum;
+    if (size < 12) return false;
+    memcpy(&mask, data + 4, 4);
+    const unsigned char *c = data + 8;
+    const unsigned char *end = data + size - 4;
+
+    if (base != NULL) *current = *base;
+    else memset(current, 0, sizeof(*current));
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        if (!(mask & (1u << i))) continue;
+        if (end - c < 4) return false;
+        memcpy(&current->fields[i], c, 4);
+        c += 4;
+    }
+    memcpy(&checksum, end, 4);
+    return c == end && checksum == SnapshotChecksum(current);
+}
+
+double ServerTickPercentile(const ServerStats *stats, double percentile) {
+    if (stats->ticks == 0) return 0.0;
+    uint64_t wanted = (uint64_t)(percentile * (double)stats->ticks);
+    uint64_t seen = 0;
+    for (int i = 0; i < SERVER_TICK_BUCKETS; i++) {
+        seen += stats->tickHistogram[i];
+        if (seen > wanted) return (i + 1) * 1e-6;
+    }
+    return SERVER_TICK_BUCKETS * 1e-6;
+}
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct ServerClient {
+    bool used;                    // false on the free list
+    uint32_t host;
+    uint16_t port;
+    int match;                    // Index into the worker's matches, -1 when not playing
+    SimSide side;
+    int move;
+    uint32_t ackTick;             // Newest state the client decoded, the base for its next delta
+    Difficulty difficulty;
+    double joinTime;
+    double lastHeard;
+} ServerClient;
+
+typedef struct ServerMatch {
+    SimState state;
+    int players[2];               // Client on the left and right, -1 for the AI
+    int listIndex;                // Position in the worker's active list
+    uint16_t id;
+    int finalStates;              // Still to send once the match has a winner
+    Snapshot history[SERVER_SNAPSHOT_HISTORY];
+} ServerMatch;
+
+struct ServerWorker {
+    GameServer *server;
+    pthread_t thread;
+    bool running;
+    int socket;
+    int epoll;
+    int timer;
+    int stop;
+
+    ServerClient *clients;
+    int clientCount;              // Slots ever handed out, the free list holds the reclaimed ones below it
+    int *freeClients;
+    int freeClientCount;
+    int sweep;                    // Next client to check for reclaiming
+    int32_t *table;               // Address hash to client, open addressing with tombstones
+    int tombstones;
+    ServerMatch *matches;
+    int *freeMatches;
+    int freeCount;
+    int *active;                  // Matches being played, dense so ticking walks an array
+    int activeCount;
+    int waiting[3];               // Client waiting for an opponent, per difficulty
+    uint16_t nextId;
+    uint64_t seed;
+
+    // Outgoing packets of one tick, flushed with a single sendmmsg
+    struct mmsghdr out[BATCH];
+    struct iovec outVectors[BATCH];
+    struct sockaddr_in outAddresses[BATCH];
+    unsigned char outData[BATCH][PACKET_SIZE];
+    int outCount;
+    unsigned char inData[BATCH][PACKET_SIZE];
+
+    ServerStats stats;
+};
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t AddressHash(uint32_t host, uint16_t port) {
+    uint64_t x = ((uint64_t)host << 16 | port) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(x >> 40);
+}
+
+// Client for an address, added on first contact. -1 when the worker is full.
+static int FindClient(ServerWorker *worker, uint32_t host, uint16_t port, bool add) {
+    uint32_t slot = AddressHash(host, port) & (CLIENT_TABLE_SIZE - 1);
+    int64_t reuse = -1;           // First tombstone on the way, a new client goes there
+    bool empty = false;
+    for (int probes = 0; probes < CLIENT_TABLE_SIZE; probes++) {
+        int32_t index = worker->table[slot];
+        if (index == TABLE_EMPTY) {
+            empty = true;
+            break;
+        }
+        if (index == TABLE_REMOVED) {
+            if (reuse < 0) reuse = slot;
+        } else if (worker->clients[index].host == host && worker->clients[index].port == port) {
+            return index;
+        }
+        slot = (slot + 1) & (CLIENT_TABLE_SIZE - 1);
+    }
+    if (!add) return -1;
+
+    int index = -1;
+    if (empty || reuse >= 0) {
+        if (worker->freeClientCount > 0) index = worker->freeClients[--worker->freeClientCount];
+        else if (worker->clientCount < SERVER_MAX_CLIENTS) index = worker->clientCount++;
+    }
+    if (index < 0) {
+        worker->stats.joinsRefused++;
+        return -1;
+    }
+    worker->clients[index] = (ServerClient){ .used = true, .host = host, .port = port, .match = -1, .ackTick = SERVER_NO_BASE };
+    if (reuse >= 0) {
+        slot = (uint32_t)reuse;
+        worker->tombstones--;
+    }
+    worker->table[slot] = index;
+    return index;
+}
+
+// Put every live client back into a table without tombstones
+static void RebuildTable(ServerWorker *worker) {
+    memset(worker->table, 0xFF, sizeof(int32_t) * CLIENT_TABLE_SIZE);
+    for (int index = 0; index < worker->clientCount; index++) {
+        const ServerClient *client = &worker->clients[index];
+        if (!client->used) continue;
+        uint32_t slot = AddressHash(client->host, client->port) & (CLIENT_TABLE_SIZE - 1);
+        while (worker->table[slot] != TABLE_EMPTY) slot = (slot + 1) & (CLIENT_TABLE_SIZE - 1);
+        worker->table[slot] = index;
+    }
+    worker->tombstones = 0;
+}
+
+// Forget a client outside any match, its slot and index go to the next new address
+static void RemoveClient(ServerWorker *worker, int index) {
+    ServerClient *client = &worker->clients[index];
+    uint32_t slot = AddressHash(client->host, client->port) & (CLIENT_TABLE_SIZE - 1);
+    while (worker->table[slot] != index) slot = (slot + 1) & (CLIENT_TABLE_SIZE - 1);
+    worker->table[slot] = TABLE_REMOVED;
+    worker->tombstones++;
+    client->used = false;
+    worker->freeClients[worker->freeClientCount++] = index;
+    worker->stats.clientsReclaimed++;
+    // Tombstones only go away when reused, clear them out before they make lookups long
+    if (worker->tombstones > CLIENT_TABLE_SIZE / 4) RebuildTable(worker);
+}
+
+static void Flush(ServerWorker *worker) {
+    int sent = 0;
+    while (sent < worker->outCount) {
+        int result = sendmmsg(worker->socket, worker->out + sent, (unsigned int)(worker->outCount - sent), 0);
+        if (result <= 0) break;   // Socket buffer full, the clients will get the next state
+        sent += result;
+    }
+    worker->outCount = 0;
+}
+
+static void SendState(ServerWorker *worker, ServerMatch *match, int side, const Snapshot *current) {
+    ServerClient *client = &worker->clients[match->players[side]];
+    if (worker->outCount == BATCH) Flush(worker);
+    int n = worker->outCount++;
+
+    // Delta against the newest state the client has, if it is still in the history
+    const Snapshot *base = NULL;
+    if (client->ackTick != SERVER_NO_BASE) {
+        for (int i = 0; i < SERVER_SNAPSHOT_HISTORY; i++) {
+            if (match->history[i].fields[FIELD_TICK] == client->ackTick) {
+                base = &match->history[i];
+                break;
+            }
+        }
+    }
+
+    ServerPacketHeader header = { SERVER_MAGIC, SERVER_STATE, (uint8_t)client->side, match->id };
+    unsigned char *data = worker->outData[n];
+    memcpy(data, &header, sizeof(header));
+    int size = (int)sizeof(header) + SnapshotEncode(data + sizeof(header), base, current);
+
+    worker->outAddresses[n] = (struct sockaddr_in){ .sin_family = AF_INET, .sin_port = htons(client->port),
+                                                    .sin_addr.s_addr = htonl(client->host) };
+    worker->outVectors[n] = (struct iovec){ data, (size_t)size };
+    worker->out[n] = (struct mmsghdr){ .msg_hdr = { .msg_name = &worker->outAddresses[n],
+                                                    .msg_namelen = sizeof(struct sockaddr_in),
+                                                    .msg_iov = &worker->outVectors[n], .msg_iovlen = 1 } };
+    worker->stats.packetsOut++;
+    worker->stats.bytesOut += (uint64_t)size;
+    if (base) worker->stats.deltaStates++;
+    else worker->stats.fullStates++;
+}
+
+// False when every match slot is taken, the players stay where they were and keep asking
+static bool StartMatch(ServerWorker *worker, int left, int right, Difficulty difficulty) {
+    if (worker->freeCount == 0) return false;
+    int index = worker->freeMatches[--worker->freeCount];
+    ServerMatch *match = &worker->matches[index];
+    const ServerConfig *config = &worker->server->config;
+
+    SimConfig rules = SimDifficultyConfig(difficulty, 1280, 800);
+    rules.tickRate = config->tickRate;
+    worker->seed = worker->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    SimInit(&match->state, rules, worker->seed);
+    match->players[0] = left;
+    match->players[1] = right;
+    match->id = ++worker->nextId;
+    match->finalStates = FINAL_STATES;
+    for (int i = 0; i < SERVER_SNAPSHOT_HISTORY; i++) match->history[i].fields[FIELD_TICK] = SERVER_NO_BASE;
+    match->listIndex = worker->activeCount;
+    worker->active[worker->activeCount++] = index;
+
+    for (int side = 0; side < 2; side++) {
+        if (match->players[side] < 0) continue;
+        ServerClient *client = &worker->clients[match->players[side]];
+        client->match = index;
+        client->side = side == 0 ? SIDE_LAVA : SIDE_ICE;
+        client->move = 0;
+        client->ackTick = SERVER_NO_BASE;
+    }
+    worker->stats.matchesStarted++;
+    if ((uint32_t)worker->activeCount > worker->stats.peakMatches) worker->stats.peakMatches = (uint32_t)worker->activeCount;
+    return true;
+}
+
+static void EndMatch(ServerWorker *worker, int index) {
+    ServerMatch *match = &worker->matches[index];
+    for (int side = 0; side < 2; side++) {
+        if (match->players[side] >= 0) worker->clients[match->players[side]].match = -1;
+    }
+    int last = worker->active[--worker->activeCount];
+    worker->active[match->listIndex] = last;
+    worker->matches[last].listIndex = match->listIndex;
+    worker->freeMatches[worker->freeCount++] = index;
+    worker->stats.matchesFinished++;
+}
+
+static void HandlePacket(ServerWorker *worker, const unsigned char *data, int size, uint32_t host, uint16_t port, double now) {
+    ServerPacketHeader header;
+    if (size < (int)sizeof(header)) return;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SERVER_MAGIC) return;
+
+    int index = FindClient(worker, host, port, header.type == SERVER_JOIN);
+    if (index < 0) return;
+    ServerClient *client = &worker->clients[index];
+    client->lastHeard = now;
+
+    if (header.type == SERVER_JOIN && client->match < 0) {
+        Difficulty difficulty = header.side <= HARD ? (Difficulty)header.side : MEDIUM;
+        int *waiting = &worker->waiting[difficulty];
+        if (*waiting == index) return;   // Resent JOIN
+        client->difficulty = difficulty;
+        client->joinTime = now;
+        if (*waiting >= 0) {
+            if (StartMatch(worker, *waiting, index, difficulty)) *waiting = -1;
+        } else {
+            *waiting = index;
+        }
+    } else if (header.type == SERVER_INPUT && client->match >= 0 && size >= (int)(sizeof(header) + sizeof(ServerInput))) {
+        // Input for an earlier match can still be in flight, its ack would name the wrong base
+        if (worker->matches[client->match].id != header.match) return;
+        ServerInput input;
+        memcpy(&input, data + sizeof(header), sizeof(input));
+        client->move = input.move < 0 ? -1 : (input.move > 0 ? 1 : 0);
+        client->ackTick = input.ackTick;
+    }
+}
+
+static void Receive(ServerWorker *worker, double now) {
+    struct mmsghdr messages[BATCH];
+    struct iovec vectors[BATCH];
+    struct sockaddr_in addresses[BATCH];
+
+    for (;;) {
+        for (int i = 0; i < BATCH; i++) {
+            vectors[i] = (struct iovec){ worker->inData[i], PACKET_SIZE };
+            messages[i] = (struct mmsghdr){ .msg_hdr = { .msg_name = &addresses[i], .msg_namelen = sizeof(addresses[i]),
+                                                         .msg_iov = &vectors[i], .msg_iovlen = 1 } };
+        }
+        int count = recvmmsg(worker->socket, messages, BATCH, MSG_DONTWAIT, NULL);
+        if (count <= 0) break;
+        for (int i = 0; i < count; i++) {
+            HandlePacket(worker, worker->inData[i], (int)messages[i].msg_len,
+                         ntohl(addresses[i].sin_addr.s_addr), ntohs(addresses[i].sin_port), now);
+        }
+        worker->stats.packetsIn += (uint64_t)count;
+        if (count < BATCH) break;
+    }
+}
+
+static void Tick(ServerWorker *worker, double now) {
+    const ServerConfig *config = &worker->server->config;
+
+    // Nobody else showed up, play the computer
+    for (int d = 0; d < 3; d++) {
+        int waiting = worker->waiting[d];
+        if (waiting >= 0 && now - worker->clients[waiting].joinTime >= config->soloSeconds) {
+            if (StartMatch(worker, waiting, -1, (Difficulty)d)) worker->waiting[d] = -1;
+        }
+    }
+
+    // Reclaim a few clients each tick that went quiet outside a match, ports change all the
+    // time (NAT, restarts), so without this the table fills up and newcomers get turned away
+    for (int n = 0; n < SWEEP_CLIENTS && n < worker->clientCount; n++) {
+        if (worker->sweep >= worker->clientCount) worker->sweep = 0;
+        int index = worker->sweep++;
+        const ServerClient *client = &worker->clients[index];
+        bool waiting = worker->waiting[0] == index || worker->waiting[1] == index || worker->waiting[2] == index;
+        if (client->used && client->match < 0 && !waiting && now - client->lastHeard > config->idleSeconds) {
+            RemoveClient(worker, index);
+        }
+    }
+
+    for (int i = 0; i < worker->activeCount; i++) {
+        int index = worker->active[i];
+        ServerMatch *match = &worker->matches[index];
+        SimState *state = &match->state;
+
+        SimInput input = { 0 };
+        SimPaddleInput *paddles[2] = { &input.left, &input.right };
+        bool idle = false;
+        for (int side = 0; side < 2; side++) {
+            if (match->players[side] < 0) {
+                paddles[side]->ai = true;
+            } else {
+                const ServerClient *client = &worker->clients[match->players[side]];
+                paddles[side]->move = client->move;
+                idle |= now - client->lastHeard > config->idleSeconds;
+            }
+        }
+        if (idle) {
+            EndMatch(worker, index);
+            i--;   // The last active match moved into this slot
+            continue;
+        }
+        if (state->winner == SIDE_NONE) SimStep(state, input);
+
+        bool ended = state->winner != SIDE_NONE;
+        if (state->tick % (uint32_t)config->sendInterval == 0 || ended) {
+            Snapshot *current = &match->history[(state->tick / (uint32_t)config->sendInterval) & (SERVER_SNAPSHOT_HISTORY - 1)];
+            SnapshotCapture(current, state);
+            for (int side = 0; side < 2; side++) {
+                if (match->players[side] >= 0) SendState(worker, match, side, current);
+            }
+        }
+        if (ended && --match->finalStates <= 0) {
+            EndMatch(worker, index);
+            i--;
+        }
+    }
+    Flush(worker);
+}
+
+static void *WorkerThread(void *arg) {
+    ServerWorker *worker = (ServerWorker *)arg;
+    struct epoll_event events[4];
+    double start = Now();
+
+    for (;;) {
+        int count = epoll_wait(worker->epoll, events, 4, -1);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+        bool stop = false;
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            double begin = Now();
+            if (fd == worker->stop) {
+                stop = true;
+            } else if (fd == worker->socket) {
+                Receive(worker, begin);
+            } else if (fd == worker->timer) {
+                uint64_t expirations = 0;
+                if (read(worker->timer, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+                if (expirations > 1) worker->stats.overruns += expirations - 1;
+
+                // Catch up a little after a long tick, beyond that the matches slow down
+                for (uint64_t t = 0; t < expirations && t < 4; t++) {
+                    double tickStart = Now();
+                    Tick(worker, tickStart);
+                    uint64_t micros = (uint64_t)((Now() - tickStart) * 1e6);
+                    worker->stats.tickHistogram[micros < SERVER_TICK_BUCKETS ? micros : SERVER_TICK_BUCKETS - 1]++;
+                    worker->stats.ticks++;
+                }
+            }
+            worker->stats.busySeconds += Now() - begin;
+        }
+        if (stop) break;
+    }
+    worker->stats.wallSeconds = Now() - start;
+    worker->stats.activeMatches = (uint32_t)worker->activeCount;
+    return NULL;
+}
+
+static void FreeWorker(ServerWorker *worker) {
+    if (worker->socket >= 0) close(worker->socket);
+    if (worker->epoll >= 0) close(worker->epoll);
+    if (worker->timer >= 0) close(worker->timer);
+    if (worker->stop >= 0) close(worker->stop);
+    free(worker->clients);
+    free(worker->freeClients);
+    free(worker->table);
+    free(worker->matches);
+    free(worker->freeMatches);
+    free(worker->active);
+}
+
+static bool InitWorker(ServerWorker *worker, GameServer *server, int number) {
+    const ServerConfig *config = &server->config;
+    worker->server = server;
+    worker->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    worker->epoll = epoll_create1(0);
+    worker->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    worker->stop = eventfd(0, EFD_NONBLOCK);
+    worker->clients = malloc(sizeof(ServerClient) * SERVER_MAX_CLIENTS);
+    worker->freeClients = malloc(sizeof(int) * SERVER_MAX_CLIENTS);
+    worker->table = malloc(sizeof(int32_t) * CLIENT_TABLE_SIZE);
+    worker->matches = calloc(SERVER_MAX_MATCHES, sizeof(ServerMatch));   // Pages only get touched as matches start
+    worker->freeMatches = malloc(sizeof(int) * SERVER_MAX_MATCHES);
+    worker->active = malloc(sizeof(int) * SERVER_MAX_MATCHES);
+    if (worker->socket < 0 || worker->epoll < 0 || worker->timer < 0 || worker->stop < 0 || !worker->clients ||
+        !worker->freeClients || !worker->table || !worker->matches || !worker->freeMatches || !worker->active) {
+        return false;
+    }
+
+    memset(worker->table, 0xFF, sizeof(int32_t) * CLIENT_TABLE_SIZE);
+    for (int i = 0; i < SERVER_MAX_MATCHES; i++) worker->freeMatches[i] = SERVER_MAX_MATCHES - 1 - i;
+    worker->freeCount = SERVER_MAX_MATCHES;
+    worker->waiting[0] = worker->waiting[1] = worker->waiting[2] = -1;
+    worker->seed = 0x853C49E6748FEA9BULL ^ (uint64_t)number;
+
+    // Every worker binds the same port, the kernel hashes each client address to one of them
+    int one = 1;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(config->port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (setsockopt(worker->socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0 ||
+        bind(worker->socket, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        return false;
+    }
+
+    long nanos = (long)(1e9 / config->tickRate);
+    struct itimerspec interval = { { nanos / 1000000000L, nanos % 1000000000L }, { nanos / 1000000000L, nanos % 1000000000L } };
+    struct epoll_event event = { .events = EPOLLIN };
+    bool ok = timerfd_settime(worker->timer, 0, &interval, NULL) == 0;
+    int fds[3] = { worker->socket, worker->timer, worker->stop };
+    for (int i = 0; ok && i < 3; i++) {
+        event.data.fd = fds[i];
+        ok = epoll_ctl(worker->epoll, EPOLL_CTL_ADD, fds[i], &event) == 0;
+    }
+    return ok;
+}
+
+bool ServerStart(GameServer *server, ServerConfig config) {
+    memset(server, 0, sizeof(*server));
+    if (config.workers <= 0) config.workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (config.workers < 1) config.workers = 1;
+    if (config.workers > SERVER_MAX_WORKERS) config.workers = SERVER_MAX_WORKERS;
+    if (config.sendInterval < 1) config.sendInterval = 1;
+    server->config = config;
+    server->workers = calloc((size_t)config.workers, sizeof(ServerWorker));
+    if (server->workers == NULL) return false;
+
+    bool ok = true;
+    for (int i = 0; i < config.workers; i++) {
+        ServerWorker *worker = &server->workers[i];
+        worker->socket = worker->epoll = worker->timer = worker->stop = -1;
+        server->workerCount++;
+        ok = ok && InitWorker(worker, server, i);
+    }
+    for (int i = 0; ok && i < config.workers; i++) {
+        ServerWorker *worker = &server->workers[i];
+        worker->running = pthread_create(&worker->thread, NULL, WorkerThread, worker) == 0;
+        ok = worker->running;
+    }
+    if (!ok) ServerStop(server, NULL);
+    return ok;
+}
+
+void ServerStop(GameServer *server, ServerStats *stats) {
+    if (stats != NULL) memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < server->workerCount; i++) {
+        ServerWorker *worker = &server->workers[i];
+        if (worker->running) {
+            uint64_t one = 1;
+            if (write(worker->stop, &one, sizeof(one)) == sizeof(one)) pthread_join(worker->thread, NULL);
+        }
+        if (stats != NULL) {
+            const ServerStats *w = &worker->stats;
+            stats->ticks += w->ticks;
+            stats->overruns += w->overruns;
+            stats->busySeconds += w->busySeconds;
+            if (w->wallSeconds > stats->wallSeconds) stats->wallSeconds = w->wallSeconds;
+            stats->packetsIn += w->packetsIn;
+            stats->packetsOut += w->packetsOut;
+            stats->bytesOut += w->bytesOut;
+            stats->fullStates += w->fullStates;
+            stats->deltaStates += w->deltaStates;
+            stats->matchesStarted += w->matchesStarted;
+            stats->matchesFinished += w->matchesFinished;
+            stats->activeMatches += w->activeMatches;
+            stats->peakMatches += w->peakMatches;
+            stats->clientsReclaimed += w->clientsReclaimed;
+            stats->joinsRefused += w->joinsRefused;
+            for (int b = 0; b < SERVER_TICK_BUCKETS; b++) stats->tickHistogram[b] += w->tickHistogram[b];
+        }
+        FreeWorker(worker);
+    }
+    free(server->workers);
+    memset(server, 0, sizeof(*server));
+}
+
+#else
+
+bool ServerStart(GameServer *server, ServerConfig config) {
+    memset(server, 0, sizeof(*server));
+    server->config = config;
+    return false;   // The worker loop is built on epoll
+}
+
+void ServerStop(GameServer *server, ServerStats *stats) {
+    if (stats != NULL) memset(stats, 0, sizeof(*stats));
+    memset(server, 0, sizeof(*server));
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "sim.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Authoritative match server. One process runs many independent matches with
+// the normal rules (difficulty presets, winScore, obstacles). Worker threads each
+// own a UDP socket on the shared port (SO_REUSEPORT, so the kernel spreads
+// clients across them), an epoll loop and a timer, and every match lives on the
+// worker its players reached. Each tick a worker steps all its matches and sends
+// every player the state as a delta against the last one it acknowledged.
+//
+// Packets (host byte order, see ServerPacketHeader):
+//   JOIN    client -> server, difficulty in the side byte, resent until a STATE arrives
+//   INPUT   client -> server, move (-1, 0, 1) and the newest tick it has decoded
+//   STATE   server -> client, base tick, field mask, changed fields, checksum
+
+#define SERVER_MAGIC 0x56525350u         // "PSRV"
+#define SERVER_MAX_WORKERS 64
+#define SERVER_MAX_CLIENTS 4096          // Per worker at once, quiet ones outside a match are reclaimed
+#define SERVER_MAX_MATCHES 2048          // Per worker
+#define SERVER_SNAPSHOT_HISTORY 64       // Sent states kept per match as delta bases, power of two
+#define SERVER_TICK_BUCKETS 20000        // Tick time histogram, 1 us per bucket
+#define SERVER_NO_BASE 0xFFFFFFFFu
+
+// Everything a client sees of a match, one 32-bit word per field so deltas are a mask and a list
+typedef enum SnapshotField {
+    FIELD_TICK,
+    FIELD_BALL_X, FIELD_BALL_Y, FIELD_BALL_SPEED_X, FIELD_BALL_SPEED_Y,
+    FIELD_LEFT_Y, FIELD_RIGHT_Y, FIELD_PADDLE_HEIGHT,
+    FIELD_LEFT_SCORE, FIELD_RIGHT_SCORE, FIELD_WIN_SCORE, FIELD_WINNER,
+    FIELD_OBSTACLE_COUNT,
+    FIELD_OBSTACLES,                     // x, y, width, height for each of SIM_MAX_OBSTACLES
+    SNAPSHOT_FIELDS = FIELD_OBSTACLES + 4 * SIM_MAX_OBSTACLES
+} SnapshotField;
+
+typedef struct Snapshot {
+    uint32_t fields[SNAPSHOT_FIELDS];
+} Snapshot;
+
+typedef enum ServerPacketType {
+    SERVER_JOIN,
+    SERVER_INPUT,
+    SERVER_STATE
+} ServerPacketType;
+
+typedef struct ServerPacketHeader {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t side;                        // SimSide of the receiving player, difficulty for JOIN
+    uint16_t match;
+} ServerPacketHeader;
+
+typedef struct ServerInput {
+    uint32_t ackTick;                    // SERVER_NO_BASE until the first state is decoded
+    int8_t move;
+    uint8_t reserved[3];
+} ServerInput;
+
+typedef struct ServerConfig {
+    uint16_t port;
+    int workers;
+    float tickRate;                      // Simulation steps per second
+    int sendInterval;                    // Steps between two state packets
+    double soloSeconds;                  // Wait for an opponent this long, then play the AI
+    double idleSeconds;                  // Drop a match when a player is silent this long
+} ServerConfig;
+
+typedef struct ServerStats {
+    uint64_t ticks;
+    uint64_t overruns;                   // Timer expirations missed because a tick ran long
+    double busySeconds;                  // Time spent ticking and handling packets
+    double wallSeconds;
+    uint64_t packetsIn;
+    uint64_t packetsOut;
+    uint64_t bytesOut;
+    uint64_t fullStates;                 // Sent without a base
+    uint64_t deltaStates;
+    uint64_t matchesStarted;
+    uint64_t matchesFinished;
+    uint64_t clientsReclaimed;           // Quiet clients outside a match that were forgotten
+    uint64_t joinsRefused;               // JOINs from new addresses turned away, the worker had no free client
+    uint32_t activeMatches;
+    uint32_t peakMatches;
+    uint32_t tickHistogram[SERVER_TICK_BUCKETS];   // Microseconds per tick, last bucket catches the rest
+} ServerStats;
+
+typedef struct ServerWorker ServerWorker;
+
+typedef struct GameServer {
+    ServerConfig config;
+    ServerWorker *workers;
+    int workerCount;
+} GameServer;
+
+// Fill in defaults: port 7777, one worker per core, 120 Hz, states at 60 Hz
+ServerConfig ServerDefaultConfig(void);
+
+// Bind the workers and start ticking. Linux only (epoll), returns false elsewhere.
+bool ServerStart(GameServer *server, ServerConfig config);
+
+// Stop the workers and free everything, stats may be NULL
+void ServerStop(GameServer *server, ServerStats *stats);
+
+// Shared with clients: capture, delta encode and decode match state
+void SnapshotCapture(Snapshot *snapshot, const SimState *state);
+int SnapshotEncode(unsigned char *out, const Snapshot *base, const Snapshot *current);
+bool SnapshotBaseTick(const unsigned char *data, int size, uint32_t *tick);   // Look the base up before decoding
+bool SnapshotDecode(const unsigned char *data, int size, const Snapshot *base, Snapshot *current);
+uint32_t SnapshotChecksum(const Snapshot *snapshot);
+
+// Tick time at the given percentile (0 to 1), in seconds
+double ServerTickPercentile(const ServerStats *stats, double percentile);
+
+#endif // SERVER_H
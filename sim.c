@@ -0,0 +1,404 @@
+#include "sim.h"
+#include "ai.h"
+#include "collide.h"
+#include "level.h"
+#include <math.h>
+#include <stddef.h>
+
+uint32_t SimRandom(SimState *state) {
+    uint64_t x = state->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    state->rng = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+SimConfig SimDifficultyConfig(Difficulty difficulty, float width, float height) {
+    // The presets were tuned as pixels per frame at 60 FPS
+    const float perFrame = 60.0f;
+
+    SimConfig config = { 0 };
+    config.width = width;
+    config.height = height;
+    config.tickRate = SIM_DEFAULT_TICK_RATE;
+    config.ballRadius = 20.0f;
+    config.hitBoost = 0.5f * perFrame;
+    config.winScore = 5;
+
+    // Set parameters by difficulty
+    if (difficulty == EASY) {
+        config.serveSpeed = 4.0f * perFrame;
+        config.maxSpeed = 8.0f * perFrame;
+        config.paddleSpeed = 7.0f * perFrame;
+        config.aiSpeed = 3.0f * perFrame;
+        config.aiReaction = 0.35f;
+        config.aiError = 150.0f;
+        config.paddleHeight = 150;
+    } else if (difficulty == MEDIUM) {
+        config.serveSpeed = 5.0f * perFrame;
+        config.maxSpeed = 12.0f * perFrame;
+        config.paddleSpeed = 6.0f * perFrame;
+        config.aiSpeed = 5.0f * perFrame;
+        config.aiReaction = 0.2f;
+        config.aiError = 110.0f;
+        config.paddleHeight = 100;
+    } else {
+        config.serveSpeed = 7.0f * perFrame;
+        config.maxSpeed = 15.0f * perFrame;
+        config.paddleSpeed = 5.0f * perFrame;
+        config.aiSpeed = 7.0f * perFrame;
+        config.aiReaction = 0.08f;
+        config.aiError = 80.0f;
+        config.paddleHeight = 70;
+    }
+    return config;
+}
+
+// Put the ball back in the middle and send it in a random diagonal
+static void Serve(SimState *state) {
+    state->ballPosition = (SimVec2){ state->config.width / 2.0f, state->config.height / 2.0f };
+    float dirX = (SimRandom(state) % 2 == 0) ? 1.0f : -1.0f;
+    float dirY = (SimRandom(state) % 2 == 0) ? 1.0f : -1.0f;
+    state->ballSpeed.x = state->config.serveSpeed * dirX;
+    state->ballSpeed.y = state->config.serveSpeed * dirY;
+}
+
+void SimInit(SimState *state, SimConfig config, uint64_t seed) {
+    float width = config.width;
+    float height = config.height;
+
+    *state = (SimState){ 0 };
+    state->config = config;
+    state->rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+
+    state->leftPaddle = (SimRect){ 50, height / 2 - config.paddleHeight / 2, 20, config.paddleHeight };
+    state->rightPaddle = (SimRect){ width - 70, height / 2 - config.paddleHeight / 2, 20, config.paddleHeight };
+
+    // Obstacles in the middle, unless a level brings its own
+    state->obstacleCount = (config.level == NULL) ? 3 : 0;
+    state->obstacles[0] = (SimRect){ width / 2 - 10, 100, 20, 50 };
+    state->obstacles[1] = (SimRect){ width / 2 - 10, 300, 20, 50 };
+    state->obstacles[2] = (SimRect){ width / 2 - 10, 500, 20, 50 };
+    
+    AiReset(&state->leftAi, &state->config);
+    AiReset(&state->rightAi, &state->config);
+
+    Serve(state);
+}
+
+// Move a paddle from its input, clamping happens afterwards
+static void MovePaddle(SimState *state, SimSide side, SimPaddleInput input, float dt) {
+    SimRect *paddle = (side == SIDE_LAVA) ? &state->leftPaddle : &state->rightPaddle;
+    if (input.ai) {
+        // AI heads for where it expects the ball, stopping there instead of overshooting
+        AiBrain *brain = (side == SIDE_LAVA) ? &state->leftAi : &state->rightAi;
+        float target = AiUpdate(state, brain, side) - paddle->height / 2;
+        float step = brain->skill.speed * dt;
+        if (paddle->y < target) paddle->y = fminf(paddle->y + step, target);
+        else paddle->y = fmaxf(paddle->y - step, target);
+    } else if (input.useTarget) {
+        paddle->y = input.targetY - paddle->height / 2;
+    } else {
+        paddle->y += input.move * state->config.paddleSpeed * dt;
+    }
+}
+
+static void ClampPaddle(SimRect *paddle, float height) {
+    if (paddle->y < 0) paddle->y = 0;
+    if (paddle->y + paddle->height > height) paddle->y = height - paddle->height;
+}
+
+// What the ball runs into first during a step
+typedef enum BallContact {
+    CONTACT_NONE,
+    CONTACT_PADDLE,
+    CONTACT_OBSTACLE,
+    CONTACT_WALL,
+    CONTACT_LAVA_GOAL,   // Right edge, point for Lava
+    CONTACT_ICE_GOAL     // Left edge, point for Ice
+} BallContact;
+
+// Bounce off a paddle or obstacle. Responds on the dominant axis of the contact
+// normal only, so a face hit flips one axis and corners never send the ball back in.
+// Round level shapes and slanted lines mirror the speed about the normal instead.
+static void BounceOffBox(SimState *state, SimVec2 normal, bool paddle, bool mirror) {
+    SimVec2 *speed = &state->ballSpeed;
+    if (mirror) {
+        // Only a ball moving into the shape bounces, one grazing it on the way out keeps going
+        float along = speed->x * normal.x + speed->y * normal.y;
+        if (along < 0.0f) {
+            speed->x -= 2.0f * along * normal.x;
+            speed->y -= 2.0f * along * normal.y;
+        }
+    } else if (fabsf(normal.x) >= fabsf(normal.y)) {
+        speed->x = fabsf(speed->x) * (normal.x > 0 ? 1.0f : -1.0f);
+        if (paddle) speed->y += (speed->y > 0 ? state->config.hitBoost : -state->config.hitBoost);
+        if (speed->x * normal.x + speed->y * normal.y < 0) speed->y = -speed->y;
+    } else {
+        speed->y = fabsf(speed->y) * (normal.y > 0 ? 1.0f : -1.0f);
+        if (speed->x * normal.x + speed->y * normal.y < 0) speed->x = -speed->x;
+    }
+}
+
+// Award a point and serve again, returns the events raised
+static unsigned int ScoreGoal(SimState *state, SimSide scorer) {
+    unsigned int events = 0;
+    if (scorer == SIDE_LAVA) {
+        state->leftScore++;
+        events |= SIM_EVENT_LAVA_SCORED;
+        if (state->leftScore >= state->config.winScore) state->winner = SIDE_LAVA;
+    } else {
+        state->rightScore++;
+        events |= SIM_EVENT_ICE_SCORED;
+        if (state->rightScore >= state->config.winScore) state->winner = SIDE_ICE;
+    }
+
+    if (state->winner != SIDE_NONE) {
+        events |= SIM_EVENT_GAME_OVER;
+    } else {
+        Serve(state);
+    }
+    return events;
+}
+
+// Move the ball through one step with swept collision: find the earliest contact,
+// advance to it, bounce, and continue with the rest of the step
+static unsigned int MoveBall(SimState *state, float dt) {
+    const SimConfig *config = &state->config;
+    const float radius = config->ballRadius;
+    float remaining = 1.0f;
+    unsigned int events = 0;
+    bool stalled = false;
+
+    for (int bounce = 0; bounce < SIM_MAX_BOUNCES && remaining > 0.0f; bounce++) {
+        SimVec2 position = state->ballPosition;
+        SimVec2 motion = { state->ballSpeed.x * dt * remaining, state->ballSpeed.y * dt * remaining };
+        BallContact contact = CONTACT_NONE;
+        const SimRect *box = NULL;
+        bool mirror = false;
+        int shape;
+        SweepHit first = { 1.0f, { 0, 0 }, 0.0f };
+        SweepHit hit;
+        float time;
+
+        // Paddles first so a save wins a tie with the goal line
+        if (SweepCircleRect(position, motion, radius, state->leftPaddle, first.time, &hit) &&
+            (contact == CONTACT_NONE || hit.time < first.time)) {
+            first = hit;
+            contact = CONTACT_PADDLE;
+            box = &state->leftPaddle;
+        }
+        if (SweepCircleRect(position, motion, radius, state->rightPaddle, first.time, &hit) &&
+            (contact == CONTACT_NONE || hit.time < first.time)) {
+            first = hit;
+            contact = CONTACT_PADDLE;
+            box = &state->rightPaddle;
+        }
+        for (int i = 0; i < state->obstacleCount; i++) {
+            if (SweepCircleRect(position, motion, radius, state->obstacles[i], first.time, &hit) &&
+                (contact == CONTACT_NONE || hit.time < first.time)) {
+                first = hit;
+                contact = CONTACT_OBSTACLE;
+                box = &state->obstacles[i];
+            }
+        }
+        if (config->level != NULL && LevelSweep(config->level, position, motion, radius, first.time, &hit, &shape) &&
+            (contact == CONTACT_NONE || hit.time < first.time)) {
+            first = hit;
+            contact = CONTACT_OBSTACLE;
+            box = &config->level->shapes[shape].bounds;
+            mirror = config->level->shapes[shape].type != LEVEL_RECT;
+        }
+
+        // Wall collision (top and bottom)
+        if (SweepPlane(position.y, motion.y, config->height - radius, true, first.time, &time) &&
+            (contact == CONTACT_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, -1 }, 0.0f };
+            contact = CONTACT_WALL;
+        }
+        if (SweepPlane(position.y, motion.y, radius, false, first.time, &time) &&
+            (contact == CONTACT_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, 1 }, 0.0f };
+            contact = CONTACT_WALL;
+        }
+
+        // Goal lines
+        if (SweepPlane(position.x, motion.x, config->width - radius, true, first.time, &time) &&
+            (contact == CONTACT_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, 0 }, 0.0f };
+            contact = CONTACT_LAVA_GOAL;
+        }
+        if (SweepPlane(position.x, motion.x, radius, false, first.time, &time) &&
+            (contact == CONTACT_NONE || time < first.time)) {
+            first = (SweepHit){ time, { 0, 0 }, 0.0f };
+            contact = CONTACT_ICE_GOAL;
+        }
+
+        state->ballPosition.x = position.x + motion.x * first.time + first.normal.x * first.depth;
+        state->ballPosition.y = position.y + motion.y * first.time + first.normal.y * first.depth;
+        remaining *= 1.0f - first.time;
+
+        if (contact == CONTACT_NONE) break;
+        if (contact == CONTACT_LAVA_GOAL || contact == CONTACT_ICE_GOAL) {
+            // The serve starts from rest at the center, drop the rest of the step
+            events |= ScoreGoal(state, contact == CONTACT_LAVA_GOAL ? SIDE_LAVA : SIDE_ICE);
+            break;
+        }
+
+        if (contact == CONTACT_WALL) {
+            state->ballSpeed.y = fabsf(state->ballSpeed.y) * first.normal.y;
+            events |= SIM_EVENT_WALL_HIT;
+        } else {
+            BounceOffBox(state, first.normal, contact == CONTACT_PADDLE, mirror);
+            events |= (contact == CONTACT_PADDLE) ? SIM_EVENT_PADDLE_HIT : SIM_EVENT_OBSTACLE_HIT;
+        }
+
+        // A second contact in a row without moving means the ball is wedged between a wall
+        // and the end of a paddle or obstacle, in a gap too narrow for it. Squeeze it out
+        // sideways, otherwise the single-axis bounces would hold it there forever.
+        bool moved = fabsf(state->ballPosition.x - position.x) + fabsf(state->ballPosition.y - position.y) > 0.01f;
+        if (!moved && stalled && box != NULL) {
+            bool leftSide = state->ballPosition.x < box->x + box->width / 2;
+            state->ballPosition.x = leftSide ? box->x - radius : box->x + box->width + radius;
+            state->ballSpeed.x = fabsf(state->ballSpeed.x) * (leftSide ? -1.0f : 1.0f);
+            state->ballSpeed.y = fabsf(state->ballSpeed.y) * (state->ballPosition.y < config->height / 2 ? 1.0f : -1.0f);
+        }
+        stalled = !moved;
+
+        if (state->ballSpeed.y > config->maxSpeed) state->ballSpeed.y = config->maxSpeed;
+        if (state->ballSpeed.y < -config->maxSpeed) state->ballSpeed.y = -config->maxSpeed;
+    }
+    return events;
+}
+
+unsigned int SimStep(SimState *state, SimInput input) {
+    const SimConfig *config = &state->config;
+    const float dt = 1.0f / config->tickRate;
+
+    if (state->winner != SIDE_NONE) return 0;
+    state->tick++;
+
+    // --- Paddle Controls ---
+    MovePaddle(state, SIDE_LAVA, input.left, dt);
+    MovePaddle(state, SIDE_ICE, input.right, dt);
+    ClampPaddle(&state->leftPaddle, config->height);
+    ClampPaddle(&state->rightPaddle, config->height);
+
+    return MoveBall(state, dt);
+}
+
+static bool Finite(const float *values, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!isfinite(values[i])) return false;
+    }
+    return true;
+}
+
+static bool RectFinite(SimRect rect) {
+    const float values[] = { rect.x, rect.y, rect.width, rect.height };
+    return Finite(values, 4);
+}
+
+static bool Positive(float value) {
+    return isfinite(value) && value > 0.0f;
+}
+
+static bool BrainValid(const AiBrain *brain, float tickRate) {
+    const float values[] = { brain->skill.speed, brain->skill.error, brain->targetY, brain->pendingY,
+                             brain->aimError, brain->seenSpeed.x, brain->seenSpeed.y };
+    // AiUpdate turns the reaction time into a tick count
+    return Finite(values, 7) && brain->skill.reaction >= 0.0f && brain->skill.reaction * tickRate < 4294967296.0f;
+}
+
+bool SimStateValid(const SimState *state) {
+    const SimConfig *config = &state->config;
+    if (!Positive(config->width) || !Positive(config->height) || !Positive(config->tickRate) ||
+        !Positive(config->ballRadius) || !Positive(config->paddleHeight) || config->winScore <= 0) return false;
+    const float rules[] = { config->serveSpeed, config->maxSpeed, config->hitBoost, config->paddleSpeed,
+                            config->aiSpeed, config->aiReaction, config->aiError };
+    if (!Finite(rules, 7)) return false;
+
+    if (state->obstacleCount < 0 || state->obstacleCount > SIM_MAX_OBSTACLES) return false;
+    if (state->winner != SIDE_NONE && state->winner != SIDE_LAVA && state->winner != SIDE_ICE) return false;
+    if (state->leftScore < 0 || state->rightScore < 0) return false;
+    const float ball[] = { state->ballPosition.x, state->ballPosition.y, state->ballSpeed.x, state->ballSpeed.y };
+    if (!Finite(ball, 4)) return false;
+    if (!RectFinite(state->leftPaddle) || !RectFinite(state->rightPaddle)) return false;
+    for (int i = 0; i < state->obstacleCount; i++) {
+        if (!RectFinite(state->obstacles[i])) return false;
+    }
+    return BrainValid(&state->leftAi, config->tickRate) && BrainValid(&state->rightAi, config->tickRate);
+}
+
+// FNV-1a over a run of bytes
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+uint64_t SimHash(const SimState *state) {
+    // Field by field so struct padding never leaks into the hash
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = HashBytes(hash, &state->ballPosition, sizeof(state->ballPosition));
+    hash = HashBytes(hash, &state->ballSpeed, sizeof(state->ballSpeed));
+    hash = HashBytes(hash, &state->leftPaddle, sizeof(state->leftPaddle));
+    hash = HashBytes(hash, &state->rightPaddle, sizeof(state->rightPaddle));
+    hash = HashBytes(hash, &state->leftScore, sizeof(state->leftScore));
+    hash = HashBytes(hash, &state->rightScore, sizeof(state->rightScore));
+    hash = HashBytes(hash, &state->winner, sizeof(state->winner));
+    hash = HashBytes(hash, &state->tick, sizeof(state->tick));
+    hash = HashBytes(hash, &state->rng, sizeof(state->rng));
+    const AiBrain *brains[2] = { &state->leftAi, &state->rightAi };
+    for (int i = 0; i < 2; i++) {
+        hash = HashBytes(hash, &brains[i]->targetY, sizeof(brains[i]->targetY));
+        hash = HashBytes(hash, &brains[i]->pendingY, sizeof(brains[i]->pendingY));
+        hash = HashBytes(hash, &brains[i]->aimError, sizeof(brains[i]->aimError));
+        hash = HashBytes(hash, &brains[i]->reactTick, sizeof(brains[i]->reactTick));
+    }
+    return hash;
+}
+
+static float Lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+SimState SimInterpolate(const SimState *previous, const SimState *current, float alpha) {
+    SimState out = *current;
+    out.leftPaddle.y = Lerp(previous->leftPaddle.y, current->leftPaddle.y, alpha);
+    out.rightPaddle.y = Lerp(previous->rightPaddle.y, current->rightPaddle.y, alpha);
+
+    // A serve teleports the ball, don't smear it across the field
+    if (previous->leftScore == current->leftScore && previous->rightScore == current->rightScore) {
+        out.ballPosition.x = Lerp(previous->ballPosition.x, current->ballPosition.x, alpha);
+        out.ballPosition.y = Lerp(previous->ballPosition.y, current->ballPosition.y, alpha);
+    }
+    return out;
+}
+
+void SimClockInit(SimClock *clock, float tickRate) {
+    *clock = (SimClock){ 0 };
+    clock->tickSeconds = 1.0 / tickRate;
+}
+
+int SimClockAdvance(SimClock *clock, double frameSeconds) {
+    // Cap huge frames (debugger, window drag) instead of spiralling to catch up
+    if (frameSeconds > SIM_MAX_FRAME_SECONDS) {
+        clock->droppedSeconds += frameSeconds - SIM_MAX_FRAME_SECONDS;
+        frameSeconds = SIM_MAX_FRAME_SECONDS;
+    }
+    if (frameSeconds < 0) frameSeconds = 0;
+
+    clock->accumulator += frameSeconds;
+    int steps = (int)(clock->accumulator / clock->tickSeconds);
+    clock->accumulator -= steps * clock->tickSeconds;
+    return steps;
+}
+
+float SimClockAlpha(const SimClock *clock) {
+    return (float)(clock->accumulator / clock->tickSeconds);
+}
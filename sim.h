@@ -0,0 +1,157 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Window-free match simulation: everything that decides a game of LAVA VS ICE
+// lives here so it can run without raylib (see headless.c)
+
+#define SIM_MAX_OBSTACLES 3
+#define SIM_DEFAULT_TICK_RATE 120.0f
+#define SIM_MAX_FRAME_SECONDS 0.25   // Longest frame the clock will catch up on
+#define SIM_MAX_BOUNCES 8            // Contacts resolved per step before the ball stops for the step
+
+// Plain geometry types, layout-compatible with raylib's Vector2 and Rectangle
+typedef struct SimVec2 {
+    float x;
+    float y;
+} SimVec2;
+
+typedef struct SimRect {
+    float x;
+    float y;
+    float width;
+    float height;
+} SimRect;
+
+// Enum for difficulty levels
+typedef enum Difficulty {
+    EASY,
+    MEDIUM,
+    HARD
+} Difficulty;
+
+// Which side won the match
+typedef enum SimSide {
+    SIDE_NONE,
+    SIDE_LAVA,  // Left paddle
+    SIDE_ICE    // Right paddle
+} SimSide;
+
+// Events raised by a single SimStep, used by the front end for sounds and effects
+typedef enum SimEvent {
+    SIM_EVENT_PADDLE_HIT   = 1 << 0,
+    SIM_EVENT_WALL_HIT     = 1 << 1,
+    SIM_EVENT_OBSTACLE_HIT = 1 << 2,
+    SIM_EVENT_LAVA_SCORED  = 1 << 3,
+    SIM_EVENT_ICE_SCORED   = 1 << 4,
+    SIM_EVENT_GAME_OVER    = 1 << 5
+} SimEvent;
+
+// Match rules, normally taken from a difficulty preset. Speeds are in pixels per second.
+typedef struct SimConfig {
+    float width;
+    float height;
+    float tickRate;      // Fixed simulation steps per second
+    float ballRadius;
+    float serveSpeed;    // Initial speed on both axes after every serve
+    float maxSpeed;      // Clamp for the vertical ball speed
+    float hitBoost;      // Vertical speed added by every paddle hit
+    float paddleSpeed;   // Player paddle speed
+    float aiSpeed;       // Computer paddle speed
+    float aiReaction;    // Seconds before the computer acts on a new ball path
+    float aiError;       // Aim error in pixels per second of flight left, see ai.c
+    float paddleHeight;
+    int winScore;
+    const struct Level *level;  // Static colliders in place of the center blocks, NULL for the classic layout (see level.h)
+} SimConfig;
+
+// Input for one paddle during one step
+typedef struct SimPaddleInput {
+    int move;            // -1 up, 0 idle, 1 down
+    bool useTarget;      // Place the paddle directly (mouse control)
+    float targetY;       // Paddle center when useTarget is set
+    bool ai;             // Let the computer drive this paddle
+} SimPaddleInput;
+
+typedef struct SimInput {
+    SimPaddleInput left;
+    SimPaddleInput right;
+} SimInput;
+
+// How well a computer player plays, normally the aiSpeed, aiReaction and aiError of the config
+typedef struct AiSkill {
+    float speed;         // Paddle speed, pixels per second
+    float reaction;      // Seconds before acting on a new ball path
+    float error;         // Aim error in pixels per second of flight left
+} AiSkill;
+
+// Computer player memory: its current prediction and when it will act on it (see ai.c)
+typedef struct AiBrain {
+    AiSkill skill;       // Set from the config by AiReset, a tournament can give each side its own
+    float targetY;       // Paddle center being steered to
+    float pendingY;      // Newest prediction, becomes the target at reactTick
+    float aimError;      // Misjudgement drawn once per shot, in pixels
+    uint32_t reactTick;
+    SimVec2 seenSpeed;   // Ball velocity and score the prediction was made for,
+    int seenScore;       // it stays valid until the ball hits something
+    uint32_t predictions;
+} AiBrain;
+
+// Complete state of one match
+typedef struct SimState {
+    SimConfig config;
+    SimVec2 ballPosition;
+    SimVec2 ballSpeed;
+    SimRect leftPaddle;
+    SimRect rightPaddle;
+    SimRect obstacles[SIM_MAX_OBSTACLES];
+    int obstacleCount;
+    int leftScore;
+    int rightScore;
+    SimSide winner;
+    uint32_t tick;
+    uint64_t rng;
+    AiBrain leftAi;
+    AiBrain rightAi;
+} SimState;
+
+// Accumulator that turns variable frame times into a whole number of fixed steps
+typedef struct SimClock {
+    double accumulator;
+    double tickSeconds;
+    double droppedSeconds;   // Time discarded because a frame exceeded SIM_MAX_FRAME_SECONDS
+} SimClock;
+
+// Rules for a difficulty preset on a playfield of the given size
+SimConfig SimDifficultyConfig(Difficulty difficulty, float width, float height);
+
+// Reset scores, paddles and obstacles and serve the first ball
+void SimInit(SimState *state, SimConfig config, uint64_t seed);
+
+// Advance the match by one fixed step (1 / config.tickRate seconds), returns a mask of SimEvent flags
+unsigned int SimStep(SimState *state, SimInput input);
+
+// Next value of the match random generator (xorshift64*)
+uint32_t SimRandom(SimState *state);
+
+// Whether a state read from a file or the network is safe to step: counts within
+// their arrays, sizes and rates positive, every number finite. Ignores config.level.
+bool SimStateValid(const SimState *state);
+
+// Hash of everything that decides the match, used to compare runs
+uint64_t SimHash(const SimState *state);
+
+// Render state between the previous and current step, alpha in [0, 1]
+SimState SimInterpolate(const SimState *previous, const SimState *current, float alpha);
+
+void SimClockInit(SimClock *clock, float tickRate);
+
+// Feed one frame of real time, returns how many steps to run this frame
+int SimClockAdvance(SimClock *clock, double frameSeconds);
+
+// How far the clock is into the next step, used for render interpolation
+float SimClockAlpha(const SimClock *clock);
+
+#endif // SIM_H
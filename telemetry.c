@@ -0,0 +1,225 @@
+// nanosleep is POSIX, not C11 (MinGW gets it from winpthreads)
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "telemetry.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+static void Add(TelemetryBatch *batch, TelemetryEvent event, TelemetryType type, SimSide side) {
+    if (batch->count >= TELEMETRY_BATCH_SIZE) {
+        batch->overflow++;
+        return;
+    }
+    event.type = (uint8_t)type;
+    event.side = (uint8_t)side;
+    batch->events[batch->count++] = event;
+}
+
+void TelemetryRecordStep(TelemetryBatch *batch, const SimState *before, const SimState *after, unsigned int events,
+                         Difficulty difficulty, int mode) {
+    TelemetryEvent event = {
+        .tick = after->tick, .rally = batch->rally,
+        .speed = sqrtf(before->ballSpeed.x * before->ballSpeed.x + before->ballSpeed.y * before->ballSpeed.y),
+        .difficulty = (uint8_t)difficulty, .mode = (uint8_t)mode,
+        .leftScore = (uint8_t)after->leftScore, .rightScore = (uint8_t)after->rightScore
+    };
+    if (before->tick == 0) {
+        batch->rally = 0;
+        TelemetryEvent start = event;
+        start.tick = 0;
+        start.rally = 0;
+        start.leftScore = (uint8_t)before->leftScore;
+        start.rightScore = (uint8_t)before->rightScore;
+        Add(batch, start, TELEMETRY_MATCH_START, SIDE_NONE);
+    }
+    if (events == 0) return;
+
+    if (events & SIM_EVENT_WALL_HIT) Add(batch, event, TELEMETRY_WALL_HIT, SIDE_NONE);
+    if (events & SIM_EVENT_OBSTACLE_HIT) Add(batch, event, TELEMETRY_OBSTACLE_HIT, SIDE_NONE);
+    if (events & SIM_EVENT_PADDLE_HIT) {
+        if (batch->rally < UINT16_MAX) batch->rally++;
+        event.rally = batch->rally;
+        Add(batch, event, TELEMETRY_PADDLE_HIT, after->ballPosition.x < after->config.width / 2 ? SIDE_LAVA : SIDE_ICE);
+    }
+    if (events & (SIM_EVENT_LAVA_SCORED | SIM_EVENT_ICE_SCORED)) {
+        Add(batch, event, TELEMETRY_GOAL, (events & SIM_EVENT_LAVA_SCORED) ? SIDE_LAVA : SIDE_ICE);
+        batch->rally = 0;
+    }
+    if (events & SIM_EVENT_GAME_OVER) Add(batch, event, TELEMETRY_MATCH_END, after->winner);
+}
+
+bool TelemetryFileName(char *path, size_t size, const char *prefix, int64_t startTime, unsigned index) {
+    int length = snprintf(path, size, "%s-%lld-%u.tlm", prefix, (long long)startTime, index);
+    return length > 0 && (size_t)length < size;
+}
+
+// Close the current file and start the next one with its header
+static bool OpenNext(Telemetry *telemetry) {
+    if (telemetry->file != NULL) fclose(telemetry->file);
+    telemetry->file = NULL;
+    char path[600];
+    if (!TelemetryFileName(path, sizeof(path), telemetry->prefix, telemetry->startTime, telemetry->files)) return false;
+    telemetry->file = fopen(path, "wb");
+    if (telemetry->file == NULL) return false;
+    setvbuf(telemetry->file, NULL, _IONBF, 0);  // Writes are already batched
+    telemetry->files++;
+    TelemetryHeader header = { TELEMETRY_MAGIC, TELEMETRY_VERSION, sizeof(TelemetryEvent), (int64_t)time(NULL) };
+    telemetry->fileBytes = (long)sizeof(header);
+    return fwrite(&header, sizeof(header), 1, telemetry->file) == 1;
+}
+
+// Write out the buffer in one call, then rotate if the file has grown past the limit
+static void WriteBuffer(Telemetry *telemetry) {
+    if (telemetry->buffered == 0) return;
+    if (!telemetry->failed) {
+        if (fwrite(telemetry->buffer, telemetry->buffered, 1, telemetry->file) == 1) {
+            telemetry->fileBytes += (long)telemetry->buffered;
+            telemetry->written += telemetry->buffered / sizeof(TelemetryEvent);
+            telemetry->writes++;
+            if (telemetry->rotateBytes > 0 && telemetry->fileBytes >= telemetry->rotateBytes && !OpenNext(telemetry)) {
+                telemetry->failed = true;
+            }
+        } else {
+            telemetry->failed = true;
+        }
+    }
+    telemetry->buffered = 0;
+}
+
+// Move everything queued into the write buffer, writing whenever it fills up
+static void Drain(Telemetry *telemetry) {
+    TelemetryQueue *queue = &telemetry->queue;
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    for (; head != tail; head++) {
+        memcpy(telemetry->buffer + telemetry->buffered, &queue->items[head & (TELEMETRY_QUEUE_SIZE - 1)], sizeof(TelemetryEvent));
+        telemetry->buffered += sizeof(TelemetryEvent);
+        if (telemetry->buffered + sizeof(TelemetryEvent) > TELEMETRY_WRITE_BYTES) WriteBuffer(telemetry);
+    }
+    atomic_store_explicit(&queue->head, head, memory_order_release);
+}
+
+static void *TelemetryThread(void *arg) {
+    Telemetry *telemetry = (Telemetry *)arg;
+    struct timespec tick = { 0, (long)(TELEMETRY_TICK_SECONDS * 1e9) };
+    int flushTicks = (int)(TELEMETRY_FLUSH_SECONDS / TELEMETRY_TICK_SECONDS);
+    int ticks = 0;
+
+    for (;;) {
+        bool quit = atomic_load_explicit(&telemetry->quit, memory_order_acquire);
+        Drain(telemetry);
+        // Partly filled buffers still reach the disk every so often, so a crash loses little
+        if (++ticks >= flushTicks) {
+            WriteBuffer(telemetry);
+            ticks = 0;
+        }
+        if (quit) break;   // Checked before draining, so nothing posted before TelemetryStop is lost
+        nanosleep(&tick, NULL);
+    }
+    WriteBuffer(telemetry);
+    return NULL;
+}
+
+bool TelemetryStart(Telemetry *telemetry, const char *prefix, long rotateBytes) {
+    memset(telemetry, 0, sizeof(*telemetry));
+    atomic_init(&telemetry->queue.head, 0);
+    atomic_init(&telemetry->queue.tail, 0);
+    atomic_init(&telemetry->quit, false);
+    atomic_init(&telemetry->dropped, 0);
+    if (snprintf(telemetry->prefix, sizeof(telemetry->prefix), "%s", prefix) >= (int)sizeof(telemetry->prefix)) return false;
+    telemetry->startTime = (int64_t)time(NULL);
+    telemetry->rotateBytes = rotateBytes;
+
+    if (!OpenNext(telemetry)) {
+        if (telemetry->file != NULL) fclose(telemetry->file);
+        telemetry->file = NULL;
+        return false;
+    }
+    telemetry->running = (pthread_create(&telemetry->thread, NULL, TelemetryThread, telemetry) == 0);
+    if (!telemetry->running) {
+        fclose(telemetry->file);
+        telemetry->file = NULL;
+    }
+    return telemetry->running;
+}
+
+void TelemetryStop(Telemetry *telemetry) {
+    if (!telemetry->running) return;
+    atomic_store_explicit(&telemetry->quit, true, memory_order_release);
+    pthread_join(telemetry->thread, NULL);
+    telemetry->running = false;
+    if (telemetry->file != NULL) fclose(telemetry->file);
+    telemetry->file = NULL;
+}
+
+bool TelemetryPost(Telemetry *telemetry, TelemetryBatch *batch) {
+    unsigned lost = batch->overflow;
+    if (telemetry->running && batch->count > 0) {
+        TelemetryQueue *queue = &telemetry->queue;
+        unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        unsigned space = TELEMETRY_QUEUE_SIZE - (tail - head);
+        unsigned count = ((unsigned)batch->count < space) ? (unsigned)batch->count : space;
+        for (unsigned i = 0; i < count; i++) queue->items[(tail + i) & (TELEMETRY_QUEUE_SIZE - 1)] = batch->events[i];
+        atomic_store_explicit(&queue->tail, tail + count, memory_order_release);   // The whole batch in one store
+        lost += (unsigned)batch->count - count;
+    }
+    if (lost > 0) atomic_fetch_add_explicit(&telemetry->dropped, lost, memory_order_relaxed);
+    batch->count = 0;
+    batch->overflow = 0;
+    return lost == 0;
+}
+
+static void AddEvent(TelemetrySummary *summary, const TelemetryEvent *event) {
+    if (event->difficulty > HARD || event->type >= TELEMETRY_TYPE_COUNT) return;
+    TelemetryTotals *totals = &summary->difficulty[event->difficulty];
+    totals->events[event->type]++;
+    switch (event->type) {
+        case TELEMETRY_MATCH_START:
+            totals->matches++;
+            break;
+        case TELEMETRY_PADDLE_HIT:
+            totals->impactSpeed += event->speed;
+            if (event->speed > totals->fastestImpact) totals->fastestImpact = event->speed;
+            break;
+        case TELEMETRY_GOAL:
+            totals->rallies++;
+            totals->rallyHits += event->rally;
+            if (event->rally > totals->longestRally) totals->longestRally = event->rally;
+            break;
+        case TELEMETRY_MATCH_END:
+            totals->finished++;
+            if (event->side <= SIDE_ICE) totals->wins[event->side]++;
+            totals->ticks += event->tick;
+            break;
+        default:
+            break;
+    }
+}
+
+bool TelemetrySummarize(TelemetrySummary *summary, const char *path) {
+    FILE *file = fopen(path, "rb");
+    TelemetryHeader header;
+    if (file == NULL || fread(&header, sizeof(header), 1, file) != 1 || header.magic != TELEMETRY_MAGIC ||
+        header.version != TELEMETRY_VERSION || header.eventSize != sizeof(TelemetryEvent)) {
+        if (file != NULL) fclose(file);
+        summary->badFiles++;
+        return false;
+    }
+    if (summary->files == 0 || header.startTime < summary->firstStart) summary->firstStart = header.startTime;
+    if (summary->files == 0 || header.startTime > summary->lastStart) summary->lastStart = header.startTime;
+    summary->files++;
+
+    // Big reads, a day of logs is a few megabytes
+    TelemetryEvent events[1024];
+    size_t count;
+    while ((count = fread(events, sizeof(TelemetryEvent), 1024, file)) > 0) {
+        for (size_t i = 0; i < count; i++) AddEvent(summary, &events[i]);
+        summary->records += count;
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,141 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "sim.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Match telemetry: every paddle hit, wall and obstacle bounce, goal and match end
+// of local matches, as 16-byte records in a binary log. Steps add records to a
+// plain batch while they run (the update stage fills it, see pong.c), and the
+// frame loop posts the whole batch to a single-producer single-consumer ring
+// once a frame. A writer thread drains the ring into a large buffer, writes it
+// in one go when it fills or a moment has passed, and starts a new file once
+// one grows past a size limit. The frame loop never touches a file, a full ring
+// drops records and counts them instead of waiting.
+//
+// A log file is a TelemetryHeader followed by records. Files are named
+// PREFIX-STARTTIME-N.tlm, N counting the files of one run.
+
+#define TELEMETRY_MAGIC 0x474F4C54u            // "TLOG"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_QUEUE_SIZE 4096              // Records in flight, power of two
+#define TELEMETRY_BATCH_SIZE 256               // Records one frame can add
+#define TELEMETRY_WRITE_BYTES (64 * 1024)      // Writer buffer, written when full
+#define TELEMETRY_FLUSH_SECONDS 1.0            // or when this old
+#define TELEMETRY_TICK_SECONDS 0.05            // How often the writer thread wakes up
+#define TELEMETRY_DEFAULT_ROTATE_BYTES (8L * 1024 * 1024)
+
+typedef enum TelemetryType {
+    TELEMETRY_MATCH_START,
+    TELEMETRY_PADDLE_HIT,   // side: the paddle
+    TELEMETRY_WALL_HIT,
+    TELEMETRY_OBSTACLE_HIT,
+    TELEMETRY_GOAL,         // side: who scored, rally: hits in the rally it ended
+    TELEMETRY_MATCH_END,    // side: the winner
+    TELEMETRY_TYPE_COUNT
+} TelemetryType;
+
+typedef struct TelemetryEvent {
+    uint32_t tick;          // Sim step the event happened in
+    float speed;            // Ball speed going into the step, pixels per second
+    uint16_t rally;         // Paddle hits since the serve, this one included
+    uint8_t type;           // TelemetryType
+    uint8_t side;           // SimSide
+    uint8_t difficulty;
+    uint8_t mode;           // GameMode
+    uint8_t leftScore;      // Score after the event
+    uint8_t rightScore;
+} TelemetryEvent;
+
+typedef struct TelemetryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t eventSize;
+    int64_t startTime;      // Unix seconds the file was opened
+} TelemetryHeader;
+
+// One frame's records, filled by whoever steps the match
+typedef struct TelemetryBatch {
+    TelemetryEvent events[TELEMETRY_BATCH_SIZE];
+    int count;
+    unsigned overflow;      // Records that did not fit
+    uint16_t rally;         // Carried from step to step
+} TelemetryBatch;
+
+// Lock-free ring, the frame loop writes tail and the writer thread writes head
+typedef struct TelemetryQueue {
+    TelemetryEvent items[TELEMETRY_QUEUE_SIZE];
+    alignas(64) atomic_uint head;
+    alignas(64) atomic_uint tail;
+} TelemetryQueue;
+
+typedef struct Telemetry {
+    TelemetryQueue queue;
+    pthread_t thread;
+    bool running;
+    atomic_bool quit;
+    atomic_uint dropped;        // Records lost to a full ring
+    char prefix[512];
+    int64_t startTime;
+    long rotateBytes;
+
+    // Everything below belongs to the writer thread
+    FILE *file;
+    long fileBytes;
+    unsigned files;             // Files opened so far
+    unsigned char buffer[TELEMETRY_WRITE_BYTES];
+    size_t buffered;
+    unsigned long written;      // Records that reached a file
+    unsigned writes;
+    bool failed;                // A file could not be opened or written, later records are dropped
+} Telemetry;
+
+// Add the records for one SimStep from before to after, which raised events.
+// A step from tick 0 starts a match.
+void TelemetryRecordStep(TelemetryBatch *batch, const SimState *before, const SimState *after, unsigned int events,
+                         Difficulty difficulty, int mode);
+
+// Start the writer thread, the first file is opened right away
+bool TelemetryStart(Telemetry *telemetry, const char *prefix, long rotateBytes);
+
+// Write what is queued, stop the thread and close the file
+void TelemetryStop(Telemetry *telemetry);
+
+// Called from the frame loop only. Queues the batch and empties it, returns false if records were dropped.
+bool TelemetryPost(Telemetry *telemetry, TelemetryBatch *batch);
+
+// Path of file index of a run, false if it does not fit
+bool TelemetryFileName(char *path, size_t size, const char *prefix, int64_t startTime, unsigned index);
+
+// Totals per difficulty, the offline reader's output
+typedef struct TelemetryTotals {
+    unsigned long matches;          // Match starts seen
+    unsigned long finished;         // Match ends seen
+    unsigned long wins[3];          // By SimSide
+    unsigned long events[TELEMETRY_TYPE_COUNT];
+    unsigned long rallies;          // Goals, each ends a rally
+    unsigned long rallyHits;
+    unsigned longestRally;
+    double impactSpeed;             // Sum over paddle hits
+    float fastestImpact;
+    uint64_t ticks;                 // Sim steps of finished matches
+} TelemetryTotals;
+
+typedef struct TelemetrySummary {
+    TelemetryTotals difficulty[3];
+    unsigned long files;
+    unsigned long records;
+    unsigned long badFiles;
+    int64_t firstStart;
+    int64_t lastStart;
+} TelemetrySummary;
+
+// Add one log file to the summary, false if it is not a telemetry log
+bool TelemetrySummarize(TelemetrySummary *summary, const char *path);
+
+#endif // TELEMETRY_H
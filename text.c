@@ -0,0 +1,86 @@
+#include "text.h"
+#include "render.h"
+#include "rlgl.h"
+#include <stdio.h>
+
+// Gradient layers drawn behind LAVA and ICE, each one pixel up and left of the last
+#define TITLE_LAYERS 5
+
+TextLabel LayoutText(const char *text, int fontSize, int x, int y) {
+    TextLabel label = { text, fontSize, MeasureText(text, fontSize), x, y };
+    return label;
+}
+
+TextLabel LayoutCenteredText(const char *text, int fontSize, int centerX, int y) {
+    TextLabel label = LayoutText(text, fontSize, 0, y);
+    label.x = centerX - label.width / 2;
+    return label;
+}
+
+void DrawTextLabel(const TextLabel *label, Color color) {
+    DrawText(label->text, label->x, label->y, label->fontSize, color);
+    CountDrawCalls(1);
+}
+
+const char *TextNumberGet(TextNumber *number, int value) {
+    if (!number->valid || number->value != value) {
+        snprintf(number->buffer, sizeof(number->buffer), "%d", value);
+        number->value = value;
+        number->valid = true;
+    }
+    return number->buffer;
+}
+
+void TitleCacheBake(TitleCache *title, int fontSize, int centerX, int y) {
+    // Calculate positions for each part of the title
+    int lavaWidth = MeasureText("LAVA", fontSize);
+    int vsWidth = MeasureText(" VS ", fontSize);
+    int iceWidth = MeasureText("ICE", fontSize);
+    int totalWidth = lavaWidth + vsWidth + iceWidth;
+    int margin = TITLE_LAYERS - 1;
+
+    TitleCacheUnload(title);
+    title->x = centerX - totalWidth / 2 - margin;
+    title->y = y - margin;
+    title->texture = LoadRenderTexture(totalWidth + margin, fontSize + margin);
+
+    BeginTextureMode(title->texture);
+    ClearBackground(BLANK);
+    // Store premultiplied color with accumulated coverage so the layers composite
+    // onto the menu exactly as if they were drawn one by one
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+
+    // Draw LAVA with fiery gradient
+    for (int i = 0; i < TITLE_LAYERS; i++) {
+        Color lavaColor = ColorLerp((Color){255, 50, 0, 255}, (Color){255, 200, 0, 255}, i / 4.0f);
+        DrawText("LAVA", margin - i, margin - i, fontSize, Fade(lavaColor, 1.0f - i * 0.15f));
+    }
+
+    // Draw " VS " in white
+    DrawText(" VS ", margin + lavaWidth, margin, fontSize, WHITE);
+
+    // Draw ICE with icy gradient
+    for (int i = 0; i < TITLE_LAYERS; i++) {
+        Color iceColor = ColorLerp((Color){0, 150, 255, 255}, (Color){150, 220, 255, 255}, i / 4.0f);
+        DrawText("ICE", margin + lavaWidth + vsWidth - i, margin - i, fontSize, Fade(iceColor, 1.0f - i * 0.15f));
+    }
+
+    EndBlendMode();
+    EndTextureMode();
+}
+
+void TitleCacheDraw(const TitleCache *title) {
+    Texture2D texture = title->texture.texture;
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    // Render textures are stored upside down
+    DrawTextureRec(texture, (Rectangle){ 0, 0, (float)texture.width, (float)-texture.height },
+                   (Vector2){ (float)title->x, (float)title->y }, WHITE);
+    EndBlendMode();
+    CountDrawCalls(1);
+}
+
+void TitleCacheUnload(TitleCache *title) {
+    if (title->texture.id != 0) UnloadRenderTexture(title->texture);
+    title->texture = (RenderTexture2D){ 0 };
+}
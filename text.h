@@ -0,0 +1,48 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "raylib.h"
+
+// Text layout cache: static strings are measured and positioned once, numbers
+// are only re-formatted when their value changes, and the layered title is
+// baked into a texture.
+
+typedef struct TextLabel {
+    const char *text;
+    int fontSize;
+    int width;
+    int x;
+    int y;
+} TextLabel;
+
+// Number text that keeps its formatted string until the value changes
+typedef struct TextNumber {
+    int value;
+    bool valid;
+    char buffer[16];
+} TextNumber;
+
+// "LAVA VS ICE" title with its gradient layers baked into one texture
+typedef struct TitleCache {
+    RenderTexture2D texture;
+    int x;
+    int y;
+} TitleCache;
+
+// Lay out a string with its top-left corner at x, y
+TextLabel LayoutText(const char *text, int fontSize, int x, int y);
+
+// Lay out a string horizontally centered on centerX
+TextLabel LayoutCenteredText(const char *text, int fontSize, int centerX, int y);
+
+void DrawTextLabel(const TextLabel *label, Color color);
+
+// Formatted value, only calls the formatter when value differs from last time
+const char *TextNumberGet(TextNumber *number, int value);
+
+// Bake the title centered on centerX with its baseline row at y, call outside BeginDrawing/EndDrawing
+void TitleCacheBake(TitleCache *title, int fontSize, int centerX, int y);
+void TitleCacheDraw(const TitleCache *title);
+void TitleCacheUnload(TitleCache *title);
+
+#endif // TEXT_H
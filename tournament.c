@@ -0,0 +1,222 @@
+#include "tournament.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+// One worker's block of match numbers, begin in the high half and end in the low
+// half of one word, so the owner taking a match and a thief splitting the block
+// are both a single compare-and-swap
+typedef struct TournamentWorker {
+    alignas(64) _Atomic uint64_t block;
+    const TournamentConfig *config;
+    struct TournamentWorker *workers;
+    int workerCount;
+    pthread_t thread;
+    TournamentPairing *pairings;      // This worker's share of the results, merged at the end
+    uint64_t steals;
+    uint64_t hash;
+} TournamentWorker;
+
+static const SimInput aiVsAi = { .left = { .ai = true }, .right = { .ai = true } };
+
+static uint64_t PackBlock(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+// splitmix64, turns consecutive match numbers into unrelated seeds
+static uint64_t MixSeed(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+TournamentEntrant TournamentPresetEntrant(Difficulty difficulty) {
+    static const char *names[] = { "easy", "medium", "hard" };
+    SimConfig config = SimDifficultyConfig(difficulty, 1280, 800);
+    TournamentEntrant entrant = { .skill = { config.aiSpeed, config.aiReaction, config.aiError } };
+    snprintf(entrant.name, sizeof(entrant.name), "%s", names[difficulty]);
+    return entrant;
+}
+
+// Next match from the front of the worker's own block
+static bool TakeMatch(TournamentWorker *worker, uint32_t *match) {
+    uint64_t block = atomic_load_explicit(&worker->block, memory_order_acquire);
+    for (;;) {
+        uint32_t begin = (uint32_t)(block >> 32), end = (uint32_t)block;
+        if (begin >= end) return false;
+        if (atomic_compare_exchange_weak_explicit(&worker->block, &block, PackBlock(begin + 1, end),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *match = begin;
+            return true;
+        }
+    }
+}
+
+// Move the back half of the biggest block left into the worker's own, false once every block is empty
+static bool StealMatches(TournamentWorker *worker) {
+    for (;;) {
+        TournamentWorker *victim = NULL;
+        uint64_t victimBlock = 0;
+        uint32_t most = 0;
+        for (int i = 0; i < worker->workerCount; i++) {
+            TournamentWorker *other = &worker->workers[i];
+            if (other == worker) continue;
+            uint64_t block = atomic_load_explicit(&other->block, memory_order_acquire);
+            uint32_t begin = (uint32_t)(block >> 32), end = (uint32_t)block;
+            if (begin < end && end - begin > most) {
+                victim = other;
+                victimBlock = block;
+                most = end - begin;
+            }
+        }
+        if (victim == NULL) return false;
+
+        // The owner keeps [begin, middle), a lone match goes to the thief
+        uint32_t begin = (uint32_t)(victimBlock >> 32), end = (uint32_t)victimBlock;
+        uint32_t middle = begin + (end - begin) / 2;
+        if (atomic_compare_exchange_strong_explicit(&victim->block, &victimBlock, PackBlock(begin, middle),
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            atomic_store_explicit(&worker->block, PackBlock(middle, end), memory_order_release);
+            worker->steals++;
+            return true;
+        }
+        // Lost the race to the owner or another thief, look again
+    }
+}
+
+static void PlayMatch(TournamentWorker *worker, uint32_t match) {
+    const TournamentConfig *config = worker->config;
+    TournamentPairing *pairing = &worker->pairings[match / config->matchesPerPairing];
+    bool swapped = (match % config->matchesPerPairing) % 2 == 1;
+    const TournamentEntrant *lava = &config->entrants[pairing->entrants[swapped ? 1 : 0]];
+    const TournamentEntrant *ice = &config->entrants[pairing->entrants[swapped ? 0 : 1]];
+
+    SimState state;
+    SimInit(&state, config->rules, MixSeed(config->seed ^ ((uint64_t)match << 1)));
+    state.leftAi.skill = lava->skill;
+    state.rightAi.skill = ice->skill;
+
+    uint32_t rally = 0;
+    while (state.winner == SIDE_NONE && state.tick < config->maxTicks) {
+        unsigned int events = SimStep(&state, aiVsAi);
+        if (events & SIM_EVENT_PADDLE_HIT) rally++;
+        if (events & (SIM_EVENT_LAVA_SCORED | SIM_EVENT_ICE_SCORED)) {
+            pairing->rallies[rally < TOURNAMENT_RALLY_BUCKETS ? rally : TOURNAMENT_RALLY_BUCKETS - 1]++;
+            pairing->paddleHits += rally;
+            pairing->points++;
+            rally = 0;
+        }
+    }
+
+    if (state.winner == SIDE_NONE) pairing->unfinished++;
+    else pairing->wins[((state.winner == SIDE_LAVA) != swapped) ? 0 : 1]++;
+    pairing->ticks += state.tick;
+    worker->hash += MixSeed(SimHash(&state) ^ match);   // A sum, so the order matches finish in doesn't matter
+}
+
+static void *WorkerThread(void *arg) {
+    TournamentWorker *worker = arg;
+    uint32_t match;
+    for (;;) {
+        while (TakeMatch(worker, &match)) PlayMatch(worker, match);
+        if (!StealMatches(worker)) break;
+    }
+    return NULL;
+}
+
+bool TournamentRun(const TournamentConfig *config, TournamentResult *result) {
+    memset(result, 0, sizeof(*result));
+    int entrants = config->entrantCount;
+    if (entrants < 1 || entrants > TOURNAMENT_MAX_ENTRANTS || config->matchesPerPairing == 0 ||
+        config->threads < 1 || config->threads > TOURNAMENT_MAX_THREADS) {
+        return false;
+    }
+    for (int a = 0; a < entrants; a++) {
+        for (int b = a; b < entrants; b++) {
+            result->pairings[result->pairingCount++] = (TournamentPairing){ .entrants = { a, b } };
+        }
+    }
+    uint64_t total = (uint64_t)result->pairingCount * config->matchesPerPairing;
+    if (total > UINT32_MAX) return false;
+
+    int count = config->threads;
+    TournamentWorker *workers = aligned_alloc(64, sizeof(TournamentWorker) * (size_t)count);
+    TournamentPairing *pairings = calloc((size_t)count * (size_t)result->pairingCount, sizeof(TournamentPairing));
+    bool ok = workers != NULL && pairings != NULL;
+
+    // Even blocks to start with. Pairings sit next to each other, so some blocks are
+    // all long rallies and others all short ones, and stealing evens that out.
+    int started = 0;
+    for (int i = 0; ok && i < count; i++) {
+        TournamentWorker *worker = &workers[i];
+        memset(worker, 0, sizeof(*worker));
+        worker->config = config;
+        worker->workers = workers;
+        worker->workerCount = count;
+        worker->pairings = &pairings[(size_t)i * result->pairingCount];
+        memcpy(worker->pairings, result->pairings, sizeof(TournamentPairing) * result->pairingCount);
+        atomic_init(&worker->block, PackBlock((uint32_t)(total * i / count), (uint32_t)(total * (i + 1) / count)));
+    }
+    for (int i = 0; ok && i < count; i++) {
+        ok = pthread_create(&workers[i].thread, NULL, WorkerThread, &workers[i]) == 0;
+        if (ok) started++;
+    }
+    if (!ok) {
+        // Empty every block so the threads that did start stop early
+        for (int i = 0; i < count && workers != NULL; i++) atomic_store(&workers[i].block, 0);
+    }
+    for (int i = 0; i < started; i++) pthread_join(workers[i].thread, NULL);
+
+    for (int i = 0; ok && i < count; i++) {
+        const TournamentWorker *worker = &workers[i];
+        for (int p = 0; p < result->pairingCount; p++) {
+            const TournamentPairing *from = &worker->pairings[p];
+            TournamentPairing *to = &result->pairings[p];
+            to->wins[0] += from->wins[0];
+            to->wins[1] += from->wins[1];
+            to->unfinished += from->unfinished;
+            to->ticks += from->ticks;
+            to->points += from->points;
+            to->paddleHits += from->paddleHits;
+            for (int r = 0; r < TOURNAMENT_RALLY_BUCKETS; r++) to->rallies[r] += from->rallies[r];
+            result->ticks += from->ticks;
+        }
+        result->steals += worker->steals;
+        result->hash += worker->hash;
+    }
+    result->matches = ok ? total : 0;
+    free(workers);
+    free(pairings);
+    return ok;
+}
+
+int TournamentRallyPercentile(const TournamentPairing *pairing, double percentile) {
+    uint64_t target = (uint64_t)(percentile * pairing->points);
+    uint64_t seen = 0;
+    for (int r = 0; r < TOURNAMENT_RALLY_BUCKETS; r++) {
+        seen += pairing->rallies[r];
+        if (seen > target) return r;
+    }
+    return TOURNAMENT_RALLY_BUCKETS - 1;
+}
+
+int TournamentCoreCount(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cores = (int)info.dwNumberOfProcessors;
+#else
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return cores > 0 ? cores : 1;
+}
@@ -0,0 +1,70 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Self-play tournament for tuning the difficulty presets. Every pair of entrants
+// (computer players with their own AiSkill, an entrant also plays itself) plays
+// a batch of matches under one set of rules, spread over worker threads.
+//
+// Matches are numbered and each worker starts with a block of numbers, taken
+// one at a time from the front. A worker that runs dry steals the back half of
+// the biggest block left, so a thread stuck with long rallies doesn't keep the
+// others waiting at the end. A match's seed comes from the tournament seed and
+// its number alone, so the results don't depend on the thread count or on who
+// stole what.
+
+#define TOURNAMENT_MAX_ENTRANTS 8
+#define TOURNAMENT_MAX_PAIRINGS (TOURNAMENT_MAX_ENTRANTS * (TOURNAMENT_MAX_ENTRANTS + 1) / 2)
+#define TOURNAMENT_MAX_THREADS 64
+#define TOURNAMENT_RALLY_BUCKETS 64   // Paddle hits per point, the last bucket catches longer rallies
+
+typedef struct TournamentEntrant {
+    char name[32];
+    AiSkill skill;
+} TournamentEntrant;
+
+typedef struct TournamentConfig {
+    SimConfig rules;                  // Field, ball and paddle size, the config's own AI skill is not used
+    TournamentEntrant entrants[TOURNAMENT_MAX_ENTRANTS];
+    int entrantCount;
+    uint32_t matchesPerPairing;       // Sides alternate, the first entrant is Lava in even matches
+    int threads;
+    uint64_t seed;
+    uint32_t maxTicks;                // Matches still going after this many steps count as unfinished
+} TournamentConfig;
+
+typedef struct TournamentPairing {
+    int entrants[2];
+    uint32_t wins[2];
+    uint32_t unfinished;
+    uint64_t ticks;
+    uint64_t points;
+    uint64_t paddleHits;              // Over every point played
+    uint64_t rallies[TOURNAMENT_RALLY_BUCKETS];
+} TournamentPairing;
+
+typedef struct TournamentResult {
+    TournamentPairing pairings[TOURNAMENT_MAX_PAIRINGS];
+    int pairingCount;
+    uint64_t matches;
+    uint64_t ticks;
+    uint64_t steals;                  // Blocks taken from another worker
+    uint64_t hash;                    // Of every final state, the same for any thread count
+} TournamentResult;
+
+// The computer player of a difficulty preset
+TournamentEntrant TournamentPresetEntrant(Difficulty difficulty);
+
+// Play every pairing, returns false if the config is out of range or a thread could not start
+bool TournamentRun(const TournamentConfig *config, TournamentResult *result);
+
+// Logical cores, at least 1
+int TournamentCoreCount(void);
+
+// Paddle hits per point at the given percentile (0 to 1)
+int TournamentRallyPercentile(const TournamentPairing *pairing, double percentile);
+
+#endif // TOURNAMENT_H
@@ -0,0 +1,315 @@
+#include "vecenv.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Every rule constant of a step, worked out once per call the way SimStep works it out
+typedef struct StepRules {
+    float dt, paddleSpeed, aiStep, halfPaddle, paddleHeight, height;
+    float paddleLowest;              // ClampPaddle's bottom stop
+    float wallTop, wallBottom, goalLeft, goalRight;
+    // Sweep bounds of the boxes grown by the ball radius, as SweepCircleRect computes them
+    float agentLeft, agentRight, opponentLeft, opponentRight, radius;
+    float blockLeft[SIM_MAX_OBSTACLES], blockRight[SIM_MAX_OBSTACLES];
+    float blockTop[SIM_MAX_OBSTACLES], blockBottom[SIM_MAX_OBSTACLES];
+    uint32_t maxTicks;
+} StepRules;
+
+static StepRules GetRules(const VecEnv *env) {
+    const SimState *layout = &env->layout;
+    const SimConfig *sim = &layout->config;
+    const float radius = sim->ballRadius;
+    StepRules rules;
+    rules.dt = 1.0f / sim->tickRate;
+    rules.paddleSpeed = sim->paddleSpeed;
+    rules.aiStep = layout->rightAi.skill.speed * rules.dt;
+    rules.halfPaddle = layout->rightPaddle.height / 2;
+    rules.paddleHeight = layout->leftPaddle.height;
+    rules.height = sim->height;
+    rules.paddleLowest = sim->height - layout->leftPaddle.height;
+    rules.wallTop = radius;
+    rules.wallBottom = sim->height - radius;
+    rules.goalLeft = radius;
+    rules.goalRight = sim->width - radius;
+    rules.radius = radius;
+    rules.agentLeft = layout->leftPaddle.x - radius;
+    rules.agentRight = layout->leftPaddle.x + layout->leftPaddle.width + radius;
+    rules.opponentLeft = layout->rightPaddle.x - radius;
+    rules.opponentRight = layout->rightPaddle.x + layout->rightPaddle.width + radius;
+    for (int b = 0; b < SIM_MAX_OBSTACLES; b++) {
+        const SimRect *box = &layout->obstacles[b];
+        rules.blockLeft[b] = box->x - radius;
+        rules.blockRight[b] = box->x + box->width + radius;
+        rules.blockTop[b] = box->y - radius;
+        rules.blockBottom[b] = box->y + box->height + radius;
+    }
+    rules.maxTicks = env->config.maxTicks;
+    return rules;
+}
+
+// splitmix64, one unrelated generator seed per env
+static uint64_t MixSeed(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t VecEnvSeed(uint64_t seed, int index) {
+    return MixSeed(seed + (uint64_t)index);
+}
+
+VecEnvConfig VecEnvDefaultConfig(Difficulty difficulty, int count) {
+    VecEnvConfig config = { 0 };
+    config.sim = SimDifficultyConfig(difficulty, 1280, 800);
+    config.count = count;
+    config.maxTicks = 120u * 600u;   // Ten minutes of play
+    return config;
+}
+
+void VecEnvGetState(const VecEnv *env, int index, SimState *state) {
+    *state = env->layout;
+    state->ballPosition = (SimVec2){ env->ballX[index], env->ballY[index] };
+    state->ballSpeed = (SimVec2){ env->ballSpeedX[index], env->ballSpeedY[index] };
+    state->leftPaddle.y = env->agentY[index];
+    state->rightPaddle.y = env->opponentY[index];
+    state->leftScore = env->agentScore[index];
+    state->rightScore = env->opponentScore[index];
+    state->winner = SIDE_NONE;
+    state->tick = env->tick[index];
+    state->rng = env->rng[index];
+
+    AiBrain *brain = &state->rightAi;
+    brain->targetY = env->targetY[index];
+    brain->pendingY = env->pendingY[index];
+    brain->aimError = env->aimError[index];
+    brain->reactTick = env->reactTick[index];
+    brain->seenSpeed = (SimVec2){ env->seenSpeedX[index], env->seenSpeedY[index] };
+    brain->seenScore = env->seenScore[index];
+}
+
+static void PutState(VecEnv *env, int index, const SimState *state) {
+    env->ballX[index] = state->ballPosition.x;
+    env->ballY[index] = state->ballPosition.y;
+    env->ballSpeedX[index] = state->ballSpeed.x;
+    env->ballSpeedY[index] = state->ballSpeed.y;
+    env->agentY[index] = state->leftPaddle.y;
+    env->opponentY[index] = state->rightPaddle.y;
+    env->agentScore[index] = state->leftScore;
+    env->opponentScore[index] = state->rightScore;
+    env->tick[index] = state->tick;
+    env->rng[index] = state->rng;
+
+    const AiBrain *brain = &state->rightAi;
+    env->targetY[index] = brain->targetY;
+    env->pendingY[index] = brain->pendingY;
+    env->aimError[index] = brain->aimError;
+    env->reactTick[index] = brain->reactTick;
+    env->seenSpeedX[index] = brain->seenSpeed.x;
+    env->seenSpeedY[index] = brain->seenSpeed.y;
+    env->seenScore[index] = brain->seenScore;
+}
+
+// Row-major copy of the state for the learner, a separate pass so the step loop only does contiguous stores
+static void WriteObservations(VecEnv *env) {
+    const SimConfig *sim = &env->layout.config;
+    const float toX = 1.0f / sim->width, toY = 1.0f / sim->height, toSpeed = 1.0f / sim->maxSpeed;
+    const float halfPaddle = env->layout.leftPaddle.height / 2;
+    float *restrict out = env->observations;
+    for (int i = 0; i < env->count; i++) {
+        float *row = out + (size_t)i * VECENV_OBSERVATIONS;
+        row[OBS_BALL_X] = env->ballX[i] * toX;
+        row[OBS_BALL_Y] = env->ballY[i] * toY;
+        row[OBS_BALL_SPEED_X] = env->ballSpeedX[i] * toSpeed;
+        row[OBS_BALL_SPEED_Y] = env->ballSpeedY[i] * toSpeed;
+        row[OBS_AGENT_Y] = (env->agentY[i] + halfPaddle) * toY;
+        row[OBS_OPPONENT_Y] = (env->opponentY[i] + halfPaddle) * toY;
+    }
+}
+
+// Round an array size up so the next array starts on a fresh cache line
+static size_t Aligned(size_t bytes) {
+    return (bytes + VECENV_ALIGN - 1) / VECENV_ALIGN * VECENV_ALIGN;
+}
+
+bool VecEnvInit(VecEnv *env, VecEnvConfig config, uint64_t seed) {
+    *env = (VecEnv){ 0 };
+    // The fast path knows the classic three blocks only
+    if (config.count <= 0 || config.sim.level != NULL) return false;
+    const size_t n = (size_t)config.count;
+    const size_t floats = Aligned(sizeof(float) * n);
+    const size_t words = Aligned(sizeof(uint32_t) * n);
+    const size_t longs = Aligned(sizeof(uint64_t) * n);
+    const size_t observations = Aligned(sizeof(float) * n * VECENV_OBSERVATIONS);
+    const size_t bytes = Aligned(n);
+    const size_t total = floats * 12 + words * 6 + longs + observations + bytes * 2;
+    env->block = aligned_alloc(VECENV_ALIGN, total);
+    if (env->block == NULL) return false;
+    memset(env->block, 0, total);
+
+    char *memory = (char *)env->block;
+    env->ballX = (float *)memory; memory += floats;
+    env->ballY = (float *)memory; memory += floats;
+    env->ballSpeedX = (float *)memory; memory += floats;
+    env->ballSpeedY = (float *)memory; memory += floats;
+    env->agentY = (float *)memory; memory += floats;
+    env->opponentY = (float *)memory; memory += floats;
+    env->targetY = (float *)memory; memory += floats;
+    env->pendingY = (float *)memory; memory += floats;
+    env->aimError = (float *)memory; memory += floats;
+    env->seenSpeedX = (float *)memory; memory += floats;
+    env->seenSpeedY = (float *)memory; memory += floats;
+    env->rewards = (float *)memory; memory += floats;
+    env->agentScore = (int32_t *)memory; memory += words;
+    env->opponentScore = (int32_t *)memory; memory += words;
+    env->tick = (uint32_t *)memory; memory += words;
+    env->reactTick = (uint32_t *)memory; memory += words;
+    env->seenScore = (int32_t *)memory; memory += words;
+    env->actions = (int32_t *)memory; memory += words;
+    env->rng = (uint64_t *)memory; memory += longs;
+    env->observations = (float *)memory; memory += observations;
+    env->dones = (uint8_t *)memory; memory += bytes;
+    env->full = (uint8_t *)memory;
+
+    env->config = config;
+    env->count = config.count;
+    SimInit(&env->layout, config.sim, 1);
+    for (int i = 0; i < env->count; i++) {
+        SimState state;
+        SimInit(&state, config.sim, VecEnvSeed(seed, i));
+        PutState(env, i, &state);
+    }
+    WriteObservations(env);
+    return true;
+}
+
+void VecEnvFree(VecEnv *env) {
+    free(env->block);
+    *env = (VecEnv){ 0 };
+}
+
+// fast ? next : old with bit masks. Written as a select, GCC sees that the old arm stores
+// back what was loaded, turns the store into a branch and then won't vectorize the loop.
+static inline float Keep(bool fast, float next, float old) {
+    uint32_t nextBits, oldBits, mask = 0u - (uint32_t)fast;
+    memcpy(&nextBits, &next, sizeof(nextBits));
+    memcpy(&oldBits, &old, sizeof(oldBits));
+    oldBits = (nextBits & mask) | (oldBits & ~mask);
+    memcpy(&old, &oldBits, sizeof(old));
+    return old;
+}
+
+// A SweepPlane call that reports no contact within the whole step
+static inline bool PlaneClear(float start, float motion, float limit, bool positive) {
+    // Division by a zero motion only feeds a lane the first test already settles
+    float time = (limit - start) / motion;
+    return positive ? (motion <= 0.0f) | ((start < limit) & (time > 1.0f))
+                    : (motion >= 0.0f) | ((start > limit) & (time > 1.0f));
+}
+
+// Steps where nothing happens: paddles move, the ball flies straight, the opponent keeps
+// its prediction. Every test mirrors a branch of SimStep, and the results are only
+// stored for matches that pass all of them, full marks the rest. The arrays come in as
+// restrict parameters: GCC ignores restrict on locals loaded from a struct, and without
+// it the alias checks it would need to vectorize are more than it is willing to emit.
+static void StepClear(const StepRules *rulesIn, int count, const int32_t *restrict actions,
+                      float *restrict ballX, float *restrict ballY, const float *restrict ballSpeedX,
+                      const float *restrict ballSpeedY, float *restrict agentY, float *restrict opponentY,
+                      const int32_t *restrict agentScore, const int32_t *restrict opponentScore,
+                      uint32_t *restrict tick, float *restrict targetY, const float *restrict pendingY,
+                      const uint32_t *restrict reactTick, const float *restrict seenSpeedX,
+                      const float *restrict seenSpeedY, const int32_t *restrict seenScore,
+                      float *restrict rewards, uint8_t *restrict dones, uint8_t *restrict full) {
+    const StepRules rules = *rulesIn;
+
+    for (int i = 0; i < count; i++) {
+        float vx = ballSpeedX[i], vy = ballSpeedY[i];
+        float x = ballX[i], y = ballY[i];
+        float agent = agentY[i], opponent = opponentY[i];
+        float oldTarget = targetY[i], pending = pendingY[i];
+        uint32_t oldTick = tick[i], ticks = oldTick + 1u;
+
+        // AiUpdate: a prediction made for this speed and score stands, the target
+        // switches to it once the reaction time is up
+        bool current = (vx == seenSpeedX[i]) & (vy == seenSpeedY[i]) &
+                       (agentScore[i] + opponentScore[i] == seenScore[i]);
+        float target = ticks >= reactTick[i] ? pending : oldTarget;
+
+        // MovePaddle and ClampPaddle. Every select below picks between two values only,
+        // nested ones keep GCC from vectorizing the loop.
+        int32_t action = actions[i];
+        action = action < -1 ? -1 : action;
+        action = action > 1 ? 1 : action;
+        float nextAgent = agent + (float)action * rules.paddleSpeed * rules.dt;
+        float aim = target - rules.halfPaddle;
+        float up = opponent + rules.aiStep, down = opponent - rules.aiStep;
+        up = up < aim ? up : aim;
+        down = down > aim ? down : aim;
+        float nextOpponent = opponent < aim ? up : down;
+        nextAgent = nextAgent < 0.0f ? 0.0f : nextAgent;
+        nextAgent = nextAgent + rules.paddleHeight > rules.height ? rules.paddleLowest : nextAgent;
+        nextOpponent = nextOpponent < 0.0f ? 0.0f : nextOpponent;
+        nextOpponent = nextOpponent + rules.paddleHeight > rules.height ? rules.paddleLowest : nextOpponent;
+
+        // MoveBall's first sweep: the early reject of SweepCircleRect for both paddles
+        // and the blocks, then the walls and goal lines
+        float motionX = vx * rules.dt, motionY = vy * rules.dt;
+        float endX = x + motionX, endY = y + motionY;
+        float lowX = x < endX ? x : endX, highX = x > endX ? x : endX;
+        float lowY = y < endY ? y : endY, highY = y > endY ? y : endY;
+        bool clear = (highX < rules.agentLeft) | (lowX > rules.agentRight) |
+                     (highY < nextAgent - rules.radius) | (lowY > nextAgent + rules.paddleHeight + rules.radius);
+        clear &= (highX < rules.opponentLeft) | (lowX > rules.opponentRight) |
+                 (highY < nextOpponent - rules.radius) | (lowY > nextOpponent + rules.paddleHeight + rules.radius);
+        for (int b = 0; b < SIM_MAX_OBSTACLES; b++) {
+            clear &= (highX < rules.blockLeft[b]) | (lowX > rules.blockRight[b]) |
+                     (highY < rules.blockTop[b]) | (lowY > rules.blockBottom[b]);
+        }
+        clear &= PlaneClear(y, motionY, rules.wallBottom, true) & PlaneClear(y, motionY, rules.wallTop, false);
+        clear &= PlaneClear(x, motionX, rules.goalRight, true) & PlaneClear(x, motionX, rules.goalLeft, false);
+
+        // No contact leaves the ball at the end of its motion (MoveBall adds a zero push on top)
+        bool fast = current & clear & (ticks < rules.maxTicks);
+        tick[i] = oldTick + (uint32_t)fast;
+        targetY[i] = Keep(fast, target, oldTarget);
+        agentY[i] = Keep(fast, nextAgent, agent);
+        opponentY[i] = Keep(fast, nextOpponent, opponent);
+        ballX[i] = Keep(fast, endX, x);
+        ballY[i] = Keep(fast, endY, y);
+        rewards[i] = 0.0f;
+        dones[i] = 0;
+        full[i] = fast ? 0 : 1;
+    }
+}
+
+// Everything else goes through SimStep itself
+static int StepFull(VecEnv *env) {
+    int stepped = 0;
+    for (int i = 0; i < env->count; i++) {
+        if (!env->full[i]) continue;
+        SimState state;
+        VecEnvGetState(env, i, &state);
+        SimInput input = { .right = { .ai = true } };
+        input.left.move = env->actions[i] < -1 ? -1 : (env->actions[i] > 1 ? 1 : env->actions[i]);
+        unsigned int events = SimStep(&state, input);
+        if (events & SIM_EVENT_LAVA_SCORED) env->rewards[i] = 1.0f;
+        if (events & SIM_EVENT_ICE_SCORED) env->rewards[i] = -1.0f;
+        if (state.winner != SIDE_NONE || state.tick >= env->config.maxTicks) {
+            SimInit(&state, env->config.sim, state.rng);
+            env->dones[i] = 1;
+        }
+        PutState(env, i, &state);
+        stepped++;
+    }
+    return stepped;
+}
+
+int VecEnvStep(VecEnv *env) {
+    const StepRules rules = GetRules(env);
+    StepClear(&rules, env->count, env->actions, env->ballX, env->ballY, env->ballSpeedX, env->ballSpeedY,
+              env->agentY, env->opponentY, env->agentScore, env->opponentScore, env->tick, env->targetY,
+              env->pendingY, env->reactTick, env->seenSpeedX, env->seenSpeedY, env->seenScore,
+              env->rewards, env->dones, env->full);
+    int stepped = StepFull(env);
+    WriteObservations(env);
+    return stepped;
+}
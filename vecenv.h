@@ -0,0 +1,102 @@
+#ifndef VECENV_H
+#define VECENV_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Vectorized environment for reinforcement learning: thousands of independent
+// matches kept as parallel arrays and advanced together by one VecEnvStep call.
+// The rules are the real ones: each match steps exactly like SimStep with the
+// agent's move on the left paddle and the computer (AiUpdate) on the right, on
+// the classic field with the three center blocks.
+//
+// Most steps the ball touches nothing and the opponent only steers towards a
+// prediction it already has. Those steps take a branch-free pass over the arrays
+// that the compiler turns into SIMD code (build with -O3 -fno-trapping-math, add
+// -march=native for AVX2). The pass uses SweepCircleRect's own early reject, so
+// it only claims a step when SimStep would find no contact either. Every other
+// match, a bounce, a goal, a fresh prediction or a restart, is copied into a
+// SimState, stepped with SimStep and copied back. Both paths give the state
+// SimStep gives, bit for bit.
+//
+// A match that ends, or runs past maxTicks, starts over on the same step, seeded
+// from where its random generator stood.
+//
+// actions, observations, rewards and dones live in one aligned block owned by the
+// env and keep their address for its whole life, so a learner can wrap them once
+// (numpy.frombuffer, torch.from_blob) and never copy.
+
+#define VECENV_OBSERVATIONS 6        // Floats per env, see VecEnvObservation
+#define VECENV_ALIGN 64
+
+// Index of each feature within an env's observation row
+typedef enum VecEnvObservation {
+    OBS_BALL_X,                      // 0 left edge to 1 right edge
+    OBS_BALL_Y,                      // 0 top to 1 bottom
+    OBS_BALL_SPEED_X,                // In units of maxSpeed
+    OBS_BALL_SPEED_Y,
+    OBS_AGENT_Y,                     // Paddle centers, 0 top to 1 bottom
+    OBS_OPPONENT_Y
+} VecEnvObservation;
+
+typedef struct VecEnvConfig {
+    SimConfig sim;                   // Field, speeds and paddle size from a difficulty preset, no level
+    int count;                       // Matches stepped together
+    uint32_t maxTicks;               // Steps before a match is cut off and restarted
+} VecEnvConfig;
+
+typedef struct VecEnv {
+    VecEnvConfig config;
+    int count;
+    SimState layout;                 // Config, paddle and block placement shared by every match
+
+    // Match state, one entry per env: the parts of a SimState that change during play
+    float *ballX;
+    float *ballY;
+    float *ballSpeedX;               // Pixels per second
+    float *ballSpeedY;
+    float *agentY;                   // Paddle top edges
+    float *opponentY;
+    int32_t *agentScore;
+    int32_t *opponentScore;
+    uint32_t *tick;
+    uint64_t *rng;
+
+    // The opponent's AiBrain
+    float *targetY;
+    float *pendingY;
+    float *aimError;
+    uint32_t *reactTick;
+    float *seenSpeedX;
+    float *seenSpeedY;
+    int32_t *seenScore;
+
+    // Learner buffers
+    int32_t *actions;                // Set by the caller before each step: -1 up, 0 stay, 1 down, as SimPaddleInput.move
+    float *observations;             // count rows of VECENV_OBSERVATIONS, filled by every step and by VecEnvInit
+    float *rewards;                  // +1 the agent scored this step, -1 it conceded, 0 otherwise
+    uint8_t *dones;                  // 1 if the match ended this step and was restarted
+
+    uint8_t *full;                   // Matches the last step sent through SimStep
+    void *block;                     // Single allocation backing every array above
+} VecEnv;
+
+// Defaults for a difficulty preset on a 1280x800 field
+VecEnvConfig VecEnvDefaultConfig(Difficulty difficulty, int count);
+
+// Serve every match, returns false if memory runs out or the config has a level
+bool VecEnvInit(VecEnv *env, VecEnvConfig config, uint64_t seed);
+void VecEnvFree(VecEnv *env);
+
+// Seed VecEnvInit gives match index
+uint64_t VecEnvSeed(uint64_t seed, int index);
+
+// Advance every match by one step with the current actions (the step_batch of the API).
+// Returns how many matches needed the full SimStep.
+int VecEnvStep(VecEnv *env);
+
+// One match as a SimState, to compare with SimStep or draw it
+void VecEnvGetState(const VecEnv *env, int index, SimState *state);
+
+#endif // VECENV_H
@@ -0,0 +1,78 @@
+#include "world.h"
+#include "level.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void WorldInit(World *world) {
+    memset(world, 0, sizeof(*world));
+    world->magic = WORLD_MAGIC;
+    world->version = WORLD_VERSION;
+    world->size = sizeof(World);
+    world->screen = MENU;
+    world->mode = PVP;
+    world->difficulty = EASY;
+}
+
+void WorldSnapshot(const World *world, World *snapshot) {
+    const Level *level = world->sim.config.level;
+    *snapshot = *world;
+    snapshot->levelHash = (level != NULL) ? level->hash : 0;
+    snapshot->sim.config.level = NULL;
+    snapshot->previousSim.config.level = NULL;
+}
+
+// Header, enums, and match states and a clock that can be stepped safely: a corrupt
+// obstacle count or tick rate would otherwise reach SimStep straight from the file
+static bool SnapshotValid(const World *snapshot) {
+    if (snapshot->magic != WORLD_MAGIC || snapshot->version != WORLD_VERSION || snapshot->size != sizeof(World)) return false;
+    if ((unsigned)snapshot->screen > GAME_OVER || (unsigned)snapshot->mode > ARENA || (unsigned)snapshot->difficulty > HARD) return false;
+    if ((unsigned)snapshot->modeSelection > 2 || (unsigned)snapshot->difficultySelection > 2) return false;
+    if (!SimStateValid(&snapshot->sim) || !SimStateValid(&snapshot->previousSim)) return false;
+    // Up to a million steps a second, and less than a step waiting, so a frame's step count fits an int
+    const SimClock *clock = &snapshot->clock;
+    if (!isfinite(clock->tickSeconds) || clock->tickSeconds < 1e-6 || !isfinite(clock->droppedSeconds) ||
+        !(clock->accumulator >= 0.0 && clock->accumulator < clock->tickSeconds)) return false;
+    for (int i = 0; i < WORLD_STARS; i++) {
+        if (!isfinite(snapshot->stars[i].x) || !isfinite(snapshot->stars[i].y)) return false;
+    }
+    // The arena lives outside the world, so there is no arena match to go back to
+    return !(snapshot->mode == ARENA && (snapshot->screen == PLAYING || snapshot->screen == GAME_OVER));
+}
+
+bool WorldRestore(World *world, const World *snapshot, const Level *level) {
+    if (!SnapshotValid(snapshot)) return false;
+    if (snapshot->levelHash != 0 && (level == NULL || level->hash != snapshot->levelHash)) return false;
+    *world = *snapshot;
+    world->levelHash = 0;
+    world->sim.config.level = (snapshot->levelHash != 0) ? level : NULL;
+    world->previousSim.config.level = world->sim.config.level;
+    return true;
+}
+
+// Written next to path and renamed over it, so a crash mid-write leaves the last good save
+bool WorldSave(const World *snapshot, const char *path) {
+    char temporary[4096];
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) return false;
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL) return false;
+    bool ok = fwrite(snapshot, sizeof(*snapshot), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+#if defined(_WIN32)
+    if (ok) remove(path);   // rename does not replace files there
+#endif
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok) remove(temporary);
+    return ok;
+}
+
+bool WorldLoad(World *snapshot, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    bool ok = fread(snapshot, sizeof(*snapshot), 1, file) == 1 && SnapshotValid(snapshot);
+    fclose(file);
+    // The level pointer was only valid in the process that saved, WorldRestore links it again
+    snapshot->sim.config.level = NULL;
+    snapshot->previousSim.config.level = NULL;
+    return ok;
+}
@@ -0,0 +1,75 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Everything that decides where the game is, kept in one flat block: the screen,
+// the menu selections, the local match with its clock and the background stars. A snapshot is a copy
+// of the block, so saving and restoring cost about a microsecond, which is what
+// quick-save, instant rematch and kiosk crash recovery need.
+//
+// The only pointer inside is the match's level. Snapshots store it as NULL plus
+// the level hash, the way replays do, and restoring links it again. Particles and
+// raindrops are not part of it: the default particle pool is 3.5 MB, which would
+// turn a snapshot from a 2 KB copy into one taking about a millisecond. They are
+// cosmetic and restart empty. The online and arena matches keep their state in
+// the rollback session and the arena and can't be snapshotted.
+//
+// Snapshot files are the raw block. The header (magic, version, size) rejects
+// files from another build instead of reading them wrong, and the match states
+// are checked like replay keyframes before anything steps them.
+
+#define WORLD_MAGIC 0x444C5257u    // "WRLD"
+#define WORLD_VERSION 2
+#define WORLD_STARS 200
+
+typedef struct Level Level;
+
+// Enum for game states
+typedef enum GameState {
+    MENU,
+    MODE_SELECT,
+    DIFFICULTY_SELECT,
+    PLAYING,
+    GAME_OVER
+} GameState;
+
+// Enum for game modes
+typedef enum GameMode {
+    PVP,  // Player vs Player
+    PVC,  // Player vs Computer
+    ARENA // Party mode: two players against thousands of balls (see arena.c)
+} GameMode;
+
+typedef struct World {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                 // sizeof(World), catches a mismatched build
+    uint64_t levelHash;            // Level.hash of sim's level, 0 for the classic layout (snapshots only)
+    GameState screen;
+    GameMode mode;
+    Difficulty difficulty;
+    int modeSelection;             // 0: PvP, 1: PvAI, 2: Arena
+    int difficultySelection;       // 0: Easy, 1: Medium, 2: Hard
+    SimState sim;                  // Match state: ball, paddles, obstacles and scores
+    SimState previousSim;          // State one step back, for render interpolation
+    SimClock clock;
+    SimVec2 stars[WORLD_STARS];    // Background stars, scattered once at startup
+} World;
+
+// Empty world on the main menu, sim still has to be set up
+void WorldInit(World *world);
+
+// Copy the world into a snapshot, with the level pointer swapped for its hash
+void WorldSnapshot(const World *world, World *snapshot);
+
+// Put a snapshot back. level is the level loaded in this process, NULL for none. Returns
+// false (and changes nothing) if the snapshot is from another build or needs another level.
+bool WorldRestore(World *world, const World *snapshot, const Level *level);
+
+bool WorldSave(const World *snapshot, const char *path);
+bool WorldLoad(World *snapshot, const char *path);
+
+#endif // WORLD_H